@@ -102,6 +102,9 @@ int main(int argc, char* argv[]) {
     parser.addArgument( // optional
         "multi-thresholds", "t", mitkCommandLineParser::Bool,
         "Multiple thresholds", "Produce the output for the scar score using multiple thresholds:\n\t  (mean+V*stdev) V = 1, 2, 2.3, 3.3, 4 and 5\n\t (V*IIR) V = 0.86,0.97, 1.16, 1.2 and 1.32");
+    parser.addArgument( // optional
+        "histogram", "g", mitkCommandLineParser::Bool,
+        "Scalar histogram", "Write the fixed-bin and quantile-bin histogram of the shell scalars with the threshold versus percentage curve (CSV)");
     parser.addArgument( // optional
         "verbose", "v", mitkCommandLineParser::Bool,
         "Verbose Output", "Whether to produce verbose output");
@@ -129,6 +132,7 @@ int main(int argc, char* argv[]) {
     std::string segref = "segmentation.vtk";
     auto verbose = false;
     auto multithreshold = false;
+    auto histogram = false;
 
     // Parse, cast and set optional arguments
     if (parsedArgs.end() != parsedArgs.find("verbose")) {
@@ -140,6 +144,9 @@ int main(int argc, char* argv[]) {
     if (parsedArgs.end() != parsedArgs.find("multi-thresholds")) {
         multithreshold = us::any_cast<bool>(parsedArgs["multi-thresholds"]);
     }
+    if (parsedArgs.end() != parsedArgs.find("histogram")) {
+        histogram = us::any_cast<bool>(parsedArgs["histogram"]);
+    }
 
 
     try {
@@ -219,12 +226,19 @@ int main(int argc, char* argv[]) {
         mitk::CastToItkImage(mitk::IOUtil::Load<mitk::Image>(lgePath.toStdString()), lgeFloat);
 
         double mean = 0.0, stdv = 0.0;
-        scar->CalculateMeanStd(mitk::ImportItkImage(lgeFloat), roiImage, mean, stdv);
+        if (!scar->CalculateMeanStd(mitk::ImportItkImage(lgeFloat), roiImage, mean, stdv)) {
+            MITK_ERROR << "Could not calculate the mean and std of the blood pool ROI.";
+            return EXIT_FAILURE;
+        }//_if
 
         MITK_INFO(verbose) << "Performing Scar projection using " + segvtk.toStdString();
 
         QString prodPath = direct + "/";
         mitk::Surface::Pointer scarShell = scar->Scar3D(direct.toStdString(), mitk::ImportItkImage(lgeITK));
+        if (scarShell.IsNull()) {
+            MITK_ERROR << "Scar projection failed.";
+            return EXIT_FAILURE;
+        }//_if
 
         MITK_INFO(verbose) << "Saving new scar map to " + outname.toStdString();
 
@@ -276,28 +290,34 @@ int main(int argc, char* argv[]) {
         if (multithreshold) {
             MITK_INFO << "Scores for multiple thresholds.";
             prodFile1 << "MULTIPLE SCORES:" << std::endl;
+            std::vector<double> manyvalues, manythres;
             if (method == 2) {
-                double manyvalues[6] = {1, 2, 2.3, 3.3, 4, 5};
-                for (int i = 0; i < 6; i++) {
-                    double thisthres = mean + manyvalues[i] * stdv;
-                    double thispercentage = scar->Thresholding(thisthres);
-                    prodFile1 << "V = " << manyvalues[i] <<
-                        ", SCORE:" << thispercentage << "%" << std::endl;
-                }
+                manyvalues = {1, 2, 2.3, 3.3, 4, 5};
+                for (unsigned int i = 0; i < manyvalues.size(); i++)
+                    manythres.push_back(mean + manyvalues[i] * stdv);
             } // mean + V*stdv
             else {
-                double manyvalues[5] = {0.86, 0.97, 1.16, 1.2, 1.32};
-                for (int i = 0; i < 5; i++) {
-                    double thisthres = mean * manyvalues[i];
-                    double thispercentage = scar->Thresholding(thisthres);
-                    prodFile1 << "V = " << manyvalues[i] <<
-                        ", SCORE:" << thispercentage << "%" << std::endl;
-                }
+                manyvalues = {0.86, 0.97, 1.16, 1.2, 1.32};
+                for (unsigned int i = 0; i < manyvalues.size(); i++)
+                    manythres.push_back(mean * manyvalues[i]);
             } // V*IIR
+
+            std::vector<double> manypercentages = scar->ThresholdingCurve(manythres);
+            for (unsigned int i = 0; i < manyvalues.size(); i++) {
+                prodFile1 << "V = " << manyvalues[i] <<
+                    ", SCORE:" << manypercentages[i] << "%" << std::endl;
+            }
         }
 
         prodFile1.close();
 
+        if (histogram) {
+            QString histfile = prodPath + fi2.baseName() + "_histogram.csv";
+            MITK_INFO(verbose) << "Writing scalar histogram to " + histfile.toStdString();
+            if (!scar->SaveHistogramCsv(histfile))
+                return EXIT_FAILURE;
+        }
+
         MITK_INFO << "Saving debug scar map labels.";
         scar->SaveScarDebugImage("Max", direct);
 
@@ -0,0 +1,293 @@
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+CEMRG GAP MEASUREMENT BATCH
+Headless F&I T2 (measurement of ablation gaps) over many cases. Each line
+of the manifest names a case, its scar shell, the fill threshold and the
+point ids picked around the vein:
+
+    # case  mesh                    threshold  point ids
+    p01_left  p01/MaxScar.vtk       1.2        1043 2210 3318 4127 5051
+
+Tokens are separated by spaces, tabs or commas and relative mesh paths are
+taken from the manifest folder. Case names must be unique, they name the
+output files of each case (see test/Data/GapMeasurement/manifest.txt for a
+sample). Cases run in parallel, one CemrgScarAdvanced per case, and the
+measurements are collected in a single CSV table.
+=========================================================================*/
+
+// Qmitk
+#include <mitkCommandLineParser.h>
+#include <mitkLogMacros.h>
+
+// VTK
+#include <vtkSmartPointer.h>
+#include <vtkPolyData.h>
+#include <vtkPointData.h>
+#include <vtkFloatArray.h>
+#include <vtkPolyDataReader.h>
+#include <vtkXMLPolyDataReader.h>
+
+// Qt
+#include <QString>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+
+// C++ Standard
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <vector>
+
+// CemrgApp
+#include <CemrgCommonUtils.h>
+#include <CemrgGapManifest.h>
+#include <CemrgScarAdvanced.h>
+
+typedef CemrgGapManifest::GapCase GapCase;
+
+vtkSmartPointer<vtkPolyData> ReadShell(QString path) {
+
+    vtkSmartPointer<vtkPolyData> pd;
+    if (path.endsWith(".vtp", Qt::CaseInsensitive)) {
+        vtkSmartPointer<vtkXMLPolyDataReader> reader = vtkSmartPointer<vtkXMLPolyDataReader>::New();
+        reader->SetFileName(path.toStdString().c_str());
+        reader->Update();
+        pd = reader->GetOutput();
+    } else {
+        vtkSmartPointer<vtkPolyDataReader> reader = vtkSmartPointer<vtkPolyDataReader>::New();
+        reader->SetFileName(path.toStdString().c_str());
+        reader->Update();
+        pd = reader->GetOutput();
+    }//_if
+    return pd;
+}
+
+void MeasureCase(GapCase& gc, QString outDir, int neighbourhood, double maxScalar, bool weighted, bool closeLoop, bool vtp, bool meshes) {
+
+    vtkSmartPointer<vtkPolyData> pd = ReadShell(gc.mesh);
+    vtkDataArray* scalars = (pd != NULL) ? pd->GetPointData()->GetScalars() : NULL;
+    if (pd == NULL || pd->GetNumberOfPoints() == 0 || scalars == NULL) {
+        MITK_WARN << ("Case " + gc.name + ": no point scalars in " + gc.mesh).toStdString();
+        gc.status = "no_mesh";
+        return;
+    }//_if
+    gc.numberOfPoints = pd->GetNumberOfPoints();
+
+    for (int id : gc.points) {
+        if (id < 0 || id >= gc.numberOfPoints) {
+            MITK_WARN << ("Case " + gc.name + ": point id " + QString::number(id) + " is not on the mesh").toStdString();
+            gc.status = "bad_point";
+            return;
+        }//_if
+    }//_for
+
+    // The corridor extraction reads the shell scalars as floats
+    if (vtkFloatArray::SafeDownCast(scalars) == NULL) {
+        vtkSmartPointer<vtkFloatArray> floatScalars = vtkSmartPointer<vtkFloatArray>::New();
+        floatScalars->DeepCopy(scalars);
+        floatScalars->SetName(scalars->GetName());
+        pd->GetPointData()->SetScalars(floatScalars);
+    }//_if
+
+    QString csvPath = outDir + gc.name + "_encirclement.csv";
+    QFile::remove(csvPath);
+
+    CemrgScarAdvanced csadv;
+    csadv.SetOutputPath(outDir.toStdString());
+    csadv.SetOutputPrefix((gc.name + "_").toStdString());
+    csadv.SetOutputFileName(csvPath.toStdString());
+    csadv.SetInputData(pd);
+    csadv.SetFillThreshold(gc.threshold);
+    csadv.SetMaxScalar(maxScalar);
+    csadv.SetNeighbourhoodSize(neighbourhood);
+    csadv.SetWeightedCorridorBool(weighted);
+    csadv.SetCorridorVtpBool(vtp);
+    csadv.SetCorridorMeshesBool(meshes);
+    csadv.CorridorFromPointList(gc.points, closeLoop);
+
+    gc.percentage = csadv.fi2_percentage;
+    gc.connectedAreas = csadv.fi2_connectedAreasTotal;
+    gc.largestArea = csadv.fi2_largestSurfaceArea;
+    gc.corridorArea = csadv.fi2_corridorSurfaceArea;
+    gc.status = "ok";
+}
+
+int main(int argc, char* argv[]) {
+    mitkCommandLineParser parser;
+
+    // Set general information about your command-line app
+    parser.setCategory("Post processing");
+    parser.setTitle("Gap Measurement Batch Command-line App");
+    parser.setContributor("CEMRG, KCL");
+    parser.setDescription(
+        "Measure ablation gaps (F&I T2) for every case of a manifest and write one results table.");
+
+    // How should arguments be prefixed
+    parser.setArgumentPrefix("--", "-");
+
+    // Add arguments. Unless specified otherwise, each argument is optional.
+    // See mitkCommandLineParser::addArgument() for more information.
+    parser.addArgument(
+        "manifest", "i", mitkCommandLineParser::InputFile,
+        "Manifest", "Text file with one case per line: name, mesh, threshold and point ids.",
+        us::Any(), false);
+    parser.addArgument(
+        "output", "o", mitkCommandLineParser::OutputFile,
+        "Results table", "CSV file with the measurements of every case.",
+        us::Any(), false);
+    parser.addArgument( // optional
+        "output-dir", "d", mitkCommandLineParser::String,
+        "Output directory", "Where the corridor files of each case are saved (default: folder of the results table).");
+    parser.addArgument( // optional
+        "neighbourhood", "n", mitkCommandLineParser::Int,
+        "Neighbourhood size", "Rings of neighbours around the path that make the corridor (default: 3).");
+    parser.addArgument( // optional
+        "max-scalar", "m", mitkCommandLineParser::Float,
+        "Maximum scalar", "Upper end of the scar range used for the connected areas (default: 200).");
+    parser.addArgument( // optional
+        "unweighted", "u", mitkCommandLineParser::Bool,
+        "Unweighted corridor", "Use edge lengths only for the shortest paths instead of scalar weighted ones.");
+    parser.addArgument( // optional
+        "open-path", "p", mitkCommandLineParser::Bool,
+        "Open path", "Do not join the last picked point back to the first one.");
+    parser.addArgument( // optional
+        "vtp", "x", mitkCommandLineParser::Bool,
+        "Binary corridor output", "Save the corridor arrays of each case in a single binary .vtp.");
+    parser.addArgument( // optional
+        "no-meshes", "k", mitkCommandLineParser::Bool,
+        "Measurements only", "Do not save the corridor meshes of each case, only the tables.");
+    parser.addArgument( // optional
+        "threads", "t", mitkCommandLineParser::Int,
+        "Threads", "Number of cases measured at the same time (default: all cores).");
+    parser.addArgument( // optional
+        "verbose", "v", mitkCommandLineParser::Bool,
+        "Verbose Output", "Whether to produce verbose output");
+
+    // Parse arguments.
+    // This method returns a mapping of long argument names to their values.
+    auto parsedArgs = parser.parseArguments(argc, argv);
+
+    if (parsedArgs.empty())
+        return EXIT_FAILURE;
+
+    if (parsedArgs["manifest"].Empty() ||
+        parsedArgs["output"].Empty()) {
+        MITK_INFO << parser.helpText();
+        return EXIT_FAILURE;
+    }
+
+    // Parse, cast and set required arguments
+    auto manifestFilename = us::any_cast<std::string>(parsedArgs["manifest"]);
+    auto outFilename = us::any_cast<std::string>(parsedArgs["output"]);
+
+    // Default values for optional arguments
+    std::string outDirname = "";
+    int neighbourhood = 3;
+    double maxScalar = 200;
+    auto weighted = true;
+    auto closeLoop = true;
+    auto vtp = false;
+    auto meshes = true;
+    int numThreads = 0;
+    auto verbose = false;
+
+    // Parse, cast and set optional arguments
+    if (parsedArgs.end() != parsedArgs.find("output-dir")) {
+        outDirname = us::any_cast<std::string>(parsedArgs["output-dir"]);
+    }
+    if (parsedArgs.end() != parsedArgs.find("neighbourhood")) {
+        neighbourhood = us::any_cast<int>(parsedArgs["neighbourhood"]);
+    }
+    if (parsedArgs.end() != parsedArgs.find("max-scalar")) {
+        maxScalar = us::any_cast<float>(parsedArgs["max-scalar"]);
+    }
+    if (parsedArgs.end() != parsedArgs.find("unweighted")) {
+        weighted = !us::any_cast<bool>(parsedArgs["unweighted"]);
+    }
+    if (parsedArgs.end() != parsedArgs.find("open-path")) {
+        closeLoop = !us::any_cast<bool>(parsedArgs["open-path"]);
+    }
+    if (parsedArgs.end() != parsedArgs.find("vtp")) {
+        vtp = us::any_cast<bool>(parsedArgs["vtp"]);
+    }
+    if (parsedArgs.end() != parsedArgs.find("no-meshes")) {
+        meshes = !us::any_cast<bool>(parsedArgs["no-meshes"]);
+    }
+    if (parsedArgs.end() != parsedArgs.find("threads")) {
+        numThreads = us::any_cast<int>(parsedArgs["threads"]);
+    }
+    if (parsedArgs.end() != parsedArgs.find("verbose")) {
+        verbose = us::any_cast<bool>(parsedArgs["verbose"]);
+    }
+
+    try {
+        MITK_INFO(verbose) << "Verbose mode ON.";
+
+        QString outname = QString::fromStdString(outFilename);
+        if (!outname.endsWith(".csv", Qt::CaseInsensitive))
+            outname = outname + ".csv";
+
+        QString outDir = outDirname.empty() ? QFileInfo(outname).absolutePath() : QString::fromStdString(outDirname);
+        if (!QDir().mkpath(outDir)) {
+            MITK_ERROR << ("Could not create output directory " + outDir).toStdString();
+            return EXIT_FAILURE;
+        }//_if
+        outDir = QDir(outDir).absolutePath() + "/";
+
+        std::vector<GapCase> cases;
+        if (!CemrgGapManifest::Read(QString::fromStdString(manifestFilename), cases))
+            return EXIT_FAILURE;
+
+        int threads = std::min<int>(CemrgCommonUtils::GetNumberOfThreads(numThreads), std::max<int>(cases.size(), 1));
+        MITK_INFO << ("Measuring " + QString::number(cases.size()) + " cases on " + QString::number(threads) + " threads").toStdString();
+
+        // Cases differ a lot in size, so each thread takes the next unclaimed case
+        std::atomic<size_t> nextCase(0);
+        CemrgCommonUtils::ParallelFor(0, threads, [&](vtkIdType, vtkIdType) {
+            for (size_t c = nextCase++; c < cases.size(); c = nextCase++) {
+                MITK_INFO(verbose) << ("Case " + cases[c].name + ": " + cases[c].mesh).toStdString();
+                try {
+                    MeasureCase(cases[c], outDir, neighbourhood, maxScalar, weighted, closeLoop, vtp, meshes);
+                } catch (const std::exception& e) {
+                    MITK_ERROR << ("Case " + cases[c].name + ": ").toStdString() << e.what();
+                    cases[c].status = "error";
+                }//_try
+            }//_for
+        }, threads);
+
+        int failed = 0;
+        for (const GapCase& gc : cases)
+            if (gc.status != "ok") failed++;
+
+        MITK_INFO(verbose) << "Writing results table to " + outname.toStdString();
+        if (!CemrgGapManifest::WriteResults(outname, cases, neighbourhood))
+            return EXIT_FAILURE;
+
+        if (failed > 0)
+            MITK_WARN << failed << " of " << cases.size() << " cases could not be measured, see the status column.";
+
+        MITK_INFO(verbose) << "Goodbye!";
+    } catch (const std::exception &e) {
+        MITK_ERROR << e.what();
+        return EXIT_FAILURE;
+    } catch (...) {
+        MITK_ERROR << "Unexpected error";
+        return EXIT_FAILURE;
+    }
+}
@@ -0,0 +1,209 @@
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+CEMRG MESH SEQUENCE CONVERT
+Packs the motion-tracked meshes of a case folder (transformed-0.vtk,
+transformed-1.vtk, ...) into a single binary mesh sequence file
+(transformed.cms) next to them. CemrgStrains and the 4D mesh of the motion
+tracking view use that file instead of the VTK frames when it is there.
+With --recursive every subfolder holding a transformed-0.vtk is converted.
+The VTK frames are left untouched.
+=========================================================================*/
+
+// Qmitk
+#include <mitkCommandLineParser.h>
+#include <mitkLogMacros.h>
+
+// Qt
+#include <QString>
+#include <QStringList>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QDirIterator>
+
+// C++ Standard
+#include <string>
+
+// CemrgApp
+#include <CemrgMeshSequence.h>
+
+QStringList CaseFolders(QString input, bool recursive) {
+
+    QStringList folders;
+    if (QFileInfo::exists(input + "/transformed-0.vtk"))
+        folders << input;
+
+    if (recursive) {
+        QDirIterator it(input, QDir::Dirs | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+        while (it.hasNext()) {
+            QString folder = it.next();
+            if (QFileInfo::exists(folder + "/transformed-0.vtk"))
+                folders << folder;
+        }//_while
+    }//_if
+    return folders;
+}
+
+bool ConvertFolder(QString folder, int numFrames, bool delta, bool force, int numThreads, bool verbose) {
+
+    QString path = folder + "/" + CemrgMeshSequence::SequenceFileName();
+    if (QFileInfo::exists(path)) {
+        if (!force) {
+            MITK_INFO << ("Skipping " + folder + ", it already has a mesh sequence (use --force)").toStdString();
+            return true;
+        }//_if
+        QFile::remove(path);
+    }//_if
+
+    // Count the frames when not given
+    if (numFrames <= 0) {
+        numFrames = 0;
+        while (QFileInfo::exists(folder + "/transformed-" + QString::number(numFrames) + ".vtk"))
+            numFrames++;
+    }//_if
+
+    CemrgMeshSequence sequence;
+    sequence.SetDirectory(folder);
+    if (!sequence.LoadFrames(0, numFrames, numThreads)) {
+        MITK_ERROR << ("Could not read all " + QString::number(numFrames) + " frames of " + folder).toStdString();
+        return false;
+    }//_if
+    if (!sequence.Save(path, delta))
+        return false;
+    if (sequence.FramesHaveArrays())
+        MITK_WARN << ("The frames of " + folder + " carry point or cell arrays the mesh sequence doesn't keep, the 4D mesh will read the VTK frames").toStdString();
+
+    qint64 vtkBytes = 0;
+    for (int i = 0; i < numFrames; i++)
+        vtkBytes += QFileInfo(sequence.GetFramePath(i)).size();
+    MITK_INFO(verbose) << ("Converted " + QString::number(numFrames) + " frames of " + folder + ": " +
+        QString::number(vtkBytes) + " bytes of VTK to " + QString::number(QFileInfo(path).size()) + " bytes").toStdString();
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    mitkCommandLineParser parser;
+
+    // Set general information about your command-line app
+    parser.setCategory("Pre processing");
+    parser.setTitle("Mesh Sequence Convert Command-line App");
+    parser.setContributor("CEMRG, KCL");
+    parser.setDescription(
+        "Pack the transformed-N.vtk frames of motion tracking cases into one binary mesh sequence file per case.");
+
+    // How should arguments be prefixed
+    parser.setArgumentPrefix("--", "-");
+
+    // Add arguments. Unless specified otherwise, each argument is optional.
+    // See mitkCommandLineParser::addArgument() for more information.
+    parser.addArgument(
+        "input", "i", mitkCommandLineParser::InputDirectory,
+        "Case folder", "Folder with the transformed-N.vtk frames, or the root of many cases with --recursive.",
+        us::Any(), false);
+    parser.addArgument( // optional
+        "frames", "n", mitkCommandLineParser::Int,
+        "Number of frames", "Frames to pack (default: every consecutive transformed-N.vtk from 0).");
+    parser.addArgument( // optional
+        "delta", "d", mitkCommandLineParser::Bool,
+        "Delta encoding", "Store the frames after the first as offsets from the first one.");
+    parser.addArgument( // optional
+        "recursive", "r", mitkCommandLineParser::Bool,
+        "Recursive", "Convert every subfolder holding a transformed-0.vtk.");
+    parser.addArgument( // optional
+        "force", "f", mitkCommandLineParser::Bool,
+        "Force", "Rewrite sequence files that already exist.");
+    parser.addArgument( // optional
+        "threads", "t", mitkCommandLineParser::Int,
+        "Threads", "Number of frames read at the same time (default: all cores).");
+    parser.addArgument( // optional
+        "verbose", "v", mitkCommandLineParser::Bool,
+        "Verbose Output", "Whether to produce verbose output");
+
+    // Parse arguments.
+    // This method returns a mapping of long argument names to their values.
+    auto parsedArgs = parser.parseArguments(argc, argv);
+
+    if (parsedArgs.empty())
+        return EXIT_FAILURE;
+
+    if (parsedArgs["input"].Empty()) {
+        MITK_INFO << parser.helpText();
+        return EXIT_FAILURE;
+    }
+
+    // Parse, cast and set required arguments
+    auto inputDirname = us::any_cast<std::string>(parsedArgs["input"]);
+
+    // Default values for optional arguments
+    int numFrames = 0;
+    auto delta = false;
+    auto recursive = false;
+    auto force = false;
+    int numThreads = 0;
+    auto verbose = false;
+
+    // Parse, cast and set optional arguments
+    if (parsedArgs.end() != parsedArgs.find("frames")) {
+        numFrames = us::any_cast<int>(parsedArgs["frames"]);
+    }
+    if (parsedArgs.end() != parsedArgs.find("delta")) {
+        delta = us::any_cast<bool>(parsedArgs["delta"]);
+    }
+    if (parsedArgs.end() != parsedArgs.find("recursive")) {
+        recursive = us::any_cast<bool>(parsedArgs["recursive"]);
+    }
+    if (parsedArgs.end() != parsedArgs.find("force")) {
+        force = us::any_cast<bool>(parsedArgs["force"]);
+    }
+    if (parsedArgs.end() != parsedArgs.find("threads")) {
+        numThreads = us::any_cast<int>(parsedArgs["threads"]);
+    }
+    if (parsedArgs.end() != parsedArgs.find("verbose")) {
+        verbose = us::any_cast<bool>(parsedArgs["verbose"]);
+    }
+
+    try {
+        MITK_INFO(verbose) << "Verbose mode ON.";
+
+        QString input = QDir(QString::fromStdString(inputDirname)).absolutePath();
+        QStringList folders = CaseFolders(input, recursive);
+        if (folders.isEmpty()) {
+            MITK_ERROR << ("No transformed-0.vtk found in " + input).toStdString();
+            return EXIT_FAILURE;
+        }//_if
+
+        int failed = 0;
+        for (const QString& folder : folders) {
+            if (!ConvertFolder(folder, numFrames, delta, force, numThreads, verbose))
+                failed++;
+        }//_for
+
+        if (failed > 0) {
+            MITK_WARN << failed << " of " << folders.size() << " folders could not be converted.";
+            return EXIT_FAILURE;
+        }//_if
+
+        MITK_INFO(verbose) << "Goodbye!";
+    } catch (const std::exception &e) {
+        MITK_ERROR << e.what();
+        return EXIT_FAILURE;
+    } catch (...) {
+        MITK_ERROR << "Unexpected error";
+        return EXIT_FAILURE;
+    }
+}
@@ -185,11 +185,12 @@ int main(int argc, char* argv[]) {
 
             //Volume and surface calculations
             std::unique_ptr<CemrgMeasure> morphAnal = std::unique_ptr<CemrgMeasure>(new CemrgMeasure());
-            double surfceLA = morphAnal->calcSurfaceMesh(surfLA);
-            double volumeLA = morphAnal->calcVolumeMesh(surfLA);
-            double surfceAP = morphAnal->calcSurfaceMesh(surfAP);
-            double volumeAP = morphAnal->calcVolumeMesh(surfAP);
-            double sphereLA = morphAnal->GetSphericity(surfLA->GetVtkPolyData());
+            std::vector<CemrgMeasure::Morphology> morphs = morphAnal->GetMorphology({surfLA, surfAP});
+            double surfceLA = morphs[0].surfaceArea;
+            double volumeLA = morphs[0].volume;
+            double surfceAP = morphs[1].surfaceArea;
+            double volumeAP = morphs[1].volume;
+            double sphereLA = morphs[0].sphericity;
 
             //Store in text file
             ofstream morphResult;
@@ -0,0 +1,224 @@
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+CEMRG POWER RIB SPACINGS
+Acoustic intensity of the power transmitter on an endo mesh for several
+rib spacings at once, to compare candidate transmitter positions. The
+transmitter of each rib spacing is read from the ebrN.vtk that the power
+transmitter view maps into the project folder. Every pose is evaluated in
+a single pass over the endo mesh. The endoN.vtk power maps are written
+next to them, as the Calculate Power step does, with a CSV summary.
+=========================================================================*/
+
+// Qmitk
+#include <mitkCommandLineParser.h>
+#include <mitkLogMacros.h>
+
+// VTK
+#include <vtkDataArray.h>
+#include <vtkPointData.h>
+#include <vtkPolyData.h>
+
+// Qt
+#include <QString>
+#include <QStringList>
+#include <QFileInfo>
+#include <QDir>
+#include <QRegularExpression>
+
+// C++ Standard
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// CemrgApp
+#include <CemrgCommonUtils.h>
+#include <CemrgPower.h>
+
+std::vector<int> MappedRibSpacings(QString dir) {
+
+    std::vector<int> ribSpacings;
+    QRegularExpression ebrName("^ebr(\\d+)\\.vtk$");
+    QStringList files = QDir(dir).entryList(QStringList() << "ebr*.vtk", QDir::Files);
+    for (const QString& file : files) {
+        QRegularExpressionMatch match = ebrName.match(file);
+        if (match.hasMatch())
+            ribSpacings.push_back(match.captured(1).toInt());
+    }//_for
+    std::sort(ribSpacings.begin(), ribSpacings.end());
+    return ribSpacings;
+}
+
+bool ParseRibSpacings(QString list, std::vector<int>& ribSpacings) {
+
+    ribSpacings.clear();
+    QStringList tokens = list.split(QRegularExpression("[,\\s]+"), QString::SkipEmptyParts);
+    for (const QString& token : tokens) {
+        bool ok;
+        int ribSpacing = token.toInt(&ok);
+        if (!ok || ribSpacing <= 0) {
+            MITK_ERROR << ("Wrong rib spacing: " + token).toStdString();
+            return false;
+        }//_if
+        ribSpacings.push_back(ribSpacing);
+    }//_for
+    return !ribSpacings.empty();
+}
+
+int main(int argc, char* argv[]) {
+    mitkCommandLineParser parser;
+
+    // Set general information about your command-line app
+    parser.setCategory("Post processing");
+    parser.setTitle("Power Rib Spacings Command-line App");
+    parser.setContributor("CEMRG, KCL");
+    parser.setDescription(
+        "Calculate the acoustic intensity on an endo mesh for the power transmitter of several rib spacings in one pass.");
+
+    // How should arguments be prefixed
+    parser.setArgumentPrefix("--", "-");
+
+    // Add arguments. Unless specified otherwise, each argument is optional.
+    // See mitkCommandLineParser::addArgument() for more information.
+    parser.addArgument(
+        "input", "i", mitkCommandLineParser::InputFile,
+        "Endo mesh", "Endocardial mesh (.vtk) the power is calculated on.",
+        us::Any(), false);
+    parser.addArgument(
+        "dir", "d", mitkCommandLineParser::InputDirectory,
+        "Project directory", "Folder with the ebrN.vtk transmitter meshes, the power maps are saved there.",
+        us::Any(), false);
+    parser.addArgument( // optional
+        "rib-spacings", "r", mitkCommandLineParser::String,
+        "Rib spacings", "Comma separated rib spacings to evaluate (default: every ebrN.vtk in the project directory).");
+    parser.addArgument( // optional
+        "output", "o", mitkCommandLineParser::OutputFile,
+        "Summary", "CSV file with the powered points and intensities of each rib spacing (default: powerRibSpacings.csv in the project directory).");
+    parser.addArgument( // optional
+        "threads", "t", mitkCommandLineParser::Int,
+        "Threads", "Number of threads (default: all cores).");
+    parser.addArgument( // optional
+        "verbose", "v", mitkCommandLineParser::Bool,
+        "Verbose Output", "Whether to produce verbose output");
+
+    // Parse arguments.
+    // This method returns a mapping of long argument names to their values.
+    auto parsedArgs = parser.parseArguments(argc, argv);
+
+    if (parsedArgs.empty())
+        return EXIT_FAILURE;
+
+    if (parsedArgs["input"].Empty() ||
+        parsedArgs["dir"].Empty()) {
+        MITK_INFO << parser.helpText();
+        return EXIT_FAILURE;
+    }
+
+    // Parse, cast and set required arguments
+    auto inFilename = us::any_cast<std::string>(parsedArgs["input"]);
+    auto dirname = us::any_cast<std::string>(parsedArgs["dir"]);
+
+    // Default values for optional arguments
+    std::string ribSpacingList = "";
+    std::string outFilename = "";
+    int numThreads = 0;
+    auto verbose = false;
+
+    // Parse, cast and set optional arguments
+    if (parsedArgs.end() != parsedArgs.find("rib-spacings")) {
+        ribSpacingList = us::any_cast<std::string>(parsedArgs["rib-spacings"]);
+    }
+    if (parsedArgs.end() != parsedArgs.find("output")) {
+        outFilename = us::any_cast<std::string>(parsedArgs["output"]);
+    }
+    if (parsedArgs.end() != parsedArgs.find("threads")) {
+        numThreads = us::any_cast<int>(parsedArgs["threads"]);
+    }
+    if (parsedArgs.end() != parsedArgs.find("verbose")) {
+        verbose = us::any_cast<bool>(parsedArgs["verbose"]);
+    }
+
+    try {
+        MITK_INFO(verbose) << "Verbose mode ON.";
+
+        QString dir = QDir(QString::fromStdString(dirname)).absolutePath();
+        std::vector<int> ribSpacings;
+        if (ribSpacingList.empty()) {
+            ribSpacings = MappedRibSpacings(dir);
+            if (ribSpacings.empty()) {
+                MITK_ERROR << ("No ebrN.vtk transmitter meshes found in " + dir).toStdString();
+                return EXIT_FAILURE;
+            }//_if
+        } else if (!ParseRibSpacings(QString::fromStdString(ribSpacingList), ribSpacings)) {
+            return EXIT_FAILURE;
+        }//_if
+
+        // Same axes as the meshes loaded in the power transmitter view
+        mitk::Surface::Pointer endo = CemrgCommonUtils::LoadVTKMesh(inFilename);
+        CemrgPower power(dir, ribSpacings.front());
+        std::vector<CemrgPower::TransmitterPose> poses(ribSpacings.size());
+        for (size_t r = 0; r < ribSpacings.size(); r++) {
+            if (!power.LoadTransmitterPose(ribSpacings[r], poses[r]))
+                return EXIT_FAILURE;
+        }//_for
+
+        MITK_INFO(verbose) << "Calculating the acoustic intensity of " << poses.size() << " rib spacings.";
+        std::vector<mitk::Surface::Pointer> maps = power.CalculateAcousticIntensity(endo, poses, numThreads);
+        if (maps.size() != poses.size())
+            return EXIT_FAILURE;
+
+        QString outname = outFilename.empty() ? dir + "/powerRibSpacings.csv" : QString::fromStdString(outFilename);
+        std::ofstream summary(outname.toStdString());
+        if (!summary.is_open()) {
+            MITK_ERROR << ("Could not open " + outname + " for writing.").toStdString();
+            return EXIT_FAILURE;
+        }//_if
+        summary << "rib_spacing,powered_points,max_intensity,mean_intensity\n";
+
+        int failed = 0;
+        for (size_t r = 0; r < maps.size(); r++) {
+            if (!power.SavePowerMap(maps[r], ribSpacings[r]))
+                failed++;
+
+            vtkDataArray* intensity = maps[r]->GetVtkPolyData()->GetPointData()->GetScalars();
+            vtkIdType numPoints = intensity->GetNumberOfTuples();
+            double maxIntensity = 0, sumIntensity = 0;
+            for (vtkIdType i = 0; i < numPoints; i++) {
+                maxIntensity = std::max(maxIntensity, intensity->GetTuple1(i));
+                sumIntensity += intensity->GetTuple1(i);
+            }//_for
+            summary << ribSpacings[r] << "," << numPoints << "," << maxIntensity << ",";
+            summary << (numPoints > 0 ? sumIntensity / numPoints : 0) << "\n";
+            MITK_INFO(verbose) << "Rib spacing " << ribSpacings[r] << ": " << numPoints << " powered points.";
+        }//_for
+        summary.close();
+
+        if (failed > 0) {
+            MITK_WARN << failed << " of " << maps.size() << " power maps could not be saved.";
+            return EXIT_FAILURE;
+        }//_if
+
+        MITK_INFO(verbose) << "Goodbye!";
+    } catch (const std::exception &e) {
+        MITK_ERROR << e.what();
+        return EXIT_FAILURE;
+    } catch (...) {
+        MITK_ERROR << "Unexpected error";
+        return EXIT_FAILURE;
+    }
+}
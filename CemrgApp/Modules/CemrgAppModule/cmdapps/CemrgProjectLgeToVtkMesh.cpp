@@ -22,9 +22,7 @@ in the framework.
 
 // ITK
 #include <itkPoint.h>
-#include <itkImageFileWriter.h>
-#include <itkImageRegionIterator.h>
-#include <itkImageRegionIteratorWithIndex.h>
+#include <itkImageIOBase.h>
 
 // VTK
 #include <vtkPolyDataWriter.h>
@@ -60,6 +58,7 @@ in the framework.
 
 // CemrgApp
 #include <CemrgScar3D.h>
+#include <CemrgScarProjection.h>
 #include <CemrgAtriaClipper.h>
 #include <CemrgCommandLine.h>
 
@@ -67,14 +66,9 @@ in the framework.
 #include <algorithm>
 #include <string>
 
-typedef itk::Image<short, 3> itkImageType;
-void ItkDeepCopy(itkImageType::Pointer input, itkImageType::Pointer output);
 mitk::Surface::Pointer ReadVTKMesh(std::string meshPath);
-double GetIntensityAlongNormal(itkImageType::Pointer scarImage, itkImageType::Pointer visitedImage,
-                               double n_x, double n_y, double n_z, double centre_x, double centre_y, double centre_z, int minStep = -3, int maxStep = 3);
-
-double GetStatisticalMeasure(itkImageType::Pointer scarSegImage, std::vector<mitk::Point3D> pointsOnAndAroundNormal,
-                             itkImageType::Pointer scarImage, itkImageType::Pointer visitedImage, int measure);
+template <typename TPixel>
+bool ProjectLge(mitk::Image::Pointer lgeImage, vtkPolyData* pd, int minStep, int maxStep, std::string measure, std::vector<double>& cellIntensities);
 
 
 int main(int argc, char* argv[]) {
@@ -112,6 +106,9 @@ int main(int argc, char* argv[]) {
         "max-step", "maxS", mitkCommandLineParser::Int,
         "number of voxels", "Number of voxels towards the exterior to project LGE. Default=3",
         3, true);
+    parser.addArgument( // optional
+        "measure", "m", mitkCommandLineParser::String,
+        "Projection measure", "Reduction of the intensities along each normal: max, mean, sum, median or p90 (90th percentile) (default=max)");
 
     parser.addArgument( // optional
         "verbose", "v", mitkCommandLineParser::Bool,
@@ -139,6 +136,7 @@ int main(int argc, char* argv[]) {
 
     auto minStep = -1 * 3;
     auto maxStep = 3;
+    std::string measure = "max";
 
     if (parsedArgs.end() != parsedArgs.find("min-step")) {
         minStep = us::any_cast<int>(parsedArgs["min-step"]);
@@ -148,6 +146,10 @@ int main(int argc, char* argv[]) {
         maxStep = us::any_cast<int>(parsedArgs["max-step"]);
     }
 
+    if (parsedArgs.end() != parsedArgs.find("measure")) {
+        measure = us::any_cast<std::string>(parsedArgs["measure"]);
+    }
+
     //min step is negative within the code
     if (minStep > 0) {
         minStep = -1 * minStep;
@@ -174,12 +176,6 @@ int main(int argc, char* argv[]) {
         // Load the LGE image
         mitk::Image::Pointer lgeImage = mitk::IOUtil::Load<mitk::Image>(lgeFilename);
 
-        //Convert to itk image
-        itkImageType::Pointer scarImage;
-        mitk::CastToItkImage(lgeImage, scarImage);
-        itkImageType::Pointer visitedImage = itkImageType::New();
-        ItkDeepCopy(scarImage, visitedImage);
-
         // Read the surface
         mitk::Surface::Pointer surface = ReadVTKMesh(surfFilename);
         vtkSmartPointer<vtkPolyData> pd = surface->GetVtkPolyData();
@@ -194,13 +190,28 @@ int main(int argc, char* argv[]) {
         normals->Update();
         pd = normals->GetOutput();
 
+        //Project in the LGE pixel type, only types without an engine are cast to short
+        bool projected = false;
+        std::vector<double> cellIntensities;
+        switch (lgeImage->GetPixelType().GetComponentType()) {
+            case itk::ImageIOBase::FLOAT:
+                projected = ProjectLge<float>(lgeImage, pd, minStep, maxStep, measure, cellIntensities);
+                break;
+            case itk::ImageIOBase::DOUBLE:
+                projected = ProjectLge<double>(lgeImage, pd, minStep, maxStep, measure, cellIntensities);
+                break;
+            case itk::ImageIOBase::UCHAR:
+                projected = ProjectLge<unsigned char>(lgeImage, pd, minStep, maxStep, measure, cellIntensities);
+                break;
+            default:
+                projected = ProjectLge<short>(lgeImage, pd, minStep, maxStep, measure, cellIntensities);
+                break;
+        }//_switch
+        if (!projected)
+            return EXIT_FAILURE;
+
         // Declarations
-        vtkSmartPointer<vtkIdList> cellPoints = vtkSmartPointer<vtkIdList>::New();
-        vtkSmartPointer<vtkFloatArray> cellNormals = vtkFloatArray::SafeDownCast(pd->GetCellData()->GetNormals());
         vtkSmartPointer<vtkFloatArray> scalars = vtkSmartPointer<vtkFloatArray>::New();
-        itkImageType::IndexType pixelXYZ;
-        itkImageType::PointType pointXYZ;
-        double pN[3], cP[3];
         double maxSdev = -1e9;
         double maxSratio = -1e9;
         double mean = 0, var = 1;
@@ -208,42 +219,7 @@ int main(int argc, char* argv[]) {
         double minScalar = 1E10;
 
         for (int i = 0; i < pd->GetNumberOfCells(); i++) {
-            cellNormals->GetTuple(i, pN);
-            double cX = 0, cY = 0, cZ = 0, numPoints = 0;
-            pd->GetCellPoints(i, cellPoints);
-            vtkIdType numCellPoints = cellPoints->GetNumberOfIds();
-            for (vtkIdType neighborPoint = 0; neighborPoint < numCellPoints; ++neighborPoint) {
-                //Get the neighbor point ID
-                vtkIdType neighborPointID = cellPoints->GetId(neighborPoint);
-
-                //Get the neighbor point position
-                pd->GetPoint(neighborPointID, cP);
-
-                // ITK method
-                pointXYZ[0] = cP[0];
-                pointXYZ[1] = cP[1];
-                pointXYZ[2] = cP[2];
-                scarImage->TransformPhysicalPointToIndex(pointXYZ, pixelXYZ);
-                cP[0] = pixelXYZ[0];
-                cP[1] = pixelXYZ[1];
-                cP[2] = pixelXYZ[2];
-                cX += cP[0];
-                cY += cP[1];
-                cZ += cP[2];
-                numPoints++;
-            }//_innerLoop
-            cX /= numPoints;
-            cY /= numPoints;
-            cZ /= numPoints;
-            // ITK method
-            pointXYZ[0] = pN[0];
-            pointXYZ[1] = pN[1];
-            pointXYZ[2] = pN[2];
-            scarImage->TransformPhysicalPointToIndex(pointXYZ, pixelXYZ);
-            pN[0] = pixelXYZ[0];
-            pN[1] = pixelXYZ[1];
-            pN[2] = pixelXYZ[2];
-            double scalar = GetIntensityAlongNormal(scarImage, visitedImage, pN[0], pN[1], pN[2], cX, cY, cZ, minStep, maxStep);
+            double scalar = cellIntensities[i];
             if (scalar > maxScalar) maxScalar = scalar;
             if (scalar < minScalar) minScalar = scalar;
             double sdev = (scalar - mean) / sqrt(var);
@@ -273,7 +249,6 @@ int main(int argc, char* argv[]) {
             scalars->InsertTuple1(i, scalarToPlot); // if (_SCAR_MIP == 1 && _SCAR_AS_STANDARD_DEVIATION == 1)
             //else: scalars->InsertTuple1(i, scalar);
         }//_for
-        itkImageType::Pointer scarDebugLabel = visitedImage;
         pd->GetCellData()->SetScalars(scalars);
         surface->SetVtkPolyData(pd);
 
@@ -294,21 +269,6 @@ int main(int argc, char* argv[]) {
     }
 }
 
-void ItkDeepCopy(itkImageType::Pointer input, itkImageType::Pointer output) {
-    output->SetRegions(input->GetLargestPossibleRegion());
-    output->Allocate();
-
-    itk::ImageRegionConstIterator<itkImageType> inputIterator(input, input->GetLargestPossibleRegion());
-    itk::ImageRegionIterator<itkImageType> outputIterator(output, output->GetLargestPossibleRegion());
-
-    while (!inputIterator.IsAtEnd()) {
-        outputIterator.Set(0);
-        ++inputIterator;
-        ++outputIterator;
-    }
-}
-
-
 mitk::Surface::Pointer ReadVTKMesh(std::string meshPath) {
 
     //Load the mesh
@@ -346,134 +306,30 @@ mitk::Surface::Pointer ReadVTKMesh(std::string meshPath) {
 }
 
 
-double GetIntensityAlongNormal(itkImageType::Pointer scarImage, itkImageType::Pointer visitedImage,
-                               double n_x, double n_y, double n_z, double centre_x, double centre_y, double centre_z, int minStep, int maxStep) {
-
-    // Declarations
-    int methodType = 2;
-    std::vector<mitk::Point3D> pointsOnAndAroundNormal;
-
-    // Normalize
-    double tempArr[3];
-    tempArr[0] = n_x;
-    tempArr[1] = n_y;
-    tempArr[2] = n_z;
-    double norm = vtkMath::Normalize(tempArr);
-    n_x /= norm;
-    n_y /= norm;
-    n_z /= norm;
-
-    double scar_step_min = minStep;
-    double scar_step_max = maxStep;
-    double scar_step_size = 1;
-
-    const itkImageType::SizeType sizeOfImage = scarImage->GetLargestPossibleRegion().GetSize();
-    double maxX = sizeOfImage[0];
-    double maxY = sizeOfImage[1];
-    double maxZ = sizeOfImage[2];
-
-    for (double i = scar_step_min; i <= scar_step_max; i += scar_step_size) {
-        double x = floor(centre_x + (i * n_x));
-        double y = floor(centre_y + (i * n_y));
-        double z = floor(centre_z + (i * n_z));
-        for (int a = -1; a <= 1; a++) {
-            for (int b = -1; b <= 1; b++) {
-                for (int c = -1; c <= 1; c++) {
-                    if (x + a >= 0 && x + a < maxX && y + b >= 0 && y + b < maxY && z + c >= 0 && z + c < maxZ) {
-                        mitk::Point3D tempPoint;
-                        tempPoint.SetElement(0, x + a);
-                        tempPoint.SetElement(1, y + b);
-                        tempPoint.SetElement(2, z + c);
-                        pointsOnAndAroundNormal.push_back(tempPoint);
-                    }
-                }
-            }
-        }
-        //        a=0;b=0;c=0;
-        //        if (x+a>=0 && x+a<maxX && y+b>=0 && y+b<maxY && z+c>=0 && z+c<maxZ) {
-        //            mitk::Point3D tempPoint;
-        //            tempPoint.SetElement(0, x+a);
-        //            tempPoint.SetElement(1, y+b);
-        //            tempPoint.SetElement(2, z+c);
-        //            pointsOnAndAroundNormal.push_back(tempPoint);
-        //        }
-    }//_for
-
-    double insty = 0;
-    insty = GetStatisticalMeasure(scarImage, pointsOnAndAroundNormal, scarImage, visitedImage, methodType);
-
-    return insty;
-}
-
-
-double GetStatisticalMeasure(itkImageType::Pointer scarSegImage, std::vector<mitk::Point3D> pointsOnAndAroundNormal,
-                             itkImageType::Pointer scarImage, itkImageType::Pointer visitedImage, int measure) {
-
-    //Declarations
-    itkImageType::IndexType pixel_xyz;
-    int size = pointsOnAndAroundNormal.size();
-    double sum = 0, returnVal = 0; //, visitedStatus;
-
-    //Filter out cut regions
-    for (int i = 0; i < size; i++) {
-        pixel_xyz[0] = pointsOnAndAroundNormal.at(i).GetElement(0);
-        pixel_xyz[1] = pointsOnAndAroundNormal.at(i).GetElement(1);
-        pixel_xyz[2] = pointsOnAndAroundNormal.at(i).GetElement(2);
-        double val = scarSegImage->GetPixel(pixel_xyz);
-        visitedImage->SetPixel(pixel_xyz, 1);
-        if (std::abs(val - 3.0) < 1E-10)
-            return -1;
-    }//_for
-
-    //Return mean
-    if (measure == 1) {
-        for (int i = 0; i < size; i++) {
-            pixel_xyz[0] = pointsOnAndAroundNormal.at(i).GetElement(0);
-            pixel_xyz[1] = pointsOnAndAroundNormal.at(i).GetElement(1);
-            pixel_xyz[2] = pointsOnAndAroundNormal.at(i).GetElement(2);
-            sum += scarImage->GetPixel(pixel_xyz);
-        }
-        returnVal = sum / size;
-    }//_if_mean
-
-    //Return max
-    if (measure == 2) {
-        int maxIndex = 0;
-        double max = -1;
-        for (int i = 0; i < size; i++) {
-            pixel_xyz[0] = pointsOnAndAroundNormal.at(i).GetElement(0);
-            pixel_xyz[1] = pointsOnAndAroundNormal.at(i).GetElement(1);
-            pixel_xyz[2] = pointsOnAndAroundNormal.at(i).GetElement(2);
-            double greyVal = scarImage->GetPixel(pixel_xyz);
-            // visitedStatus = visitedImage->GetPixel(pixel_xyz);
-            if (greyVal > max) { // && visitedStatus < 1) {
-                max = greyVal;
-                maxIndex = i;
-            }
-        }
-        if (max == -1) {
-            returnVal = 0;
-        } else {
-            returnVal = max;
-            //Now change the visited status of this max pixel
-            pixel_xyz[0] = pointsOnAndAroundNormal.at(maxIndex).GetElement(0);
-            pixel_xyz[1] = pointsOnAndAroundNormal.at(maxIndex).GetElement(1);
-            pixel_xyz[2] = pointsOnAndAroundNormal.at(maxIndex).GetElement(2);
-            visitedImage->SetPixel(pixel_xyz, 2);
-        }
-    }//_if_max
-
-    //Sum along the normal (integration)
-    if (measure == 3) {
-        for (int i = 0; i < size; i++) {
-            pixel_xyz[0] = pointsOnAndAroundNormal.at(i).GetElement(0);
-            pixel_xyz[1] = pointsOnAndAroundNormal.at(i).GetElement(1);
-            pixel_xyz[2] = pointsOnAndAroundNormal.at(i).GetElement(2);
-            double greyVal = scarImage->GetPixel(pixel_xyz);
-            sum += greyVal;
-        }
-        returnVal = sum;
-    }//_if_sum
-
-    return returnVal;
+template <typename TPixel>
+bool ProjectLge(mitk::Image::Pointer lgeImage, vtkPolyData* pd, int minStep, int maxStep, std::string measure, std::vector<double>& cellIntensities) {
+
+    //Convert to itk image
+    typename CemrgScarProjection<TPixel>::ImageType::Pointer scarImage;
+    mitk::CastToItkImage(lgeImage, scarImage);
+
+    CemrgScarProjection<TPixel> projection;
+    projection.SetImage(scarImage);
+    projection.SetSteps(minStep, maxStep);
+    if (!projection.ComputeCellGeometry(pd))
+        return false;
+
+    if (measure == "max")
+        return projection.template Project<CemrgProjectionMax>(cellIntensities);
+    if (measure == "mean")
+        return projection.template Project<CemrgProjectionMean>(cellIntensities);
+    if (measure == "sum")
+        return projection.template Project<CemrgProjectionSum>(cellIntensities);
+    if (measure == "median")
+        return projection.template Project<CemrgProjectionMedian>(cellIntensities);
+    if (measure == "p90")
+        return projection.template Project<CemrgProjectionPercentile<90>>(cellIntensities);
+
+    MITK_ERROR << "Unknown projection measure: " << measure;
+    return false;
 }
@@ -56,6 +56,7 @@ in the framework.
 // Qt
 #include <QtDebug>
 #include <QString>
+#include <QStringList>
 #include <QDir>
 #include <QFileInfo>
 #include <QProcess>
@@ -65,6 +66,8 @@ in the framework.
 #include <algorithm>
 #include <string>
 #include <numeric>
+#include <utility>
+#include <vector>
 
 // CemrgApp
 #include <CemrgScar3D.h>
@@ -98,6 +101,18 @@ int main(int argc, char* argv[]) {
     parser.addArgument( // optional
         "single-voxel-projection", "svp", mitkCommandLineParser::Bool,
         "Single Voxel Projection", "Project LGE voxels onto Scar Map ONLY ONCE (Default=OFF)");
+    parser.addArgument( // optional
+        "trilinear", "tri", mitkCommandLineParser::Bool,
+        "Trilinear sampling", "Sample the LGE with trilinear interpolation along the normal instead of the 3x3x3 neighbourhood (Default=OFF)");
+    parser.addArgument( // optional
+        "step-size", "ss", mitkCommandLineParser::Float,
+        "Step size", "Distance (mm) between trilinear samples along the normal (Default=0.25)");
+    parser.addArgument( // optional
+        "vertex-projection", "vp", mitkCommandLineParser::Bool,
+        "Vertex projection", "Project along the point normals and save point scalars instead of cell scalars (Default=OFF)");
+    parser.addArgument( // optional
+        "windows", "w", mitkCommandLineParser::String,
+        "Projection windows", "Comma separated min:max step windows (e.g. -1:3,0:2) projected in one sweep, one array each in Windows_<output>");
     parser.addArgument( // optional
         "multi-thresholds", "t", mitkCommandLineParser::Bool,
         "Multiple thresholds", "Produce the output for the scar score using multiple thresholds:\n\t  (mean+V*stdev) V = 1:0.1:5\n\t (V*IIR) V = 0.7:0.01:1.61");
@@ -126,6 +141,10 @@ int main(int argc, char* argv[]) {
     // std::string prodthresfile = "prodThresholds.txt";
     auto thresmethod = 2;
     auto singlevoxelprojection = false;
+    auto trilinear = false;
+    auto stepsize = 0.25;
+    auto vertexprojection = false;
+    std::string windowList = "";
     auto multithreshold = false;
     auto verbose = false;
 
@@ -146,6 +165,22 @@ int main(int argc, char* argv[]) {
     }
     std::cout << "single voxel " << singlevoxelprojection << '\n';
 
+    if (parsedArgs.end() != parsedArgs.find("trilinear")) {
+        trilinear = us::any_cast<bool>(parsedArgs["trilinear"]);
+    }
+
+    if (parsedArgs.end() != parsedArgs.find("step-size")) {
+        stepsize = us::any_cast<float>(parsedArgs["step-size"]);
+    }
+
+    if (parsedArgs.end() != parsedArgs.find("vertex-projection")) {
+        vertexprojection = us::any_cast<bool>(parsedArgs["vertex-projection"]);
+    }
+
+    if (parsedArgs.end() != parsedArgs.find("windows")) {
+        windowList = us::any_cast<std::string>(parsedArgs["windows"]);
+    }
+
     if (parsedArgs.end() != parsedArgs.find("verbose")) {
         verbose = us::any_cast<bool>(parsedArgs["verbose"]);
     }
@@ -166,8 +201,27 @@ int main(int argc, char* argv[]) {
         QString segvtk = "segmentation.vtk";
         QString outname = methodPref + "MaxScar";
         outname += singlevoxelprojection ? "-single-voxel" : "-repeated-voxels";
+        outname += trilinear ? "-trilinear" : "";
+        outname += vertexprojection ? "-vertex" : "";
         outname += ".vtk";
 
+        std::vector<std::pair<int, int>> windows;
+        QStringList windowTokens = QString::fromStdString(windowList).split(",", QString::SkipEmptyParts);
+        for (int i = 0; i < windowTokens.size(); i++) {
+            QStringList limits = windowTokens.at(i).trimmed().split(":");
+            bool okMin = false, okMax = false;
+            int windowMin = 0, windowMax = 0;
+            if (limits.size() == 2) {
+                windowMin = limits.at(0).toInt(&okMin);
+                windowMax = limits.at(1).toInt(&okMax);
+            }//_if
+            if (!okMin || !okMax || windowMin > windowMax) {
+                MITK_ERROR << ("Wrong projection window: " + windowTokens.at(i)).toStdString();
+                return EXIT_FAILURE;
+            }//_if
+            windows.push_back(std::make_pair(windowMin, windowMax));
+        }//_for
+
         MITK_INFO(verbose) << "Obtaining input file path and working directory: ";
 
         // OBTAINING directory and lgepath variables
@@ -199,6 +253,11 @@ int main(int argc, char* argv[]) {
         MITK_INFO(singlevoxelprojection) << "Setting Single voxel projection";
         MITK_INFO(!singlevoxelprojection) << "Setting multiple voxels projection";
         scar->SetVoxelBasedProjection(singlevoxelprojection);
+        MITK_INFO(trilinear) << "Setting trilinear sampling, step size " << stepsize;
+        scar->SetSamplingMode(trilinear ? 2 : 1);
+        scar->SetStepSize(stepsize);
+        MITK_INFO(vertexprojection) << "Setting vertex projection";
+        scar->SetVertexBasedProjection(vertexprojection);
 
         ImageTypeCHAR::Pointer segITK = ImageTypeCHAR::New();
         ImageTypeSHRT::Pointer lgeITK = ImageTypeSHRT::New();
@@ -240,18 +299,35 @@ int main(int argc, char* argv[]) {
         mitk::CastToItkImage(mitk::IOUtil::Load<mitk::Image>(lgePath.toStdString()), lgeFloat);
 
         double mean = 0.0, stdv = 0.0;
-        scar->CalculateMeanStd(mitk::ImportItkImage(lgeFloat), roiImage, mean, stdv);
+        if (!scar->CalculateMeanStd(mitk::ImportItkImage(lgeFloat), roiImage, mean, stdv)) {
+            MITK_ERROR << "Could not calculate the mean and std of the blood pool ROI.";
+            return EXIT_FAILURE;
+        }//_if
 
         MITK_INFO(verbose) << "Performing Scar projection using " + segvtk.toStdString();
 
         QString prodPath = direct + "/";
         mitk::Surface::Pointer scarShell = scar->Scar3D(direct.toStdString(), mitk::ImportItkImage(lgeITK));
+        if (scarShell.IsNull()) {
+            MITK_ERROR << "Scar projection failed.";
+            return EXIT_FAILURE;
+        }//_if
 
         MITK_INFO(verbose) << "Saving new scar map to " + outname.toStdString();
 
         mitk::IOUtil::Save(scarShell, (outputFolder + outname).toStdString());
         scar->SaveNormalisedScalars(mean, scarShell, outputFolder + "Normalised_" + outname);
 
+        if (!windows.empty()) {
+            MITK_INFO(verbose) << "Projecting " << windows.size() << " windows in one sweep.";
+            mitk::Surface::Pointer windowShell = scar->Scar3DWindows(direct.toStdString(), mitk::ImportItkImage(lgeITK), windows);
+            if (windowShell.IsNull()) {
+                MITK_ERROR << "Window projection failed.";
+                return EXIT_FAILURE;
+            }//_if
+            mitk::IOUtil::Save(windowShell, (outputFolder + "Windows_" + outname).toStdString());
+        }//_if
+
         QFileInfo fi2(outputFolder + outname);
         QString prothresfile = fi2.baseName() + "_prodStats.txt";
 
@@ -271,14 +347,18 @@ int main(int argc, char* argv[]) {
             endVal = (method == 2) ? 5.0 : 1.61;
             increment = (method == 2) ? 0.1 : 0.01;
 
+            std::vector<double> allVals, allThres;
             double thisVal = startVal;
             while (thisVal <= endVal) {
-                double thisthres = (method == 2) ? mean + thisVal * stdv : mean * thisVal;
-                double thispercentage = scar->Thresholding(thisthres);
-                prodFile1 << "V=" << thisVal << ", SCORE=" << thispercentage << std::endl;
+                allVals.push_back(thisVal);
+                allThres.push_back((method == 2) ? mean + thisVal * stdv : mean * thisVal);
 
                 thisVal += increment;
             }
+
+            std::vector<double> allPercentages = scar->ThresholdingCurve(allThres);
+            for (unsigned int i = 0; i < allVals.size(); i++)
+                prodFile1 << "V=" << allVals[i] << ", SCORE=" << allPercentages[i] << std::endl;
         }
 
         prodFile1.close();
@@ -0,0 +1,166 @@
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+CEMRG SCAR TRANSFER
+Maps the scalars of the pre-ablation shell onto the aligned post-ablation
+shell, as the scar overlap step (F&I T3) of the scar calculations view does,
+so the comparison can be run over a whole cohort. The transferred shell is
+written as MaxScarPre_OnPost.vtk in the output directory. The values are
+taken from the nearest pre-ablation point, weighted by inverse distance over
+the nearest points, or interpolated on the closest triangle.
+=========================================================================*/
+
+// Qmitk
+#include <mitkIOUtil.h>
+#include <mitkSurface.h>
+#include <mitkCommandLineParser.h>
+#include <mitkLogMacros.h>
+
+// VTK
+#include <vtkPolyData.h>
+#include <vtkPointData.h>
+
+// Qt
+#include <QString>
+#include <QFileInfo>
+#include <QFile>
+#include <QDir>
+
+// C++ Standard
+#include <memory>
+#include <string>
+
+// CemrgApp
+#include <CemrgScalarTransfer.h>
+#include <CemrgScarAdvanced.h>
+
+int main(int argc, char* argv[]) {
+    mitkCommandLineParser parser;
+
+    // Set general information about your command-line app
+    parser.setCategory("Post processing");
+    parser.setTitle("Scar Transfer Command-line App");
+    parser.setContributor("CEMRG, KCL");
+    parser.setDescription(
+        "Map the scalars of the pre-ablation shell onto the aligned post-ablation shell.");
+
+    // How should arguments be prefixed
+    parser.setArgumentPrefix("--", "-");
+
+    // Add arguments. Unless specified otherwise, each argument is optional.
+    // See mitkCommandLineParser::addArgument() for more information.
+    parser.addArgument(
+        "source", "s", mitkCommandLineParser::InputFile,
+        "Post-ablation shell", "Aligned post-ablation shell (MaxScarPost_Aligned.vtk) the values are mapped onto.",
+        us::Any(), false);
+    parser.addArgument(
+        "target", "t", mitkCommandLineParser::InputFile,
+        "Pre-ablation shell", "Pre-ablation shell (MaxScarPre.vtk) the values are read from.",
+        us::Any(), false);
+    parser.addArgument( // optional
+        "output", "o", mitkCommandLineParser::OutputDirectory,
+        "Output directory", "Folder of MaxScarPre_OnPost.vtk (default: folder of the post-ablation shell).");
+    parser.addArgument( // optional
+        "interpolation", "m", mitkCommandLineParser::String,
+        "Interpolation", "nearest (default), idw (inverse squared distance over the nearest points) or cell (barycentric on the closest triangle).");
+    parser.addArgument( // optional
+        "verbose", "v", mitkCommandLineParser::Bool,
+        "Verbose Output", "Whether to produce verbose output");
+
+    // Parse arguments.
+    // This method returns a mapping of long argument names to their values.
+    auto parsedArgs = parser.parseArguments(argc, argv);
+
+    if (parsedArgs.empty())
+        return EXIT_FAILURE;
+
+    if (parsedArgs["source"].Empty() ||
+        parsedArgs["target"].Empty()) {
+        MITK_INFO << parser.helpText();
+        return EXIT_FAILURE;
+    }
+
+    // Parse, cast and set required arguments
+    auto sourceFilename = us::any_cast<std::string>(parsedArgs["source"]);
+    auto targetFilename = us::any_cast<std::string>(parsedArgs["target"]);
+
+    // Default values for optional arguments
+    std::string outDirname = "";
+    std::string interpolation = "nearest";
+    auto verbose = false;
+
+    // Parse, cast and set optional arguments
+    if (parsedArgs.end() != parsedArgs.find("output")) {
+        outDirname = us::any_cast<std::string>(parsedArgs["output"]);
+    }
+    if (parsedArgs.end() != parsedArgs.find("interpolation")) {
+        interpolation = us::any_cast<std::string>(parsedArgs["interpolation"]);
+    }
+    if (parsedArgs.end() != parsedArgs.find("verbose")) {
+        verbose = us::any_cast<bool>(parsedArgs["verbose"]);
+    }
+
+    try {
+        MITK_INFO(verbose) << "Verbose mode ON.";
+
+        int mode;
+        if (interpolation == "nearest") {
+            mode = CemrgScalarTransfer::NEAREST_POINT;
+        } else if (interpolation == "idw") {
+            mode = CemrgScalarTransfer::INVERSE_DISTANCE;
+        } else if (interpolation == "cell") {
+            mode = CemrgScalarTransfer::CLOSEST_CELL;
+        } else {
+            MITK_ERROR << "Wrong interpolation: " << interpolation << ", use nearest, idw or cell.";
+            return EXIT_FAILURE;
+        }//_if
+
+        QString outdir = outDirname.empty() ?
+            QFileInfo(QString::fromStdString(sourceFilename)).absolutePath() : QDir(QString::fromStdString(outDirname)).absolutePath();
+
+        QString outname = outdir + "/MaxScarPre_OnPost.vtk";
+        QFile::remove(outname);
+
+        mitk::Surface::Pointer source = mitk::IOUtil::Load<mitk::Surface>(sourceFilename);
+        mitk::Surface::Pointer target = mitk::IOUtil::Load<mitk::Surface>(targetFilename);
+        if (target->GetVtkPolyData()->GetPointData()->GetScalars() == NULL) {
+            MITK_ERROR << "The pre-ablation shell has no point scalars.";
+            return EXIT_FAILURE;
+        }//_if
+
+        MITK_INFO(verbose) << "Mapping " << target->GetVtkPolyData()->GetNumberOfPoints() << " pre-ablation points onto "
+                           << source->GetVtkPolyData()->GetNumberOfPoints() << " post-ablation points (" << interpolation << ").";
+        std::unique_ptr<CemrgScarAdvanced> csadv(new CemrgScarAdvanced());
+        csadv->SetOutputPath(outdir.toStdString() + "/");
+        csadv->SetTransferInterpolation(mode);
+        csadv->SetSourceAndTarget(source->GetVtkPolyData(), target->GetVtkPolyData());
+        csadv->TransformSource2Target();
+
+        if (!QFileInfo::exists(outname)) {
+            MITK_ERROR << ("Could not write " + outname).toStdString();
+            return EXIT_FAILURE;
+        }//_if
+
+        MITK_INFO(verbose) << "Goodbye!";
+    } catch (const std::exception &e) {
+        MITK_ERROR << e.what();
+        return EXIT_FAILURE;
+    } catch (...) {
+        MITK_ERROR << "Unexpected error";
+        return EXIT_FAILURE;
+    }
+}
@@ -7,6 +7,18 @@ set(CPP_FILES
     CemrgPower.cpp
     CemrgAtriaClipper.cpp
     CemrgScarAdvanced.cpp
+    CemrgScarThresholdIndex.cpp
+    CemrgScarProjection.cpp
+    CemrgScarHistogram.cpp
+    CemrgMeshGraph.cpp
+    CemrgGeodesicPath.cpp
+    CemrgScarComponents.cpp
+    CemrgScalarTransfer.cpp
+    CemrgCorridorTable.cpp
+    CemrgMeshSequence.cpp
+    CemrgAhaSegmentation.cpp
+    CemrgAhaUtils.cpp
+    CemrgGapManifest.cpp
     CemrgTests.cpp
 )
 
@@ -22,6 +34,18 @@ set(MOC_H_FILES
   include/CemrgStrains.h
   include/CemrgPower.h
   include/CemrgScarAdvanced.h
+  include/CemrgScarThresholdIndex.h
+  include/CemrgScarProjection.h
+  include/CemrgScarHistogram.h
+  include/CemrgMeshGraph.h
+  include/CemrgGeodesicPath.h
+  include/CemrgScarComponents.h
+  include/CemrgScalarTransfer.h
+  include/CemrgCorridorTable.h
+  include/CemrgMeshSequence.h
+  include/CemrgAhaSegmentation.h
+  include/CemrgAhaUtils.h
+  include/CemrgGapManifest.h
 )
 
 set(RESOURCE_FILES
@@ -0,0 +1,99 @@
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * AHA Segmentation
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrgapp.com
+ * orod.razeghi@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+#ifndef CemrgAhaSegmentation_h
+#define CemrgAhaSegmentation_h
+
+#include <MitkCemrgAppModuleExports.h>
+#include <mitkMatrix.h>
+#include <mitkPoint.h>
+#include <vtkPolyData.h>
+#include <vector>
+
+/**
+ * 16 segment AHA labelling of a left ventricle from its landmarks:
+ * Siemens 4 LM = [apex, basecenter, RV1, RV2]
+ * Siemens 7 LM = [apex, baseMV1, baseMV2, baseMV3, RV1, RV2, apex]
+ * Manual 6 LM = [apex, MV1, MV2, MV3, RV1, RV2]
+ * SetLandmarks fixes the frame (apex at the origin, valve centre on the z axis)
+ * and the sectors of the three layers. Segment maps the points into that frame
+ * in one affine pass, then labels points by their own position and triangles by
+ * their centres, summing the triangle areas of each segment on the way. The mesh
+ * is read, never moved, so the same object can label every frame of a sequence.
+ */
+class MITKCEMRGAPPMODULE_EXPORT CemrgAhaSegmentation {
+
+public:
+
+    CemrgAhaSegmentation();
+    bool SetLandmarks(const std::vector<mitk::Point3D>& landmarks, bool pacingSite = false);
+    void SetSegmentRatios(const int segRatios[3]);
+    bool Segment(vtkPolyData* pd, int numberOfThreads = 0);
+    //x block, then y and z, as in CemrgMeshSequence
+    bool Segment(const double* xyz, vtkIdType numberOfPoints, const vtkIdType* triangles, vtkIdType numberOfCells, int numberOfThreads = 0);
+
+    //Labels are 1 to 16, 0 above the base
+    inline const std::vector<int>& GetPointLabels() const { return pointLabels; };
+    inline const std::vector<int>& GetCellLabels() const { return cellLabels; };
+    inline const std::vector<double>& GetPointAngles() const { return pointAngles; };
+    inline const std::vector<double>& GetCellAreas() const { return cellAreas; };
+    inline const std::vector<double>& GetSegmentAreas() const { return segmentAreas; };
+    inline const std::vector<int>& GetSegmentCounts() const { return segmentCounts; };
+    //Points in the AHA frame, x block, then y and z
+    inline const std::vector<double>& GetLocalPoints() const { return localPoints; };
+    inline const mitk::Matrix<double, 3, 3>& GetRotation() const { return rotation; };
+    inline const mitk::Point3D& GetApex() const { return apex; };
+    inline const mitk::Point3D& GetCentre() const { return centre; };
+
+    static mitk::Point3D ZeroPoint(mitk::Point3D apex, mitk::Point3D point);
+    static mitk::Point3D RotatePoint(mitk::Matrix<double, 3, 3> rotationMatrix, mitk::Point3D point);
+    static mitk::Point3D Circlefit3d(mitk::Point3D point1, mitk::Point3D point2, mitk::Point3D point3);
+    static mitk::Matrix<double, 3, 3> CalcRotationMatrix(mitk::Point3D point1, mitk::Point3D point2);
+
+private:
+
+    struct Sector {
+        double lower, upper;
+        int label;
+    };
+
+    double Angle(double x, double y) const;
+    int Label(int layer, double angle) const;
+
+    bool hasLandmarks;
+    int segmentRatios[3];
+    double appendAngle;
+    mitk::Point3D apex, centre;
+    mitk::Matrix<double, 3, 3> rotation;
+    std::vector<Sector> sectors[3];
+
+    std::vector<double> localPoints, pointAngles, cellAreas, segmentAreas;
+    std::vector<int> pointLabels, cellLabels, segmentCounts;
+};
+
+#endif // CemrgAhaSegmentation_h
@@ -30,34 +30,29 @@ PURPOSE.  See the above copyright notices for more information.
 #define CemrgAhaUtils_h
 
 // Qmitk
-#include <mitkImage.h>
-#include <mitkPointSet.h>
+#include <mitkDataNode.h>
+#include <mitkSurface.h>
 #include <MitkCemrgAppModuleExports.h>
 
-// VTK
-//#include <vtkFloatArray.h>
-#include <vtkSmartPointer.h>
-//#include <vtkMatrix3x3.h>
-
-// #include <MyCemrgLibExports.h>
-
+// C++ Standard
+#include <vector>
 
+/**
+ * AHA mapping of the power transmitter meshes. The labels come from
+ * CemrgAhaSegmentation and are added to the mesh as the "AHA" point array,
+ * the active scalars (e.g. the power intensity) are left as they are.
+ */
 class MITKCEMRGAPPMODULE_EXPORT CemrgAhaUtils {
 
 public:
 
     CemrgAhaUtils();
     mitk::Surface::Pointer ReferenceAHA(mitk::DataNode::Pointer lmNode, mitk::Surface::Pointer refSurface);
+    mitk::Surface::Pointer ReferenceAHA(const std::vector<mitk::Point3D>& landmarks, mitk::Surface::Pointer refSurface);
 
 private:
 
-    // Copied from Strain for AHA mapping
-    mitk::Matrix<double, 3, 3> CalcRotationMatrix(mitk::Point3D point1, mitk::Point3D point2);
-    mitk::Point3D Circlefit3d(mitk::Point3D point1, mitk::Point3D point2, mitk::Point3D point3);
-    mitk::Point3D RotatePoint(mitk::Matrix<double, 3, 3> rotationMatrix, mitk::Point3D point);
-    void RotateVTKMesh(mitk::Matrix<double, 3, 3> rotationMatrix, mitk::Surface::Pointer surface);
-    mitk::Point3D ZeroPoint(mitk::Point3D apex, mitk::Point3D point);
-    void ZeroVTKMesh(mitk::Point3D apex, mitk::Surface::Pointer surface);
+    std::vector<mitk::Point3D> ConvertMPS(mitk::DataNode::Pointer node);
 };
 
 #endif // CemrgAhaUtils_h
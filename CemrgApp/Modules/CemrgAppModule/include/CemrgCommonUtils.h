@@ -34,7 +34,9 @@ PURPOSE.  See the above copyright notices for more information.
 #include <mitkBoundingObject.h>
 #include <mitkDataNode.h>
 #include <mitkDataStorage.h>
+#include <vtkType.h>
 #include <QString>
+#include <functional>
 
 class MITKCEMRGAPPMODULE_EXPORT CemrgCommonUtils {
 
@@ -79,6 +81,10 @@ public:
     //Generic
     static mitk::DataNode::Pointer AddToStorage(mitk::BaseData* data, std::string nodeName, mitk::DataStorage::Pointer ds, bool init = true);
 
+    //Threading Utils
+    static int GetNumberOfThreads(int requested = 0);
+    static void ParallelFor(vtkIdType first, vtkIdType last, std::function<void(vtkIdType, vtkIdType)> body, int numThreads = 0);
+
     //Carp Utils
     static void OriginalCoordinates(QString imagePath, QString pointPath, QString outputPath, double scaling = 1000);
     static void CalculateCentreOfGravity(QString pointPath, QString elemPath, QString outputPath);
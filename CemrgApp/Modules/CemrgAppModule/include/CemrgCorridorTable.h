@@ -0,0 +1,59 @@
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * Corridor Table
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrgapp.com
+ * jose.solislemus@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+#ifndef CemrgCorridorTable_h
+#define CemrgCorridorTable_h
+
+#include <MitkCemrgAppModuleExports.h>
+#include <vtkType.h>
+#include <string>
+#include <vector>
+
+/**
+ * Rows of the corridor CSV, one column per field, gathered in memory while the
+ * corridor is explored and written out in a single buffered write.
+ */
+class MITKCEMRGAPPMODULE_EXPORT CemrgCorridorTable {
+
+public:
+
+    void Clear();
+    void Reserve(size_t rows);
+    void AddRow(int sequence, vtkIdType vertexId, const double* xyz, int depth, double scalar);
+    bool WriteCsv(std::string path, bool append = true) const;
+
+    inline size_t GetNumberOfRows() const { return vertexIds.size(); };
+
+private:
+
+    std::vector<int> sequences, depths;
+    std::vector<vtkIdType> vertexIds;
+    std::vector<double> x, y, z, scalars;
+};
+
+#endif // CemrgCorridorTable_h
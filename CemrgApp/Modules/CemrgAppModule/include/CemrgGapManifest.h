@@ -0,0 +1,70 @@
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * Gap Manifest
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrgapp.com
+ * jose.solislemus@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+#ifndef CemrgGapManifest_h
+#define CemrgGapManifest_h
+
+#include <MitkCemrgAppModuleExports.h>
+#include <vtkType.h>
+#include <QString>
+#include <string>
+#include <vector>
+
+/**
+ * Cases of a batch gap measurement (F&I T2), one per manifest line:
+ *
+ *     # case  mesh                    threshold  point ids
+ *     p01_left  p01/MaxScar.vtk       1.2        1043 2210 3318 4127 5051
+ *
+ * Tokens are separated by spaces, tabs or commas and relative mesh paths are
+ * taken from the manifest folder. Case names name the output files of a case,
+ * so they must be unique (ignoring case). WriteResults writes the summary table,
+ * quoting text fields as CSV needs.
+ */
+class MITKCEMRGAPPMODULE_EXPORT CemrgGapManifest {
+
+public:
+
+    struct GapCase {
+        QString name, mesh;
+        double threshold;
+        std::vector<int> points;
+
+        //Results, -1 until measured
+        QString status;
+        vtkIdType numberOfPoints;
+        double percentage, largestArea, corridorArea;
+        int connectedAreas;
+    };
+
+    static bool Read(QString path, std::vector<GapCase>& cases);
+    static bool WriteResults(QString path, const std::vector<GapCase>& cases, int neighbourhood);
+    static std::string CsvField(const QString& field);
+};
+
+#endif // CemrgGapManifest_h
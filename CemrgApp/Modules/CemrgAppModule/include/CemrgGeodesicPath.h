@@ -0,0 +1,89 @@
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * Geodesic Path
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrgapp.com
+ * jose.solislemus@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+#ifndef CemrgGeodesicPath_h
+#define CemrgGeodesicPath_h
+
+#include <MitkCemrgAppModuleExports.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+#include <utility>
+#include <vector>
+#include "CemrgMeshGraph.h"
+
+/**
+ * Shortest paths along the edges of a mesh, with the weighted edge graph built
+ * once and searched many times. Edge costs follow vtkDijkstraGraphGeodesicPath:
+ * the edge length, divided by the squared scalar of the vertex reached when
+ * scalar weights are on. Single targets use A* with a Euclidean bound, several
+ * targets of one start share one Dijkstra tree. Paths run from the start to the
+ * end vertex, the reverse of the id list of vtkDijkstraGraphGeodesicPath, which
+ * runs from the end back to the start. An unreachable target gives an empty path,
+ * and an empty path gives a polydata without lines.
+ */
+class MITKCEMRGAPPMODULE_EXPORT CemrgGeodesicPath {
+
+public:
+
+    CemrgGeodesicPath();
+    void Build(vtkPolyData* pd, const CemrgMeshGraph& graph, bool useScalarWeights);
+    void Clear();
+    bool IsBuiltFor(vtkPolyData* pd, bool useScalarWeights) const;
+
+    bool ShortestPath(vtkIdType start, vtkIdType end, std::vector<vtkIdType>& path);
+    int ShortestPaths(vtkIdType start, const std::vector<vtkIdType>& targets, std::vector<std::vector<vtkIdType>>& paths);
+    vtkSmartPointer<vtkPolyData> GetPathPolyData(const std::vector<vtkIdType>& path) const;
+
+    inline vtkIdType GetNumberOfVertices() const { return offsets.empty() ? 0 : offsets.size() - 1; };
+
+private:
+
+    std::vector<vtkIdType> offsets, neighbours;
+    std::vector<double> weights, coordinates;
+    double heuristicScale; //smallest cost per unit length over all edges
+
+    //Search state, valid for the vertices stamped with the current epoch
+    typedef std::pair<double, vtkIdType> HeapEntry;
+    std::vector<HeapEntry> heap;
+    std::vector<double> distance;
+    std::vector<vtkIdType> predecessor;
+    std::vector<unsigned int> reachedEpoch, settledEpoch, targetEpoch;
+    unsigned int epoch;
+
+    vtkPolyData* source;
+    vtkMTimeType sourceMTime;
+    vtkIdType sourcePoints;
+    bool sourceWeighted;
+
+    unsigned int NextEpoch();
+    double Heuristic(vtkIdType v, vtkIdType goal) const;
+    unsigned int Search(vtkIdType start, const std::vector<vtkIdType>& targets, vtkIdType goal);
+    bool TracePath(vtkIdType end, unsigned int stamp, std::vector<vtkIdType>& path) const;
+};
+
+#endif // CemrgGeodesicPath_h
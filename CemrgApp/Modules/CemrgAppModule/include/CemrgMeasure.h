@@ -43,6 +43,16 @@ public:
     typedef std::tuple<double, double, double> Point;
     typedef std::vector<Point> Points;
 
+    //Shape of a closed surface mesh, bounds as xmin, xmax, ymin, ymax, zmin, zmax
+    struct Morphology {
+        double surfaceArea;
+        double volume;
+        double sphericity;
+        double normalisedShapeIndex;
+        double centre[3];
+        double bounds[6];
+    };
+
     //Point to Point Tools
     void Convert(QString dir, mitk::DataNode::Pointer);
     Points Deconvert(QString dir, int noFile);
@@ -52,7 +62,11 @@ public:
     mitk::Point3D FindCentre(mitk::PointSet::Pointer pointset);
 
     //Sphericity Tools
-    double GetSphericity(vtkPolyData* poly);
+    double GetSphericity(vtkPolyData* poly, int numberOfThreads = 0);
+
+    //Morphology Tools
+    Morphology GetMorphology(vtkPolyData* poly, int numberOfThreads = 0);
+    std::vector<Morphology> GetMorphology(const std::vector<mitk::Surface::Pointer>& surfaces, int numberOfThreads = 0);
 
     //Mesh Mass Tools
     double calcVolumeMesh(mitk::Surface::Pointer surface);
@@ -65,13 +79,6 @@ private:
     double CalcDist3D(Point& pointA, Point& pointB);
     double Heron(Point& pointA, Point& pointB, Point& centre);
     std::vector<std::string>& Split(const std::string& str, std::vector<std::string>& elements);
-
-    //Sphericity Tools
-    void GetArea(vtkPolyData* polys, double* TiA, double& LACA);
-    void GetCentreOfMass(double** TiMC, double* TiA, int TiMC_size, double LACA, double* LAC_mc);
-    void GetCentreOfMassOfEachT(vtkPolyData* polys, double** TiMC);
-    void GetAverageRadius(double** TiMC, double* TiA, double TiMC_size, double* LAC_mc, double LACA, double& AR);
-    void LASphericity(double** TiMC, double* TiA, double TiMC_size, double* LAC_mc, double LACA, double AR, double& sigma, double& Sphericity);
 };
 
 #endif // CemrgMeasure_h
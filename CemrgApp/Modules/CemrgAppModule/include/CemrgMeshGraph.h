@@ -0,0 +1,71 @@
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * Mesh Graph
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrgapp.com
+ * jose.solislemus@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+#ifndef CemrgMeshGraph_h
+#define CemrgMeshGraph_h
+
+#include <MitkCemrgAppModuleExports.h>
+#include <vtkPolyData.h>
+#include <utility>
+#include <vector>
+
+/**
+ * Vertex adjacency of a surface mesh in compressed sparse row form, built once
+ * from the polygon and strip edges. Neighbourhood queries walk it breadth first
+ * and mark visited vertices with an epoch stamp, so nothing is cleared between them.
+ */
+class MITKCEMRGAPPMODULE_EXPORT CemrgMeshGraph {
+
+public:
+
+    CemrgMeshGraph();
+    void Build(vtkPolyData* pd);
+    void Clear();
+    bool IsBuiltFor(vtkPolyData* pd) const;
+
+    void GetKRing(vtkIdType seed, int maxOrder, std::vector<std::pair<int, int>>& neighbourAndOrder);
+
+    inline vtkIdType GetNumberOfVertices() const { return offsets.empty() ? 0 : offsets.size() - 1; };
+    inline vtkIdType GetDegree(vtkIdType v) const { return offsets[v + 1] - offsets[v]; };
+    inline const vtkIdType* GetNeighbours(vtkIdType v) const { return neighbours.data() + offsets[v]; };
+
+private:
+
+    std::vector<vtkIdType> offsets, neighbours;
+    std::vector<unsigned int> visitedEpoch;
+    std::vector<vtkIdType> frontier;
+    unsigned int epoch;
+
+    vtkPolyData* source;
+    vtkMTimeType sourceMTime;
+    vtkIdType sourcePoints;
+
+    unsigned int NextEpoch();
+};
+
+#endif // CemrgMeshGraph_h
@@ -0,0 +1,99 @@
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * Mesh Sequence
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrgapp.com
+ * orod.razeghi@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+#ifndef CemrgMeshSequence_h
+#define CemrgMeshSequence_h
+
+#include <MitkCemrgAppModuleExports.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+#include <QFile>
+#include <QString>
+#include <memory>
+#include <vector>
+
+/**
+ * Frames of a motion-tracked triangle mesh (transformed-N.vtk) held in memory.
+ * All frames share one copy of the connectivity. The points of a frame are read
+ * once, on first use, and kept as x, y and z blocks of a single buffer.
+ * LoadFrames reads a range of frames in parallel, each into its own slot.
+ * Axes follow CemrgCommonUtils::LoadVTKMesh.
+ *
+ * Save writes the whole sequence to one binary file: a header, the triangles
+ * as 32-bit ids and the x, y and z blocks of every frame in float32. With delta
+ * encoding the frames after the first hold the offset from the first one, which
+ * keeps more precision for small motion. Open memory-maps such a file and
+ * decodes a frame only when it is loaded. SetDirectory opens the sequence file
+ * of the folder when it is newer than the transformed-N.vtk there and has as
+ * many frames, those VTK frames are read otherwise. The sequence file keeps the
+ * points and triangles only, FramesHaveArrays tells whether the VTK frames carry
+ * point or cell arrays that a caller reading the file would lose.
+ */
+class MITKCEMRGAPPMODULE_EXPORT CemrgMeshSequence {
+
+public:
+
+    CemrgMeshSequence();
+    void SetDirectory(QString dir);
+    bool SetTopology(vtkPolyData* pd);
+    bool SetFrame(int frameNo, vtkPolyData* pd);
+    bool LoadFrame(int frameNo);
+    bool LoadFrames(int first, int last, int numberOfThreads = 0);
+    bool Open(QString path);
+    bool Save(QString path, bool deltaEncoding = false) const;
+    void Clear();
+    bool FramesHaveArrays() const;
+
+    inline bool HasFrame(int frameNo) const { return frameNo >= 0 && frameNo < (int)frames.size() && !frames[frameNo].empty(); };
+    inline int GetNumberOfFrames() const { return frames.size(); };
+    inline vtkIdType GetNumberOfPoints() const { return numberOfPoints; };
+    inline vtkIdType GetNumberOfCells() const { return triangles.size() / 3; };
+    inline const vtkIdType* GetTriangles() const { return triangles.data(); };
+    //x block, then y and z, GetNumberOfPoints() values each
+    inline const double* GetFrame(int frameNo) const { return HasFrame(frameNo) ? frames[frameNo].data() : NULL; };
+    QString GetFramePath(int frameNo) const;
+    inline QString GetSequencePath() const { return directory + "/" + SequenceFileName(); };
+    static inline QString SequenceFileName() { return "transformed.cms"; };
+    inline bool IsMapped() const { return mappedFile != nullptr; };
+    vtkSmartPointer<vtkPolyData> GetPolyData(int frameNo) const;
+
+private:
+
+    QString directory;
+    vtkIdType numberOfPoints;
+    std::vector<vtkIdType> triangles;
+    std::vector<std::vector<double>> frames;
+
+    //Binary sequence, frames are decoded from the mapping on demand
+    std::shared_ptr<QFile> mappedFile;
+    const float* mappedFrames;
+    int numberOfMappedFrames;
+    bool mappedDelta;
+};
+
+#endif // CemrgMeshSequence_h
@@ -38,16 +38,30 @@ PURPOSE.  See the above copyright notices for more information.
 #include <vtkFloatArray.h>
 #include <vtkSmartPointer.h>
 #include <vtkMatrix3x3.h>
+#include <vtkPolyData.h>
+
+// C++ Standard
+#include <vector>
 
 class MITKCEMRGAPPMODULE_EXPORT CemrgPower {
 
 public:
 
+    //Centre of the transmitter face and direction of the beam
+    struct TransmitterPose {
+        double centre[3];
+        double normal[3];
+    };
+
     CemrgPower();
     CemrgPower(QString dir, int ribSpacing);
 
     mitk::Surface::Pointer MapPowerTransmitterToLandmarks(mitk::DataNode::Pointer lmNode);
+    bool GetTransmitterPose(vtkPolyData* ebr, TransmitterPose& pose);
+    bool LoadTransmitterPose(int ribSpacing, TransmitterPose& pose);
     mitk::Surface::Pointer CalculateAcousticIntensity(mitk::Surface::Pointer endoMesh);
+    std::vector<mitk::Surface::Pointer> CalculateAcousticIntensity(mitk::Surface::Pointer endoMesh, const std::vector<TransmitterPose>& poses, int numberOfThreads = 0);
+    bool SavePowerMap(mitk::Surface::Pointer mesh, int ribSpacing);
     mitk::Surface::Pointer ReferenceAHA(mitk::PointSet::Pointer lmNode, mitk::Surface::Pointer refSurface);
 
 private:
@@ -55,21 +69,12 @@ private:
     QString projectDirectory;
     int currentRibSpacing;
 
-    double sinc(const double x);
     void normalise(double v[]);
     void crossProduct(double a[], double b[], double product[]);
     double dotProduct(double a[], double b[]);
     std::vector<mitk::Point3D> ConvertMPS(mitk::DataNode::Pointer node);
     void fcn_RotationToUnity(const double v[], vtkSmartPointer<vtkMatrix3x3>& RotationMatrix);
     void fcn_RotationFromTwoVectors(double a[], double b[], vtkSmartPointer<vtkMatrix3x3>& RotationMatrix);
-
-    // Copied from Strain for AHA mapping
-    mitk::Matrix<double, 3, 3> CalcRotationMatrix(mitk::Point3D point1, mitk::Point3D point2);
-    mitk::Point3D Circlefit3d(mitk::Point3D point1, mitk::Point3D point2, mitk::Point3D point3);
-    mitk::Point3D RotatePoint(mitk::Matrix<double, 3, 3> rotationMatrix, mitk::Point3D point);
-    void RotateVTKMesh(mitk::Matrix<double, 3, 3> rotationMatrix, mitk::Surface::Pointer surface);
-    mitk::Point3D ZeroPoint(mitk::Point3D apex, mitk::Point3D point);
-    void ZeroVTKMesh(mitk::Point3D apex, mitk::Surface::Pointer surface);
 };
 
 #endif // CemrgPower_h
@@ -0,0 +1,87 @@
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * Scalar Transfer
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrgapp.com
+ * jose.solislemus@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+#ifndef CemrgScalarTransfer_h
+#define CemrgScalarTransfer_h
+
+#include <MitkCemrgAppModuleExports.h>
+#include <vtkDataArray.h>
+#include <vtkFloatArray.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+#include <vector>
+
+/**
+ * Maps point scalars of a reference mesh onto the points of another mesh.
+ * The reference points are kept in a balanced KD-tree, stored flat and split at
+ * the median of the widest axis, and the query points are mapped in parallel.
+ * Each query point gets a stencil of reference points, then the same stencil
+ * maps every requested array.
+ */
+class MITKCEMRGAPPMODULE_EXPORT CemrgScalarTransfer {
+
+public:
+
+    enum InterpolationMode {
+        NEAREST_POINT = 1,
+        INVERSE_DISTANCE, //inverse squared distance over the nearest neighbours
+        CLOSEST_CELL //barycentric on the closest triangle around the nearest point
+    };
+
+    CemrgScalarTransfer();
+    void SetReference(vtkPolyData* pd);
+    void SetInterpolationMode(int value);
+    void SetNumberOfNeighbours(int value);
+    void SetNumberOfThreads(int value);
+    void SetDefaultValue(double value);
+
+    bool Transfer(vtkPolyData* query, const std::vector<vtkDataArray*>& arrays, std::vector<vtkSmartPointer<vtkFloatArray>>& mapped) const;
+    vtkIdType FindClosestPoint(const double x[3]) const;
+
+    inline vtkIdType GetNumberOfReferencePoints() const { return treeIds.size(); };
+
+private:
+
+    static const int leafSize = 8;
+    static const int maxNeighbours = 16;
+
+    std::vector<double> treePoints; //xyz in tree order
+    std::vector<vtkIdType> treeIds; //reference id at each tree slot
+    std::vector<unsigned char> splitAxis; //axis of the split at each median slot
+    std::vector<double> referencePoints;
+    std::vector<vtkIdType> triangles, pointTriangleOffsets, pointTriangles;
+
+    int interpolationMode, numberOfNeighbours, numberOfThreads;
+    double defaultValue;
+
+    void BuildTree(vtkIdType first, vtkIdType last);
+    void SearchTree(vtkIdType first, vtkIdType last, const double* x, int k, vtkIdType* ids, double* dist2, int& found) const;
+    int GetStencil(const double* x, vtkIdType* ids, double* weights) const;
+};
+
+#endif // CemrgScalarTransfer_h
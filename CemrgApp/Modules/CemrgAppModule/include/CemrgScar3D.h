@@ -34,19 +34,49 @@ PURPOSE.  See the above copyright notices for more information.
 #include <mitkSurface.h>
 #include <mitkPointSet.h>
 #include <vtkFloatArray.h>
+#include <vtkPolyData.h>
 #include <MitkCemrgAppModuleExports.h>
 #include <QString>
+#include <map>
+#include <utility>
+#include "CemrgScarThresholdIndex.h"
+#include "CemrgScarHistogram.h"
 
 class MITKCEMRGAPPMODULE_EXPORT CemrgScar3D {
 
 public:
 
+    //Intensity statistics of one ROI label
+    struct RoiStatistics {
+        double mean, stdv, min, max;
+        unsigned long count;
+    };
+
+    //Return codes of CalculateRoiStatistics
+    enum RoiStatisticsStatus {
+        ROI_STATS_OK = 0,
+        ROI_STATS_NULL_IMAGE,
+        ROI_STATS_SIZE_MISMATCH,
+        ROI_STATS_EMPTY_LABEL
+    };
+
     CemrgScar3D();
+    //Both projections return nullptr when the shell can't be loaded or projected
     mitk::Surface::Pointer Scar3D(std::string directory, mitk::Image::Pointer lgeImage, std::string segname = "segmentation.vtk");
+    mitk::Surface::Pointer Scar3DWindows(
+        std::string directory, mitk::Image::Pointer lgeImage,
+        const std::vector<std::pair<int, int>>& windows, std::string segname = "segmentation.vtk");
+    static QString WindowArrayName(int minStep, int maxStep);
 
     mitk::Surface::Pointer ClipMesh3D(mitk::Surface::Pointer surface, mitk::PointSet::Pointer landmarks);
     bool CalculateMeanStd(mitk::Image::Pointer lgeImage, mitk::Image::Pointer roiImage, double& mean, double& stdv);
+    int CalculateRoiStatistics(
+        mitk::Image::Pointer lgeImage, mitk::Image::Pointer roiImage,
+        const std::vector<int>& labels, std::map<int, RoiStatistics>& statistics);
     double Thresholding(double thresh);
+    std::vector<double> ThresholdingCurve(const std::vector<double>& thresholds);
+    const CemrgScarHistogram& GetHistogram(int numberOfBins = 100);
+    bool SaveHistogramCsv(QString path, int numberOfBins = 100);
     void SaveScarDebugImage(QString name, QString dir);
     void SaveNormalisedScalars(double divisor, mitk::Surface::Pointer surface, QString name);
     void PrintThresholdingResults(QString dir, std::vector<double> values_vector, int threshType, double mean, double stdv, bool printGuide = true);
@@ -57,8 +87,13 @@ public:
     void SetMinStep(int value);
     void SetMaxStep(int value);
     void SetMethodType(int value);
+    void SetSamplingMode(int value);
+    void SetStepSize(double value);
     void SetScarSegImage(const mitk::Image::Pointer image);
     void SetVoxelBasedProjection(bool value);
+    void SetVertexBasedProjection(bool value);
+    void SetNumberOfThreads(int value);
+    int GetNumberOfThreads() const;
 
     inline void SetDebug(bool b){debugging=b;};
     inline void SetDebugOn(){SetDebug(true);};
@@ -69,20 +104,31 @@ private:
     int methodType;
     int minStep, maxStep;
     bool voxelBasedProjection, debugging;
+    bool vertexBasedProjection; //project along point normals and write point scalars
+    bool pointScalars; //scalars of the last projection live on the points
+    int numberOfThreads;
+    int samplingMode; //1 = 3x3x3 voxel neighbourhood, 2 = trilinear along the normal
+    double stepSize; //mm between trilinear samples
     double minScalar, maxScalar;
     vtkSmartPointer<vtkFloatArray> scalars;
+    CemrgScarThresholdIndex thresholdIndex;
+    CemrgScarHistogram histogram;
+    bool histogramValid; //histogram matches the current threshold index
+    QString histogramCsvPath; //file the current histogram was written to
 
     typedef itk::Image<short, 3> itkImageType;
     itkImageType::Pointer scarSegImage;
-    itk::Image<short, 3>::Pointer scarDebugLabel;
-
-    double GetIntensityAlongNormal(
-        itkImageType::Pointer scarImage, itkImageType::Pointer visitedImage,
-        double n_x, double n_y, double n_z, double centre_x, double centre_y, double centre_z);
-    double GetStatisticalMeasure(
-        std::vector<mitk::Point3D> pointsOnAndAroundNormal,
-        itkImageType::Pointer scarImage, itkImageType::Pointer visitedImage, int measure);
-    void ItkDeepCopy(itkImageType::Pointer input, itkImageType::Pointer output);
+    itkImageType::RegionType visitedRegion;
+    std::vector<bool> visitedVoxels;
+
+    void UpdateThresholdIndex();
+    vtkSmartPointer<vtkPolyData> LoadShellWithNormals(std::string path, mitk::Surface::Pointer& surface);
+    bool ProjectLgeImage(
+        mitk::Image::Pointer lgeImage, vtkPolyData* pd,
+        const std::vector<std::pair<int, int>>& windows, std::vector<std::vector<double>>& intensities);
+    template <typename TPixel> bool ProjectLge(
+        mitk::Image::Pointer lgeImage, vtkPolyData* pd,
+        const std::vector<std::pair<int, int>>& windows, std::vector<std::vector<double>>& intensities);
 };
 
 #endif // CemrgScar3D_h
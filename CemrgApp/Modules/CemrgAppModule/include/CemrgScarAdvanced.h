@@ -34,6 +34,11 @@ PURPOSE.  See the above copyright notices for more information.
 #include <mitkPointSet.h>
 #include <vtkFloatArray.h>
 #include <MitkCemrgAppModuleExports.h>
+#include "CemrgScarThresholdIndex.h"
+#include "CemrgMeshGraph.h"
+#include "CemrgGeodesicPath.h"
+#include "CemrgScarComponents.h"
+#include "CemrgScalarTransfer.h"
 
 // VTK
 #include <vtkAppendFilter.h>
@@ -98,6 +103,9 @@ public:
     double _fill_threshold;
     double _max_scalar;
     bool _weightedcorridor;
+    bool _corridorvtp; // corridor arrays in one binary exploration.vtp instead of three legacy files
+    bool _corridormeshes; // save the corridor meshes, measurements only when off
+    int _transfer_interpolation; // CemrgScalarTransfer::InterpolationMode used by TransformSource2Target
     std::string _fileOutName;
     std::string _outPath;
     std::string _prefix;
@@ -110,7 +118,6 @@ public:
     double fi3_totalPoints, fi3_emptyPoints, fi3_healthy, fi3_preScar, fi3_postScar, fi3_overlapScar;
     std::string fi1_fname, fi2_fname, fi3_fname;
 
-    std::vector<std::pair<int, int> > _visited_point_list; // stores the neighbours around a point
     std::vector<vtkSmartPointer<vtkPolyData> > _paths; // container to store shortest paths between points
     std::vector<vtkSmartPointer<vtkPolyDataMapper> > _pathMappers;
     std::vector<vtkSmartPointer<vtkActor> > _actors;
@@ -122,7 +129,7 @@ public:
     vtkSmartPointer<vtkPolyData> _source;
     vtkSmartPointer<vtkPolyData> _target;
 
-    std::vector<vtkSmartPointer<vtkDijkstraGraphGeodesicPath> > _shortestPaths;
+    std::vector<std::vector<vtkIdType> > _shortestPaths; // vertex ids along each path
     std::vector<int> _pointidarray;
     std::vector<int> _corridoridarray;
 
@@ -146,6 +153,16 @@ public:
     inline void SetWeightedCorridorOn() { SetWeightedCorridorBool(true); };
     inline void SetWeightedCorridorOff() { SetWeightedCorridorBool(false); };
 
+    inline void SetCorridorVtpBool(bool vtp) { _corridorvtp = vtp; };
+    inline void SetCorridorVtpOn() { SetCorridorVtpBool(true); };
+    inline void SetCorridorVtpOff() { SetCorridorVtpBool(false); };
+
+    inline void SetCorridorMeshesBool(bool meshes) { _corridormeshes = meshes; };
+    inline void SetCorridorMeshesOn() { SetCorridorMeshesBool(true); };
+    inline void SetCorridorMeshesOff() { SetCorridorMeshesBool(false); };
+
+    inline void SetTransferInterpolation(int mode) { _transfer_interpolation = mode; };
+
     inline void SetNeighbourhoodSize(int s) { _neighbourhood_size = s; };
     inline void SetFillThreshold(double s) { _fill_threshold = s; };
     inline void SetMaxScalar(double s) { _max_scalar = s; };
@@ -189,12 +206,10 @@ public:
     void ScarScore(double thres);
 
     // F&I T2
-    void ExtractCorridorData(std::vector<vtkSmartPointer<vtkDijkstraGraphGeodesicPath>> allShortestPaths);
+    void ExtractCorridorData(const std::vector<std::vector<vtkIdType>>& allShortestPaths);
     void NeighbourhoodFillingPercentage(std::vector<int> points);
-    int RecursivePointNeighbours(vtkIdType pointId, int order);
     void GetNeighboursAroundPoint2(int pointID, std::vector<std::pair<int, int>>& pointNeighbourAndOrder, int max_order);
-    void getCorridorPoints(std::vector<vtkSmartPointer<vtkDijkstraGraphGeodesicPath>> allShortestPaths);
-    bool InsertPointIntoVisitedList2(vtkIdType id, int order);
+    void getCorridorPoints(const std::vector<std::vector<vtkIdType>>& allShortestPaths);
     void CorridorFromPointList(std::vector<int> points, bool circleToStart = true);
 
     // F&I T3
@@ -202,5 +217,19 @@ public:
     void TransformSource2Target();
 
     CemrgScarAdvanced();
+
+private:
+
+    CemrgScarThresholdIndex _scarScoreIndex;
+    CemrgScarThresholdIndex& ScarScoreIndex();
+
+    CemrgMeshGraph _meshGraph;
+    CemrgMeshGraph& MeshGraph();
+
+    CemrgGeodesicPath _geodesicPath;
+    CemrgGeodesicPath& GeodesicPath();
+
+    CemrgScarComponents _scarComponents;
+    CemrgScarComponents& ScarComponents(double maxscalar);
 };
 #endif // CemrgScarAdvanced_h
@@ -0,0 +1,75 @@
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * Scar Components
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrgapp.com
+ * jose.solislemus@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+#ifndef CemrgScarComponents_h
+#define CemrgScarComponents_h
+
+#include <MitkCemrgAppModuleExports.h>
+#include <vtkDataArray.h>
+#include <vtkPolyData.h>
+#include <vector>
+
+/**
+ * Connected scar regions of a shell for every threshold at once. Polygons are
+ * added in descending order of the threshold that lets them in and merged with
+ * union-find through shared points, keeping the area of each region as it grows.
+ * Inclusion follows vtkPolyDataConnectivityFilter with point scalars in
+ * [threshold, maxScalar]: any overlap of the cell's range, or all of its points
+ * with full scalar connectivity. The largest region is the one with most cells.
+ */
+class MITKCEMRGAPPMODULE_EXPORT CemrgScarComponents {
+
+public:
+
+    CemrgScarComponents();
+    void Build(vtkPolyData* pd, vtkDataArray* scalars, double maxScalar, bool fullScalarConnectivity);
+    void Clear();
+    bool IsBuiltFor(vtkPolyData* pd, vtkDataArray* scalars, double maxScalar, bool fullScalarConnectivity) const;
+
+    double GetLargestArea(double threshold) const;
+    int GetNumberOfComponents(double threshold) const;
+    inline double GetTotalArea() const { return totalArea; };
+
+private:
+
+    //One entry per distinct threshold, in descending order
+    std::vector<double> levels, largestAreas;
+    std::vector<int> componentCounts;
+    double totalArea;
+
+    vtkPolyData* source;
+    vtkMTimeType sourceMTime;
+    vtkDataArray* sourceScalars;
+    vtkMTimeType scalarsMTime;
+    double sourceMaxScalar;
+    bool sourceFull;
+
+    size_t NumberOfLevelsAbove(double threshold) const;
+};
+
+#endif // CemrgScarComponents_h
@@ -0,0 +1,72 @@
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * Scar Histogram
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrgapp.com
+ * orod.razeghi@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+#ifndef CemrgScarHistogram_h
+#define CemrgScarHistogram_h
+
+#include <MitkCemrgAppModuleExports.h>
+#include <QString>
+#include <vector>
+#include "CemrgScarThresholdIndex.h"
+
+/**
+ * Distribution of the finite scalars of a shell, taken from a threshold index.
+ * Fixed bins split [min, max] evenly, quantile bins hold equal shares of the
+ * scalars. Fixed bins hold the values in (lower, upper]. The cumulative
+ * percentages count the scalars at or below each upper edge and the above
+ * percentages the ones strictly above it, the comparison CemrgScar3D::Thresholding
+ * uses, which gives the threshold versus scar percentage curve without a rescan.
+ * Percentages are of the finite scalars, so they match Thresholding on shells
+ * without NaN or infinite values.
+ */
+class MITKCEMRGAPPMODULE_EXPORT CemrgScarHistogram {
+
+public:
+
+    CemrgScarHistogram();
+    void Build(const CemrgScarThresholdIndex& index, int numberOfBins, int numberOfThreads = 0);
+    void Clear();
+    bool ExportCsv(QString path) const;
+
+    inline int GetNumberOfBins() const { return counts.size(); };
+    inline vtkIdType GetNumberOfValues() const { return numberOfValues; };
+    inline const std::vector<double>& GetEdges() const { return edges; };
+    inline const std::vector<vtkIdType>& GetCounts() const { return counts; };
+    inline const std::vector<double>& GetCumulativePercentages() const { return cumulative; };
+    inline const std::vector<double>& GetAbovePercentages() const { return above; };
+    inline const std::vector<double>& GetQuantileEdges() const { return quantileEdges; };
+    inline const std::vector<vtkIdType>& GetQuantileCounts() const { return quantileCounts; };
+
+private:
+
+    vtkIdType numberOfValues;
+    std::vector<double> edges, cumulative, above, quantileEdges;
+    std::vector<vtkIdType> counts, quantileCounts;
+};
+
+#endif // CemrgScarHistogram_h
@@ -0,0 +1,177 @@
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * Scar Projection Engine
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrgapp.com
+ * orod.razeghi@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+#ifndef CemrgScarProjection_h
+#define CemrgScarProjection_h
+
+#include <MitkCemrgAppModuleExports.h>
+#include <itkImage.h>
+#include <vtkPolyData.h>
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+/**
+ * Reducers of the intensities sampled along one normal, chosen at compile time.
+ * A reducer that claims voxels returns the maximum and marks the voxel it came from
+ * as visited, which is what voxel based projection relies on. Reducers with FromSteps
+ * can also be rebuilt from per-step partials, which the window sweep uses.
+ */
+struct CemrgProjectionMean {
+    static const bool ClaimsVoxels = false;
+    static double Reduce(std::vector<double>& values) {
+        double sum = 0;
+        for (double v : values)
+            sum += v;
+        return values.empty() ? 0 : sum / values.size();
+    }
+    static double FromSteps(double sum, double max, size_t count) {
+        return (count == 0) ? 0 : sum / count;
+    }
+};
+
+struct CemrgProjectionMax {
+    static const bool ClaimsVoxels = true;
+    static double Reduce(std::vector<double>& values) {
+        double max = -1;
+        for (double v : values)
+            if (v > max) max = v;
+        return (max == -1) ? 0 : max;
+    }
+    static double FromSteps(double sum, double max, size_t count) {
+        return (max == -1) ? 0 : max;
+    }
+};
+
+struct CemrgProjectionSum {
+    static const bool ClaimsVoxels = false;
+    static double Reduce(std::vector<double>& values) {
+        double sum = 0;
+        for (double v : values)
+            sum += v;
+        return sum;
+    }
+    static double FromSteps(double sum, double max, size_t count) {
+        return sum;
+    }
+};
+
+template <int Percent>
+struct CemrgProjectionPercentile {
+    static const bool ClaimsVoxels = false;
+    static double Reduce(std::vector<double>& values) {
+        if (values.empty())
+            return 0;
+        //Linear interpolation between the two closest ranks
+        double rank = (values.size() - 1) * Percent / 100.0;
+        size_t lower = rank;
+        std::nth_element(values.begin(), values.begin() + lower, values.end());
+        double lowerValue = values[lower];
+        if (lower + 1 >= values.size())
+            return lowerValue;
+        double upperValue = *std::min_element(values.begin() + lower + 1, values.end());
+        return lowerValue + (rank - lower) * (upperValue - lowerValue);
+    }
+};
+
+struct CemrgProjectionMedian : CemrgProjectionPercentile<50> {};
+
+/**
+ * Samples an LGE image along the normals of a mesh and reduces the samples to one
+ * value per cell, or per vertex when the point geometry is used. Shared by CemrgScar3D and the projection command-line apps.
+ * Pixel types short, float, double and unsigned char are instantiated in the module.
+ */
+template <typename TPixel>
+class MITKCEMRGAPPMODULE_EXPORT CemrgScarProjection {
+
+public:
+
+    typedef itk::Image<TPixel, 3> ImageType;
+    typedef itk::Image<short, 3> SegImageType;
+
+    CemrgScarProjection();
+    void SetImage(typename ImageType::Pointer image);
+    void SetSegmentation(SegImageType::Pointer image);
+    void SetSteps(int minStep, int maxStep);
+    void SetSamplingMode(int value);
+    void SetStepSize(double value);
+    void SetVoxelBasedProjection(bool value);
+    void SetNumberOfThreads(int value);
+
+    bool ComputeCellGeometry(vtkPolyData* pd);
+    bool ComputePointGeometry(vtkPolyData* pd);
+    template <class TReducer> bool Project(std::vector<double>& intensities);
+    template <class TReducer> bool ProjectWindows(
+        const std::vector<std::pair<int, int>>& windows, std::vector<std::vector<double>>& intensities);
+
+    inline const std::vector<bool>& GetVisitedVoxels() const { return visitedVoxels; };
+    inline itk::ImageRegion<3> GetRegion() const { return region; };
+    inline void SwapVisitedVoxels(std::vector<bool>& other) { visitedVoxels.swap(other); };
+
+private:
+
+    typename ImageType::Pointer scarImage;
+    SegImageType::Pointer segImage;
+    itk::ImageRegion<3> region;
+    std::vector<bool> visitedVoxels;
+    std::vector<double> centresXYZ, normalsXYZ;
+
+    int minStep, maxStep;
+    int samplingMode; //1 = 3x3x3 voxel neighbourhood, 2 = trilinear along the normal
+    double stepSize; //mm between trilinear samples
+    bool voxelBasedProjection;
+    int numberOfThreads;
+
+    //Sampling stencil over the raw image buffers
+    itk::OffsetValueType stencilOrigin, stencilStrides[3], stencilSize[3];
+    itk::OffsetValueType neighbourhoodOffsets[27];
+    static const int interpolationLanes = 8; //normals interpolated together
+
+    bool ComputeGeometry(vtkPolyData* pd, bool onPoints);
+    void PrepareSamplingStencil();
+    bool IsCutRegion(const std::vector<itk::OffsetValueType>& samples, const short* segBuffer) const;
+    template <class TReducer> double ReduceSamples(
+        const std::vector<itk::OffsetValueType>& samples, std::vector<double>& values, const short* segBuffer);
+    int GetNumberOfSteps() const;
+    void SampleCells(
+        const TPixel* scarBuffer, const double* normals, const double* centres, int lanes,
+        std::vector<itk::OffsetValueType>* samples, std::vector<double>* values, std::vector<size_t>* stepEnds = NULL) const;
+    void GetSamplesAlongNormal(
+        const TPixel* scarBuffer, const double* normal, const double* centre,
+        std::vector<itk::OffsetValueType>& samples, std::vector<double>& values, std::vector<size_t>* stepEnds) const;
+    void InterpolateAlongNormals(
+        const TPixel* scarBuffer, const double* normals, const double* centres, int lanes,
+        std::vector<itk::OffsetValueType>* samples, std::vector<double>* values, std::vector<size_t>* stepEnds) const;
+    int GetMaxCandidates(
+        const std::vector<itk::OffsetValueType>& samples, const std::vector<double>& values, const short* segBuffer,
+        int maxCandidates, itk::OffsetValueType* offsets, double* candidateValues, std::vector<std::pair<double, int>>& ranking) const;
+    template <class TReducer> void ProjectInParallel(
+        const TPixel* scarBuffer, const short* segBuffer, std::vector<double>& intensities);
+};
+
+#endif // CemrgScarProjection_h
@@ -0,0 +1,70 @@
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * Scar Threshold Index
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrgapp.com
+ * orod.razeghi@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+#ifndef CemrgScarThresholdIndex_h
+#define CemrgScarThresholdIndex_h
+
+#include <MitkCemrgAppModuleExports.h>
+#include <vtkDataArray.h>
+#include <vector>
+
+/**
+ * Sorted copy of the finite scalars of a shell. Built once, it answers the
+ * percentage of valid scalars above any threshold with a binary search.
+ * The excluded value is left out. Non-finite scalars are counted apart and
+ * kept in the percentage as the linear count did: NaN and -inf are never
+ * above a threshold, +inf is above any threshold but +inf and NaN.
+ */
+class MITKCEMRGAPPMODULE_EXPORT CemrgScarThresholdIndex {
+
+public:
+
+    CemrgScarThresholdIndex();
+    void Build(vtkDataArray* scalars, double excludedValue);
+    void Clear();
+    bool IsBuiltFor(vtkDataArray* scalars) const;
+
+    double Percentage(double thresh) const;
+    std::vector<double> Percentages(const std::vector<double>& thresholds) const;
+
+    inline vtkIdType GetNumberOfValid() const { return sortedScalars.size() + numberOfNonFinite; };
+    inline vtkIdType GetNumberOfFinite() const { return sortedScalars.size(); };
+    inline vtkIdType GetNumberOfExcluded() const { return numberOfExcluded; };
+    inline vtkIdType GetNumberOfNonFinite() const { return numberOfNonFinite; };
+    inline const std::vector<double>& GetSortedScalars() const { return sortedScalars; };
+
+private:
+
+    std::vector<double> sortedScalars;
+    vtkIdType numberOfExcluded, numberOfNonFinite, numberOfPositiveInfinite;
+    vtkDataArray* source;
+    vtkMTimeType sourceMTime;
+    vtkIdType sourceTuples;
+};
+
+#endif // CemrgScarThresholdIndex_h
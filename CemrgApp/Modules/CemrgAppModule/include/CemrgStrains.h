@@ -33,11 +33,39 @@ PURPOSE.  See the above copyright notices for more information.
 #include <vtkCell.h>
 #include <vtkFloatArray.h>
 #include <MitkCemrgAppModuleExports.h>
+#include "CemrgMeshSequence.h"
+
+/**
+ * Values of every frame from one CemrgStrains::CalculateAllPlots pass.
+ * Segment averages are stored frame by frame, with the 16 AHA segments and then
+ * the components inside each frame. Cell values hold the per cell numbers behind
+ * the averages, in the order of the flattened AHA mesh.
+ */
+struct MITKCEMRGAPPMODULE_EXPORT CemrgStrainSeries {
+
+    int numberOfFrames;
+    int numberOfCells;
+    std::vector<double> segments;
+    std::vector<float> cells;
+
+    CemrgStrainSeries();
+    double Get(int frame, int segment, int component) const;
+    std::vector<double> GetSegmentValues(int frame, int component) const;
+    vtkSmartPointer<vtkFloatArray> GetCellValues(int frame, int component) const;
+};
 
 class MITKCEMRGAPPMODULE_EXPORT CemrgStrains {
 
 public:
 
+    //Components of CalculateAllPlots, flag n of CalculateStrainsPlot is FlagComponent(n)
+    enum StrainComponent {
+        RADIAL_SMALL, CIRCUMFERENTIAL_SMALL, LONGITUDINAL_SMALL,
+        RADIAL_LARGE, CIRCUMFERENTIAL_LARGE, LONGITUDINAL_LARGE,
+        SQUEEZE, NUMBER_OF_COMPONENTS
+    };
+    static inline int FlagComponent(int flag) { return (flag > 2) ? flag + 1 : flag; };
+
     CemrgStrains();
     CemrgStrains(QString dir, int refMeshNo);
     ~CemrgStrains();
@@ -45,6 +73,8 @@ public:
     double CalculateGlobalSqzPlot(int meshNo);
     std::vector<double> CalculateSqzPlot(int meshNo);
     std::vector<double> CalculateStrainsPlot(int meshNo, mitk::DataNode::Pointer lmNode, int flag);
+    CemrgStrainSeries CalculateAllPlots(int numberOfFrames, mitk::DataNode::Pointer lmNode);
+    inline void SetNumberOfThreads(int value) { numberOfThreads = value; };
     double CalculateSDI(std::vector<std::vector<double>> valueVectors, int cycleLengths, int noFrames);
 
     std::vector<mitk::Surface::Pointer> ReferenceGuideLines(mitk::DataNode::Pointer lmNode);
@@ -55,41 +85,41 @@ public:
 
 protected:
 
-    mitk::Point3D ZeroPoint(mitk::Point3D apex, mitk::Point3D point);
-    void ZeroVTKMesh(mitk::Point3D apex, mitk::Surface::Pointer surface);
-
-    mitk::Point3D RotatePoint(mitk::Matrix<double, 3, 3> rotationMatrix, mitk::Point3D point);
-    void RotateVTKMesh(mitk::Matrix<double, 3, 3> rotationMatrix, mitk::Surface::Pointer surface);
-
-    double GetCellArea(vtkSmartPointer<vtkPolyData> pd, vtkIdType cellID);
-    mitk::Point3D GetCellCenter(vtkSmartPointer<vtkPolyData> pd, vtkIdType cellID);
-    mitk::Matrix<double, 3, 3> GetCellAxes(vtkSmartPointer<vtkCell> &cell, mitk::Point3D &termPt, mitk::Matrix<double, 3, 3> &J);
+    mitk::Matrix<double, 3, 3> GetCellAxes(const double* pt1, const double* pt2, const double* pt3, const mitk::Point3D& termPt, mitk::Matrix<double, 3, 3>& J);
 
 private:
 
     mitk::Surface::Pointer ReadVTKMesh(int refMshNo);
+    const double* Frame(int meshNo);
+    bool FrameTransform(mitk::DataNode::Pointer lmNode, mitk::Matrix<double, 3, 3>& rotation);
+    std::vector<double> StorePlot(const std::vector<double>& segments, const std::vector<float>& cells, int component);
+    void StrainAxes(const mitk::Matrix<double, 3, 3>& rotation, std::vector<double>& axes) const;
+    void TriangleAreas(const double* xyz, std::vector<double>& areas) const;
+    void FrameSqueeze(const double* xyz, double* segments, float* cells) const;
+    void FrameStrains(const double* xyz, const std::vector<double>& axes, double* segments, float* cells) const;
     std::vector<mitk::Point3D> ConvertMPS(mitk::DataNode::Pointer node);
 
     double Norm(mitk::Point3D vec);
     double Dot(mitk::Point3D vec1, mitk::Point3D vec2);
     mitk::Point3D Cross(mitk::Point3D vec1, mitk::Point3D vec2);
     std::vector<double> GetMinMax(vtkSmartPointer<vtkPolyData> pd, int dimension);
-    mitk::Point3D Circlefit3d(mitk::Point3D point1, mitk::Point3D point2, mitk::Point3D point3);
-    mitk::Matrix<double, 3, 3> CalcRotationMatrix(mitk::Point3D point1, mitk::Point3D point2);
-
-    void AssignpLabels(int layer, std::vector<double>& pLabel, std::vector<int> index, std::vector<double> pAngles, double sepA, double freeA);
-    void AssigncLabels(int layer, std::vector<int>& refCellLabels, std::vector<int> index, std::vector<double> cAngles, double sepA, double freeA);
 
     QString projectDirectory;
     std::vector<double> refArea;
     std::vector<double> refAhaArea;
-    std::vector<mitk::Matrix<double, 3, 3>> refJ;
-    std::vector<mitk::Matrix<double, 3, 3>> refQ;
+    std::vector<double> refGlobalArea; //every cell of the first frame, for the global squeeze
+    //Per AHA cell, one row per entry: p_i = J^-1 q_i (9 rows), then the local axes q_i (9 rows)
+    std::vector<double> refStrainBasis;
+    static const int strainLanes = 64; //triangles per batch of the strain kernel
     std::vector<int> refCellLabels;
+    std::vector<vtkIdType> refAhaCells;
+    std::vector<int> refAhaCount;
     std::vector<double> refPointLabels;
     mitk::Surface::Pointer refSurface;
     mitk::Surface::Pointer flatSurface;
     vtkSmartPointer<vtkFloatArray> flatSurfScalars;
+    CemrgMeshSequence frames;
+    int numberOfThreads;
 };
 
 #endif // CemrgStrains_h
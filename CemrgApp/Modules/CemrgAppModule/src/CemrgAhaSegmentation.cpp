@@ -0,0 +1,440 @@
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * AHA Segmentation
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrgapp.com
+ * orod.razeghi@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+// Qmitk
+#include <mitkLogMacros.h>
+
+// VTK
+#include <vtkCellType.h>
+#include <vtkIdList.h>
+#include <vtkSmartPointer.h>
+
+// C++ Standard
+#include <algorithm>
+#include <cmath>
+
+// CemrgApp
+#include "CemrgCommonUtils.h"
+#include "CemrgAhaSegmentation.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+CemrgAhaSegmentation::CemrgAhaSegmentation() {
+
+    hasLandmarks = false;
+    segmentRatios[0] = 40;
+    segmentRatios[1] = 40;
+    segmentRatios[2] = 20;
+    appendAngle = 0;
+    rotation.SetIdentity();
+}
+
+void CemrgAhaSegmentation::SetSegmentRatios(const int segRatios[3]) {
+
+    std::copy(segRatios, segRatios + 3, segmentRatios);
+}
+
+bool CemrgAhaSegmentation::SetLandmarks(const std::vector<mitk::Point3D>& landmarks, bool pacingSite) {
+
+    hasLandmarks = false;
+    if (landmarks.size() != 4 && landmarks.size() != 6 && landmarks.size() != 7) {
+        MITK_WARN << "AHA segmentation needs 4, 6 or 7 landmarks, " << landmarks.size() << " given.";
+        return false;
+    }//_if
+
+    //Calculate a circle through the mitral valve points
+    mitk::Point3D RIV1, RIV2, centreRaw;
+    apex = landmarks.at(0);
+    if (landmarks.size() >= 6) {
+        RIV1 = landmarks.at(4);
+        RIV2 = landmarks.at(5);
+        centreRaw = Circlefit3d(ZeroPoint(apex, landmarks.at(1)), ZeroPoint(apex, landmarks.at(2)), ZeroPoint(apex, landmarks.at(3)));
+    } else {
+        RIV1 = landmarks.at(2);
+        RIV2 = landmarks.at(3);
+        centreRaw = ZeroPoint(apex, landmarks.at(1));
+    }//_if
+
+    //Rotate the landmarks relative to the apex to the new frame
+    RIV1 = ZeroPoint(apex, RIV1);
+    RIV2 = ZeroPoint(apex, RIV2);
+    rotation = CalcRotationMatrix(centreRaw, RIV2);
+    RIV1 = RotatePoint(rotation, RIV1);
+    RIV2 = RotatePoint(rotation, RIV2);
+    centre = RotatePoint(rotation, centreRaw);
+
+    //Angle RV cusps, assuming RV angle1 < RV angle 2
+    double RVangle1 = atan2(RIV1.GetElement(1), RIV1.GetElement(0));
+    double RVangle2 = atan2(RIV2.GetElement(1), RIV2.GetElement(0));
+    double sepA, freeA;
+    if ((landmarks.size() == 6) && (pacingSite == false)) {
+
+        // only do this for manual segmentation, with 6 points
+        sepA = (RVangle2 - RVangle1) / 2;
+        freeA = (2 * M_PI - (RVangle2 - RVangle1)) / 4;
+        appendAngle = -RVangle1;
+
+    } else {
+
+        sepA = (2 * M_PI) / 6;
+        freeA = (2 * M_PI) / 6;
+        if (RVangle1 > 0) {
+            appendAngle = -((M_PI - RVangle1) / 2 + RVangle1) + M_PI / 3;
+        } else {
+            appendAngle = -RVangle1 / 2 + M_PI / 3;
+        }//_if
+        if (pacingSite == true)
+            appendAngle += M_PI / 6;
+
+    }//_if
+
+    //Sectors of the base, mid and apical layers, a later sector wins on overlaps
+    const std::vector<int> oLab[3] = {{3, 2, 1, 6, 5, 4}, {9, 8, 7, 12, 11, 10}, {14, 13, 16, 15}};
+    const std::vector<double> WID[3] = {
+        {sepA, sepA, freeA, freeA, freeA, freeA},
+        {sepA, sepA, freeA, freeA, freeA, freeA},
+        {M_PI / 2, M_PI / 2, M_PI / 2, M_PI / 2}};
+    for (int layer = 0; layer < 3; layer++) {
+        double Csec = (layer == 2) ? sepA - M_PI / 4 : 0;
+        sectors[layer].clear();
+        for (size_t i = 0; i < oLab[layer].size(); i++) {
+            double Upper = Csec + WID[layer].at(i);
+            double Lower = Csec;
+            sectors[layer].push_back(Sector{Lower, Upper, oLab[layer].at(i)});
+            if (Lower < 0)
+                sectors[layer].push_back(Sector{2 * M_PI + Lower, 2 * M_PI, oLab[layer].at(i)});
+            if (Upper > 2 * M_PI)
+                sectors[layer].push_back(Sector{0, Upper - 2 * M_PI, oLab[layer].at(i)});
+            Csec = Csec + WID[layer].at(i);
+        }//_for
+    }//_for
+
+    hasLandmarks = true;
+    return true;
+}
+
+bool CemrgAhaSegmentation::Segment(vtkPolyData* pd, int numberOfThreads) {
+
+    if (pd == NULL)
+        return false;
+
+    //Raw buffers of the mesh, triangles only
+    vtkIdType numPoints = pd->GetNumberOfPoints();
+    vtkIdType numCells = pd->GetNumberOfCells();
+    std::vector<double> xyz(3 * numPoints);
+    double pt[3];
+    for (vtkIdType i = 0; i < numPoints; i++) {
+        pd->GetPoint(i, pt);
+        xyz[i] = pt[0];
+        xyz[i + numPoints] = pt[1];
+        xyz[i + 2 * numPoints] = pt[2];
+    }//_for
+
+    std::vector<vtkIdType> triangles(3 * numCells);
+    vtkSmartPointer<vtkIdList> cellPoints = vtkSmartPointer<vtkIdList>::New();
+    for (vtkIdType i = 0; i < numCells; i++) {
+        pd->GetCellPoints(i, cellPoints);
+        if (pd->GetCellType(i) != VTK_TRIANGLE || cellPoints->GetNumberOfIds() != 3) {
+            MITK_ERROR << "AHA segmentation needs a triangle mesh, cell " << i << " is not one.";
+            return false;
+        }//_if
+        for (int j = 0; j < 3; j++)
+            triangles[3 * i + j] = cellPoints->GetId(j);
+    }//_for
+
+    return Segment(xyz.data(), numPoints, triangles.data(), numCells, numberOfThreads);
+}
+
+bool CemrgAhaSegmentation::Segment(const double* xyz, vtkIdType numberOfPoints, const vtkIdType* triangles, vtkIdType numberOfCells, int numberOfThreads) {
+
+    if (!hasLandmarks) {
+        MITK_ERROR << "AHA segmentation needs landmarks before a mesh.";
+        return false;
+    }//_if
+
+    //Top, mid, and base segments heights, from the apex to the valve centre
+    double min = 0;
+    double max = centre.GetElement(2);
+    double RangeZ = (max - min) * 1.0;
+    double TOP = RangeZ * (segmentRatios[0] / 100.00 + segmentRatios[1] / 100.00 + segmentRatios[2] / 100.0) + min;
+    double MID = RangeZ * (segmentRatios[1] / 100.00 + segmentRatios[2] / 100.0) + min;
+    double BAS = RangeZ * (segmentRatios[2] / 100.0) + min;
+
+    //Apex translation and rotation as one affine map: local = R p - R apex
+    double R[3][3], T[3];
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++)
+            R[i][j] = rotation[i][j];
+        T[i] = -(R[i][0] * apex.GetElement(0) + R[i][1] * apex.GetElement(1) + R[i][2] * apex.GetElement(2));
+    }//_for
+
+    const double* x = xyz;
+    const double* y = x + numberOfPoints;
+    const double* z = y + numberOfPoints;
+    localPoints.resize(3 * numberOfPoints);
+    pointAngles.resize(numberOfPoints);
+    pointLabels.resize(numberOfPoints);
+    double* lx = localPoints.data();
+    double* ly = lx + numberOfPoints;
+    double* lz = ly + numberOfPoints;
+
+    //Points: position, angle and label in one pass
+    CemrgCommonUtils::ParallelFor(0, numberOfPoints, [&](vtkIdType first, vtkIdType last) {
+        for (vtkIdType i = first; i < last; i++) {
+            lx[i] = R[0][0] * x[i] + R[0][1] * y[i] + R[0][2] * z[i] + T[0];
+            ly[i] = R[1][0] * x[i] + R[1][1] * y[i] + R[1][2] * z[i] + T[1];
+            lz[i] = R[2][0] * x[i] + R[2][1] * y[i] + R[2][2] * z[i] + T[2];
+            pointAngles[i] = Angle(lx[i], ly[i]);
+            int layer = (lz[i] >= MID && lz[i] <= TOP) ? 0 : (lz[i] >= BAS && lz[i] < MID) ? 1 : (lz[i] < BAS) ? 2 : -1;
+            pointLabels[i] = Label(layer, pointAngles[i]);
+        }//_for
+    }, numberOfThreads);
+
+    //Cells: centre, label and area, each block keeps its own segment sums
+    int blocks = CemrgCommonUtils::GetNumberOfThreads(numberOfThreads);
+    std::vector<double> blockAreas(16 * blocks, 0);
+    std::vector<int> blockCounts(16 * blocks, 0);
+    cellLabels.resize(numberOfCells);
+    cellAreas.resize(numberOfCells);
+    CemrgCommonUtils::ParallelFor(0, blocks, [&](vtkIdType firstBlock, vtkIdType lastBlock) {
+        for (vtkIdType b = firstBlock; b < lastBlock; b++) {
+            vtkIdType first = numberOfCells * b / blocks;
+            vtkIdType last = numberOfCells * (b + 1) / blocks;
+            for (vtkIdType c = first; c < last; c++) {
+                const vtkIdType* ids = triangles + 3 * c;
+                double cx = (lx[ids[0]] + lx[ids[1]] + lx[ids[2]]) / 3;
+                double cy = (ly[ids[0]] + ly[ids[1]] + ly[ids[2]]) / 3;
+                double cz = (lz[ids[0]] + lz[ids[1]] + lz[ids[2]]) / 3;
+                int layer = (cz >= MID && cz < TOP) ? 0 : (cz >= BAS && cz < MID) ? 1 : (cz < BAS) ? 2 : -1;
+                cellLabels[c] = Label(layer, Angle(cx, cy));
+
+                double ax = lx[ids[1]] - lx[ids[0]], ay = ly[ids[1]] - ly[ids[0]], az = lz[ids[1]] - lz[ids[0]];
+                double bx = lx[ids[2]] - lx[ids[0]], by = ly[ids[2]] - ly[ids[0]], bz = lz[ids[2]] - lz[ids[0]];
+                double nx = ay * bz - az * by;
+                double ny = az * bx - ax * bz;
+                double nz = ax * by - ay * bx;
+                cellAreas[c] = 0.5 * std::sqrt(nx * nx + ny * ny + nz * nz);
+                if (cellLabels[c] > 0) {
+                    blockAreas[16 * b + cellLabels[c] - 1] += cellAreas[c];
+                    blockCounts[16 * b + cellLabels[c] - 1]++;
+                }//_if
+            }//_for
+        }//_for
+    }, blocks);
+
+    segmentAreas.assign(16, 0);
+    segmentCounts.assign(16, 0);
+    for (int b = 0; b < blocks; b++) {
+        for (int s = 0; s < 16; s++) {
+            segmentAreas[s] += blockAreas[16 * b + s];
+            segmentCounts[s] += blockCounts[16 * b + s];
+        }//_for
+    }//_for
+    return true;
+}
+
+double CemrgAhaSegmentation::Angle(double x, double y) const {
+
+    double angle = atan2(y, x) + appendAngle;
+    return angle * (angle > 0 ? 1 : 0) + (2 * M_PI + angle) * (angle < 0 ? 1 : 0);
+}
+
+int CemrgAhaSegmentation::Label(int layer, double angle) const {
+
+    int label = 0;
+    if (layer < 0)
+        return label;
+    for (const Sector& sector : sectors[layer])
+        if (angle >= sector.lower && angle < sector.upper)
+            label = sector.label;
+    return label;
+}
+
+/**************************************************************************************************
+ *************** HELPER FUNCTIONS *****************************************************************
+ **************************************************************************************************/
+
+mitk::Point3D CemrgAhaSegmentation::ZeroPoint(mitk::Point3D apex, mitk::Point3D point) {
+
+    //Zero relative to the apex
+    point.SetElement(0, point.GetElement(0) - apex.GetElement(0));
+    point.SetElement(1, point.GetElement(1) - apex.GetElement(1));
+    point.SetElement(2, point.GetElement(2) - apex.GetElement(2));
+    return point;
+}
+
+mitk::Point3D CemrgAhaSegmentation::RotatePoint(mitk::Matrix<double, 3, 3> rotationMatrix, mitk::Point3D point) {
+
+    mitk::Matrix<double, 1, 3> vec;
+    mitk::Matrix<double, 3, 1> ans;
+
+    vec[0][0] = point.GetElement(0);
+    vec[0][1] = point.GetElement(1);
+    vec[0][2] = point.GetElement(2);
+    ans = rotationMatrix * vec.GetTranspose();
+    point.SetElement(0, ans[0][0]);
+    point.SetElement(1, ans[1][0]);
+    point.SetElement(2, ans[2][0]);
+
+    return point;
+}
+
+mitk::Point3D CemrgAhaSegmentation::Circlefit3d(mitk::Point3D point1, mitk::Point3D point2, mitk::Point3D point3) {
+
+    //v1, v2 describe the vectors from p1 to p2 and p3, resp.
+    mitk::Point3D v1;
+    mitk::Point3D v2;
+    for (int i = 0; i < 3; i++) {
+        v1.SetElement(i, point2.GetElement(i) - point1.GetElement(i));
+        v2.SetElement(i, point3.GetElement(i) - point1.GetElement(i));
+    }
+
+    //l1, l2 describe the lengths of those vectors
+    double l1 = sqrt(pow(v1.GetElement(0), 2) + pow(v1.GetElement(1), 2) + pow(v1.GetElement(2), 2));
+    double l2 = sqrt(pow(v2.GetElement(0), 2) + pow(v2.GetElement(1), 2) + pow(v2.GetElement(2), 2));
+
+    //v1n, v2n describe the normalized vectors v1 and v2
+    mitk::Point3D v1n = v1;
+    mitk::Point3D v2n = v2;
+    for (int i = 0; i < 3; i++) {
+        v1n.SetElement(i, v1n.GetElement(i) / l1);
+        v2n.SetElement(i, v2n.GetElement(i) / l2);
+    }
+
+    //nv describes the normal vector on the plane of the circle
+    mitk::Point3D nv;
+    nv.SetElement(0, v1n.GetElement(1) * v2n.GetElement(2) - v1n.GetElement(2) * v2n.GetElement(1));
+    nv.SetElement(1, v1n.GetElement(2) * v2n.GetElement(0) - v1n.GetElement(0) * v2n.GetElement(2));
+    nv.SetElement(2, v1n.GetElement(0) * v2n.GetElement(1) - v1n.GetElement(1) * v2n.GetElement(0));
+
+    //v2nb: orthogonalization of v2n against v1n
+    double dotp = v2n.GetElement(0) * v1n.GetElement(0) +
+        v2n.GetElement(1) * v1n.GetElement(1) +
+        v2n.GetElement(2) * v1n.GetElement(2);
+
+    mitk::Point3D v2nb = v2n;
+    for (int i = 0; i < 3; i++) {
+        v2nb.SetElement(i, v2nb.GetElement(i) - dotp * v1n.GetElement(i));
+    }
+
+    //Normalize v2nb
+    double l2nb = sqrt(pow(v2nb.GetElement(0), 2) + pow(v2nb.GetElement(1), 2) + pow(v2nb.GetElement(2), 2));
+    for (int i = 0; i < 3; i++) {
+        v2nb.SetElement(i, v2nb.GetElement(i) / l2nb);
+    }
+
+    //Calculate 2d coordinates of points in each plane
+    mitk::Point2D p3_2d;
+    p3_2d.SetElement(0, 0);
+    p3_2d.SetElement(1, 0);
+    for (int i = 0; i < 3; i++) {
+        p3_2d.SetElement(0, p3_2d.GetElement(0) + v2.GetElement(i) * v1n.GetElement(i));
+        p3_2d.SetElement(1, p3_2d.GetElement(1) + v2.GetElement(i) * v2nb.GetElement(i));
+    }
+
+    //Calculate the fitting circle
+    double a = l1;
+    double b = p3_2d.GetElement(0);
+    double c = p3_2d.GetElement(1);
+    double t = .5 * (a - b) / c;
+    double scale1 = b / 2 + c * t;
+    double scale2 = c / 2 - b * t;
+
+    //centre
+    mitk::Point3D centre;
+    for (int i = 0; i < 3; i++) {
+        double val = point1.GetElement(i) + (scale1 * v1n.GetElement(i)) + (scale2 * v2nb.GetElement(i));
+        centre.SetElement(i, val);
+    }
+    // qDebug() << centre.GetElement(0) << centre.GetElement(1) << centre.GetElement(2);
+
+    /*radius
+    double radius = sqrt(pow(centre.GetElement(0) - point1.GetElement(0),2) +
+                         pow(centre.GetElement(1) - point1.GetElement(1),2) +
+                         pow(centre.GetElement(2) - point1.GetElement(2),2));*/
+    return centre;
+}
+
+mitk::Matrix<double, 3, 3> CemrgAhaSegmentation::CalcRotationMatrix(mitk::Point3D point1, mitk::Point3D point2) {
+
+    //X Axis
+    mitk::Matrix<double, 1, 3> vec;
+    vec[0][0] = point1.GetElement(0);
+    vec[0][1] = point1.GetElement(1);
+    vec[0][2] = point1.GetElement(2);
+    double theta_x = atan(vec[0][1] / vec[0][2]);
+
+    mitk::Matrix<double, 3, 3> R_x;
+    R_x[0][0] = 1;
+    R_x[0][1] = 0;
+    R_x[0][2] = 0;
+    R_x[1][0] = 0;
+    R_x[1][1] = cos(theta_x);
+    R_x[1][2] = -sin(theta_x);
+    R_x[2][0] = 0;
+    R_x[2][1] = sin(theta_x);
+    R_x[2][2] = cos(theta_x);
+
+    //Y Axis
+    mitk::Matrix<double, 3, 1> vecX;
+    vecX = R_x * vec.GetTranspose();
+    double theta_y = atan(-vecX[0][0] / vecX[2][0]);
+
+    mitk::Matrix<double, 3, 3> R_y;
+    R_y[0][0] = cos(theta_y);
+    R_y[0][1] = 0;
+    R_y[0][2] = sin(theta_y);
+    R_y[1][0] = 0;
+    R_y[1][1] = 1;
+    R_y[1][2] = 0;
+    R_y[2][0] = -sin(theta_y);
+    R_y[2][1] = 0;
+    R_y[2][2] = cos(theta_y);
+
+    //Z Axis
+    point2 = RotatePoint(R_y * R_x, point2);
+    double theta_z = atan(-point2.GetElement(1) / point2.GetElement(0));
+
+    mitk::Matrix<double, 3, 3> R_z;
+    R_z[0][0] = cos(theta_z);
+    R_z[0][1] = -sin(theta_z);
+    R_z[0][2] = 0;
+    R_z[1][0] = sin(theta_z);
+    R_z[1][1] = cos(theta_z);
+    R_z[1][2] = 0;
+    R_z[2][0] = 0;
+    R_z[2][1] = 0;
+    R_z[2][2] = 1;
+
+    //Rotation Matrix
+    mitk::Matrix<double, 3, 3> R;
+    R = R_z * R_y * R_x;
+    return R;
+}
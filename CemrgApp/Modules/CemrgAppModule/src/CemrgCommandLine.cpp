@@ -44,6 +44,7 @@ PURPOSE.  See the above copyright notices for more information.
 #include <chrono>
 #include <sys/stat.h>
 #include "CemrgCommandLine.h"
+#include "CemrgMeshSequence.h"
 
 CemrgCommandLine::CemrgCommandLine() {
 
@@ -219,6 +220,9 @@ void CemrgCommandLine::ExecuteApplying(QString dir, QString inputMesh, double in
         fctTime = 2;
     }
 
+    //A sequence file from an earlier run would shadow the new frames
+    QFile::remove(dir + "/" + CemrgMeshSequence::SequenceFileName());
+
     QString output = dir + "/transformed-";
     QString thisOutput;
     for (int i=0; i<noFrames; i++) {
@@ -227,6 +231,12 @@ void CemrgCommandLine::ExecuteApplying(QString dir, QString inputMesh, double in
         iniTime += fctTime;
         mitk::ProgressBar::GetInstance()->Progress();
     }
+
+    //One binary copy of all frames for the viewers and the strain calculations
+    CemrgMeshSequence sequence;
+    sequence.SetDirectory(dir);
+    if (!sequence.LoadFrames(0, noFrames) || !sequence.Save(sequence.GetSequencePath()))
+        MITK_WARN << "Mesh sequence file not written, the frames will be read from the VTK files.";
 }
 
 void CemrgCommandLine::ExecuteRegistration(QString dir, QString fixed, QString moving, QString transformFileName, QString modelname) {
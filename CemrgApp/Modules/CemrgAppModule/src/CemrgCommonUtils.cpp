@@ -89,6 +89,11 @@ PURPOSE.  See the above copyright notices for more information.
 #include <QFileInfo>
 #include <QTextStream>
 
+// C++ Standard
+#include <algorithm>
+#include <vector>
+#include <thread>
+#include <exception>
 
 #include "CemrgCommonUtils.h"
 
@@ -585,7 +590,12 @@ bool CemrgCommonUtils::ConvertToCarto(std::string vtkPath, std::vector<double> t
     //Point data
     vtkSmartPointer<vtkFloatArray> pointData = vtkSmartPointer<vtkFloatArray>::New();
     try {
-        if (pd->GetCellData()->GetScalars() != NULL) {
+        if (pd->GetCellData()->GetScalars() == NULL && pd->GetPointData()->GetScalars() != NULL) {
+
+            //Vertex projections carry point scalars already
+            pointData = vtkFloatArray::SafeDownCast(pd->GetPointData()->GetScalars());
+
+        } else if (pd->GetCellData()->GetScalars() != NULL) {
 
             vtkSmartPointer<vtkCellDataToPointData> cellToPoint = vtkSmartPointer<vtkCellDataToPointData>::New();
             cellToPoint->SetInputData(pd);
@@ -599,6 +609,10 @@ bool CemrgCommonUtils::ConvertToCarto(std::string vtkPath, std::vector<double> t
         MITK_ERROR << "Storing point data failed! Check your input";
         return false;
     }//_try
+    if (pointData == NULL) {
+        MITK_ERROR << "Point data must be stored as floats! Check your input";
+        return false;
+    }//_if
 
     float min = pointData->GetRange()[0];
     float max = pointData->GetRange()[1];
@@ -815,6 +829,47 @@ mitk::DataNode::Pointer CemrgCommonUtils::AddToStorage(
     return node;
 }
 
+int CemrgCommonUtils::GetNumberOfThreads(int requested) {
+
+    //Non-positive requests mean all available cores
+    if (requested > 0)
+        return requested;
+    int cores = std::thread::hardware_concurrency();
+    return (cores > 0) ? cores : 1;
+}
+
+void CemrgCommonUtils::ParallelFor(vtkIdType first, vtkIdType last, std::function<void(vtkIdType, vtkIdType)> body, int numThreads) {
+
+    vtkIdType total = last - first;
+    if (total <= 0)
+        return;
+
+    //Contiguous chunks, one per thread. The calling thread runs the last one
+    vtkIdType threads = std::min<vtkIdType>(GetNumberOfThreads(numThreads), total);
+    if (threads == 1) {
+        body(first, last);
+        return;
+    }//_if
+
+    std::vector<std::thread> workers;
+    std::vector<std::exception_ptr> errors(threads);
+    auto runChunk = [&](vtkIdType t) {
+        try {
+            body(first + (total * t) / threads, first + (total * (t + 1)) / threads);
+        } catch (...) {
+            errors[t] = std::current_exception();
+        }
+    };
+    for (vtkIdType t = 0; t < threads - 1; t++)
+        workers.push_back(std::thread(runChunk, t));
+    runChunk(threads - 1);
+    for (size_t t = 0; t < workers.size(); t++)
+        workers[t].join();
+
+    for (size_t t = 0; t < errors.size(); t++)
+        if (errors[t]) std::rethrow_exception(errors[t]);
+}
+
 void CemrgCommonUtils::FillHoles(mitk::Surface::Pointer surf, QString dir, QString vtkname) {
     vtkSmartPointer<vtkPolyData> pd = surf->GetVtkPolyData();
     vtkSmartPointer<vtkFillHolesFilter> fillholes = vtkSmartPointer<vtkFillHolesFilter>::New();
@@ -0,0 +1,91 @@
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * Corridor Table
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrgapp.com
+ * jose.solislemus@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+// Qmitk
+#include <mitkLogMacros.h>
+
+// C++ Standard
+#include <cstdio>
+#include <fstream>
+
+// CemrgApp
+#include "CemrgCorridorTable.h"
+
+void CemrgCorridorTable::Clear() {
+
+    sequences.clear();
+    depths.clear();
+    vertexIds.clear();
+    x.clear();
+    y.clear();
+    z.clear();
+    scalars.clear();
+}
+
+void CemrgCorridorTable::Reserve(size_t rows) {
+
+    sequences.reserve(rows);
+    depths.reserve(rows);
+    vertexIds.reserve(rows);
+    x.reserve(rows);
+    y.reserve(rows);
+    z.reserve(rows);
+    scalars.reserve(rows);
+}
+
+void CemrgCorridorTable::AddRow(int sequence, vtkIdType vertexId, const double* xyz, int depth, double scalar) {
+
+    sequences.push_back(sequence);
+    vertexIds.push_back(vertexId);
+    x.push_back(xyz[0]);
+    y.push_back(xyz[1]);
+    z.push_back(xyz[2]);
+    depths.push_back(depth);
+    scalars.push_back(scalar);
+}
+
+bool CemrgCorridorTable::WriteCsv(std::string path, bool append) const {
+
+    //Same number formatting as the default ostream, %g with 6 significant digits
+    std::string text = "MainVertexSeq,VertexID,X,Y,Z,VertexDepth,MeshScalar\n";
+    text.reserve(text.size() + 64 * GetNumberOfRows());
+    char row[256];
+    for (size_t i = 0; i < GetNumberOfRows(); i++) {
+        int length = snprintf(row, sizeof(row), "%d,%lld,%g,%g,%g,%d,%g\n",
+            sequences[i], (long long)vertexIds[i], x[i], y[i], z[i], depths[i], scalars[i]);
+        text.append(row, length);
+    }//_for
+
+    std::ofstream out(path.c_str(), append ? std::ios_base::app : std::ios_base::out);
+    if (!out.is_open()) {
+        MITK_ERROR << "Could not open " << path << " for writing.";
+        return false;
+    }//_if
+    out.write(text.data(), text.size());
+    return out.good();
+}
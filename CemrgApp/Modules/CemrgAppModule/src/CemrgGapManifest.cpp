@@ -0,0 +1,133 @@
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * Gap Manifest
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrgapp.com
+ * jose.solislemus@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+// Qmitk
+#include <mitkLogMacros.h>
+
+// Qt
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QTextStream>
+#include <QRegularExpression>
+#include <QMap>
+
+// C++ Standard
+#include <fstream>
+#include <sstream>
+
+// CemrgApp
+#include "CemrgGapManifest.h"
+
+bool CemrgGapManifest::Read(QString path, std::vector<GapCase>& cases) {
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        MITK_ERROR << ("Could not open manifest " + path).toStdString();
+        return false;
+    }//_if
+
+    //Line of each case name, cases write their outputs under that name
+    QMap<QString, int> nameLines;
+    QDir base = QFileInfo(path).absoluteDir();
+    QTextStream in(&file);
+    int lineNumber = 0;
+    while (!in.atEnd()) {
+        QString line = in.readLine().trimmed();
+        lineNumber++;
+        if (line.isEmpty() || line.startsWith("#"))
+            continue;
+
+        QStringList tokens = line.split(QRegularExpression("[\\s,]+"), QString::SkipEmptyParts);
+        GapCase gc;
+        bool ok = tokens.size() >= 5;
+        if (ok) {
+            gc.name = tokens[0];
+            gc.mesh = QDir::cleanPath(base.absoluteFilePath(tokens[1]));
+            gc.threshold = tokens[2].toDouble(&ok);
+        }//_if
+        for (int i = 3; ok && i < tokens.size(); i++)
+            gc.points.push_back(tokens[i].toInt(&ok));
+
+        if (!ok) {
+            MITK_ERROR << ("Manifest line " + QString::number(lineNumber) +
+                " needs a case name, a mesh, a threshold and at least two point ids").toStdString();
+            return false;
+        }//_if
+
+        QString key = gc.name.toLower();
+        if (nameLines.contains(key)) {
+            MITK_ERROR << ("Manifest line " + QString::number(lineNumber) + " repeats the case name " + gc.name +
+                " of line " + QString::number(nameLines[key]) + ", case names must be unique").toStdString();
+            return false;
+        }//_if
+        nameLines[key] = lineNumber;
+
+        gc.status = "not_run";
+        gc.numberOfPoints = -1;
+        gc.percentage = -1;
+        gc.largestArea = -1;
+        gc.corridorArea = -1;
+        gc.connectedAreas = -1;
+        cases.push_back(gc);
+    }//_while
+    return true;
+}
+
+bool CemrgGapManifest::WriteResults(QString path, const std::vector<GapCase>& cases, int neighbourhood) {
+
+    std::ostringstream table;
+    table << "case,mesh,threshold,number_of_picked_points,neighbourhood_size,"
+        "percentage_in_corridor,connected_areas,largest_area_in_corridor,corridor_area,status\n";
+    for (const GapCase& gc : cases) {
+        table << CsvField(gc.name) << "," << CsvField(gc.mesh) << "," << gc.threshold << ","
+            << gc.points.size() << "," << neighbourhood << ","
+            << gc.percentage << "," << gc.connectedAreas << ","
+            << gc.largestArea << "," << gc.corridorArea << ","
+            << CsvField(gc.status) << "\n";
+    }//_for
+
+    std::ofstream out(path.toStdString(), std::ios_base::out | std::ios_base::trunc);
+    if (!out.is_open()) {
+        MITK_ERROR << ("Could not write results table " + path).toStdString();
+        return false;
+    }//_if
+    const std::string text = table.str();
+    out.write(text.data(), text.size());
+    return out.good();
+}
+
+std::string CemrgGapManifest::CsvField(const QString& field) {
+
+    //Quoted when it holds a separator, a quote or a line break, quotes are doubled
+    if (!field.contains(QRegularExpression("[,\"\\r\\n]")))
+        return field.toStdString();
+    QString quoted = field;
+    quoted.replace("\"", "\"\"");
+    return ("\"" + quoted + "\"").toStdString();
+}
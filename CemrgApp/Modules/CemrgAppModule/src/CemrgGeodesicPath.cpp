@@ -0,0 +1,251 @@
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * Geodesic Path
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrgapp.com
+ * jose.solislemus@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+// VTK
+#include <vtkCellArray.h>
+#include <vtkDataArray.h>
+#include <vtkMath.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+
+// C++ Standard
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+// CemrgApp
+#include "CemrgGeodesicPath.h"
+
+CemrgGeodesicPath::CemrgGeodesicPath() {
+
+    Clear();
+}
+
+void CemrgGeodesicPath::Build(vtkPolyData* pd, const CemrgMeshGraph& graph, bool useScalarWeights) {
+
+    Clear();
+    if (pd == NULL || graph.GetNumberOfVertices() != pd->GetNumberOfPoints())
+        return;
+
+    vtkIdType numPoints = pd->GetNumberOfPoints();
+    coordinates.resize(3 * numPoints);
+    for (vtkIdType v = 0; v < numPoints; v++)
+        pd->GetPoint(v, &coordinates[3 * v]);
+
+    vtkDataArray* scalars = useScalarWeights ? pd->GetPointData()->GetScalars() : NULL;
+    offsets.resize(numPoints + 1);
+    offsets[0] = 0;
+    for (vtkIdType v = 0; v < numPoints; v++)
+        offsets[v + 1] = offsets[v] + graph.GetDegree(v);
+    neighbours.resize(offsets[numPoints]);
+    weights.resize(offsets[numPoints]);
+
+    //Weighted costs are not symmetric, each direction is stored on its own
+    heuristicScale = 1;
+    for (vtkIdType v = 0; v < numPoints; v++) {
+        const vtkIdType* adjacent = graph.GetNeighbours(v);
+        for (vtkIdType k = 0; k < graph.GetDegree(v); k++) {
+            vtkIdType w = adjacent[k];
+            double cost = std::sqrt(vtkMath::Distance2BetweenPoints(&coordinates[3 * v], &coordinates[3 * w]));
+            if (scalars != NULL) {
+                double s = scalars->GetTuple1(w);
+                if (s * s != 0) {
+                    cost /= s * s;
+                    heuristicScale = std::min(heuristicScale, 1.0 / (s * s));
+                }//_if
+            }//_if
+            neighbours[offsets[v] + k] = w;
+            weights[offsets[v] + k] = cost;
+        }//_for
+    }//_for
+
+    distance.resize(numPoints);
+    predecessor.resize(numPoints);
+    reachedEpoch.assign(numPoints, 0);
+    settledEpoch.assign(numPoints, 0);
+    targetEpoch.assign(numPoints, 0);
+    source = pd;
+    sourceMTime = pd->GetMTime();
+    sourcePoints = numPoints;
+    sourceWeighted = useScalarWeights;
+}
+
+void CemrgGeodesicPath::Clear() {
+
+    offsets.clear();
+    neighbours.clear();
+    weights.clear();
+    coordinates.clear();
+    heuristicScale = 1;
+    heap.clear();
+    distance.clear();
+    predecessor.clear();
+    reachedEpoch.clear();
+    settledEpoch.clear();
+    targetEpoch.clear();
+    epoch = 0;
+    source = NULL;
+    sourceMTime = 0;
+    sourcePoints = 0;
+    sourceWeighted = false;
+}
+
+bool CemrgGeodesicPath::IsBuiltFor(vtkPolyData* pd, bool useScalarWeights) const {
+
+    return pd != NULL && pd == source && pd->GetMTime() == sourceMTime &&
+        pd->GetNumberOfPoints() == sourcePoints && useScalarWeights == sourceWeighted;
+}
+
+bool CemrgGeodesicPath::ShortestPath(vtkIdType start, vtkIdType end, std::vector<vtkIdType>& path) {
+
+    path.clear();
+    if (start < 0 || end < 0 || start >= GetNumberOfVertices() || end >= GetNumberOfVertices())
+        return false;
+
+    std::vector<vtkIdType> targets(1, end);
+    unsigned int stamp = Search(start, targets, end);
+    return TracePath(end, stamp, path);
+}
+
+int CemrgGeodesicPath::ShortestPaths(vtkIdType start, const std::vector<vtkIdType>& targets, std::vector<std::vector<vtkIdType>>& paths) {
+
+    //One tree from start answers every target, returns how many were reached
+    paths.assign(targets.size(), std::vector<vtkIdType>());
+    if (start < 0 || start >= GetNumberOfVertices())
+        return 0;
+
+    std::vector<vtkIdType> validTargets;
+    for (vtkIdType t : targets)
+        if (t >= 0 && t < GetNumberOfVertices())
+            validTargets.push_back(t);
+
+    //A lone target keeps the A* bound, several need the full Dijkstra tree
+    vtkIdType goal = (validTargets.size() == 1) ? validTargets[0] : -1;
+    unsigned int stamp = Search(start, validTargets, goal);
+    int reached = 0;
+    for (size_t i = 0; i < targets.size(); i++)
+        if (targets[i] >= 0 && targets[i] < GetNumberOfVertices() && TracePath(targets[i], stamp, paths[i]))
+            reached++;
+    return reached;
+}
+
+vtkSmartPointer<vtkPolyData> CemrgGeodesicPath::GetPathPolyData(const std::vector<vtkIdType>& path) const {
+
+    //Poly line through the path vertices, like the output of vtkDijkstraGraphGeodesicPath
+    vtkSmartPointer<vtkPolyData> line = vtkSmartPointer<vtkPolyData>::New();
+    if (path.empty())
+        return line; //unreachable target, no zero-length line cell
+
+    vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+    vtkSmartPointer<vtkCellArray> lines = vtkSmartPointer<vtkCellArray>::New();
+    lines->InsertNextCell(path.size());
+    for (size_t i = 0; i < path.size(); i++) {
+        lines->InsertCellPoint(points->InsertNextPoint(&coordinates[3 * path[i]]));
+    }//_for
+
+    line->SetPoints(points);
+    line->SetLines(lines);
+    return line;
+}
+
+unsigned int CemrgGeodesicPath::NextEpoch() {
+
+    //Stamps only need resetting when the counter wraps
+    if (++epoch == 0) {
+        std::fill(reachedEpoch.begin(), reachedEpoch.end(), 0);
+        std::fill(settledEpoch.begin(), settledEpoch.end(), 0);
+        std::fill(targetEpoch.begin(), targetEpoch.end(), 0);
+        epoch = 1;
+    }//_if
+    return epoch;
+}
+
+double CemrgGeodesicPath::Heuristic(vtkIdType v, vtkIdType goal) const {
+
+    //No edge is cheaper than heuristicScale per unit length, so this never overestimates
+    if (goal < 0)
+        return 0;
+    return heuristicScale * std::sqrt(vtkMath::Distance2BetweenPoints(&coordinates[3 * v], &coordinates[3 * goal]));
+}
+
+unsigned int CemrgGeodesicPath::Search(vtkIdType start, const std::vector<vtkIdType>& targets, vtkIdType goal) {
+
+    unsigned int stamp = NextEpoch();
+    size_t remaining = 0;
+    for (vtkIdType t : targets) {
+        if (targetEpoch[t] != stamp) {
+            targetEpoch[t] = stamp;
+            remaining++;
+        }//_if
+    }//_for
+
+    std::greater<HeapEntry> later;
+    heap.clear();
+    distance[start] = 0;
+    predecessor[start] = -1;
+    reachedEpoch[start] = stamp;
+    heap.push_back(HeapEntry(Heuristic(start, goal), start));
+
+    while (!heap.empty() && remaining > 0) {
+        std::pop_heap(heap.begin(), heap.end(), later);
+        vtkIdType v = heap.back().second;
+        heap.pop_back();
+        if (settledEpoch[v] == stamp)
+            continue; //stale entry
+        settledEpoch[v] = stamp;
+        if (targetEpoch[v] == stamp)
+            remaining--;
+
+        for (vtkIdType e = offsets[v]; e < offsets[v + 1]; e++) {
+            vtkIdType w = neighbours[e];
+            if (settledEpoch[w] == stamp)
+                continue;
+            double d = distance[v] + weights[e];
+            if (reachedEpoch[w] != stamp || d < distance[w]) {
+                reachedEpoch[w] = stamp;
+                distance[w] = d;
+                predecessor[w] = v;
+                heap.push_back(HeapEntry(d + Heuristic(w, goal), w));
+                std::push_heap(heap.begin(), heap.end(), later);
+            }//_if
+        }//_for
+    }//_while
+    return stamp;
+}
+
+bool CemrgGeodesicPath::TracePath(vtkIdType end, unsigned int stamp, std::vector<vtkIdType>& path) const {
+
+    path.clear();
+    if (settledEpoch[end] != stamp)
+        return false;
+
+    for (vtkIdType v = end; v != -1; v = predecessor[v])
+        path.push_back(v);
+    std::reverse(path.begin(), path.end());
+    return true;
+}
@@ -28,6 +28,9 @@ PURPOSE.  See the above copyright notices for more information.
 
 // VTK
 #include <vtkPolyData.h>
+#include <vtkPoints.h>
+#include <vtkCellArray.h>
+#include <vtkDataArray.h>
 #include <vtkMath.h>
 #include <vtkIdList.h>
 #include <vtkMassProperties.h>
@@ -35,9 +38,170 @@ PURPOSE.  See the above copyright notices for more information.
 // Qmitk
 #include <mitkIOUtil.h>
 
-// Qt
+// C++ Standard
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// CemrgApp
+#include "CemrgCommonUtils.h"
 #include "CemrgMeasure.h"
 
+namespace {
+
+//Area weighted mean and sum of squared deviations of the radii
+struct RadiusMoments {
+    double weight, mean, m2;
+};
+
+void AddRadius(RadiusMoments& moments, double weight, double radius) {
+
+    //Weighted running update, stays accurate when the radii barely vary
+    if (weight <= 0)
+        return;
+    moments.weight += weight;
+    double delta = radius - moments.mean;
+    moments.mean += delta * weight / moments.weight;
+    moments.m2 += weight * delta * (radius - moments.mean);
+}
+
+void MergeRadius(RadiusMoments& moments, const RadiusMoments& other) {
+
+    if (other.weight <= 0)
+        return;
+    double weight = moments.weight + other.weight;
+    double delta = other.mean - moments.mean;
+    moments.mean += delta * other.weight / weight;
+    moments.m2 += other.m2 + delta * delta * moments.weight * other.weight / weight;
+    moments.weight = weight;
+}
+
+template <typename T>
+double CellMoments(const T* xyz, const vtkIdType* ids, vtkIdType n, double* centre) {
+
+    //Centre of all the points of the cell, area of its first three
+    centre[0] = centre[1] = centre[2] = 0;
+    for (vtkIdType j = 0; j < n; j++) {
+        const T* pt = xyz + 3 * ids[j];
+        centre[0] += pt[0];
+        centre[1] += pt[1];
+        centre[2] += pt[2];
+    }//_for
+    if (n < 3)
+        return 0;
+    for (int i = 0; i < 3; i++)
+        centre[i] /= n;
+
+    const T* p1 = xyz + 3 * ids[0];
+    const T* p2 = xyz + 3 * ids[1];
+    const T* p3 = xyz + 3 * ids[2];
+    double p1_p2[3] = {(double)p1[0] - p2[0], (double)p1[1] - p2[1], (double)p1[2] - p2[2]};
+    double p2_p3[3] = {(double)p2[0] - p3[0], (double)p2[1] - p3[1], (double)p2[2] - p3[2]};
+    double crossProduct[3];
+    vtkMath::Cross(p1_p2, p2_p3, crossProduct);
+    return 0.5 * vtkMath::Norm(crossProduct);
+}
+
+template <typename T, typename CellIds>
+CemrgMeasure::Morphology MeshMorphology(const T* xyz, vtkIdType numCells, CellIds& cellIds, int blocks) {
+
+    CemrgMeasure::Morphology morphology = {};
+
+    //First pass: area, volume, area weighted centre and bounds, one set of sums per block
+    //Volumes are taken from the first point to keep the signed terms small
+    const double origin[3] = {(double)xyz[0], (double)xyz[1], (double)xyz[2]};
+    std::vector<double> blockSums(11 * blocks, 0);
+    CemrgCommonUtils::ParallelFor(0, blocks, [&](vtkIdType firstBlock, vtkIdType lastBlock) {
+        double centre[3], p0[3], p1[3], p2[3], crossProduct[3];
+        for (vtkIdType b = firstBlock; b < lastBlock; b++) {
+            double* sums = blockSums.data() + 11 * b;
+            double* bounds = sums + 5;
+            bounds[0] = bounds[2] = bounds[4] = VTK_DOUBLE_MAX;
+            bounds[1] = bounds[3] = bounds[5] = VTK_DOUBLE_MIN;
+            for (vtkIdType c = numCells * b / blocks; c < numCells * (b + 1) / blocks; c++) {
+                vtkIdType n;
+                const vtkIdType* ids = cellIds(c, n);
+                double area = CellMoments(xyz, ids, n, centre);
+                sums[0] += area;
+                sums[2] += area * centre[0];
+                sums[3] += area * centre[1];
+                sums[4] += area * centre[2];
+                for (vtkIdType j = 0; j < n; j++) {
+                    const T* pt = xyz + 3 * ids[j];
+                    for (int i = 0; i < 3; i++) {
+                        bounds[2 * i] = std::min(bounds[2 * i], (double)pt[i]);
+                        bounds[2 * i + 1] = std::max(bounds[2 * i + 1], (double)pt[i]);
+                    }//_for
+                }//_for
+
+                //Divergence theorem over a fan of the cell
+                for (int i = 0; i < 3 && n > 0; i++)
+                    p0[i] = xyz[3 * ids[0] + i] - origin[i];
+                for (vtkIdType j = 1; j + 1 < n; j++) {
+                    for (int i = 0; i < 3; i++) {
+                        p1[i] = xyz[3 * ids[j] + i] - origin[i];
+                        p2[i] = xyz[3 * ids[j + 1] + i] - origin[i];
+                    }//_for
+                    vtkMath::Cross(p1, p2, crossProduct);
+                    sums[1] += vtkMath::Dot(p0, crossProduct) / 6;
+                }//_for
+            }//_for
+        }//_for
+    }, blocks);
+
+    for (int i = 0; i < 3; i++) {
+        morphology.bounds[2 * i] = VTK_DOUBLE_MAX;
+        morphology.bounds[2 * i + 1] = VTK_DOUBLE_MIN;
+    }//_for
+    for (int b = 0; b < blocks; b++) {
+        const double* sums = blockSums.data() + 11 * b;
+        morphology.surfaceArea += sums[0];
+        morphology.volume += sums[1];
+        for (int i = 0; i < 3; i++) {
+            morphology.centre[i] += sums[i + 2];
+            morphology.bounds[2 * i] = std::min(morphology.bounds[2 * i], sums[5 + 2 * i]);
+            morphology.bounds[2 * i + 1] = std::max(morphology.bounds[2 * i + 1], sums[6 + 2 * i]);
+        }//_for
+    }//_for
+    morphology.volume = std::fabs(morphology.volume);
+    if (morphology.surfaceArea <= 0) {
+        MITK_WARN << "Morphology of a mesh without area.";
+        return morphology;
+    }//_if
+    for (int i = 0; i < 3; i++)
+        morphology.centre[i] /= morphology.surfaceArea;
+
+    //Second pass: mean and spread of the distances to that centre, cells are recomputed, not stored
+    std::vector<RadiusMoments> blockMoments(blocks, RadiusMoments {0, 0, 0});
+    CemrgCommonUtils::ParallelFor(0, blocks, [&](vtkIdType firstBlock, vtkIdType lastBlock) {
+        double centre[3];
+        for (vtkIdType b = firstBlock; b < lastBlock; b++) {
+            for (vtkIdType c = numCells * b / blocks; c < numCells * (b + 1) / blocks; c++) {
+                vtkIdType n;
+                const vtkIdType* ids = cellIds(c, n);
+                double area = CellMoments(xyz, ids, n, centre);
+                AddRadius(blockMoments[b], area, std::sqrt(vtkMath::Distance2BetweenPoints(morphology.centre, centre)));
+            }//_for
+        }//_for
+    }, blocks);
+
+    RadiusMoments moments = {0, 0, 0};
+    for (int b = 0; b < blocks; b++)
+        MergeRadius(moments, blockMoments[b]);
+
+    double AR = moments.mean;
+    double sigma = std::sqrt(moments.m2 / moments.weight);
+    double CVS = sigma / AR;
+    morphology.sphericity = 100 * (1 - CVS);
+
+    //Normalised as in vtkMassProperties, 1 for a sphere
+    if (morphology.volume > 0)
+        morphology.normalisedShapeIndex = (std::sqrt(morphology.surfaceArea) / std::cbrt(morphology.volume)) / 2.199085233;
+    return morphology;
+}
+
+}
+
 void CemrgMeasure::Convert(QString dir, mitk::DataNode::Pointer node) {
 
     mitk::BaseData::Pointer data = node->GetData();
@@ -171,30 +335,70 @@ mitk::Point3D CemrgMeasure::FindCentre(mitk::PointSet::Pointer pointset) {
     return centrePoint;
 }
 
-double CemrgMeasure::GetSphericity(vtkPolyData* LAC_poly) {
+double CemrgMeasure::GetSphericity(vtkPolyData* LAC_poly, int numberOfThreads) {
 
-    double LACA;
-    double LAC_mc[3];
-    double AR, sigma, Sphericity;
+    return GetMorphology(LAC_poly, numberOfThreads).sphericity;
+}
 
-    //containers for centre of mass, area, etc.
-    double** TiMC;
-    double* TiA;
+CemrgMeasure::Morphology CemrgMeasure::GetMorphology(vtkPolyData* LAC_poly, int numberOfThreads) {
 
-    TiMC = new double*[LAC_poly->GetNumberOfCells()];
-    for (int i = 0; i < LAC_poly->GetNumberOfCells(); i++) {
-        TiMC[i] = new double[3];
-    }
+    Morphology morphology = {};
+    vtkIdType numCells = (LAC_poly == NULL) ? 0 : LAC_poly->GetNumberOfCells();
+    vtkPoints* points = (numCells == 0) ? NULL : LAC_poly->GetPoints();
+    if (points == NULL) {
+        MITK_WARN << "Morphology of an empty mesh.";
+        return morphology;
+    }//_if
 
-    TiA = new double[LAC_poly->GetNumberOfCells()];
+    //Triangle meshes are read straight from the connectivity in parallel
+    vtkCellArray* polys = LAC_poly->GetPolys();
+    bool triangles = polys->GetNumberOfCells() == numCells && polys->GetNumberOfConnectivityEntries() == 4 * numCells;
+    const vtkIdType* connectivity = polys->GetPointer();
+    if (triangles) {
+        for (vtkIdType i = 0; i < numCells && triangles; i++)
+            triangles = connectivity[4 * i] == 3;
+    }//_if
 
-    GetCentreOfMassOfEachT(LAC_poly, TiMC);
-    GetArea(LAC_poly, TiA, LACA);
-    GetCentreOfMass(TiMC, TiA, LAC_poly->GetNumberOfCells(), LACA, LAC_mc);
-    GetAverageRadius(TiMC, TiA, LAC_poly->GetNumberOfCells(), LAC_mc, LACA, AR);
-    LASphericity(TiMC, TiA, LAC_poly->GetNumberOfCells(), LAC_mc, LACA, AR, sigma, Sphericity);
+    //Other cells through one id list, serially
+    vtkSmartPointer<vtkIdList> cellPoints = vtkSmartPointer<vtkIdList>::New();
+    auto cellIds = [&](vtkIdType i, vtkIdType& n) -> const vtkIdType* {
+        if (triangles) {
+            n = 3;
+            return connectivity + 4 * i + 1;
+        }//_if
+        LAC_poly->GetCellPoints(i, cellPoints);
+        n = cellPoints->GetNumberOfIds();
+        return cellPoints->GetPointer(0);
+    };
+    int blocks = triangles ? CemrgCommonUtils::GetNumberOfThreads(numberOfThreads) : 1;
+
+    vtkDataArray* data = points->GetData();
+    if (data->GetDataType() == VTK_FLOAT)
+        return MeshMorphology(static_cast<const float*>(data->GetVoidPointer(0)), numCells, cellIds, blocks);
+    if (data->GetDataType() == VTK_DOUBLE)
+        return MeshMorphology(static_cast<const double*>(data->GetVoidPointer(0)), numCells, cellIds, blocks);
+
+    std::vector<double> xyz(3 * LAC_poly->GetNumberOfPoints());
+    for (vtkIdType i = 0; i < LAC_poly->GetNumberOfPoints(); i++)
+        LAC_poly->GetPoint(i, xyz.data() + 3 * i);
+    return MeshMorphology(xyz.data(), numCells, cellIds, blocks);
+}
+
+std::vector<CemrgMeasure::Morphology> CemrgMeasure::GetMorphology(const std::vector<mitk::Surface::Pointer>& surfaces, int numberOfThreads) {
 
-    return Sphericity;
+    //Many surfaces share the threads one each, a few get them all in turn
+    std::vector<Morphology> morphologies(surfaces.size());
+    int threads = CemrgCommonUtils::GetNumberOfThreads(numberOfThreads);
+    if ((int)surfaces.size() >= threads) {
+        CemrgCommonUtils::ParallelFor(0, surfaces.size(), [&](vtkIdType first, vtkIdType last) {
+            for (vtkIdType i = first; i < last; i++)
+                morphologies[i] = GetMorphology(surfaces[i].IsNull() ? NULL : surfaces[i]->GetVtkPolyData(), 1);
+        }, threads);
+    } else {
+        for (size_t i = 0; i < surfaces.size(); i++)
+            morphologies[i] = GetMorphology(surfaces[i].IsNull() ? NULL : surfaces[i]->GetVtkPolyData(), threads);
+    }//_if
+    return morphologies;
 }
 
 double CemrgMeasure::calcVolumeMesh(mitk::Surface::Pointer surface) {
@@ -278,110 +482,3 @@ std::vector<std::string>& CemrgMeasure::Split(const std::string& str, std::vecto
         elements.push_back(item);
     return elements;
 }
-
-void CemrgMeasure::GetArea(vtkPolyData* polys, double* TiA, double& LACA) {
-
-    double p1[3], p2[3], p3[3];
-    double p1_p2[3];		// p1 minus p2
-    double p2_p3[3];		// p2 minus p3
-    double crossProduct[3];
-    LACA = 0;
-    vtkSmartPointer<vtkIdList> cell_points = vtkSmartPointer<vtkIdList>::New();
-
-    for (int i = 0; i < polys->GetNumberOfCells(); i++) {
-
-        //vtkIdType neighbor_point;
-        polys->GetCellPoints(i, cell_points);
-
-        // Get all three vertices
-        vtkIdType neighbor_point_id = cell_points->GetId(0);
-        polys->GetPoint(neighbor_point_id, p1);
-
-        neighbor_point_id = cell_points->GetId(1);
-        polys->GetPoint(neighbor_point_id, p2);
-
-        neighbor_point_id = cell_points->GetId(2);
-        polys->GetPoint(neighbor_point_id, p3);
-
-        vtkMath::Subtract(p1, p2, p1_p2);
-        vtkMath::Subtract(p2, p3, p2_p3);
-
-        vtkMath::Cross(p1_p2, p2_p3, crossProduct);
-        TiA[i] = 0.5 * vtkMath::Norm(crossProduct);
-        LACA += TiA[i];
-    }
-    cout << "Total area LACA = " << LACA << endl;
-}
-
-void CemrgMeasure::GetCentreOfMass(double** TiMC, double* TiA, int TiMC_size, double LACA, double* LAC_mc) {
-
-    LAC_mc[0] = 0; LAC_mc[1] = 0; LAC_mc[2] = 0;
-
-    for (int i = 0; i < TiMC_size; i++) {
-        double contrib = TiA[i] / LACA;
-        LAC_mc[0] += (contrib)*TiMC[i][0];
-        LAC_mc[1] += (contrib)*TiMC[i][1];
-        LAC_mc[2] += (contrib)*TiMC[i][2];
-    }
-}
-
-void CemrgMeasure::GetCentreOfMassOfEachT(vtkPolyData* polys, double** TiMC) {
-
-    vtkSmartPointer<vtkIdList> cell_points = vtkSmartPointer<vtkIdList>::New();
-
-    for (int i = 0; i < polys->GetNumberOfCells(); i++) {
-        double cX = 0, cY = 0, cZ = 0;
-        int num_points = 0;
-        polys->GetCellPoints(i, cell_points);
-        vtkIdType num_cell_points = cell_points->GetNumberOfIds();
-
-        for (vtkIdType neighbor_point = 0; neighbor_point < num_cell_points; ++neighbor_point) {
-            double cP[3];
-            // Get the neighbour point id
-            vtkIdType neighbor_point_id = cell_points->GetId(neighbor_point);
-            // Get the neighbour point position
-            polys->GetPoint(neighbor_point_id, cP);
-            cX += cP[0]; cY += cP[1]; cZ += cP[2];
-            num_points++;
-        }
-        cX /= num_points;
-        cY /= num_points;
-        cZ /= num_points;
-        TiMC[i][0] = cX;
-        TiMC[i][1] = cY;
-        TiMC[i][2] = cZ;
-    }
-}
-
-void CemrgMeasure::GetAverageRadius(double** TiMC, double* TiA, double TiMC_size, double* LAC_mc, double LACA, double& AR) {
-
-    AR = 0;
-
-    for (int i = 0; i < TiMC_size; i++) {
-        double a[3] = {LAC_mc[0], LAC_mc[1], LAC_mc[2]};
-        double b[3] = {TiMC[i][0], TiMC[i][1], TiMC[i][2]};
-        double a_minus_b[3];
-        vtkMath::Subtract(a, b, a_minus_b);
-        double contrib = TiA[i] / LACA;
-        AR += contrib * vtkMath::Norm(a_minus_b);
-    }
-}
-
-void CemrgMeasure::LASphericity(double** TiMC, double* TiA, double TiMC_size, double* LAC_mc, double LACA, double AR, double& sigma, double& Sphericity) {
-
-    double eps = 0;
-
-    for (int i = 0; i < TiMC_size; i++) {
-        double contrib = TiA[i] / LACA;
-        double a[3] = {LAC_mc[0], LAC_mc[1], LAC_mc[2]};
-        double b[3] = {TiMC[i][0], TiMC[i][1], TiMC[i][2]};
-        double a_minus_b[3];
-        vtkMath::Subtract(a, b, a_minus_b);
-        double phi = (vtkMath::Norm(a_minus_b) - AR) * (vtkMath::Norm(a_minus_b) - AR);
-        eps += contrib * phi;
-    }
-
-    sigma = sqrt(eps);
-    double CVS = sigma / AR;
-    Sphericity = 100 * (1 - CVS);
-}
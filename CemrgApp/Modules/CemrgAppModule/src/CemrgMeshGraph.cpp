@@ -0,0 +1,178 @@
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * Mesh Graph
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrgapp.com
+ * jose.solislemus@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+// VTK
+#include <vtkCellType.h>
+#include <vtkIdList.h>
+#include <vtkSmartPointer.h>
+
+// C++ Standard
+#include <algorithm>
+
+// CemrgApp
+#include "CemrgMeshGraph.h"
+
+CemrgMeshGraph::CemrgMeshGraph() {
+
+    Clear();
+}
+
+void CemrgMeshGraph::Build(vtkPolyData* pd) {
+
+    Clear();
+    if (pd == NULL)
+        return;
+
+    vtkIdType numPoints = pd->GetNumberOfPoints();
+    vtkIdType numCells = pd->GetNumberOfCells();
+    vtkSmartPointer<vtkIdList> cellPoints = vtkSmartPointer<vtkIdList>::New();
+
+    //Two passes over the cells: count edge ends per vertex, then fill the rows
+    std::vector<vtkIdType> fill(numPoints + 1, 0);
+    offsets.assign(numPoints + 1, 0);
+    for (int pass = 0; pass < 2; pass++) {
+        for (vtkIdType i = 0; i < numCells; i++) {
+            int cellType = pd->GetCellType(i);
+            if (cellType != VTK_TRIANGLE && cellType != VTK_QUAD && cellType != VTK_POLYGON && cellType != VTK_TRIANGLE_STRIP)
+                continue; //vertices and lines have no edges
+
+            pd->GetCellPoints(i, cellPoints);
+            vtkIdType n = cellPoints->GetNumberOfIds();
+            for (vtkIdType j = 0; j < n; j++) {
+                //Polygons close the loop, strips also join every other point
+                vtkIdType a = cellPoints->GetId(j);
+                vtkIdType ends[2] = {-1, -1};
+                if (cellType == VTK_TRIANGLE_STRIP) {
+                    if (j + 1 < n) ends[0] = cellPoints->GetId(j + 1);
+                    if (j + 2 < n) ends[1] = cellPoints->GetId(j + 2);
+                } else {
+                    ends[0] = cellPoints->GetId((j + 1) % n);
+                }//_if
+
+                for (int k = 0; k < 2; k++) {
+                    vtkIdType b = ends[k];
+                    if (b < 0 || b == a)
+                        continue;
+                    if (pass == 0) {
+                        offsets[a + 1]++;
+                        offsets[b + 1]++;
+                    } else {
+                        neighbours[fill[a]++] = b;
+                        neighbours[fill[b]++] = a;
+                    }//_if
+                }//_for
+            }//_for
+        }//_for
+
+        if (pass == 0) {
+            for (vtkIdType v = 0; v < numPoints; v++)
+                offsets[v + 1] += offsets[v];
+            neighbours.resize(offsets[numPoints]);
+            std::copy(offsets.begin(), offsets.end(), fill.begin());
+        }//_if
+    }//_for
+
+    //Shared edges appear once per cell, keep each neighbour once
+    vtkIdType write = 0;
+    for (vtkIdType v = 0; v < numPoints; v++) {
+        std::vector<vtkIdType>::iterator first = neighbours.begin() + offsets[v];
+        std::vector<vtkIdType>::iterator last = neighbours.begin() + offsets[v + 1];
+        std::sort(first, last);
+        last = std::unique(first, last);
+        offsets[v] = write;
+        for (; first != last; ++first)
+            neighbours[write++] = *first;
+    }//_for
+    offsets[numPoints] = write;
+    neighbours.resize(write);
+    neighbours.shrink_to_fit();
+
+    visitedEpoch.assign(numPoints, 0);
+    source = pd;
+    sourceMTime = pd->GetMTime();
+    sourcePoints = numPoints;
+}
+
+void CemrgMeshGraph::Clear() {
+
+    offsets.clear();
+    neighbours.clear();
+    visitedEpoch.clear();
+    frontier.clear();
+    epoch = 0;
+    source = NULL;
+    sourceMTime = 0;
+    sourcePoints = 0;
+}
+
+bool CemrgMeshGraph::IsBuiltFor(vtkPolyData* pd) const {
+
+    return pd != NULL && pd == source && pd->GetMTime() == sourceMTime && pd->GetNumberOfPoints() == sourcePoints;
+}
+
+void CemrgMeshGraph::GetKRing(vtkIdType seed, int maxOrder, std::vector<std::pair<int, int>>& neighbourAndOrder) {
+
+    //The seed has order maxOrder and each ring outwards one less, down to 1
+    if (maxOrder <= 0 || seed < 0 || seed >= GetNumberOfVertices())
+        return;
+
+    unsigned int stamp = NextEpoch();
+    frontier.clear();
+    frontier.push_back(seed);
+    visitedEpoch[seed] = stamp;
+    neighbourAndOrder.push_back(std::make_pair(seed, maxOrder));
+
+    for (int order = maxOrder - 1; order > 0 && !frontier.empty(); order--) {
+        size_t ringEnd = frontier.size();
+        size_t ringStart = neighbourAndOrder.size();
+        for (size_t f = 0; f < ringEnd; f++) {
+            vtkIdType v = frontier[f];
+            for (vtkIdType e = offsets[v]; e < offsets[v + 1]; e++) {
+                vtkIdType w = neighbours[e];
+                if (visitedEpoch[w] == stamp)
+                    continue;
+                visitedEpoch[w] = stamp;
+                neighbourAndOrder.push_back(std::make_pair(w, order));
+            }//_for
+        }//_for
+
+        frontier.clear();
+        for (size_t r = ringStart; r < neighbourAndOrder.size(); r++)
+            frontier.push_back(neighbourAndOrder[r].first);
+    }//_for
+}
+
+unsigned int CemrgMeshGraph::NextEpoch() {
+
+    //Stamps only need resetting when the counter wraps
+    if (++epoch == 0) {
+        std::fill(visitedEpoch.begin(), visitedEpoch.end(), 0);
+        epoch = 1;
+    }//_if
+    return epoch;
+}
@@ -0,0 +1,382 @@
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * Mesh Sequence
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrgapp.com
+ * orod.razeghi@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+// Qmitk
+#include <mitkLogMacros.h>
+
+// VTK
+#include <vtkCellArray.h>
+#include <vtkCellData.h>
+#include <vtkPointData.h>
+#include <vtkCellType.h>
+#include <vtkIdList.h>
+#include <vtkPoints.h>
+#include <vtkPolyDataReader.h>
+#include <vtkSmartPointer.h>
+
+// Qt
+#include <QDateTime>
+#include <QFileInfo>
+
+// C++ Standard
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+// CemrgApp
+#include "CemrgCommonUtils.h"
+#include "CemrgMeshSequence.h"
+
+//Layout of the binary sequence, in the byte order of the machine that wrote it
+struct CemrgMeshSequenceHeader {
+    char magic[8];
+    qint32 version;
+    qint32 flags;
+    qint64 numberOfPoints;
+    qint64 numberOfCells;
+    qint32 numberOfFrames;
+    qint32 reserved;
+};
+static const char sequenceMagic[8] = {'C', 'E', 'M', 'R', 'G', 'M', 'S', 'Q'};
+static const qint32 sequenceVersion = 1;
+static const qint32 sequenceDeltaFlag = 1;
+
+//Triangles and frames must fill the file exactly, counts from a corrupt header can't overflow the sum
+static bool SequenceSizeMatches(const CemrgMeshSequenceHeader& header, qint64 size) {
+
+    qint64 remaining = size - (qint64)sizeof(header);
+    if (remaining < 0 || header.numberOfCells > remaining / 12)
+        return false;
+    remaining -= 12 * header.numberOfCells;
+    if (header.numberOfFrames == 0)
+        return remaining == 0;
+    qint64 frameBytes = 12 * (qint64)header.numberOfFrames;
+    return header.numberOfPoints <= remaining / frameBytes && header.numberOfPoints * frameBytes == remaining;
+}
+
+CemrgMeshSequence::CemrgMeshSequence() {
+
+    Clear();
+}
+
+void CemrgMeshSequence::Clear() {
+
+    numberOfPoints = 0;
+    triangles.clear();
+    frames.clear();
+    mappedFile.reset();
+    mappedFrames = NULL;
+    numberOfMappedFrames = 0;
+    mappedDelta = false;
+}
+
+void CemrgMeshSequence::SetDirectory(QString dir) {
+
+    this->directory = dir;
+    if (!QFileInfo::exists(GetSequencePath()))
+        return;
+
+    //The sequence file stands in for the VTK frames only while it is newer and holds all of them
+    int numVtkFrames = 0;
+    QDateTime newestFrame;
+    QFileInfo sequenceInfo(GetSequencePath());
+    QFileInfo frameInfo(GetFramePath(0));
+    while (frameInfo.exists()) {
+        newestFrame = std::max(newestFrame, frameInfo.lastModified());
+        frameInfo.setFile(GetFramePath(++numVtkFrames));
+    }//_while
+
+    if (numVtkFrames > 0 && sequenceInfo.lastModified() < newestFrame) {
+        MITK_WARN << ("Mesh sequence is older than the VTK frames, reading those instead: " + GetSequencePath()).toStdString();
+        return;
+    }//_if
+    if (!Open(GetSequencePath()))
+        return;
+    if (numVtkFrames > 0 && numberOfMappedFrames != numVtkFrames) {
+        MITK_WARN << "Mesh sequence holds " << numberOfMappedFrames << " frames but " << numVtkFrames << " VTK frames were found, reading those instead.";
+        Clear();
+    }//_if
+}
+
+bool CemrgMeshSequence::FramesHaveArrays() const {
+
+    //All frames come from the same tracking run, the first one stands for the rest
+    QString path = GetFramePath(0);
+    if (!QFileInfo::exists(path))
+        return false;
+
+    vtkSmartPointer<vtkPolyDataReader> reader = vtkSmartPointer<vtkPolyDataReader>::New();
+    reader->SetFileName(path.toStdString().c_str());
+    reader->Update();
+    vtkPolyData* pd = reader->GetOutput();
+    return pd->GetPointData()->GetNumberOfArrays() > 0 || pd->GetCellData()->GetNumberOfArrays() > 0;
+}
+
+QString CemrgMeshSequence::GetFramePath(int frameNo) const {
+
+    return directory + "/transformed-" + QString::number(frameNo) + ".vtk";
+}
+
+bool CemrgMeshSequence::SetTopology(vtkPolyData* pd) {
+
+    triangles.clear();
+    frames.clear();
+    numberOfPoints = 0;
+    if (pd == NULL)
+        return false;
+
+    vtkIdType numCells = pd->GetNumberOfCells();
+    vtkSmartPointer<vtkIdList> cellPoints = vtkSmartPointer<vtkIdList>::New();
+    triangles.resize(3 * numCells);
+    for (vtkIdType i = 0; i < numCells; i++) {
+        pd->GetCellPoints(i, cellPoints);
+        if (pd->GetCellType(i) != VTK_TRIANGLE || cellPoints->GetNumberOfIds() != 3) {
+            MITK_ERROR << "Mesh sequences only hold triangles, cell " << i << " is not one.";
+            triangles.clear();
+            return false;
+        }//_if
+        for (int j = 0; j < 3; j++)
+            triangles[3 * i + j] = cellPoints->GetId(j);
+    }//_for
+
+    numberOfPoints = pd->GetNumberOfPoints();
+    return true;
+}
+
+bool CemrgMeshSequence::SetFrame(int frameNo, vtkPolyData* pd) {
+
+    if (frameNo < 0 || pd == NULL)
+        return false;
+    if (triangles.empty() && !SetTopology(pd))
+        return false;
+
+    if (pd->GetNumberOfPoints() != numberOfPoints || pd->GetNumberOfCells() != GetNumberOfCells()) {
+        MITK_ERROR << "Frame " << frameNo << " does not share the connectivity of the sequence.";
+        return false;
+    }//_if
+
+    if (frameNo >= (int)frames.size())
+        frames.resize(frameNo + 1);
+    std::vector<double>& xyz = frames[frameNo];
+    xyz.resize(3 * numberOfPoints);
+    double* x = xyz.data();
+    double* y = x + numberOfPoints;
+    double* z = y + numberOfPoints;
+    double pt[3];
+    for (vtkIdType i = 0; i < numberOfPoints; i++) {
+        pd->GetPoint(i, pt);
+        x[i] = pt[0];
+        y[i] = pt[1];
+        z[i] = pt[2];
+    }//_for
+    return true;
+}
+
+bool CemrgMeshSequence::LoadFrame(int frameNo) {
+
+    if (HasFrame(frameNo))
+        return true;
+
+    //Decode from the binary sequence, the slots were made by Open
+    if (frameNo >= 0 && frameNo < numberOfMappedFrames) {
+        const float* block = mappedFrames + 3 * numberOfPoints * frameNo;
+        std::vector<double>& xyz = frames[frameNo];
+        xyz.resize(3 * numberOfPoints);
+        if (mappedDelta && frameNo > 0) {
+            for (vtkIdType i = 0; i < 3 * numberOfPoints; i++)
+                xyz[i] = (double)mappedFrames[i] + block[i];
+        } else {
+            for (vtkIdType i = 0; i < 3 * numberOfPoints; i++)
+                xyz[i] = block[i];
+        }//_if
+        return true;
+    }//_if
+
+    QString path = GetFramePath(frameNo);
+    if (!QFileInfo::exists(path)) {
+        MITK_WARN << ("Mesh sequence frame not found: " + path).toStdString();
+        return false;
+    }//_if
+
+    vtkSmartPointer<vtkPolyDataReader> reader = vtkSmartPointer<vtkPolyDataReader>::New();
+    reader->SetFileName(path.toStdString().c_str());
+    reader->Update();
+    vtkPolyData* pd = reader->GetOutput();
+
+    //Same flip as CemrgCommonUtils::LoadVTKMesh
+    if (!SetFrame(frameNo, pd))
+        return false;
+    std::vector<double>& xyz = frames[frameNo];
+    for (vtkIdType i = 0; i < 2 * numberOfPoints; i++)
+        xyz[i] = -xyz[i];
+    return true;
+}
+
+bool CemrgMeshSequence::LoadFrames(int first, int last, int numberOfThreads) {
+
+    if (first < 0 || last <= first)
+        return false;
+
+    //The connectivity comes from the first frame, the slots exist before the threads start
+    if (triangles.empty() && !LoadFrame(first))
+        return false;
+    if (last > (int)frames.size())
+        frames.resize(last);
+
+    std::vector<char> loaded(last - first, 0);
+    CemrgCommonUtils::ParallelFor(first, last, [&](vtkIdType firstFrame, vtkIdType lastFrame) {
+        for (vtkIdType i = firstFrame; i < lastFrame; i++)
+            loaded[i - first] = LoadFrame(i);
+    }, numberOfThreads);
+
+    return std::find(loaded.begin(), loaded.end(), 0) == loaded.end();
+}
+
+bool CemrgMeshSequence::Open(QString path) {
+
+    Clear();
+    std::shared_ptr<QFile> file = std::make_shared<QFile>(path);
+    if (!file->open(QIODevice::ReadOnly)) {
+        MITK_WARN << ("Mesh sequence could not be opened: " + path).toStdString();
+        return false;
+    }//_if
+
+    CemrgMeshSequenceHeader header;
+    qint64 size = file->size();
+    const uchar* data = (size >= (qint64)sizeof(header)) ? file->map(0, size) : NULL;
+    if (data == NULL) {
+        MITK_ERROR << ("Mesh sequence could not be mapped: " + path).toStdString();
+        return false;
+    }//_if
+
+    std::memcpy(&header, data, sizeof(header));
+    bool valid = std::memcmp(header.magic, sequenceMagic, sizeof(sequenceMagic)) == 0 && header.version == sequenceVersion;
+    valid = valid && header.numberOfPoints > 0 && header.numberOfCells >= 0 && header.numberOfFrames >= 0;
+    valid = valid && SequenceSizeMatches(header, size);
+    if (!valid) {
+        MITK_ERROR << ("Not a mesh sequence of this version, or a truncated one: " + path).toStdString();
+        return false;
+    }//_if
+
+    const qint32* ids = reinterpret_cast<const qint32*>(data + sizeof(header));
+    triangles.assign(ids, ids + 3 * header.numberOfCells);
+    for (size_t i = 0; i < triangles.size(); i++) {
+        if (triangles[i] < 0 || triangles[i] >= header.numberOfPoints) {
+            MITK_ERROR << ("Mesh sequence has a point id out of range: " + path).toStdString();
+            Clear();
+            return false;
+        }//_if
+    }//_for
+
+    numberOfPoints = header.numberOfPoints;
+    frames.assign(header.numberOfFrames, std::vector<double>());
+    mappedFile = file;
+    mappedFrames = reinterpret_cast<const float*>(ids + 3 * header.numberOfCells);
+    numberOfMappedFrames = header.numberOfFrames;
+    mappedDelta = (header.flags & sequenceDeltaFlag) != 0;
+    return true;
+}
+
+bool CemrgMeshSequence::Save(QString path, bool deltaEncoding) const {
+
+    int numFrames = frames.size();
+    for (int i = 0; i < numFrames; i++) {
+        if (!HasFrame(i)) {
+            MITK_ERROR << "Frame " << i << " is not loaded, the mesh sequence cannot be saved.";
+            return false;
+        }//_if
+    }//_for
+    if (numFrames == 0 || numberOfPoints > std::numeric_limits<qint32>::max()) {
+        MITK_ERROR << "The mesh sequence is empty or too large for 32-bit point ids.";
+        return false;
+    }//_if
+
+    //Truncating the file under a live mapping would pull the frames from under the readers
+    if (IsMapped() && QFileInfo(mappedFile->fileName()) == QFileInfo(path)) {
+        MITK_ERROR << ("Mesh sequence cannot be saved over its own mapping: " + path).toStdString();
+        return false;
+    }//_if
+
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        MITK_ERROR << ("Mesh sequence could not be written: " + path).toStdString();
+        return false;
+    }//_if
+
+    CemrgMeshSequenceHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, sequenceMagic, sizeof(sequenceMagic));
+    header.version = sequenceVersion;
+    header.flags = deltaEncoding ? sequenceDeltaFlag : 0;
+    header.numberOfPoints = numberOfPoints;
+    header.numberOfCells = GetNumberOfCells();
+    header.numberOfFrames = numFrames;
+    std::vector<qint32> ids(triangles.begin(), triangles.end());
+    bool ok = file.write(reinterpret_cast<const char*>(&header), sizeof(header)) == (qint64)sizeof(header);
+    ok = ok && file.write(reinterpret_cast<const char*>(ids.data()), ids.size() * sizeof(qint32)) == (qint64)(ids.size() * sizeof(qint32));
+
+    //Offsets are taken from the stored first frame so that decoding adds them back exactly
+    std::vector<float> first(3 * numberOfPoints), block(3 * numberOfPoints);
+    for (int f = 0; ok && f < numFrames; f++) {
+        const std::vector<double>& xyz = frames[f];
+        for (vtkIdType i = 0; i < 3 * numberOfPoints; i++)
+            block[i] = (deltaEncoding && f > 0) ? (float)(xyz[i] - first[i]) : (float)xyz[i];
+        if (f == 0)
+            first = block;
+        ok = file.write(reinterpret_cast<const char*>(block.data()), block.size() * sizeof(float)) == (qint64)(block.size() * sizeof(float));
+    }//_for
+
+    if (!ok) {
+        MITK_ERROR << ("Mesh sequence could not be written: " + path).toStdString();
+        file.remove();
+    }//_if
+    return ok;
+}
+
+vtkSmartPointer<vtkPolyData> CemrgMeshSequence::GetPolyData(int frameNo) const {
+
+    if (!HasFrame(frameNo))
+        return NULL;
+
+    const double* x = frames[frameNo].data();
+    const double* y = x + numberOfPoints;
+    const double* z = y + numberOfPoints;
+    vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+    points->SetNumberOfPoints(numberOfPoints);
+    for (vtkIdType i = 0; i < numberOfPoints; i++)
+        points->SetPoint(i, x[i], y[i], z[i]);
+
+    vtkSmartPointer<vtkCellArray> polys = vtkSmartPointer<vtkCellArray>::New();
+    for (vtkIdType i = 0; i < GetNumberOfCells(); i++)
+        polys->InsertNextCell(3, triangles.data() + 3 * i);
+
+    vtkSmartPointer<vtkPolyData> pd = vtkSmartPointer<vtkPolyData>::New();
+    pd->SetPoints(points);
+    pd->SetPolys(polys);
+    return pd;
+}
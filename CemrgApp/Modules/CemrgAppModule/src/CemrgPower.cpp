@@ -29,6 +29,7 @@ PURPOSE.  See the above copyright notices for more information.
 // Qmitk
 #include <mitkIOUtil.h>
 #include <mitkProperties.h>
+#include <mitkLogMacros.h>
 
 // Qt
 #include <QMessageBox>
@@ -43,22 +44,24 @@ PURPOSE.  See the above copyright notices for more information.
 #include <vtkFloatArray.h>
 #include <vtkPolyData.h>
 #include <vtkPointData.h>
+#include <vtkCellData.h>
 #include <vtkMatrix4x4.h>
 #include <vtkMatrix3x3.h>
 #include <vtkTransform.h>
 #include <vtkTransformFilter.h>
-#include <vtkExtractSelection.h>
-#include <vtkSelection.h>
-#include <vtkSelectionNode.h>
-#include <vtkUnstructuredGrid.h>
-#include <vtkUnstructuredGridWriter.h>
-#include <vtkInformation.h>
+#include <vtkPoints.h>
+#include <vtkCellArray.h>
+#include <vtkIdList.h>
 
 // C++ Standard
 #include <string.h>
+#include <algorithm>
+#include <cmath>
 #include <vector>
 
-
+// CemrgApp
+#include "CemrgAhaUtils.h"
+#include "CemrgCommonUtils.h"
 #include "CemrgPower.h"
 
 #ifndef M_PI
@@ -221,206 +224,213 @@ mitk::Surface::Pointer CemrgPower::MapPowerTransmitterToLandmarks(mitk::DataNode
     return mesh;
 }
 
-mitk::Surface::Pointer CemrgPower::CalculateAcousticIntensity(mitk::Surface::Pointer endoMesh) {
-
-    /*****************************************************************
-    // Calculate acoustic intensity on mesh
-    ******************************************************************/
-    // Read EBR vtk mesh
-    vtkSmartPointer<vtkPolyDataReader> reader = vtkSmartPointer<vtkPolyDataReader>::New();
-    // Same as output mesh from MapPowerTransmitterToLandmarks
-    QString EBRmeshPath = projectDirectory + "/ebr" + QString::number(currentRibSpacing) + ".vtk";
-
-    // ################ NEED if loop to check if file exists! //
-    reader->SetFileName(EBRmeshPath.toLocal8Bit().data());
-    reader->Update();
-    vtkPolyData* ebr_pointSet = reader->GetOutput();
-
-    // MITK load Endo Mesh
-    //QString meshPath = projectDirectory + "/transformed-" + QString::number(meshNo) + ".vtk";
-    //mitk::Surface::Pointer surf = mitk::IOUtil::Load<mitk::Surface>(meshPath.toStdString());
-    //vtkSmartPointer<vtkPolyData> pd = surf->GetVtkPolyData();
-
-    vtkSmartPointer<vtkPolyData> endo_polydata = endoMesh->GetVtkPolyData();
-
-    // Read transmitter
-    double xaxis[3], yaxis[3], zaxis[3];
-    double x0[3], x1[3], y0[3], y1[3], trans_loc[3];
-
-    // Get points from transformed EBR template (Hardcoded)
-    //vtkPointSet* ebr_pointSet = transformFilter->GetOutput();
-    //xaxis=trans[109129]-trans[70672]
-    //yaxis= trans[70672] -trans[62114]
-
-    ebr_pointSet->GetNumberOfPoints();
-    //cerr << "Number of points =" << ebr_pointSet->GetNumberOfPoints() << endl;
-    //int corner[4]={100247, 72364, 72063, 112175};
-    ebr_pointSet->GetPoint(100247, x0);
-    ebr_pointSet->GetPoint(72364, x1);
-    ebr_pointSet->GetPoint(72063, y0);
-    ebr_pointSet->GetPoint(112175, y1);
-    //*
-    trans_loc[0] = (x0[0] + x1[0] + y0[0] + y1[0]) / 4.0;
-    trans_loc[1] = (x0[1] + x1[1] + y0[1] + y1[1]) / 4.0;
-    trans_loc[2] = (x0[2] + x1[2] + y0[2] + y1[2]) / 4.0;
-
-    xaxis[0] = x1[0] - x0[0];
-    xaxis[1] = x1[1] - x0[1];
-    xaxis[2] = x1[2] - x0[2];
-    //cerr << "xaxis =" << xaxis(0) << " " << xaxis(1) << " " << xaxis(2) << endl;
+bool CemrgPower::GetTransmitterPose(vtkPolyData* ebr, TransmitterPose& pose) {
+
+    // Hard coded corners of the transmitter face on the EBR template
+    //xaxis=trans[72364]-trans[100247]
+    //yaxis=trans[100247]-trans[72063]
+    const vtkIdType corners[4] = {100247, 72364, 72063, 112175};
+    if (ebr == NULL || ebr->GetNumberOfPoints() <= corners[3]) {
+        MITK_ERROR << "The power transmitter mesh does not match the EBR template.";
+        return false;
+    }//_if
+
+    double x0[3], x1[3], y0[3], y1[3], xaxis[3], yaxis[3];
+    ebr->GetPoint(corners[0], x0);
+    ebr->GetPoint(corners[1], x1);
+    ebr->GetPoint(corners[2], y0);
+    ebr->GetPoint(corners[3], y1);
+    for (int i = 0; i < 3; i++) {
+        pose.centre[i] = (x0[i] + x1[i] + y0[i] + y1[i]) / 4.0;
+        xaxis[i] = x1[i] - x0[i];
+        yaxis[i] = x0[i] - y0[i];
+    }//_for
     CemrgPower::normalise(xaxis);
-    //cerr << "xaxis =" << xaxis(0) << " " << xaxis(1) << " " << xaxis(2) << endl;
-
-    yaxis[0] = x0[0] - y0[0];
-    yaxis[1] = x0[1] - y0[1];
-    yaxis[2] = x0[2] - y0[2];
-    //cerr << "yaxis =" << yaxis(0) << " " << yaxis(1) << " " << yaxis(2) << endl;
     CemrgPower::normalise(yaxis);
-    //cerr << "yaxis =" << yaxis(0) << " " << yaxis(1) << " " << yaxis(2) << endl;
 
     // Find the normal axis to the face of the power transmitter
-    //zaxis=yaxis.cross(xaxis);
-    //cerr << "y.cross(x) =" << zaxis(0) << " " << zaxis(1) << " " << zaxis(2) << endl;
-    CemrgPower::crossProduct(xaxis, yaxis, zaxis);
-    //zaxis=xaxis.cross(yaxis);
-    //cerr << "x.cross(y) =" << zaxis(0) << " " << zaxis(1) << " " << zaxis(2) << endl;
-    CemrgPower::normalise(zaxis);
-    //cerr << "zaxis =" << zaxis[0] << " " << zaxis[1] << " " << zaxis[2] << endl;
-    // Initialise R;
-    vtkSmartPointer<vtkMatrix3x3> R = vtkSmartPointer<vtkMatrix3x3>::New();
-    //Eigen::Matrix3f R=Eigen::Matrix3f::Identity();
-    vtkSmartPointer<vtkMatrix4x4> R1 = vtkSmartPointer<vtkMatrix4x4>::New();
-    vtkSmartPointer<vtkMatrix4x4> vtk_T = vtkSmartPointer<vtkMatrix4x4>::New();
+    CemrgPower::crossProduct(xaxis, yaxis, pose.normal);
+    CemrgPower::normalise(pose.normal);
+    return true;
+}
 
-    //Eigen::Matrix4f R1, T;
-    // Find rotation matrix to align normal axis of the power transmitter to z-axis
-    CemrgPower::fcn_RotationToUnity(zaxis, R);
+bool CemrgPower::LoadTransmitterPose(int ribSpacing, TransmitterPose& pose) {
 
-    R1->SetElement(0, 0, R->GetElement(0, 0));
-    R1->SetElement(0, 1, R->GetElement(0, 1));
-    R1->SetElement(0, 2, R->GetElement(0, 2));
-    R1->SetElement(1, 0, R->GetElement(1, 0));
-    R1->SetElement(1, 1, R->GetElement(1, 1));
-    R1->SetElement(1, 2, R->GetElement(1, 2));
-    R1->SetElement(2, 0, R->GetElement(2, 0));
-    R1->SetElement(2, 1, R->GetElement(2, 1));
-    R1->SetElement(2, 2, R->GetElement(2, 2));
+    // Same as output mesh from MapPowerTransmitterToLandmarks
+    QString EBRmeshPath = projectDirectory + "/ebr" + QString::number(ribSpacing) + ".vtk";
+    if (!QFileInfo::exists(EBRmeshPath)) {
+        MITK_ERROR << ("Power transmitter mesh " + EBRmeshPath + " does not exist.").toStdString();
+        return false;
+    }//_if
 
-    // Initialise Transformation matrices;
-    vtkSmartPointer<vtkMatrix4x4> T0 = vtkSmartPointer<vtkMatrix4x4>::New();
-    vtkSmartPointer<vtkMatrix4x4> T1 = vtkSmartPointer<vtkMatrix4x4>::New();
-    vtkSmartPointer<vtkMatrix4x4> T2 = vtkSmartPointer<vtkMatrix4x4>::New();
-    // Apply translation
-    T0->SetElement(0, 3, -trans_loc[0]);
-    T0->SetElement(1, 3, -trans_loc[1]);
-    T0->SetElement(2, 3, -trans_loc[2]);
+    vtkSmartPointer<vtkPolyDataReader> reader = vtkSmartPointer<vtkPolyDataReader>::New();
+    reader->SetFileName(EBRmeshPath.toLocal8Bit().data());
+    reader->Update();
+    return GetTransmitterPose(reader->GetOutput(), pose);
+}
 
-    // Scale by 1/1000 mm->m
-    T1->SetElement(0, 0, 0.001);
-    T1->SetElement(1, 1, 0.001);
-    T1->SetElement(2, 2, -0.001);
+mitk::Surface::Pointer CemrgPower::CalculateAcousticIntensity(mitk::Surface::Pointer endoMesh) {
 
-    // Get transformation to endo mesh
-    vtkMatrix4x4::Multiply4x4(R1, T0, T2);
-    vtkMatrix4x4::Multiply4x4(T1, T2, vtk_T);
+    mitk::Surface::Pointer mesh;
+    TransmitterPose pose;
+    if (!LoadTransmitterPose(currentRibSpacing, pose))
+        return mesh;
 
-    // Apply transformation to endo mesh so that z-axis is aligned with direction of power beam
-    vtkSmartPointer<vtkTransform> transform = vtkSmartPointer<vtkTransform>::New();
-    transform->SetMatrix(vtk_T);
+    std::vector<mitk::Surface::Pointer> meshes = CalculateAcousticIntensity(endoMesh, std::vector<TransmitterPose>(1, pose));
+    if (meshes.empty())
+        return mesh;
+    mesh = meshes.front();
+    SavePowerMap(mesh, currentRibSpacing);
+    return mesh;
+}
 
-    vtkSmartPointer<vtkTransformFilter> transformFilter = vtkSmartPointer<vtkTransformFilter>::New();
-    transformFilter->SetInputData(endo_polydata);
-    transformFilter->SetTransform(transform);
-    transformFilter->Update();
-    // Get transformed points
-    vtkPointSet* endo_pointSet = transformFilter->GetOutput();
+bool CemrgPower::SavePowerMap(mitk::Surface::Pointer mesh, int ribSpacing) {
+
+    // Keep the endo mesh where Intensity>0 in the project directory
+    QString outEndoMeshPath = projectDirectory + "/endo" + QString::number(ribSpacing) + ".vtk";
+    vtkSmartPointer<vtkPolyDataWriter> writer = vtkSmartPointer<vtkPolyDataWriter>::New();
+    writer->SetFileName(outEndoMeshPath.toLocal8Bit().data());
+    writer->SetInputData(mesh->GetVtkPolyData());
+    if (writer->Write() != 1) {
+        MITK_ERROR << ("Power map " + outEndoMeshPath + " could not be written.").toStdString();
+        return false;
+    }//_if
+    return true;
+}
 
-    //vtkDataArray *vertex=pointSet->GetPoints()->GetData();
+std::vector<mitk::Surface::Pointer> CemrgPower::CalculateAcousticIntensity(
+    mitk::Surface::Pointer endoMesh, const std::vector<TransmitterPose>& poses, int numberOfThreads) {
+
+    /*****************************************************************
+    // Calculate acoustic intensity on mesh for each transmitter pose
+    ******************************************************************/
+    std::vector<mitk::Surface::Pointer> meshes;
+    vtkPolyData* endo_polydata = endoMesh.IsNull() ? NULL : endoMesh->GetVtkPolyData();
+    if (endo_polydata == NULL || endo_polydata->GetNumberOfPoints() == 0) {
+        MITK_ERROR << "No endo mesh to calculate the acoustic intensity on.";
+        return meshes;
+    }//_if
+    vtkIdType numPoints = endo_polydata->GetNumberOfPoints();
+    size_t numPoses = poses.size();
+
+    // Transformation of each pose: align the power beam with the z-axis,
+    // centre on the transmitter and scale by 1/1000 mm->m
+    std::vector<float> beams(12 * numPoses);
+    for (size_t p = 0; p < numPoses; p++) {
+        vtkSmartPointer<vtkMatrix3x3> R = vtkSmartPointer<vtkMatrix3x3>::New();
+        CemrgPower::fcn_RotationToUnity(poses[p].normal, R);
+        const double scale[3] = {0.001, 0.001, -0.001};
+        float* T = beams.data() + 12 * p;
+        for (int r = 0; r < 3; r++) {
+            double t = 0;
+            for (int c = 0; c < 3; c++) {
+                T[4 * r + c] = scale[r] * R->GetElement(r, c);
+                t -= scale[r] * R->GetElement(r, c) * poses[p].centre[c];
+            }//_for
+            T[4 * r + 3] = t;
+        }//_for
+    }//_for
 
     // Matlab Example Computations of Acoustic Intensity
     // P. Willis EBR Systems Aug 21, 2018
-    float f, v, atten, L, A, l;
-    f = 921.25E3; // hertz
-    v = 1560; // m/sec
-    atten = -0.3; //db/(MHz*sec)
-    L = 0.9487E-3;
-    A = 8 * 24 * pow(L, 2.0);
-    l = v / f;
-
-    // Add intensities to each point
-    vtkSmartPointer<vtkFloatArray> Intensity = vtkSmartPointer<vtkFloatArray>::New();
-    Intensity->SetNumberOfComponents(1);
-    Intensity->SetName("Intensity");
-
-    // Get the ids for points where the intensity is > 0
-    vtkSmartPointer<vtkIdTypeArray> ids = vtkSmartPointer<vtkIdTypeArray>::New();
-    ids->SetNumberOfComponents(1);
-
-    std::vector<int> newMeshPoints;
-    int size_ids = 0;
-    // Calculate the power intensity for each point
-    for (int i = 0; i < endo_polydata->GetNumberOfPoints(); i++) {
-        double rx[3];
-        endo_pointSet->GetPoint(i, rx);
-
-        float d = sqrt(pow(rx[0], 2.0) + pow(rx[1], 2.0) + pow(rx[2], 2.0)); // magnitude of r vector
-        float tempx = (M_PI * L * rx[0]) / (l * d);
-        float tempy = (M_PI * L * rx[1]) / (l * d);
-        float tempI = (A / (pow(l, 2.0) * pow(d, 2.0))) * pow(10.0, (d * atten * f) / 1E5) * sinc(tempx) * sinc(tempy);
-
-        if (tempI >= 0.0) {
-            newMeshPoints.push_back(i);
-            ids->InsertNextValue(i);
-            size_ids++;
-            Intensity->InsertNextValue(tempI);
-        } else {
-            Intensity->InsertNextValue(0.0);
-        }
-    }
-    // Append intensity scalar to input endo mesh
-    // endo_polydata->GetPointData()->AddArray(Intensity);
-    endo_polydata->GetPointData()->SetScalars(Intensity);
-    // sed -i s/'FIELD FieldData 2'/'SCALARS scalars float'/g ~/Dropbox/Work/EBR/data/$case/6_pt/rib/endo${ribspace}.vtk
-    // sed -i s/'Intensity [0-9]* [0-9]* double'/'LOOKUP_TABLE default'/g ~/Dropbox/Work/EBR/data/$case/6_pt/rib/endo${ribspace}.vtk
-
-    // So we want to extract cells using points newMeshPoints
-    vtkSmartPointer<vtkSelectionNode> selectionNode = vtkSmartPointer<vtkSelectionNode>::New();
-    selectionNode->SetFieldType(vtkSelectionNode::POINT);
-    selectionNode->SetContentType(vtkSelectionNode::INDICES);
-    selectionNode->SetSelectionList(ids);
-    selectionNode->GetProperties()->Set(vtkSelectionNode::CONTAINING_CELLS(), 1);
-
-    vtkSmartPointer<vtkSelection> selection = vtkSmartPointer<vtkSelection>::New();
-    selection->AddNode(selectionNode);
-
-    vtkSmartPointer<vtkExtractSelection> extractSelection = vtkSmartPointer<vtkExtractSelection>::New();
-    extractSelection->SetInputConnection(0, reader->GetOutputPort());
-    extractSelection->SetInputData(0, endo_polydata);
-    extractSelection->SetInputData(1, selection);
-    extractSelection->Update();
-
-    // Write out new endo mesh only where Intensity>0
-    QString outEndoMeshPath = projectDirectory + "/endo" + QString::number(currentRibSpacing) + ".vtk";
-    vtkSmartPointer<vtkUnstructuredGridWriter> writer2 = vtkSmartPointer<vtkUnstructuredGridWriter>::New();
-    writer2->SetFileName(outEndoMeshPath.toLocal8Bit().data());
-    writer2->SetInputData(extractSelection->GetOutput());
-    writer2->Write();
-
-    // Load in Endo mesh
-    mitk::Surface::Pointer mesh;
-    mesh = mitk::IOUtil::Load<mitk::Surface>(outEndoMeshPath.toStdString());
-
-    cout << "TESTESTETETET" << mesh->GetVtkPolyData()->GetNumberOfCells() << endl;
-    cerr << "output Endo mesh filename in CemrgPower.cpp = " << outEndoMeshPath.toStdString() << endl;
-    return mesh;
+    const float f = 921.25E3; // hertz
+    const float v = 1560; // m/sec
+    const float atten = -0.3; //db/(MHz*sec)
+    const float L = 0.9487E-3;
+    const float A = 8 * 24 * L * L;
+    const float l = v / f;
+    // I = A/(l*d)^2 * 10^(d*atten*f/1E5) * sinc(pi*L*x/(l*d)) * sinc(pi*L*y/(l*d)), sinc(x) = sin(pi*x)/(pi*x)
+    const float kSinc = M_PI * M_PI * L / l;
+    const float kGain = A / (l * l);
+    const float kAtten = atten * f / 1E5 * std::log(10.0);
+
+    // Calculate the power intensity for each point and pose, points are read once as x, y and z blocks
+    std::vector<float> xyz(3 * numPoints);
+    std::vector<float> intensities(numPoses * numPoints);
+    CemrgCommonUtils::ParallelFor(0, numPoints, [&](vtkIdType first, vtkIdType last) {
+        float* x = xyz.data();
+        float* y = x + numPoints;
+        float* z = y + numPoints;
+        double pt[3];
+        for (vtkIdType i = first; i < last; i++) {
+            endo_polydata->GetPoint(i, pt);
+            x[i] = pt[0];
+            y[i] = pt[1];
+            z[i] = pt[2];
+        }//_for
+
+        for (size_t p = 0; p < numPoses; p++) {
+            const float* T = beams.data() + 12 * p;
+            float* intensity = intensities.data() + p * numPoints;
+            for (vtkIdType i = first; i < last; i++) {
+                float rx = T[0] * x[i] + T[1] * y[i] + T[2] * z[i] + T[3];
+                float ry = T[4] * x[i] + T[5] * y[i] + T[6] * z[i] + T[7];
+                float rz = T[8] * x[i] + T[9] * y[i] + T[10] * z[i] + T[11];
+                float d2 = rx * rx + ry * ry + rz * rz;
+                float d = std::sqrt(d2); // magnitude of r vector
+                float tempx = kSinc * rx / d;
+                float tempy = kSinc * ry / d;
+                float sincx = (tempx == 0) ? 1.0f : std::sin(tempx) / tempx;
+                float sincy = (tempy == 0) ? 1.0f : std::sin(tempy) / tempy;
+                float tempI = kGain / d2 * std::exp(kAtten * d) * sincx * sincy;
+                intensity[i] = (tempI >= 0) ? tempI : -1.0f;
+            }//_for
+        }//_for
+    }, numberOfThreads);
+
+    // Extract the cells using points where the intensity is >= 0 for each pose
+    vtkSmartPointer<vtkIdList> cellPoints = vtkSmartPointer<vtkIdList>::New();
+    vtkSmartPointer<vtkIdList> newCellPoints = vtkSmartPointer<vtkIdList>::New();
+    std::vector<vtkIdType> newIds(numPoints);
+    for (size_t p = 0; p < numPoses; p++) {
+        const float* intensity = intensities.data() + p * numPoints;
+        std::fill(newIds.begin(), newIds.end(), -1);
+
+        // The extracted surface keeps the point and cell arrays of the endo mesh
+        vtkSmartPointer<vtkPolyData> poweredEndo = vtkSmartPointer<vtkPolyData>::New();
+        poweredEndo->GetPointData()->CopyAllocate(endo_polydata->GetPointData());
+        poweredEndo->GetCellData()->CopyAllocate(endo_polydata->GetCellData());
+        vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+        vtkSmartPointer<vtkCellArray> cells = vtkSmartPointer<vtkCellArray>::New();
+        vtkSmartPointer<vtkFloatArray> Intensity = vtkSmartPointer<vtkFloatArray>::New();
+        Intensity->SetNumberOfComponents(1);
+        Intensity->SetName("Intensity");
+        for (vtkIdType c = 0; c < endo_polydata->GetNumberOfCells(); c++) {
+            endo_polydata->GetCellPoints(c, cellPoints);
+            bool powered = false;
+            for (vtkIdType j = 0; j < cellPoints->GetNumberOfIds() && !powered; j++)
+                powered = intensity[cellPoints->GetId(j)] >= 0;
+            if (!powered)
+                continue;
+
+            newCellPoints->Reset();
+            for (vtkIdType j = 0; j < cellPoints->GetNumberOfIds(); j++) {
+                vtkIdType id = cellPoints->GetId(j);
+                if (newIds[id] < 0) {
+                    newIds[id] = points->InsertNextPoint(endo_polydata->GetPoint(id));
+                    poweredEndo->GetPointData()->CopyData(endo_polydata->GetPointData(), id, newIds[id]);
+                    Intensity->InsertNextValue(std::max(intensity[id], 0.0f));
+                }//_if
+                newCellPoints->InsertNextId(newIds[id]);
+            }//_for
+            vtkIdType newCell = cells->InsertNextCell(newCellPoints);
+            poweredEndo->GetCellData()->CopyData(endo_polydata->GetCellData(), c, newCell);
+        }//_for
+
+        poweredEndo->SetPoints(points);
+        poweredEndo->SetPolys(cells);
+        poweredEndo->GetPointData()->AddArray(Intensity);
+        poweredEndo->GetPointData()->SetActiveScalars("Intensity");
+        mitk::Surface::Pointer mesh = mitk::Surface::New();
+        mesh->SetVtkPolyData(poweredEndo);
+        meshes.push_back(mesh);
+    }//_for
+    return meshes;
 }
 
 mitk::Surface::Pointer CemrgPower::ReferenceAHA(
     mitk::PointSet::Pointer lmNode, mitk::Surface::Pointer refSurface) {
 
-    //Read the mesh data
-    vtkSmartPointer<vtkPolyData> pd = refSurface->GetVtkPolyData();
-
     //Prepare landmarks
     std::vector<mitk::Point3D> LandMarks;
     if (lmNode.IsNull())
@@ -433,104 +443,14 @@ mitk::Surface::Pointer CemrgPower::ReferenceAHA(
         LandMarks.push_back(point);
     }//for
 
-    // std::vector<mitk::Point3D> LandMarks = ConvertMPS(lmNode);
-    // Siemens 4 LM = [apex, basecenter, RV1, RV2]; Siemens 7 LM = [apex, baseMV1, baseMV2, baseMV3, RV1, RV2, apex (just to make it 7 and different from manual LM)]
-    // Manual 6 LM = [apex, MV1, MV2, MV3, RV1, RV2]
-    if (LandMarks.size() != 4 && LandMarks.size() != 6 && LandMarks.size() != 7) return refSurface;
-    mitk::Point3D centre, RIV1, RIV2, APEX, MIV1, MIV2, MIV3;
-    if (LandMarks.size() >= 6) {
-        APEX = LandMarks.at(0);
-        MIV1 = LandMarks.at(1);
-        MIV2 = LandMarks.at(2);
-        MIV3 = LandMarks.at(3);
-        RIV1 = LandMarks.at(4);
-        RIV2 = LandMarks.at(5);
-        //Calcaulte a circle through the mitral valve points
-        centre = Circlefit3d(ZeroPoint(APEX, MIV1), ZeroPoint(APEX, MIV2), ZeroPoint(APEX, MIV3));
-        // Zero all points relative to apex
-    } else if (LandMarks.size() == 4) {
-        APEX = LandMarks.at(0);
-        RIV1 = LandMarks.at(2);
-        RIV2 = LandMarks.at(3);
-        centre = ZeroPoint(APEX, LandMarks.at(1));
-    }
-
-    //Zero all points relative to apex
-    RIV1 = ZeroPoint(APEX, RIV1);
-    RIV2 = ZeroPoint(APEX, RIV2);
-    ZeroVTKMesh(APEX, refSurface);
-    APEX = ZeroPoint(APEX, APEX);
-
-    //Calculate a circle through the mitral valve points
-    mitk::Point3D RCTR;
-
-    //Define Rotation matrix
-    mitk::Matrix<double, 3, 3> rotationMat = CalcRotationMatrix(centre, RIV2);
-
-    //Rotate mesh to new frame
-    RotateVTKMesh(rotationMat, refSurface);
-    //Angle RV cusp 2
-    double RVangle1 = atan2(RIV1.GetElement(1), RIV1.GetElement(0));
-    double RVangle2 = atan2(RIV2.GetElement(1), RIV2.GetElement(0));
-    double appendAngle;
-    //Assuming RV angle1 < RV angle 2
-    if (RVangle1 < RVangle2) {
-        RVangle1 = atan2(RIV2.GetElement(1), RIV2.GetElement(0));
-        RVangle2 = atan2(RIV1.GetElement(1), RIV1.GetElement(0));
-    }
-    MITK_INFO << ("RVangles: (1) " + QString::number(RVangle1) + ", (2) " + QString::number(RVangle2)).toStdString();
-
-    if ((LandMarks.size() == 6)) { // only do this for manual segmentation, with 6 points
-        appendAngle = -RVangle1;
-        //appendAngle -= freeA - ( M_PI / 3 );
-    } else {
-        if (RVangle1 > 0) {
-            appendAngle = -((M_PI - RVangle1) / 2 + RVangle1) + M_PI / 3;
-        } else {
-            appendAngle = -RVangle1 / 2 + M_PI / 3;
-        }
-    }
-    qDebug() << "appendAngle " << appendAngle;
-    //Point angles
-    std::vector<double> pAngles;
-    for (int i = 0; i < pd->GetNumberOfPoints(); i++) {
-        double pAngle;
-        double* pt = pd->GetPoint(i);
-        pAngle = atan2(pt[1], pt[0]) + appendAngle;
-        pAngle = pAngle * (pAngle > 0 ? 1 : 0) + (2 * M_PI + pAngle) * (pAngle < 0 ? 1 : 0);
-        pAngles.push_back(pAngle);
-    }
-    //Setup flattened AHA mesh
-    mitk::Surface::Pointer flatSurface = refSurface->Clone();
-    vtkSmartPointer<vtkPolyData> poly = flatSurface->GetVtkPolyData();
-    for (int i = 0; i < poly->GetNumberOfPoints(); i++) {
-        double* point = poly->GetPoint(i);
-        double  radii = point[2];
-        double  theta = pAngles.at(i);
-        point[0] = radii * cos(theta);
-        point[1] = radii * sin(theta);
-        point[2] = 0;
-        poly->GetPoints()->SetPoint(i, point);
-    }//_for
-    poly->BuildLinks();
-
-    //Return to the original position and rotation
-    APEX = ZeroPoint(LandMarks.at(0), APEX);
-    RotateVTKMesh(rotationMat.GetInverse().as_matrix(), refSurface);
-    ZeroVTKMesh(APEX, refSurface);
-    return refSurface;
+    CemrgAhaUtils aha;
+    return aha.ReferenceAHA(LandMarks, refSurface);
 }
 
 /**************************************************************************************************
  *************** PRIVATE FUNCTIONS ****************************************************************
  **************************************************************************************************/
 
-double CemrgPower::sinc(const double x) {
-
-    if (x == 0) return 1;
-    return sin(M_PI * x) / (M_PI * x);
-}
-
 void CemrgPower::normalise(double v[]) {
 
     double mag;
@@ -647,198 +567,3 @@ void CemrgPower::fcn_RotationFromTwoVectors(double a[], double b[], vtkSmartPoin
         RotationMatrix->SetElement(2, 2, t * n[2] * n[2] + c);
     }
 }
-
-/*************************************************************************************************
- * Copied from CemrgStrain
- *************************************************************************************************/
-mitk::Matrix<double, 3, 3> CemrgPower::CalcRotationMatrix(mitk::Point3D point1, mitk::Point3D point2) {
-
-    //X Axis
-    mitk::Matrix<double, 1, 3> vec;
-    vec[0][0] = point1.GetElement(0);
-    vec[0][1] = point1.GetElement(1);
-    vec[0][2] = point1.GetElement(2);
-    double theta_x = atan(vec[0][1] / vec[0][2]);
-
-    mitk::Matrix<double, 3, 3> R_x;
-    R_x[0][0] = 1;
-    R_x[0][1] = 0;
-    R_x[0][2] = 0;
-    R_x[1][0] = 0;
-    R_x[1][1] = cos(theta_x);
-    R_x[1][2] = -sin(theta_x);
-    R_x[2][0] = 0;
-    R_x[2][1] = sin(theta_x);
-    R_x[2][2] = cos(theta_x);
-
-    //Y Axis
-    mitk::Matrix<double, 3, 1> vecX;
-    vecX = R_x * vec.GetTranspose();
-    double theta_y = atan(-vecX[0][0] / vecX[2][0]);
-
-    mitk::Matrix<double, 3, 3> R_y;
-    R_y[0][0] = cos(theta_y);
-    R_y[0][1] = 0;
-    R_y[0][2] = sin(theta_y);
-    R_y[1][0] = 0;
-    R_y[1][1] = 1;
-    R_y[1][2] = 0;
-    R_y[2][0] = -sin(theta_y);
-    R_y[2][1] = 0;
-    R_y[2][2] = cos(theta_y);
-
-    //Z Axis
-    point2 = RotatePoint(R_y * R_x, point2);
-    double theta_z = atan(-point2.GetElement(1) / point2.GetElement(0));
-
-    mitk::Matrix<double, 3, 3> R_z;
-    R_z[0][0] = cos(theta_z);
-    R_z[0][1] = -sin(theta_z);
-    R_z[0][2] = 0;
-    R_z[1][0] = sin(theta_z);
-    R_z[1][1] = cos(theta_z);
-    R_z[1][2] = 0;
-    R_z[2][0] = 0;
-    R_z[2][1] = 0;
-    R_z[2][2] = 1;
-
-    //Rotation Matrix
-    mitk::Matrix<double, 3, 3> R;
-    R = R_z * R_y * R_x;
-    return R;
-}
-
-mitk::Point3D CemrgPower::Circlefit3d(mitk::Point3D point1, mitk::Point3D point2, mitk::Point3D point3) {
-
-    //v1, v2 describe the vectors from p1 to p2 and p3, resp.
-    mitk::Point3D v1;
-    mitk::Point3D v2;
-    for (int i = 0; i < 3; i++) {
-        v1.SetElement(i, point2.GetElement(i) - point1.GetElement(i));
-        v2.SetElement(i, point3.GetElement(i) - point1.GetElement(i));
-    }
-
-    //l1, l2 describe the lengths of those vectors
-    double l1 = sqrt(pow(v1.GetElement(0), 2) + pow(v1.GetElement(1), 2) + pow(v1.GetElement(2), 2));
-    double l2 = sqrt(pow(v2.GetElement(0), 2) + pow(v2.GetElement(1), 2) + pow(v2.GetElement(2), 2));
-
-    //v1n, v2n describe the normalized vectors v1 and v2
-    mitk::Point3D v1n = v1;
-    mitk::Point3D v2n = v2;
-    for (int i = 0; i < 3; i++) {
-        v1n.SetElement(i, v1n.GetElement(i) / l1);
-        v2n.SetElement(i, v2n.GetElement(i) / l2);
-    }
-
-    //nv describes the normal vector on the plane of the circle
-    mitk::Point3D nv;
-    nv.SetElement(0, v1n.GetElement(1) * v2n.GetElement(2) - v1n.GetElement(2) * v2n.GetElement(1));
-    nv.SetElement(1, v1n.GetElement(2) * v2n.GetElement(0) - v1n.GetElement(0) * v2n.GetElement(2));
-    nv.SetElement(2, v1n.GetElement(0) * v2n.GetElement(1) - v1n.GetElement(1) * v2n.GetElement(0));
-
-    //v2nb: orthogonalization of v2n against v1n
-    double dotp = v2n.GetElement(0) * v1n.GetElement(0) +
-        v2n.GetElement(1) * v1n.GetElement(1) +
-        v2n.GetElement(2) * v1n.GetElement(2);
-
-    mitk::Point3D v2nb = v2n;
-    for (int i = 0; i < 3; i++) {
-        v2nb.SetElement(i, v2nb.GetElement(i) - dotp * v1n.GetElement(i));
-    }
-
-    //Normalize v2nb
-    double l2nb = sqrt(pow(v2nb.GetElement(0), 2) + pow(v2nb.GetElement(1), 2) + pow(v2nb.GetElement(2), 2));
-    for (int i = 0; i < 3; i++) {
-        v2nb.SetElement(i, v2nb.GetElement(i) / l2nb);
-    }
-
-    //Calculate 2d coordinates of points in each plane
-    mitk::Point2D p3_2d;
-    p3_2d.SetElement(0, 0);
-    p3_2d.SetElement(1, 0);
-    for (int i = 0; i < 3; i++) {
-        p3_2d.SetElement(0, p3_2d.GetElement(0) + v2.GetElement(i) * v1n.GetElement(i));
-        p3_2d.SetElement(1, p3_2d.GetElement(1) + v2.GetElement(i) * v2nb.GetElement(i));
-    }
-
-    //Calculate the fitting circle
-    double a = l1;
-    double b = p3_2d.GetElement(0);
-    double c = p3_2d.GetElement(1);
-    double t = .5 * (a - b) / c;
-    double scale1 = b / 2 + c * t;
-    double scale2 = c / 2 - b * t;
-
-    //centre
-    mitk::Point3D centre;
-    for (int i = 0; i < 3; i++) {
-        double val = point1.GetElement(i) + (scale1 * v1n.GetElement(i)) + (scale2 * v2nb.GetElement(i));
-        centre.SetElement(i, val);
-    }
-
-    // qDebug() << centre.GetElement(0) << centre.GetElement(1) << centre.GetElement(2);
-    /*radius
-    double radius = sqrt(pow(centre.GetElement(0) - point1.GetElement(0),2) +
-                         pow(centre.GetElement(1) - point1.GetElement(1),2) +
-                         pow(centre.GetElement(2) - point1.GetElement(2),2));*/
-    return centre;
-}
-
-
-mitk::Point3D CemrgPower::RotatePoint(mitk::Matrix<double, 3, 3> rotationMatrix, mitk::Point3D point) {
-
-    mitk::Matrix<double, 1, 3> vec;
-    mitk::Matrix<double, 3, 1> ans;
-
-    vec[0][0] = point.GetElement(0);
-    vec[0][1] = point.GetElement(1);
-    vec[0][2] = point.GetElement(2);
-    ans = rotationMatrix * vec.GetTranspose();
-    point.SetElement(0, ans[0][0]);
-    point.SetElement(1, ans[1][0]);
-    point.SetElement(2, ans[2][0]);
-
-    return point;
-}
-
-void CemrgPower::RotateVTKMesh(mitk::Matrix<double, 3, 3> rotationMatrix, mitk::Surface::Pointer surface) {
-
-    //Retrieve the data
-    vtkSmartPointer<vtkPolyData> pd = surface->GetVtkPolyData();
-
-    //Rotate mesh into new coordiantes
-    for (int i = 0; i < pd->GetNumberOfPoints(); i++) {
-        mitk::Point3D point;
-        double* pt = pd->GetPoint(i);
-        point.SetElement(0, pt[0]);
-        point.SetElement(1, pt[1]);
-        point.SetElement(2, pt[2]);
-        point = RotatePoint(rotationMatrix, point);
-        pt[0] = point.GetElement(0);
-        pt[1] = point.GetElement(1);
-        pt[2] = point.GetElement(2);
-        pd->GetPoints()->SetPoint(i, pt);
-    }
-}
-
-mitk::Point3D CemrgPower::ZeroPoint(mitk::Point3D apex, mitk::Point3D point) {
-
-    //Zero relative to the apex
-    point.SetElement(0, point.GetElement(0) - apex.GetElement(0));
-    point.SetElement(1, point.GetElement(1) - apex.GetElement(1));
-    point.SetElement(2, point.GetElement(2) - apex.GetElement(2));
-    return point;
-}
-
-void CemrgPower::ZeroVTKMesh(mitk::Point3D apex, mitk::Surface::Pointer surface) {
-
-    //Retrieve the data
-    vtkSmartPointer<vtkPolyData> pd = surface->GetVtkPolyData();
-    for (int i = 0; i < pd->GetNumberOfPoints(); i++) {
-        double* point = pd->GetPoint(i);
-        point[0] = point[0] - apex.GetElement(0);
-        point[1] = point[1] - apex.GetElement(1);
-        point[2] = point[2] - apex.GetElement(2);
-        pd->GetPoints()->SetPoint(i, point);
-    }
-}
@@ -0,0 +1,340 @@
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * Scalar Transfer
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrgapp.com
+ * jose.solislemus@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+// Qmitk
+#include <mitkLogMacros.h>
+
+// VTK
+#include <vtkCellType.h>
+#include <vtkIdList.h>
+#include <vtkMath.h>
+
+// C++ Standard
+#include <algorithm>
+
+// CemrgApp
+#include "CemrgCommonUtils.h"
+#include "CemrgScalarTransfer.h"
+
+namespace {
+
+void InsertNeighbour(vtkIdType id, double d2, int k, vtkIdType* ids, double* dist2, int& found) {
+
+    //Neighbours stay sorted by distance, the furthest drops out when full
+    if (found == k && d2 >= dist2[k - 1])
+        return;
+    int slot = (found < k) ? found++ : k - 1;
+    while (slot > 0 && dist2[slot - 1] > d2) {
+        dist2[slot] = dist2[slot - 1];
+        ids[slot] = ids[slot - 1];
+        slot--;
+    }//_while
+    dist2[slot] = d2;
+    ids[slot] = id;
+}
+
+double ClosestPointOnTriangle(const double* p, const double* a, const double* b, const double* c, double* bary) {
+
+    //Closest point by Voronoi region of the triangle, returns the squared distance
+    double ab[3], ac[3], ap[3], bp[3], cp[3];
+    vtkMath::Subtract(b, a, ab);
+    vtkMath::Subtract(c, a, ac);
+    vtkMath::Subtract(p, a, ap);
+    double d1 = vtkMath::Dot(ab, ap), d2 = vtkMath::Dot(ac, ap);
+    vtkMath::Subtract(p, b, bp);
+    double d3 = vtkMath::Dot(ab, bp), d4 = vtkMath::Dot(ac, bp);
+    vtkMath::Subtract(p, c, cp);
+    double d5 = vtkMath::Dot(ab, cp), d6 = vtkMath::Dot(ac, cp);
+    double vc = d1 * d4 - d3 * d2, vb = d5 * d2 - d1 * d6, va = d3 * d6 - d5 * d4;
+
+    if (d1 <= 0 && d2 <= 0) {
+        bary[0] = 1, bary[1] = 0, bary[2] = 0;
+    } else if (d3 >= 0 && d4 <= d3) {
+        bary[0] = 0, bary[1] = 1, bary[2] = 0;
+    } else if (vc <= 0 && d1 >= 0 && d3 <= 0) {
+        double v = d1 / (d1 - d3);
+        bary[0] = 1 - v, bary[1] = v, bary[2] = 0;
+    } else if (d6 >= 0 && d5 <= d6) {
+        bary[0] = 0, bary[1] = 0, bary[2] = 1;
+    } else if (vb <= 0 && d2 >= 0 && d6 <= 0) {
+        double w = d2 / (d2 - d6);
+        bary[0] = 1 - w, bary[1] = 0, bary[2] = w;
+    } else if (va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0) {
+        double w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+        bary[0] = 0, bary[1] = 1 - w, bary[2] = w;
+    } else {
+        double denom = 1.0 / (va + vb + vc);
+        bary[1] = vb * denom, bary[2] = vc * denom;
+        bary[0] = 1 - bary[1] - bary[2];
+    }//_if
+
+    double q[3];
+    for (int i = 0; i < 3; i++)
+        q[i] = bary[0] * a[i] + bary[1] * b[i] + bary[2] * c[i];
+    return vtkMath::Distance2BetweenPoints(p, q);
+}
+
+}
+
+CemrgScalarTransfer::CemrgScalarTransfer() {
+
+    this->interpolationMode = NEAREST_POINT;
+    this->numberOfNeighbours = 4;
+    this->numberOfThreads = 0;
+    this->defaultValue = 0;
+}
+
+void CemrgScalarTransfer::SetReference(vtkPolyData* pd) {
+
+    treePoints.clear();
+    treeIds.clear();
+    splitAxis.clear();
+    referencePoints.clear();
+    triangles.clear();
+    pointTriangleOffsets.clear();
+    pointTriangles.clear();
+    if (pd == NULL)
+        return;
+
+    vtkIdType numPoints = pd->GetNumberOfPoints();
+    referencePoints.resize(3 * numPoints);
+    treeIds.resize(numPoints);
+    for (vtkIdType i = 0; i < numPoints; i++) {
+        pd->GetPoint(i, &referencePoints[3 * i]);
+        treeIds[i] = i;
+    }//_for
+
+    splitAxis.assign(numPoints, 0);
+    BuildTree(0, numPoints);
+    treePoints.resize(3 * numPoints);
+    for (vtkIdType s = 0; s < numPoints; s++)
+        std::copy(&referencePoints[3 * treeIds[s]], &referencePoints[3 * treeIds[s]] + 3, &treePoints[3 * s]);
+
+    //Triangles around each point, for the closest cell search
+    vtkSmartPointer<vtkIdList> cellPoints = vtkSmartPointer<vtkIdList>::New();
+    pointTriangleOffsets.assign(numPoints + 1, 0);
+    for (vtkIdType c = 0; c < pd->GetNumberOfCells(); c++) {
+        if (pd->GetCellType(c) != VTK_TRIANGLE)
+            continue;
+        pd->GetCellPoints(c, cellPoints);
+        for (int j = 0; j < 3; j++) {
+            triangles.push_back(cellPoints->GetId(j));
+            pointTriangleOffsets[cellPoints->GetId(j) + 1]++;
+        }//_for
+    }//_for
+    for (vtkIdType i = 0; i < numPoints; i++)
+        pointTriangleOffsets[i + 1] += pointTriangleOffsets[i];
+    std::vector<vtkIdType> fill(pointTriangleOffsets.begin(), pointTriangleOffsets.end() - 1);
+    pointTriangles.resize(triangles.size());
+    for (size_t t = 0; t < triangles.size() / 3; t++)
+        for (int j = 0; j < 3; j++)
+            pointTriangles[fill[triangles[3 * t + j]]++] = t;
+}
+
+void CemrgScalarTransfer::SetInterpolationMode(int value) {
+
+    this->interpolationMode = value;
+}
+
+void CemrgScalarTransfer::SetNumberOfNeighbours(int value) {
+
+    this->numberOfNeighbours = std::max(1, std::min(value, (int)maxNeighbours));
+}
+
+void CemrgScalarTransfer::SetNumberOfThreads(int value) {
+
+    this->numberOfThreads = value;
+}
+
+void CemrgScalarTransfer::SetDefaultValue(double value) {
+
+    this->defaultValue = value;
+}
+
+bool CemrgScalarTransfer::Transfer(
+    vtkPolyData* query, const std::vector<vtkDataArray*>& arrays, std::vector<vtkSmartPointer<vtkFloatArray>>& mapped) const {
+
+    mapped.clear();
+    if (query == NULL)
+        return false;
+
+    //Reference values are read once, the parallel loop only touches plain buffers
+    vtkIdType numReference = GetNumberOfReferencePoints();
+    std::vector<std::vector<double>> values(arrays.size());
+    for (size_t a = 0; a < arrays.size(); a++) {
+        if (arrays[a] == NULL || arrays[a]->GetNumberOfTuples() != numReference) {
+            MITK_ERROR << "Scalar array " << a << " does not match the points of the reference mesh.";
+            mapped.clear();
+            return false;
+        }//_if
+        values[a].resize(numReference);
+        for (vtkIdType i = 0; i < numReference; i++)
+            values[a][i] = arrays[a]->GetComponent(i, 0);
+
+        vtkSmartPointer<vtkFloatArray> output = vtkSmartPointer<vtkFloatArray>::New();
+        output->SetName(arrays[a]->GetName());
+        output->SetNumberOfComponents(1);
+        output->SetNumberOfTuples(query->GetNumberOfPoints());
+        mapped.push_back(output);
+    }//_for
+
+    std::vector<float*> outputs(arrays.size());
+    for (size_t a = 0; a < arrays.size(); a++)
+        outputs[a] = mapped[a]->GetPointer(0);
+
+    CemrgCommonUtils::ParallelFor(0, query->GetNumberOfPoints(), [&](vtkIdType first, vtkIdType last) {
+        vtkIdType ids[maxNeighbours];
+        double weights[maxNeighbours], x[3];
+        for (vtkIdType i = first; i < last; i++) {
+            query->GetPoint(i, x);
+            int n = (numReference > 0) ? GetStencil(x, ids, weights) : 0;
+            for (size_t a = 0; a < values.size(); a++) {
+                double value = (n == 0) ? defaultValue : 0;
+                for (int j = 0; j < n; j++)
+                    value += weights[j] * values[a][ids[j]];
+                outputs[a][i] = value;
+            }//_for
+        }//_for
+    }, numberOfThreads);
+
+    return true;
+}
+
+vtkIdType CemrgScalarTransfer::FindClosestPoint(const double x[3]) const {
+
+    vtkIdType id = -1;
+    double dist2;
+    int found = 0;
+    SearchTree(0, treeIds.size(), x, 1, &id, &dist2, found);
+    return (found == 0) ? -1 : id;
+}
+
+void CemrgScalarTransfer::BuildTree(vtkIdType first, vtkIdType last) {
+
+    if (last - first <= leafSize)
+        return;
+
+    double lower[3] = {VTK_DOUBLE_MAX, VTK_DOUBLE_MAX, VTK_DOUBLE_MAX};
+    double upper[3] = {VTK_DOUBLE_MIN, VTK_DOUBLE_MIN, VTK_DOUBLE_MIN};
+    for (vtkIdType s = first; s < last; s++) {
+        const double* p = &referencePoints[3 * treeIds[s]];
+        for (int i = 0; i < 3; i++) {
+            lower[i] = std::min(lower[i], p[i]);
+            upper[i] = std::max(upper[i], p[i]);
+        }//_for
+    }//_for
+
+    int axis = 0;
+    for (int i = 1; i < 3; i++)
+        if (upper[i] - lower[i] > upper[axis] - lower[axis])
+            axis = i;
+
+    vtkIdType mid = first + (last - first) / 2;
+    std::nth_element(treeIds.begin() + first, treeIds.begin() + mid, treeIds.begin() + last, [&](vtkIdType a, vtkIdType b) {
+        return referencePoints[3 * a + axis] < referencePoints[3 * b + axis];
+    });
+    splitAxis[mid] = axis;
+    BuildTree(first, mid);
+    BuildTree(mid + 1, last);
+}
+
+void CemrgScalarTransfer::SearchTree(
+    vtkIdType first, vtkIdType last, const double* x, int k, vtkIdType* ids, double* dist2, int& found) const {
+
+    if (last - first <= leafSize) {
+        for (vtkIdType s = first; s < last; s++)
+            InsertNeighbour(treeIds[s], vtkMath::Distance2BetweenPoints(x, &treePoints[3 * s]), k, ids, dist2, found);
+        return;
+    }//_if
+
+    vtkIdType mid = first + (last - first) / 2;
+    int axis = splitAxis[mid];
+    InsertNeighbour(treeIds[mid], vtkMath::Distance2BetweenPoints(x, &treePoints[3 * mid]), k, ids, dist2, found);
+
+    //Nearer side first, the far side only if the splitting plane is within reach
+    double diff = x[axis] - treePoints[3 * mid + axis];
+    if (diff < 0) {
+        SearchTree(first, mid, x, k, ids, dist2, found);
+        if (found < k || diff * diff < dist2[found - 1])
+            SearchTree(mid + 1, last, x, k, ids, dist2, found);
+    } else {
+        SearchTree(mid + 1, last, x, k, ids, dist2, found);
+        if (found < k || diff * diff < dist2[found - 1])
+            SearchTree(first, mid, x, k, ids, dist2, found);
+    }//_if
+}
+
+int CemrgScalarTransfer::GetStencil(const double* x, vtkIdType* ids, double* weights) const {
+
+    int found = 0;
+    double dist2[maxNeighbours];
+    int k = (interpolationMode == INVERSE_DISTANCE) ? numberOfNeighbours : 1;
+    SearchTree(0, treeIds.size(), x, k, ids, dist2, found);
+    if (found == 0)
+        return 0;
+
+    switch (interpolationMode) {
+        case INVERSE_DISTANCE: {
+            if (dist2[0] == 0)
+                break; //coincides with a reference point
+            double total = 0;
+            for (int j = 0; j < found; j++) {
+                weights[j] = 1.0 / dist2[j];
+                total += weights[j];
+            }//_for
+            for (int j = 0; j < found; j++)
+                weights[j] /= total;
+            return found;
+        }
+        case CLOSEST_CELL: {
+            vtkIdType nearest = ids[0];
+            double best = VTK_DOUBLE_MAX, bary[3];
+            for (vtkIdType e = pointTriangleOffsets[nearest]; e < pointTriangleOffsets[nearest + 1]; e++) {
+                const vtkIdType* t = &triangles[3 * pointTriangles[e]];
+                double d2 = ClosestPointOnTriangle(x,
+                    &referencePoints[3 * t[0]], &referencePoints[3 * t[1]], &referencePoints[3 * t[2]], bary);
+                if (d2 < best) {
+                    best = d2;
+                    for (int j = 0; j < 3; j++) {
+                        ids[j] = t[j];
+                        weights[j] = bary[j];
+                    }//_for
+                }//_if
+            }//_for
+            if (best < VTK_DOUBLE_MAX)
+                return 3;
+            ids[0] = nearest; //no triangles around it, fall back to the point
+            break;
+        }
+        default:
+            break;
+    }//_switch
+
+    weights[0] = 1;
+    return 1;
+}
@@ -45,24 +45,28 @@ PURPOSE.  See the above copyright notices for more information.
 #include <vtkFloatArray.h>
 #include <vtkPolyData.h>
 #include <vtkCellData.h>
+#include <vtkPointData.h>
 #include <vtkPolyDataNormals.h>
 #include <vtkIdList.h>
 
 // ITK
 #include <itkPoint.h>
+#include <itkImageIOBase.h>
 #include <itkImageFileWriter.h>
-#include <itkImageRegionIterator.h>
-#include <itkImageRegionIteratorWithIndex.h>
 
 // Qt
 #include <QtDebug>
-#include <QMessageBox>
+#include <QFileInfo>
 
 // C++ Standard
-#include <numeric>
+#include <cmath>
+#include <algorithm>
+#include <utility>
+#include <limits>
 
 // CemrgApp
 #include "CemrgCommonUtils.h"
+#include "CemrgScarProjection.h"
 #include "CemrgScar3D.h"
 
 CemrgScar3D::CemrgScar3D() {
@@ -71,94 +75,146 @@ CemrgScar3D::CemrgScar3D() {
     this->minStep = -3, this->maxStep = 3;
     this->minScalar = 1E10, this->maxScalar = -1;
     this->voxelBasedProjection = false;
+    this->vertexBasedProjection = false;
+    this->pointScalars = false;
+    this->histogramValid = false;
     this->debugging = false;
+    this->numberOfThreads = 0;
+    this->samplingMode = 1;
+    this->stepSize = 0.25;
     this->scalars = vtkSmartPointer<vtkFloatArray>::New();
 }
 
-mitk::Surface::Pointer CemrgScar3D::Scar3D(std::string directory, mitk::Image::Pointer lgeImage, std::string segname) {
+template <typename TPixel>
+bool CemrgScar3D::ProjectLge(mitk::Image::Pointer lgeImage, vtkPolyData* pd,
+    const std::vector<std::pair<int, int>>& windows, std::vector<std::vector<double>>& intensities) {
 
     //Convert to itk image
-    itkImageType::Pointer scarImage;
+    typename CemrgScarProjection<TPixel>::ImageType::Pointer scarImage;
     mitk::CastToItkImage(lgeImage, scarImage);
-    itkImageType::Pointer visitedImage = itkImageType::New();
-    ItkDeepCopy(scarImage, visitedImage);
+
+    CemrgScarProjection<TPixel> projection;
+    projection.SetImage(scarImage);
+    projection.SetSegmentation(scarSegImage);
+    projection.SetSteps(minStep, maxStep);
+    projection.SetSamplingMode(samplingMode);
+    projection.SetStepSize(stepSize);
+    projection.SetVoxelBasedProjection(voxelBasedProjection);
+    projection.SetNumberOfThreads(numberOfThreads);
+    bool geometry = vertexBasedProjection ? projection.ComputePointGeometry(pd) : projection.ComputeCellGeometry(pd);
+    if (!geometry)
+        return false;
+
+    //Window sweep, only for measures that can be rebuilt from per-step partials
+    if (!windows.empty()) {
+        if (methodType == 1)
+            return projection.template ProjectWindows<CemrgProjectionMean>(windows, intensities);
+        if (methodType == 2)
+            return projection.template ProjectWindows<CemrgProjectionMax>(windows, intensities);
+        if (methodType == 3)
+            return projection.template ProjectWindows<CemrgProjectionSum>(windows, intensities);
+        MITK_ERROR << "Projection method " << methodType << " is not supported by the window sweep.";
+        return false;
+    }//_if
+
+    bool projected = false;
+    intensities.resize(1);
+    std::vector<double>& cellIntensities = intensities[0];
+    if (methodType == 1) {
+        projected = projection.template Project<CemrgProjectionMean>(cellIntensities);
+    } else if (methodType == 2) {
+        projected = projection.template Project<CemrgProjectionMax>(cellIntensities);
+    } else if (methodType == 3) {
+        projected = projection.template Project<CemrgProjectionSum>(cellIntensities);
+    } else if (methodType == 4) {
+        projected = projection.template Project<CemrgProjectionMedian>(cellIntensities);
+    } else {
+        MITK_WARN << "Unknown projection method " << methodType << ", all intensities are set to 0.";
+        projected = projection.template Project<CemrgProjectionSum>(cellIntensities);
+        std::fill(cellIntensities.begin(), cellIntensities.end(), 0);
+    }//_if
+    if (!projected)
+        return false;
+
+    //Keep the claimed voxels for the debug image
+    visitedRegion = projection.GetRegion();
+    projection.SwapVisitedVoxels(visitedVoxels);
+    return true;
+}
+
+bool CemrgScar3D::ProjectLgeImage(mitk::Image::Pointer lgeImage, vtkPolyData* pd,
+    const std::vector<std::pair<int, int>>& windows, std::vector<std::vector<double>>& intensities) {
+
+    if (scarSegImage.IsNull()) {
+        MITK_ERROR << "The scar segmentation must be set and match the LGE image dimensions.";
+        return false;
+    }//_if
+
+    //Project in the LGE pixel type, only types without an engine are cast to short
+    switch (lgeImage->GetPixelType().GetComponentType()) {
+        case itk::ImageIOBase::FLOAT:
+            return ProjectLge<float>(lgeImage, pd, windows, intensities);
+        case itk::ImageIOBase::DOUBLE:
+            return ProjectLge<double>(lgeImage, pd, windows, intensities);
+        case itk::ImageIOBase::UCHAR:
+            return ProjectLge<unsigned char>(lgeImage, pd, windows, intensities);
+        default:
+            return ProjectLge<short>(lgeImage, pd, windows, intensities);
+    }//_switch
+}
+
+vtkSmartPointer<vtkPolyData> CemrgScar3D::LoadShellWithNormals(std::string path, mitk::Surface::Pointer& surface) {
 
     //Read in the mesh
-    std::string path = directory + "/" + segname;
-    mitk::Surface::Pointer surface = CemrgCommonUtils::LoadVTKMesh(path);
+    surface = CemrgCommonUtils::LoadVTKMesh(path);
     vtkSmartPointer<vtkPolyData> pd = surface->GetVtkPolyData();
+    if (pd == nullptr || pd->GetNumberOfCells() == 0) {
+        MITK_ERROR << "Could not load the shell " << path << ".";
+        return nullptr;
+    }//_if
 
     //Calculate normals
     vtkSmartPointer<vtkPolyDataNormals> normals = vtkSmartPointer<vtkPolyDataNormals>::New();
     vtkSmartPointer<vtkPolyData> tempPD = vtkSmartPointer<vtkPolyData>::New();
     tempPD->DeepCopy(pd);
-    normals->ComputeCellNormalsOn();
+    if (vertexBasedProjection) {
+        normals->ComputePointNormalsOn();
+        normals->ComputeCellNormalsOff();
+    } else {
+        normals->ComputeCellNormalsOn();
+    }//_if
     normals->SetInputData(tempPD);
     normals->SplittingOff();
     normals->Update();
-    pd = normals->GetOutput();
+    return normals->GetOutput();
+}
+
+mitk::Surface::Pointer CemrgScar3D::Scar3D(std::string directory, mitk::Image::Pointer lgeImage, std::string segname) {
+
+    mitk::Surface::Pointer surface;
+    vtkSmartPointer<vtkPolyData> pd = LoadShellWithNormals(directory + "/" + segname, surface);
+    std::vector<std::vector<double>> intensities;
+    if (pd == nullptr || !ProjectLgeImage(lgeImage, pd, std::vector<std::pair<int, int>>(), intensities))
+        return nullptr;
+    const std::vector<double>& cellIntensities = intensities[0];
+    vtkIdType numCells = cellIntensities.size();
+
+    //Fresh scalars, so earlier surfaces keep theirs and no stale tuples survive a smaller mesh
+    scalars = vtkSmartPointer<vtkFloatArray>::New();
+    pointScalars = vertexBasedProjection;
 
     //Declarations
-    vtkIdType numCellPoints;
-    vtkSmartPointer<vtkIdList> cellPoints = vtkSmartPointer<vtkIdList>::New();
-    vtkSmartPointer<vtkFloatArray> cellNormals = vtkFloatArray::SafeDownCast(pd->GetCellData()->GetNormals());
     std::vector<double> allScalarsInShell;
     vtkSmartPointer<vtkFloatArray> scalarsOnlyStDev = vtkSmartPointer<vtkFloatArray>::New();
     vtkSmartPointer<vtkFloatArray> scalarsOnlyMultiplier = vtkSmartPointer<vtkFloatArray>::New();
     vtkSmartPointer<vtkFloatArray> scalarsOnlyIntensity = vtkSmartPointer<vtkFloatArray>::New();
-    itkImageType::IndexType pixelXYZ;
-    itkImageType::PointType pointXYZ;
 
     double maxSdev = -1e9;
     double maxSratio = -1e9;
     double mean = 0, var = 1;
 
-    for (int i = 0; i < pd->GetNumberOfCells(); i++) {
-        double pN[3];
-        cellNormals->GetTuple(i, pN);
-        double cX = 0, cY = 0, cZ = 0, numPoints = 0;
-        pd->GetCellPoints(i, cellPoints);
-        numCellPoints = cellPoints->GetNumberOfIds();
-
-        for (vtkIdType neighborPoint = 0; neighborPoint < numCellPoints; ++neighborPoint) {
-
-            //Get the neighbor point ID
-            vtkIdType neighborPointID = cellPoints->GetId(neighborPoint);
-
-            //Get the neighbor point position
-            double cP[3];
-            pd->GetPoint(neighborPointID, cP);
-
-            // ITK method
-            pointXYZ[0] = cP[0];
-            pointXYZ[1] = cP[1];
-            pointXYZ[2] = cP[2];
-            scarImage->TransformPhysicalPointToIndex(pointXYZ, pixelXYZ);
-            cP[0] = pixelXYZ[0];
-            cP[1] = pixelXYZ[1];
-            cP[2] = pixelXYZ[2];
-
-            cX += cP[0];
-            cY += cP[1];
-            cZ += cP[2];
-
-            numPoints++;
-        }//_innerLoop
-
-        cX /= numPoints;
-        cY /= numPoints;
-        cZ /= numPoints;
-
-        // ITK method
-        pointXYZ[0] = pN[0];
-        pointXYZ[1] = pN[1];
-        pointXYZ[2] = pN[2];
-        scarImage->TransformPhysicalPointToIndex(pointXYZ, pixelXYZ);
-        pN[0] = pixelXYZ[0];
-        pN[1] = pixelXYZ[1];
-        pN[2] = pixelXYZ[2];
-
-        double scalar = GetIntensityAlongNormal(scarImage, visitedImage, pN[0], pN[1], pN[2], cX, cY, cZ);
+    for (int i = 0; i < numCells; i++) {
+        double scalar = cellIntensities[i];
 
         if (scalar > maxScalar) maxScalar = scalar;
         if (scalar < minScalar) minScalar = scalar;
@@ -211,12 +267,53 @@ mitk::Surface::Pointer CemrgScar3D::Scar3D(std::string directory, mitk::Image::P
         //      allScalarsInShell.push_back(scalar); }
     }//_for
 
-    scarDebugLabel = visitedImage;
-    pd->GetCellData()->SetScalars(scalars);
+    scalars->Modified();
+    UpdateThresholdIndex();
+    if (pointScalars)
+        pd->GetPointData()->SetScalars(scalars);
+    else
+        pd->GetCellData()->SetScalars(scalars);
+    surface->SetVtkPolyData(pd);
+    return surface;
+}
+
+mitk::Surface::Pointer CemrgScar3D::Scar3DWindows(std::string directory, mitk::Image::Pointer lgeImage,
+    const std::vector<std::pair<int, int>>& windows, std::string segname) {
+
+    if (windows.empty()) {
+        MITK_ERROR << "No projection windows were given.";
+        return nullptr;
+    }//_if
+
+    mitk::Surface::Pointer surface;
+    vtkSmartPointer<vtkPolyData> pd = LoadShellWithNormals(directory + "/" + segname, surface);
+    std::vector<std::vector<double>> intensities;
+    if (pd == nullptr || !ProjectLgeImage(lgeImage, pd, windows, intensities))
+        return nullptr;
+
+    //One named array per window, holding the scalars a Scar3D run with that window plots
+    vtkDataSetAttributes* attributes = pd->GetCellData();
+    if (vertexBasedProjection)
+        attributes = pd->GetPointData();
+    for (size_t w = 0; w < windows.size(); w++) {
+        vtkSmartPointer<vtkFloatArray> windowScalars = vtkSmartPointer<vtkFloatArray>::New();
+        windowScalars->SetName(WindowArrayName(windows[w].first, windows[w].second).toStdString().c_str());
+        windowScalars->SetNumberOfTuples(intensities[w].size());
+        for (size_t i = 0; i < intensities[w].size(); i++)
+            windowScalars->SetValue(i, intensities[w][i] <= 0 ? 0 : intensities[w][i]);
+        attributes->AddArray(windowScalars);
+    }//_for
+
+    attributes->SetActiveScalars(WindowArrayName(windows[0].first, windows[0].second).toStdString().c_str());
     surface->SetVtkPolyData(pd);
     return surface;
 }
 
+QString CemrgScar3D::WindowArrayName(int minStep, int maxStep) {
+
+    return "Window_" + QString::number(minStep) + "_" + QString::number(maxStep);
+}
+
 mitk::Surface::Pointer CemrgScar3D::ClipMesh3D(mitk::Surface::Pointer surface, mitk::PointSet::Pointer landmarks) {
 
     //Retrieve mean and distance of 3 points
@@ -273,51 +370,171 @@ mitk::Surface::Pointer CemrgScar3D::ClipMesh3D(mitk::Surface::Pointer surface, m
 
 bool CemrgScar3D::CalculateMeanStd(mitk::Image::Pointer lgeImage, mitk::Image::Pointer roiImage, double& mean, double& stdv) {
 
-    //Access image volumes
-    mitk::ImagePixelReadAccessor<float, 3> readAccess1(lgeImage);
-    float* pvLGE = (float*)readAccess1.GetData();
-    mitk::ImagePixelReadAccessor<float, 3> readAccess2(roiImage);
-    float* pvROI = (float*)readAccess2.GetData();
+    std::map<int, RoiStatistics> statistics;
+    int status = CalculateRoiStatistics(lgeImage, roiImage, std::vector<int>(1, 1), statistics);
+    if (status != ROI_STATS_OK) {
+        MITK_ERROR << "Mean and std of the ROI could not be calculated (error code " << status << ").";
+        return false;
+    }//_if
 
-    int dimsLGE = lgeImage->GetDimensions()[0] * lgeImage->GetDimensions()[1] * lgeImage->GetDimensions()[2];
-    int dimsROI = roiImage->GetDimensions()[0] * roiImage->GetDimensions()[1] * roiImage->GetDimensions()[2];
+    mean = statistics[1].mean;
+    stdv = statistics[1].stdv;
+    return true;
+}
+
+namespace {
+
+//Running moments of one label, merged pairwise (Chan et al.)
+struct RoiAccumulator {
+    unsigned long count = 0;
+    double mean = 0.0, m2 = 0.0;
+    double min = std::numeric_limits<double>::max();
+    double max = std::numeric_limits<double>::lowest();
+
+    inline void Add(double value) {
+        count++;
+        double delta = value - mean;
+        mean += delta / count;
+        m2 += delta * (value - mean);
+        if (value < min) min = value;
+        if (value > max) max = value;
+    }
+
+    void Merge(const RoiAccumulator& other) {
+        if (other.count == 0)
+            return;
+        if (count == 0) {
+            *this = other;
+            return;
+        }//_if
+        double total = count + other.count;
+        double delta = other.mean - mean;
+        mean += delta * other.count / total;
+        m2 += other.m2 + delta * delta * count * other.count / total;
+        count += other.count;
+        min = std::min(min, other.min);
+        max = std::max(max, other.max);
+    }
+};
+
+}
+
+int CemrgScar3D::CalculateRoiStatistics(
+    mitk::Image::Pointer lgeImage, mitk::Image::Pointer roiImage,
+    const std::vector<int>& labels, std::map<int, RoiStatistics>& statistics) {
+
+    statistics.clear();
+    if (lgeImage.IsNull() || roiImage.IsNull()) {
+        MITK_ERROR << "Missing LGE or ROI image.";
+        return ROI_STATS_NULL_IMAGE;
+    }//_if
+
+    size_t dimsLGE = (size_t)lgeImage->GetDimensions()[0] * lgeImage->GetDimensions()[1] * lgeImage->GetDimensions()[2];
+    size_t dimsROI = (size_t)roiImage->GetDimensions()[0] * roiImage->GetDimensions()[1] * roiImage->GetDimensions()[2];
     if (dimsLGE != dimsROI) {
-        QMessageBox::critical(NULL, "Attention", "The mask and the image dimensions do not match!");
-        return false;
+        MITK_ERROR << "The mask and the image dimensions do not match!";
+        return ROI_STATS_SIZE_MISMATCH;
     }//_wrong dimensions
 
-    //Loop image voxels
-    std::vector<float> voxelValues;
-    for (int i = 0; i < dimsROI; i++) {
-        if (*pvROI == 1)
-            voxelValues.push_back(*pvLGE);
-        pvLGE++;
-        pvROI++;
+    //Access image volumes
+    mitk::ImagePixelReadAccessor<float, 3> readAccess1(lgeImage);
+    const float* pvLGE = (const float*)readAccess1.GetData();
+    mitk::ImagePixelReadAccessor<float, 3> readAccess2(roiImage);
+    const float* pvROI = (const float*)readAccess2.GetData();
+
+    //Fixed-size blocks merged in order give the same result for any thread count
+    const vtkIdType blockSize = 1 << 16;
+    const vtkIdType numBlocks = (dimsROI + blockSize - 1) / blockSize;
+    const size_t numLabels = labels.size();
+    std::vector<float> labelValues(labels.begin(), labels.end());
+    std::vector<RoiAccumulator> partials(numBlocks * numLabels);
+
+    CemrgCommonUtils::ParallelFor(0, numBlocks, [&](vtkIdType first, vtkIdType last) {
+        for (vtkIdType b = first; b < last; b++) {
+            RoiAccumulator* blockAccumulators = &partials[b * numLabels];
+            size_t end = std::min((size_t)((b + 1) * blockSize), dimsROI);
+            for (size_t i = b * blockSize; i < end; i++) {
+                for (size_t l = 0; l < numLabels; l++) {
+                    if (pvROI[i] == labelValues[l]) {
+                        blockAccumulators[l].Add(pvLGE[i]);
+                        break;
+                    }//_if
+                }//_for
+            }//_for
+        }//_for
+    }, numberOfThreads);
+
+    int status = ROI_STATS_OK;
+    for (size_t l = 0; l < numLabels; l++) {
+        RoiAccumulator total;
+        for (vtkIdType b = 0; b < numBlocks; b++)
+            total.Merge(partials[b * numLabels + l]);
+
+        RoiStatistics& roi = statistics[labels[l]];
+        roi.count = total.count;
+        if (total.count == 0) {
+            MITK_WARN << "ROI label " << labels[l] << " has no voxels.";
+            roi.mean = roi.stdv = roi.min = roi.max = 0.0;
+            status = ROI_STATS_EMPTY_LABEL;
+            continue;
+        }//_if
+        roi.mean = total.mean;
+        roi.stdv = std::sqrt(total.m2 / total.count);
+        roi.min = total.min;
+        roi.max = total.max;
     }//_for
 
-    //Calculate mean and std
-    double sumDeviation = 0.0;
-    double sum = std::accumulate(voxelValues.begin(), voxelValues.end(), 0.0);
-    mean = sum / voxelValues.size();
-    for (unsigned int i = 0; i < voxelValues.size(); i++)
-        sumDeviation += (voxelValues[i] - mean) * (voxelValues[i] - mean);
-    stdv = std::sqrt(sumDeviation / voxelValues.size());
-    return true;
+    return status;
 }
 
 double CemrgScar3D::Thresholding(double thresh) {
 
-    int ctr1 = 0, ctr2 = 0;
-    for (int i = 0; i < scalars->GetNumberOfTuples(); i++) {
-        double value = scalars->GetValue(i);
-        if (value == -1) {
-            ctr1++;
-            continue;
-        }//_if
-        if (value > thresh) ctr2++;
-    }
-    double percentage = (ctr2 * 100.0) / (scalars->GetNumberOfTuples() - ctr1);
-    return percentage;
+    UpdateThresholdIndex();
+    return thresholdIndex.Percentage(thresh);
+}
+
+std::vector<double> CemrgScar3D::ThresholdingCurve(const std::vector<double>& thresholds) {
+
+    UpdateThresholdIndex();
+    return thresholdIndex.Percentages(thresholds);
+}
+
+const CemrgScarHistogram& CemrgScar3D::GetHistogram(int numberOfBins) {
+
+    //Binned once per projection and bin count, later requests reuse it
+    UpdateThresholdIndex();
+    if (!histogramValid || histogram.GetNumberOfBins() != numberOfBins) {
+        histogram.Build(thresholdIndex, numberOfBins, numberOfThreads);
+        histogramValid = true;
+        histogramCsvPath.clear();
+    }//_if
+    return histogram;
+}
+
+bool CemrgScar3D::SaveHistogramCsv(QString path, int numberOfBins) {
+
+    const CemrgScarHistogram& hist = GetHistogram(numberOfBins);
+    if (hist.GetNumberOfValues() == 0) {
+        MITK_WARN << "No valid scalars to write a histogram for.";
+        return false;
+    }//_if
+
+    //Written once per projection, later thresholds reuse the file
+    if (path == histogramCsvPath && QFileInfo::exists(path))
+        return true;
+    if (!hist.ExportCsv(path))
+        return false;
+    histogramCsvPath = path;
+    return true;
+}
+
+void CemrgScar3D::UpdateThresholdIndex() {
+
+    //Scalars of -1 are excluded from the score
+    if (!thresholdIndex.IsBuiltFor(scalars)) {
+        thresholdIndex.Build(scalars, -1);
+        histogramValid = false;
+    }//_if
 }
 
 void CemrgScar3D::SaveNormalisedScalars(double divisor, mitk::Surface::Pointer surface, QString name) {
@@ -335,14 +552,20 @@ void CemrgScar3D::SaveNormalisedScalars(double divisor, mitk::Surface::Pointer s
         normalisedScalars->InsertTuple1(i, value);
     }
 
-    pd->GetCellData()->SetScalars(normalisedScalars);
-    // surface->SetVtkPolyData(pd);
+    if (pointScalars) {
+        //Vertex projection, the scalars are on the points already
+        pd->GetPointData()->SetScalars(normalisedScalars);
+        surface->SetVtkPolyData(pd);
+    } else {
+        pd->GetCellData()->SetScalars(normalisedScalars);
+        // surface->SetVtkPolyData(pd);
 
-    cell_to_point->SetInputData(pd);
-    cell_to_point->PassCellDataOn();
-    cell_to_point->Update();
+        cell_to_point->SetInputData(pd);
+        cell_to_point->PassCellDataOn();
+        cell_to_point->Update();
 
-    surface->SetVtkPolyData(cell_to_point->GetPolyDataOutput());
+        surface->SetVtkPolyData(cell_to_point->GetPolyDataOutput());
+    }//_if
     MITK_INFO << "Finished saving to surface";
 
     if (!name.contains(".vtk", Qt::CaseSensitive))
@@ -356,10 +579,14 @@ void CemrgScar3D::PrintThresholdingResults(QString dir, std::vector<double> valu
     QString prodPath = dir + "/";
     std::ofstream prodFile1;
     prodFile1.open((prodPath + "prodThresholds.txt").toStdString());
+    std::vector<double> thresholds;
+    for (unsigned int ix = 0; ix < values_vector.size(); ix++)
+        thresholds.push_back((threshType == 1) ? mean * values_vector.at(ix) : mean + values_vector.at(ix) * stdv);
+    std::vector<double> percentages = ThresholdingCurve(thresholds);
     for (unsigned int ix = 0; ix < values_vector.size(); ix++) {
         double thisValue = values_vector.at(ix);
-        double thisThresh = (threshType == 1) ? mean * thisValue : mean + thisValue * stdv;
-        double thisPercentage = Thresholding(thisThresh);
+        double thisThresh = thresholds.at(ix);
+        double thisPercentage = percentages.at(ix);
         prodFile1 << thisValue << "\n";
         prodFile1 << threshType << "\n";
         prodFile1 << mean << "\n";
@@ -417,6 +644,16 @@ void CemrgScar3D::SetMethodType(int value) {
     methodType = value;
 }
 
+void CemrgScar3D::SetSamplingMode(int value) {
+
+    samplingMode = value;
+}
+
+void CemrgScar3D::SetStepSize(double value) {
+
+    stepSize = value;
+}
+
 void CemrgScar3D::SetScarSegImage(const mitk::Image::Pointer image) {
 
     //Setup roiImage
@@ -430,175 +667,44 @@ void CemrgScar3D::SetVoxelBasedProjection(bool value) {
     voxelBasedProjection = value;
 }
 
-double CemrgScar3D::GetIntensityAlongNormal(itkImageType::Pointer scarImage, itkImageType::Pointer visitedImage,
-    double n_x, double n_y, double n_z, double centre_x, double centre_y, double centre_z) {
+void CemrgScar3D::SetVertexBasedProjection(bool value) {
 
-    //Declarations
-    std::vector<mitk::Point3D> pointsOnAndAroundNormal;
-
-    //Normalize
-    double tempArr[3];
-    tempArr[0] = n_x;
-    tempArr[1] = n_y;
-    tempArr[2] = n_z;
-    double norm = vtkMath::Normalize(tempArr);
-    n_x /= norm;
-    n_y /= norm;
-    n_z /= norm;
-
-    double scar_step_min = minStep;
-    double scar_step_max = maxStep;
-    double scar_step_size = 1;
-
-    const itkImageType::SizeType sizeOfImage = scarImage->GetLargestPossibleRegion().GetSize();
-    int maxX = sizeOfImage[0];
-    int maxY = sizeOfImage[1];
-    int maxZ = sizeOfImage[2];
-
-    for (double i = scar_step_min; i <= scar_step_max; i += scar_step_size) {
-        double x = floor(centre_x + (i * n_x));
-        double y = floor(centre_y + (i * n_y));
-        double z = floor(centre_z + (i * n_z));
-
-        for (int a = -1; a <= 1; a++) {
-            for (int b = -1; b <= 1; b++) {
-                for (int c = -1; c <= 1; c++) {
-                    if (x + a >= 0 && x + a < maxX && y + b >= 0 && y + b < maxY && z + c >= 0 && z + c < maxZ) {
-                        mitk::Point3D tempPoint;
-                        tempPoint.SetElement(0, x + a);
-                        tempPoint.SetElement(1, y + b);
-                        tempPoint.SetElement(2, z + c);
-                        pointsOnAndAroundNormal.push_back(tempPoint);
-                    }
-                }
-            }
-        }
-        //        a=0;b=0;c=0;
-        //        if (x+a>=0 && x+a<maxX && y+b>=0 && y+b<maxY && z+c>=0 && z+c<maxZ) {
-        //            mitk::Point3D tempPoint;
-        //            tempPoint.SetElement(0, x+a);
-        //            tempPoint.SetElement(1, y+b);
-        //            tempPoint.SetElement(2, z+c);
-        //            pointsOnAndAroundNormal.push_back(tempPoint);
-        //        }
-    }//_for
-
-    double insty = 0;
-    if (methodType == 1) {
-        //Statistical measure 1 returns mean
-        insty = GetStatisticalMeasure(pointsOnAndAroundNormal, scarImage, visitedImage, 1);
-    } else if (methodType == 2) {
-        //Statistical measure 2 returns max
-        insty = GetStatisticalMeasure(pointsOnAndAroundNormal, scarImage, visitedImage, 2);
-    }//_if
-
-    return insty;
+    vertexBasedProjection = value;
 }
 
-double CemrgScar3D::GetStatisticalMeasure(std::vector<mitk::Point3D> pointsOnAndAroundNormal,
-    itkImageType::Pointer scarImage, itkImageType::Pointer visitedImage, int measure) {
-
-    //Declarations
-    itkImageType::IndexType pixel_xyz;
-    int size = pointsOnAndAroundNormal.size();
-    double sum = 0, returnVal = 0;
-
-    //Filter out cut regions
-    for (int i = 0; i < size; i++) {
-        pixel_xyz[0] = pointsOnAndAroundNormal.at(i).GetElement(0);
-        pixel_xyz[1] = pointsOnAndAroundNormal.at(i).GetElement(1);
-        pixel_xyz[2] = pointsOnAndAroundNormal.at(i).GetElement(2);
-        double val = scarSegImage->GetPixel(pixel_xyz);
-        if (std::abs(val - 3.0) < 1E-10)
-            return -1;
-    }//_for
-
-    //Reutrn mean
-    if (measure == 1) {
-
-        for (int i = 0; i < size; i++) {
-            pixel_xyz[0] = pointsOnAndAroundNormal.at(i).GetElement(0);
-            pixel_xyz[1] = pointsOnAndAroundNormal.at(i).GetElement(1);
-            pixel_xyz[2] = pointsOnAndAroundNormal.at(i).GetElement(2);
-            sum += scarImage->GetPixel(pixel_xyz);
-        }
-        returnVal = sum / size;
-    }//_if_mean
-
-    //Return max
-    if (measure == 2) {
-        double max = -1;
-        int maxIndex = 0;
-
-        for (int i = 0; i < size; i++) {
-            pixel_xyz[0] = pointsOnAndAroundNormal.at(i).GetElement(0);
-            pixel_xyz[1] = pointsOnAndAroundNormal.at(i).GetElement(1);
-            pixel_xyz[2] = pointsOnAndAroundNormal.at(i).GetElement(2);
-            double greyVal = scarImage->GetPixel(pixel_xyz);
-            double visitedStatus = visitedImage->GetPixel(pixel_xyz);
-            bool maxIntensity = greyVal > max;
-            if (voxelBasedProjection)
-                maxIntensity = (greyVal > max) && (visitedStatus < 1);
-            if (maxIntensity) {
-                max = greyVal;
-                maxIndex = i;
-            }
-        }
-
-        if (max == -1) {
-            returnVal = 0;
-        } else {
-            returnVal = max;
-            //Now change the visited status of this max pixel
-            pixel_xyz[0] = pointsOnAndAroundNormal.at(maxIndex).GetElement(0);
-            pixel_xyz[1] = pointsOnAndAroundNormal.at(maxIndex).GetElement(1);
-            pixel_xyz[2] = pointsOnAndAroundNormal.at(maxIndex).GetElement(2);
-            visitedImage->SetPixel(pixel_xyz, 1);
-        }
-    }//_if_max
-
-    //Sum along the normal (integration)
-    if (measure == 3) {
+void CemrgScar3D::SetNumberOfThreads(int value) {
 
-        for (int i = 0; i < size; i++) {
-            pixel_xyz[0] = pointsOnAndAroundNormal.at(i).GetElement(0);
-            pixel_xyz[1] = pointsOnAndAroundNormal.at(i).GetElement(1);
-            pixel_xyz[2] = pointsOnAndAroundNormal.at(i).GetElement(2);
-            double greyVal = scarImage->GetPixel(pixel_xyz);
-            sum += greyVal;
-        }
-        returnVal = sum;
-    }//_if_sum
-
-    return returnVal;
+    numberOfThreads = value;
 }
 
-void CemrgScar3D::ItkDeepCopy(itkImageType::Pointer input, itkImageType::Pointer output) {
-
-    output->SetRegions(input->GetLargestPossibleRegion());
-    output->Allocate();
-
-    itk::ImageRegionConstIterator<itkImageType> inputIterator(input, input->GetLargestPossibleRegion());
-    itk::ImageRegionIterator<itkImageType> outputIterator(output, output->GetLargestPossibleRegion());
+int CemrgScar3D::GetNumberOfThreads() const {
 
-    while (!inputIterator.IsAtEnd()) {
-        outputIterator.Set(0);
-        ++inputIterator;
-        ++outputIterator;
-    }
+    return CemrgCommonUtils::GetNumberOfThreads(numberOfThreads);
 }
 
 void CemrgScar3D::SaveScarDebugImage(QString name, QString dir) {
 
     typedef itk::Image<short, 3> ImageType;
     using WriterType = itk::ImageFileWriter< ImageType >;
+    if (visitedVoxels.empty()) {
+        MITK_WARN << "No projection has been run, nothing to save.";
+        return;
+    }//_if
     if (!name.contains(".nii", Qt::CaseSensitive))
         name = name + ".nii";
     QString debugSCARname = dir + "/" + name;
     MITK_INFO << "Saving to: " + debugSCARname.toStdString();
 
+    //Label image of the visited voxels, only built when it is requested
+    ImageType::Pointer scarDebugLabel = ImageType::New();
+    scarDebugLabel->SetRegions(visitedRegion);
+    scarDebugLabel->Allocate();
+    ImageType::PixelType* label = scarDebugLabel->GetBufferPointer();
+    for (size_t i = 0; i < visitedVoxels.size(); i++)
+        label[i] = visitedVoxels[i] ? 1 : 0;
+
     WriterType::Pointer writer = WriterType::New();
     writer->SetFileName(debugSCARname.toStdString());
-    writer->SetInput(this->scarDebugLabel);
+    writer->SetInput(scarDebugLabel);
     writer->Update();
 }
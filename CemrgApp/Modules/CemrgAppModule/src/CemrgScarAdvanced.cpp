@@ -48,9 +48,10 @@ PURPOSE.  See the above copyright notices for more information.
 #include <vtkPolyData.h>
 #include <vtkCellData.h>
 #include <vtkPolyDataNormals.h>
-#include <vtkMassProperties.h>
 #include <vtkIdList.h>
 #include <vtkIdTypeArray.h>
+#include <vtkUnsignedCharArray.h>
+#include <vtkXMLPolyDataWriter.h>
 
 // ITK
 #include <itkPoint.h>
@@ -62,11 +63,16 @@ PURPOSE.  See the above copyright notices for more information.
 #include <QMessageBox>
 
 // C++ Standard
+#include <algorithm>
+#include <limits>
+#include <map>
 #include <numeric>
 #include <string>
 #include <sstream>
 
 
+#include "CemrgCommonUtils.h"
+#include "CemrgCorridorTable.h"
 #include "CemrgScarAdvanced.h"
 
 CemrgScarAdvanced::CemrgScarAdvanced() {
@@ -75,6 +81,9 @@ CemrgScarAdvanced::CemrgScarAdvanced() {
     _fileOutName = "encirclements.csv";
     _leftrightpre = "";
     _weightedcorridor = true;
+    _corridorvtp = false;
+    _corridormeshes = true;
+    _transfer_interpolation = CemrgScalarTransfer::NEAREST_POINT;
     _neighbourhood_size = 3;
     _fill_threshold = 0.5;
     _max_scalar = -1;
@@ -150,44 +159,57 @@ std::string CemrgScarAdvanced::ThresholdedShell(double thresho) {
 
 std::string CemrgScarAdvanced::ScarOverlap(vtkSmartPointer<vtkPolyData> prepd, double prethresh, vtkSmartPointer<vtkPolyData> postpd, double postthresh) {
 
+    vtkDataArray* scalars_pre = prepd->GetPointData()->GetScalars();
+    vtkDataArray* scalars_post = postpd->GetPointData()->GetScalars();
+    vtkIdType numPoints = prepd->GetNumberOfPoints();
+    if (scalars_pre == NULL || scalars_post == NULL ||
+        scalars_pre->GetNumberOfTuples() < numPoints || scalars_post->GetNumberOfTuples() < numPoints) {
+        MITK_ERROR << "Pre and post ablation shells need point scalars on the same points.";
+        return "";
+    }
+
     vtkSmartPointer<vtkIntArray> exploration_values = vtkSmartPointer<vtkIntArray>::New();
-    vtkFloatArray* scalars_pre = vtkFloatArray::SafeDownCast(prepd->GetPointData()->GetScalars());
-    vtkFloatArray* scalars_post = vtkFloatArray::SafeDownCast(postpd->GetPointData()->GetScalars());
+    exploration_values->SetNumberOfTuples(numPoints);
+    int* labels = exploration_values->GetPointer(0);
     vtkSmartPointer<vtkPolyData> temp = vtkSmartPointer<vtkPolyData>::New();
     temp->DeepCopy(prepd);
 
-    int valueassigned = 0;
-    fi3_totalPoints = (double)prepd->GetNumberOfPoints();
+    // -1 = no value (veins clipped), 0 = healthy, 1 = pre, 2 = post, 3 = overlap
+    // Blocks are labelled concurrently, their counts are merged in order
+    const vtkIdType blockSize = 1 << 16;
+    const vtkIdType numBlocks = (numPoints + blockSize - 1) / blockSize;
+    std::vector<double> blockCounts(numBlocks * 5, 0);
+    CemrgCommonUtils::ParallelFor(0, numBlocks, [&](vtkIdType first, vtkIdType last) {
+        for (vtkIdType block = first; block < last; block++) {
+            double* counts = &blockCounts[block * 5];
+            vtkIdType end = std::min(numPoints, (block + 1) * blockSize);
+            for (vtkIdType i = block * blockSize; i < end; i++) {
+                int valueassigned = -1;
+                if (scalars_post->GetComponent(i, 0) != 0) {
+                    valueassigned = 0;
+                    if (scalars_pre->GetComponent(i, 0) >= prethresh)
+                        valueassigned += 1;
+                    if (scalars_post->GetComponent(i, 0) >= postthresh)
+                        valueassigned += 2;
+                }
+                labels[i] = valueassigned;
+                counts[valueassigned + 1]++;
+            }
+        }
+    });
+
+    fi3_totalPoints = (double)numPoints;
     fi3_emptyPoints = 0.0;
     fi3_healthy = 0.0;
     fi3_preScar = 0.0;
     fi3_postScar = 0.0;
     fi3_overlapScar = 0.0;
-    for (int i = 0; i < prepd->GetNumberOfPoints(); i++) {
-        if (scalars_post->GetTuple1(i) == 0) { // Veins were clipped here, no value
-            valueassigned = -1;
-            fi3_emptyPoints++;
-        } else {
-            if (scalars_pre->GetTuple1(i) >= prethresh) {
-                valueassigned += 1;
-            }
-            if (scalars_post->GetTuple1(i) >= postthresh) {
-                valueassigned += 2;
-            }
-
-            if (valueassigned == 0) {
-                fi3_healthy++;
-            } else if (valueassigned == 1) {
-                fi3_preScar++;
-            } else if (valueassigned == 2) {
-                fi3_postScar++;
-            } else if (valueassigned == 3) {
-                fi3_overlapScar++;
-            }
-        }
-
-        exploration_values->InsertNextTuple1(valueassigned);
-        valueassigned = 0;
+    for (vtkIdType block = 0; block < numBlocks; block++) {
+        fi3_emptyPoints += blockCounts[block * 5];
+        fi3_healthy += blockCounts[block * 5 + 1];
+        fi3_preScar += blockCounts[block * 5 + 2];
+        fi3_postScar += blockCounts[block * 5 + 3];
+        fi3_overlapScar += blockCounts[block * 5 + 4];
     }
 
     temp->GetPointData()->SetScalars(exploration_values);
@@ -298,44 +320,19 @@ std::vector<vtkSmartPointer<vtkActor> > CemrgScarAdvanced::GetPathsMappersAndAct
 // F&I T1
 void CemrgScarAdvanced::GetSurfaceAreaFromThreshold(double thres, double maxscalar) {
 
-    vtkSmartPointer<vtkPolyDataConnectivityFilter> connectivityFilter =
-        vtkSmartPointer<vtkPolyDataConnectivityFilter>::New();
-    //connectivityFilter->SetOutputPointsPrecision(outputPointsPrecision);
-    connectivityFilter->ScalarConnectivityOn();
-    connectivityFilter->SetScalarRange(thres, maxscalar);
-    connectivityFilter->SetInputData(this->_SourcePolyData);
-
-    connectivityFilter->Update();
-    connectivityFilter->SetExtractionModeToLargestRegion();
-
-    vtkSmartPointer<vtkMassProperties> mpwhole = vtkSmartPointer<vtkMassProperties>::New();
-    mpwhole->SetInputData(this->_SourcePolyData);
+    CemrgScarComponents& components = ScarComponents(maxscalar);
     MITK_INFO << "MASS PROPERTIES (whole):";
-    MITK_INFO << mpwhole->GetSurfaceArea();
+    MITK_INFO << components.GetTotalArea();
 
-    vtkSmartPointer<vtkMassProperties> mp = vtkSmartPointer<vtkMassProperties>::New();
-    mp->SetInputConnection(connectivityFilter->GetOutputPort());
     MITK_INFO << "MASS PROPERTIES (threshold):";
-    MITK_INFO << mp->GetSurfaceArea();
-
-    this->fi1_largestSurfaceArea = mp->GetSurfaceArea();
+    MITK_INFO << components.GetLargestArea(thres);
 
+    this->fi1_largestSurfaceArea = components.GetLargestArea(thres);
 }
 
 void CemrgScarAdvanced::ScarScore(double thres) {
 
-    vtkFloatArray* scalars = vtkFloatArray::SafeDownCast(_SourcePolyData->GetPointData()->GetScalars());
-    int ctr1 = 0, ctr2 = 0;
-
-    for (int i = 0; i < scalars->GetNumberOfTuples(); i++) {
-        double value = scalars->GetValue(i);
-        if (value == 0) {
-            ctr1++;
-            continue;
-        }//_if
-        if (value > thres) ctr2++;
-    }
-    double percentage = (ctr2 * 100.0) / (scalars->GetNumberOfTuples() - ctr1);
+    double percentage = ScarScoreIndex().Percentage(thres);
 
     fi1_scarScore = percentage;
 
@@ -348,9 +345,43 @@ void CemrgScarAdvanced::ScarScore(double thres) {
     }
 }
 
+CemrgScarThresholdIndex& CemrgScarAdvanced::ScarScoreIndex() {
+
+    //Point scalars of 0 are excluded from the score. Rebuilt only when the scalars change
+    vtkDataArray* scalars = _SourcePolyData->GetPointData()->GetScalars();
+    if (!_scarScoreIndex.IsBuiltFor(scalars))
+        _scarScoreIndex.Build(scalars, 0);
+    return _scarScoreIndex;
+}
+
+CemrgMeshGraph& CemrgScarAdvanced::MeshGraph() {
+
+    //Adjacency of the source mesh, rebuilt only when the mesh changes
+    if (!_meshGraph.IsBuiltFor(_SourcePolyData))
+        _meshGraph.Build(_SourcePolyData);
+    return _meshGraph;
+}
+
+CemrgGeodesicPath& CemrgScarAdvanced::GeodesicPath() {
+
+    //Edge costs depend on the mesh and on the weighting, rebuilt when either changes
+    if (!_geodesicPath.IsBuiltFor(_SourcePolyData, IsWeighted()))
+        _geodesicPath.Build(_SourcePolyData, MeshGraph(), IsWeighted());
+    return _geodesicPath;
+}
+
+CemrgScarComponents& CemrgScarAdvanced::ScarComponents(double maxscalar) {
+
+    //Regions of the point scalars up to maxscalar, swept once for all thresholds
+    vtkDataArray* scalars = _SourcePolyData->GetPointData()->GetScalars();
+    if (!_scarComponents.IsBuiltFor(_SourcePolyData, scalars, maxscalar, false))
+        _scarComponents.Build(_SourcePolyData, scalars, maxscalar, false);
+    return _scarComponents;
+}
+
 // F&I T2
 void CemrgScarAdvanced::ExtractCorridorData(
-    std::vector<vtkSmartPointer<vtkDijkstraGraphGeodesicPath> > allShortestPaths) {
+    const std::vector<std::vector<vtkIdType> >& allShortestPaths) {
 
     double xyz[3];
     typedef std::map<vtkIdType, int>::iterator it_type;
@@ -359,15 +390,9 @@ void CemrgScarAdvanced::ExtractCorridorData(
     std::vector<int> pointIDsInCorridor;
 
     int count = 0;
-    ofstream out;
+    CemrgCorridorTable table;
     xyz[0] = 1e-10; xyz[1] = 1e-10; xyz[2] = 1e-10;
 
-    std::stringstream ss;
-
-    ss << this->_fileOutName;
-
-    out.open(ss.str().c_str(), std::ios_base::app);
-    out << "MainVertexSeq,VertexID,X,Y,Z,VertexDepth,MeshScalar" << std::endl;
     // the recursive order - how many levels deep around a point do you want to explore?
     // default is 3 levels deep, meaning neighbours neighbours neighbour.
     int order = _neighbourhood_size;
@@ -378,19 +403,21 @@ void CemrgScarAdvanced::ExtractCorridorData(
     // this will indicate what is vertices are in the exploration corridor
     vtkSmartPointer<vtkIntArray> exploration_corridor = vtkSmartPointer<vtkIntArray>::New();
     vtkSmartPointer<vtkIntArray> exploration_scalars = vtkSmartPointer<vtkIntArray>::New();
-    for (int i = 0; i < _SourcePolyData->GetNumberOfPoints(); i++) {
-        exploration_corridor->InsertNextTuple1(0);
-        exploration_scalars->InsertNextTuple1(0);
-    }
+    exploration_corridor->SetName("exploration_corridor");
+    exploration_scalars->SetName("exploration_scalars");
+    exploration_corridor->SetNumberOfTuples(_SourcePolyData->GetNumberOfPoints());
+    exploration_scalars->SetNumberOfTuples(_SourcePolyData->GetNumberOfPoints());
+    exploration_corridor->FillComponent(0, 0);
+    exploration_scalars->FillComponent(0, 0);
 
     // collect all vertex ids lying in shortest path
     for (unsigned int i = 0; i < allShortestPaths.size(); i++) {
         // getting vertex id for each shortest path
-        vtkIdList* vertices_in_shortest_path = allShortestPaths[i]->GetIdList();
+        const std::vector<vtkIdType>& vertices_in_shortest_path = allShortestPaths[i];
 
-        for (int j = 0; j < vertices_in_shortest_path->GetNumberOfIds(); j++) {
+        for (unsigned int j = 0; j < vertices_in_shortest_path.size(); j++) {
             // map avoids duplicates
-            vertex_ids.insert(std::make_pair(vertices_in_shortest_path->GetId(j), -1));
+            vertex_ids.insert(std::make_pair(vertices_in_shortest_path[j], -1));
             // only using keys, no associated value always -2
         }
     }
@@ -407,9 +434,7 @@ void CemrgScarAdvanced::ExtractCorridorData(
             _SourcePolyData->GetPoint(iterator->first, xyz);
             scalar = scalars->GetTuple1(iterator->first);
         }
-        out << count << "," << iterator->first << ","
-            << xyz[0] << "," << xyz[1] << "," << xyz[2]
-            << "," << 0 << "," << scalar << std::endl;
+        table.AddRow(count, iterator->first, xyz, 0, scalar);
         GetNeighboursAroundPoint2(iterator->first, pointNeighbours, order);			// the key is the
 
         for (unsigned int j = 0; j < pointNeighbours.size(); j++) {
@@ -427,9 +452,7 @@ void CemrgScarAdvanced::ExtractCorridorData(
             }
 
             thresscalar = scalar;
-            out << count << "," << pointNeighborID << ","
-                << xyz[0] << "," << xyz[1] << "," << xyz[2] << ","
-                << pointNeighborOrder << "," << scalar << std::endl;
+            table.AddRow(count, pointNeighborID, xyz, pointNeighborOrder, scalar);
 
             exploration_corridor->SetTuple1(pointNeighborID, 1);
             exploration_scalars->SetTuple1(pointNeighborID, thresscalar);
@@ -440,81 +463,108 @@ void CemrgScarAdvanced::ExtractCorridorData(
     }
     this->_corridoridarray = pointIDsInCorridor;
 
+    if (!table.WriteCsv(this->_fileOutName))
+        MITK_ERROR << "Could not write the corridor table to " + this->_fileOutName;
+
+    // The arrays share the geometry of the source mesh, nothing is copied
     vtkSmartPointer<vtkPolyData> temp = vtkSmartPointer<vtkPolyData>::New();
-    temp->DeepCopy(_SourcePolyData);
+    temp->ShallowCopy(_SourcePolyData);
     temp->GetPointData()->SetScalars(exploration_corridor);
-    vtkSmartPointer<vtkPolyDataWriter> writer = vtkSmartPointer<vtkPolyDataWriter>::New();
-    writer->SetFileName((this->PathAndPrefix() + "exploration_corridor.vtk").c_str());
-    writer->SetInputData(temp);
-    writer->Update();
-    MITK_INFO << "Saved Corridor";
-
     vtkSmartPointer<vtkPolyData> temp2 = vtkSmartPointer<vtkPolyData>::New();
-    temp2->DeepCopy(_SourcePolyData);
+    temp2->ShallowCopy(_SourcePolyData);
     temp2->GetPointData()->SetScalars(exploration_scalars);
-    vtkSmartPointer<vtkPolyDataWriter> writer2 =
-        vtkSmartPointer<vtkPolyDataWriter>::New();
-    writer2->SetFileName((this->PathAndPrefix() + "exploration_scalars.vtk").c_str());
-    writer2->SetInputData(temp2);
-    writer2->Update();
-    MITK_INFO << "Saved scalars";
-
-    vtkSmartPointer<vtkPointDataToCellData> p2c = vtkSmartPointer<vtkPointDataToCellData>::New();
-    p2c->SetInputData(temp2);
-    p2c->PassPointDataOn();
-    p2c->Update();
-
-    vtkSmartPointer<vtkThreshold> threshold = vtkSmartPointer<vtkThreshold>::New();
-    threshold->ThresholdByUpper(_fill_threshold);
-    threshold->SetInputArrayToProcess(0, 0, 0, vtkDataObject::FIELD_ASSOCIATION_POINTS, vtkDataSetAttributes::SCALARS);
-    threshold->SetInputData(p2c->GetPolyDataOutput());
-    threshold->Update();
-
-    vtkSmartPointer<vtkConnectivityFilter> connectivityFilter = vtkSmartPointer<vtkConnectivityFilter>::New();
-    connectivityFilter->SetInputConnection(threshold->GetOutputPort());
-    connectivityFilter->Update();
+    if (_corridormeshes && !_corridorvtp) {
+        vtkSmartPointer<vtkPolyDataWriter> writer = vtkSmartPointer<vtkPolyDataWriter>::New();
+        writer->SetFileName((this->PathAndPrefix() + "exploration_corridor.vtk").c_str());
+        writer->SetInputData(temp);
+        writer->Update();
+        MITK_INFO << "Saved Corridor";
+
+        vtkSmartPointer<vtkPolyDataWriter> writer2 = vtkSmartPointer<vtkPolyDataWriter>::New();
+        writer2->SetFileName((this->PathAndPrefix() + "exploration_scalars.vtk").c_str());
+        writer2->SetInputData(temp2);
+        writer2->Update();
+        MITK_INFO << "Saved scalars";
+    }
+
+    //Thresholded regions use every point of a cell, as vtkThreshold and the full scalar connectivity did.
+    //Regions are counted like vtkThreshold::ThresholdByUpper, with no upper bound
+    CemrgScarComponents scarRegions;
+    scarRegions.Build(temp2, exploration_scalars, std::numeric_limits<double>::infinity(), true);
+    fi2_connectedAreasTotal = scarRegions.GetNumberOfComponents(_fill_threshold);
     MITK_INFO << "Normal connectivity filter: ";
-    MITK_INFO << connectivityFilter->GetNumberOfExtractedRegions();
-    connectivityFilter->SetExtractionModeToLargestRegion();
-    connectivityFilter->Update();
-    fi2_connectedAreasTotal = connectivityFilter->GetNumberOfExtractedRegions();
+    MITK_INFO << fi2_connectedAreasTotal;
+
+    //The largest region keeps the scalar range of the connectivity filter, swept again only if it cuts anything
+    CemrgScarComponents boundedRegions;
+    const CemrgScarComponents* largestRegions = &scarRegions;
+    if (exploration_scalars->GetRange()[1] > _max_scalar) {
+        boundedRegions.Build(temp2, exploration_scalars, _max_scalar, true);
+        largestRegions = &boundedRegions;
+    }//_if
+    MITK_INFO << "SURFACE AREA IN CORRIDOR (threshold):";
+    fi2_largestSurfaceArea = largestRegions->GetLargestArea(_fill_threshold);
+    MITK_INFO << fi2_largestSurfaceArea;
+
+    CemrgScarComponents corridorRegions;
+    corridorRegions.Build(temp, exploration_corridor, 1, true);
+    MITK_INFO << "SURFACE AREA IN CORRIDOR (full):";
+    fi2_corridorSurfaceArea = corridorRegions.GetLargestArea(1);
+    MITK_INFO << fi2_corridorSurfaceArea;
+
+    //The connectivity filter only produces the largest region for the output meshes
+    if (!_corridormeshes)
+        return;
+
+    // Original cell ids travel through the filter to mark the largest region in the .vtp
+    vtkSmartPointer<vtkPolyData> cfInput = temp2;
+    if (_corridorvtp) {
+        vtkSmartPointer<vtkIdTypeArray> cellIds = vtkSmartPointer<vtkIdTypeArray>::New();
+        cellIds->SetName("CellId");
+        cellIds->SetNumberOfTuples(_SourcePolyData->GetNumberOfCells());
+        for (vtkIdType i = 0; i < _SourcePolyData->GetNumberOfCells(); i++)
+            cellIds->SetValue(i, i);
+        cfInput = vtkSmartPointer<vtkPolyData>::New();
+        cfInput->ShallowCopy(temp2);
+        cfInput->GetCellData()->AddArray(cellIds);
+    }
 
     vtkSmartPointer<vtkPolyDataConnectivityFilter> cf = vtkSmartPointer<vtkPolyDataConnectivityFilter>::New();
-    //cf->SetOutputPointsPrecision(outputPointsPrecision);
-    cf->SetInputData(temp2);
+    cf->SetInputData(cfInput);
     cf->ScalarConnectivityOn();
     cf->FullScalarConnectivityOn();
     cf->SetScalarRange(_fill_threshold, _max_scalar);
-    cf->Update();
     cf->SetExtractionModeToLargestRegion();
+    cf->Update();
 
-    vtkSmartPointer<vtkPolyDataConnectivityFilter> cf2 = vtkSmartPointer<vtkPolyDataConnectivityFilter>::New();
-    //cf->SetOutputPointsPrecision(outputPointsPrecision);
-    cf2->SetInputData(temp);
-    cf2->ScalarConnectivityOn();
-    cf2->FullScalarConnectivityOn();
-    cf2->SetScalarRange(1, 1);
-    cf2->Update();
-    cf2->SetExtractionModeToLargestRegion();
-
-    vtkSmartPointer<vtkMassProperties> mp = vtkSmartPointer<vtkMassProperties>::New();
-    mp->SetInputConnection(cf->GetOutputPort());
-    MITK_INFO << "SURFACE AREA IN CORRIDOR (threshold):";
-    MITK_INFO << mp->GetSurfaceArea();
-    fi2_largestSurfaceArea = mp->GetSurfaceArea();
-
-    vtkSmartPointer<vtkMassProperties> mp2 = vtkSmartPointer<vtkMassProperties>::New();
-    mp2->SetInputConnection(cf2->GetOutputPort());
-    MITK_INFO << "SURFACE AREA IN CORRIDOR (full):";
-    MITK_INFO << mp2->GetSurfaceArea();
-    fi2_corridorSurfaceArea = mp2->GetSurfaceArea();
-
-    vtkSmartPointer<vtkPolyDataWriter> writercf = vtkSmartPointer<vtkPolyDataWriter>::New();
-    writercf->SetFileName((this->PathAndPrefix() + "exploration_connectivity.vtk").c_str());
-    writercf->SetInputData(cf->GetOutput());
-    writercf->Write();
-
-    out.close();
+    if (_corridorvtp) {
+        // One binary file with every corridor array on a single copy of the mesh
+        vtkSmartPointer<vtkUnsignedCharArray> connectivity = vtkSmartPointer<vtkUnsignedCharArray>::New();
+        connectivity->SetName("exploration_connectivity");
+        connectivity->SetNumberOfTuples(_SourcePolyData->GetNumberOfCells());
+        connectivity->FillComponent(0, 0);
+        vtkIdTypeArray* largestIds = vtkIdTypeArray::SafeDownCast(cf->GetOutput()->GetCellData()->GetArray("CellId"));
+        for (vtkIdType i = 0; largestIds != NULL && i < largestIds->GetNumberOfTuples(); i++)
+            connectivity->SetValue(largestIds->GetValue(i), 1);
+
+        vtkSmartPointer<vtkPolyData> corridor = vtkSmartPointer<vtkPolyData>::New();
+        corridor->ShallowCopy(_SourcePolyData);
+        corridor->GetPointData()->AddArray(exploration_corridor);
+        corridor->GetPointData()->SetScalars(exploration_scalars);
+        corridor->GetCellData()->AddArray(connectivity);
+
+        vtkSmartPointer<vtkXMLPolyDataWriter> writervtp = vtkSmartPointer<vtkXMLPolyDataWriter>::New();
+        writervtp->SetFileName((this->PathAndPrefix() + "exploration.vtp").c_str());
+        writervtp->SetInputData(corridor);
+        writervtp->SetDataModeToBinary();
+        writervtp->Write();
+        MITK_INFO << "Saved corridor arrays";
+    } else {
+        vtkSmartPointer<vtkPolyDataWriter> writercf = vtkSmartPointer<vtkPolyDataWriter>::New();
+        writercf->SetFileName((this->PathAndPrefix() + "exploration_connectivity.vtk").c_str());
+        writercf->SetInputData(cf->GetOutput());
+        writercf->Write();
+    }
 }
 
 void CemrgScarAdvanced::NeighbourhoodFillingPercentage(std::vector<int> points) {
@@ -539,52 +589,16 @@ void CemrgScarAdvanced::NeighbourhoodFillingPercentage(std::vector<int> points)
         + (percentage_in_neighbourhood > _neighbourhood_size ? "Yes" : "No")).toStdString();
 }
 
-int CemrgScarAdvanced::RecursivePointNeighbours(vtkIdType pointId, int order) {
-
-    // double s;
-    if (order == 0)
-        return 0;
-    else {
-        if (!InsertPointIntoVisitedList2(pointId, order))
-            return 0;			// already visited, no need to look further down this route
-        else {
-            //vtkIdList* pointList = cell->GetPointIds();
-            vtkIdList* pointList = vtkIdList::New();
-            // get all neighbouring points of this point
-            GetConnectedVertices(_SourcePolyData, pointId, pointList);
-
-            // running through each neighbouring point
-            for (vtkIdType e = 0; e < pointList->GetNumberOfIds(); e++) {
-                RecursivePointNeighbours(pointList->GetId(e), order - 1);
-            }
-            return 1;		// keep recursing .. 0 will stop recursing .. returning just a dummy value
-        }
-    }
-}
-
-bool CemrgScarAdvanced::InsertPointIntoVisitedList2(vtkIdType id, int order) {
-
-    for (unsigned int i = 0; i < _visited_point_list.size(); i++) {
-        if (_visited_point_list[i].first == id)
-            return false;
-    }
-    _visited_point_list.push_back(std::make_pair(id, order));
-    return true;
-}
-
 void CemrgScarAdvanced::GetNeighboursAroundPoint2(
     int pointID, std::vector<std::pair<int, int> >& pointNeighbourAndOrder, int max_order) {
 
-    _visited_point_list.clear();
-    RecursivePointNeighbours(pointID, max_order);
+    //Appends the seed and its rings, each with order max_order minus its distance in edges
+    size_t before = pointNeighbourAndOrder.size();
+    MeshGraph().GetKRing(pointID, max_order, pointNeighbourAndOrder);
 
-    for (unsigned int i = 0; i < _visited_point_list.size(); i++) {
-        //pointNeighbours.push_back(_visited_point_list[i]);
-        pointNeighbourAndOrder.push_back(std::make_pair(_visited_point_list[i].first, _visited_point_list[i].second));
-    }
     MITK_INFO(IsDebug()) << ("[INFO] This point has (recursive order n = " +
         QString::number(max_order) + ") = " +
-        QString::number(pointNeighbourAndOrder.size()) + " neighbours").toStdString();
+        QString::number(pointNeighbourAndOrder.size() - before) + " neighbours").toStdString();
 }
 
 void CemrgScarAdvanced::GetConnectedVertices(
@@ -625,7 +639,7 @@ void CemrgScarAdvanced::GetConnectedVertices(
 }
 
 void CemrgScarAdvanced::getCorridorPoints(
-    std::vector<vtkSmartPointer<vtkDijkstraGraphGeodesicPath> > allShortestPaths) {
+    const std::vector<std::vector<vtkIdType> >& allShortestPaths) {
 
     typedef std::map<vtkIdType, int>::iterator it_type;
     std::map<vtkIdType, int> vertex_ids;
@@ -634,10 +648,10 @@ void CemrgScarAdvanced::getCorridorPoints(
     int order = _neighbourhood_size;
 
     for (unsigned int i = 0; i < allShortestPaths.size(); i++) {
-        vtkIdList* vertices_in_shortest_path = allShortestPaths[i]->GetIdList();
+        const std::vector<vtkIdType>& vertices_in_shortest_path = allShortestPaths[i];
 
-        for (int j = 0; j < vertices_in_shortest_path->GetNumberOfIds(); j++)
-            vertex_ids.insert(std::make_pair(vertices_in_shortest_path->GetId(j), -1));
+        for (unsigned int j = 0; j < vertices_in_shortest_path.size(); j++)
+            vertex_ids.insert(std::make_pair(vertices_in_shortest_path[j], -1));
     }
 
     for (it_type iterator = vertex_ids.begin(); iterator != vertex_ids.end(); ++iterator) {
@@ -653,34 +667,48 @@ void CemrgScarAdvanced::getCorridorPoints(
 
 void CemrgScarAdvanced::CorridorFromPointList(std::vector<int> points, bool circleToStart) {
 
-    vtkSmartPointer<vtkPolyData> poly_data = this->GetSourcePolyData();
+    CemrgGeodesicPath& geodesics = this->GeodesicPath();
     this->_pointidarray = points;
 
+    // Consecutive seeds, and back to the first one when circling
     int lim = this->_pointidarray.size();
+    std::vector<std::pair<vtkIdType, vtkIdType> > queries;
     for (int i = 0; i < lim; i++) {
-        vtkSmartPointer<vtkDijkstraGraphGeodesicPath> dijkstra = vtkSmartPointer<vtkDijkstraGraphGeodesicPath>::New();
-        dijkstra->SetInputData(poly_data);
-
-        if (this->IsWeighted()) {
-            dijkstra->UseScalarWeightsOn();
+        if (i < lim - 1) {
+            queries.push_back(std::make_pair(this->_pointidarray[i], this->_pointidarray[i + 1]));
+        } else if (circleToStart) {
+            queries.push_back(std::make_pair(this->_pointidarray[i], this->_pointidarray[0]));
         }
+    }
 
-        dijkstra->Update();
+    // Seeds picked more than once share one search tree for all their targets
+    std::map<vtkIdType, std::vector<size_t> > queriesFrom;
+    for (size_t q = 0; q < queries.size(); q++)
+        queriesFrom[queries[q].first].push_back(q);
+
+    std::vector<std::vector<vtkIdType> > paths(queries.size());
+    for (auto& from : queriesFrom) {
+        std::vector<vtkIdType> targets;
+        for (size_t q : from.second)
+            targets.push_back(queries[q].second);
+        std::vector<std::vector<vtkIdType> > fromPaths;
+        geodesics.ShortestPaths(from.first, targets, fromPaths);
+        for (size_t j = 0; j < from.second.size(); j++)
+            paths[from.second[j]].swap(fromPaths[j]);
+    }
 
-        if (i < lim - 1) {
-            dijkstra->SetStartVertex(this->_pointidarray[i]);
-            dijkstra->SetEndVertex(this->_pointidarray[i + 1]);
-        } else if (circleToStart) {
-            dijkstra->SetStartVertex(this->_pointidarray[i]);
-            dijkstra->SetEndVertex(this->_pointidarray[0]);
+    for (size_t q = 0; q < queries.size(); q++) {
+        if (paths[q].empty()) {
+            MITK_WARN << ("No path between points " + QString::number(queries[q].first) +
+                " and " + QString::number(queries[q].second)).toStdString();
         }
-        dijkstra->Update();
+        vtkSmartPointer<vtkPolyData> pathPolyData = geodesics.GetPathPolyData(paths[q]);
         vtkSmartPointer<vtkPolyDataMapper> pathMapper = vtkSmartPointer<vtkPolyDataMapper>::New();
-        pathMapper->SetInputConnection(dijkstra->GetOutputPort());
+        pathMapper->SetInputData(pathPolyData);
 
-        this->_shortestPaths.push_back(dijkstra);
+        this->_shortestPaths.push_back(paths[q]);
         this->_pathMappers.push_back(pathMapper);
-        this->_paths.push_back(dijkstra->GetOutput());
+        this->_paths.push_back(pathPolyData);
     }
 
     // compute percentage encirlcement
@@ -702,31 +730,19 @@ void CemrgScarAdvanced::TransformSource2Target() {
     vtkSmartPointer<vtkPolyData> Output_Poly = vtkSmartPointer<vtkPolyData>::New();
     Output_Poly->DeepCopy(_source);
 
-    vtkSmartPointer<vtkPointLocator> Target_Poly_PointLocator = vtkSmartPointer<vtkPointLocator>::New();
-    Target_Poly_PointLocator->SetDataSet(_target);
-    Target_Poly_PointLocator->AutomaticOn();
-    Target_Poly_PointLocator->BuildLocator();
-
-    vtkSmartPointer<vtkFloatArray> Target_Poly_Scalar = vtkFloatArray::SafeDownCast(_target->GetPointData()->GetScalars());
-    vtkSmartPointer<vtkFloatArray> Output_Poly_Scalar = vtkSmartPointer<vtkFloatArray>::New();
-    Output_Poly_Scalar->SetNumberOfComponents(1);
-
-    double pStart[3];
-    double _mapping_default_value = 0;
-    for (vtkIdType i = 0; i < _source->GetNumberOfPoints(); ++i) {
-        _source->GetPoint(i, pStart);
-        vtkIdType id_on_target = Target_Poly_PointLocator->FindClosestPoint(pStart);
-
-        float mapped_value = 0;
-        if (id_on_target > 0) {
-            mapped_value = Target_Poly_Scalar->GetTuple1(id_on_target);
-        } else {
-            mapped_value = _mapping_default_value;
-        }
-        Output_Poly_Scalar->InsertNextTuple1(mapped_value);
+    CemrgScalarTransfer transfer;
+    transfer.SetReference(_target);
+    transfer.SetInterpolationMode(_transfer_interpolation);
+    transfer.SetDefaultValue(0);
+
+    std::vector<vtkDataArray*> arrays(1, _target->GetPointData()->GetScalars());
+    std::vector<vtkSmartPointer<vtkFloatArray> > mapped;
+    if (!transfer.Transfer(_source, arrays, mapped)) {
+        MITK_ERROR << "Scalars could not be mapped from the target mesh.";
+        return;
     }
 
-    Output_Poly->GetPointData()->SetScalars(Output_Poly_Scalar);
+    Output_Poly->GetPointData()->SetScalars(mapped[0]);
 
     vtkSmartPointer<vtkPolyDataWriter> writer = vtkSmartPointer<vtkPolyDataWriter>::New();
     writer->SetFileName((GetOutputPath() + "MaxScarPre_OnPost.vtk").c_str());
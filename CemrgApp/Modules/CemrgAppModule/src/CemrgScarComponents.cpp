@@ -0,0 +1,206 @@
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * Scar Components
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrgapp.com
+ * jose.solislemus@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+// VTK
+#include <vtkCellType.h>
+#include <vtkIdList.h>
+#include <vtkSmartPointer.h>
+#include <vtkTriangle.h>
+
+// C++ Standard
+#include <algorithm>
+#include <functional>
+#include <utility>
+
+// CemrgApp
+#include "CemrgScarComponents.h"
+
+namespace {
+
+vtkIdType FindRoot(std::vector<vtkIdType>& parent, vtkIdType c) {
+
+    while (parent[c] != c) {
+        parent[c] = parent[parent[c]];
+        c = parent[c];
+    }//_while
+    return c;
+}
+
+}
+
+CemrgScarComponents::CemrgScarComponents() {
+
+    Clear();
+}
+
+void CemrgScarComponents::Build(vtkPolyData* pd, vtkDataArray* scalars, double maxScalar, bool fullScalarConnectivity) {
+
+    Clear();
+    if (pd == NULL || scalars == NULL || scalars->GetNumberOfTuples() != pd->GetNumberOfPoints())
+        return;
+
+    vtkIdType numCells = pd->GetNumberOfCells();
+    vtkSmartPointer<vtkIdList> cellPoints = vtkSmartPointer<vtkIdList>::New();
+    std::vector<vtkIdType> cellOffsets(numCells + 1, 0), cellPointIds;
+    std::vector<double> cellAreas(numCells, 0);
+    std::vector<std::pair<double, vtkIdType>> keys;
+    keys.reserve(numCells);
+
+    for (vtkIdType c = 0; c < numCells; c++) {
+        cellOffsets[c + 1] = cellOffsets[c];
+        int cellType = pd->GetCellType(c);
+        if (cellType != VTK_TRIANGLE && cellType != VTK_QUAD && cellType != VTK_POLYGON)
+            continue;
+
+        pd->GetCellPoints(c, cellPoints);
+        vtkIdType n = cellPoints->GetNumberOfIds();
+        double minS = scalars->GetTuple1(cellPoints->GetId(0)), maxS = minS;
+        double p0[3], p1[3], p2[3];
+        pd->GetPoint(cellPoints->GetId(0), p0);
+        for (vtkIdType j = 1; j < n; j++) {
+            double s = scalars->GetTuple1(cellPoints->GetId(j));
+            minS = std::min(minS, s);
+            maxS = std::max(maxS, s);
+            if (j + 1 < n) {
+                pd->GetPoint(cellPoints->GetId(j), p1);
+                pd->GetPoint(cellPoints->GetId(j + 1), p2);
+                cellAreas[c] += vtkTriangle::TriangleArea(p0, p1, p2);
+            }//_if
+        }//_for
+        totalArea += cellAreas[c];
+
+        //Lowest threshold that still lets the cell in, cells outside the upper bound never enter
+        bool eligible = fullScalarConnectivity ? (maxS <= maxScalar) : (minS <= maxScalar);
+        if (!eligible)
+            continue;
+        keys.push_back(std::make_pair(fullScalarConnectivity ? minS : maxS, c));
+        for (vtkIdType j = 0; j < n; j++)
+            cellPointIds.push_back(cellPoints->GetId(j));
+        cellOffsets[c + 1] = cellPointIds.size();
+    }//_for
+
+    std::sort(keys.begin(), keys.end(), [](const std::pair<double, vtkIdType>& a, const std::pair<double, vtkIdType>& b) {
+        return a.first > b.first || (a.first == b.first && a.second < b.second);
+    });
+
+    //Cells sharing a point are joined through the first cell added at that point
+    std::vector<vtkIdType> parent(numCells), regionCells(numCells, 0), regionFirstCell(numCells, 0);
+    std::vector<double> regionAreas(numCells, 0);
+    std::vector<vtkIdType> pointOwner(pd->GetNumberOfPoints(), -1);
+    int components = 0;
+    vtkIdType largestCells = 0, largestFirstCell = -1;
+    double largestArea = 0;
+
+    for (size_t k = 0; k < keys.size(); k++) {
+        vtkIdType c = keys[k].second;
+        parent[c] = c;
+        regionCells[c] = 1;
+        regionAreas[c] = cellAreas[c];
+        regionFirstCell[c] = c;
+        components++;
+
+        for (vtkIdType j = cellOffsets[c]; j < cellOffsets[c + 1]; j++) {
+            vtkIdType p = cellPointIds[j];
+            if (pointOwner[p] < 0) {
+                pointOwner[p] = c;
+                continue;
+            }//_if
+            vtkIdType a = FindRoot(parent, c), b = FindRoot(parent, pointOwner[p]);
+            if (a == b)
+                continue;
+            if (regionCells[a] < regionCells[b])
+                std::swap(a, b);
+            parent[b] = a;
+            regionCells[a] += regionCells[b];
+            regionAreas[a] += regionAreas[b];
+            regionFirstCell[a] = std::min(regionFirstCell[a], regionFirstCell[b]);
+            components--;
+        }//_for
+
+        //Only the region holding c changed. Ties go to the region with the lowest cell id, as in VTK
+        vtkIdType root = FindRoot(parent, c);
+        if (regionCells[root] > largestCells ||
+            (regionCells[root] == largestCells && regionFirstCell[root] < largestFirstCell)) {
+            largestCells = regionCells[root];
+            largestFirstCell = regionFirstCell[root];
+            largestArea = regionAreas[root];
+        }//_if
+
+        if (k + 1 == keys.size() || keys[k + 1].first != keys[k].first) {
+            levels.push_back(keys[k].first);
+            largestAreas.push_back(largestArea);
+            componentCounts.push_back(components);
+        }//_if
+    }//_for
+
+    source = pd;
+    sourceMTime = pd->GetMTime();
+    sourceScalars = scalars;
+    scalarsMTime = scalars->GetMTime();
+    sourceMaxScalar = maxScalar;
+    sourceFull = fullScalarConnectivity;
+}
+
+void CemrgScarComponents::Clear() {
+
+    levels.clear();
+    largestAreas.clear();
+    componentCounts.clear();
+    totalArea = 0;
+    source = NULL;
+    sourceMTime = 0;
+    sourceScalars = NULL;
+    scalarsMTime = 0;
+    sourceMaxScalar = 0;
+    sourceFull = false;
+}
+
+bool CemrgScarComponents::IsBuiltFor(vtkPolyData* pd, vtkDataArray* scalars, double maxScalar, bool fullScalarConnectivity) const {
+
+    return pd != NULL && pd == source && pd->GetMTime() == sourceMTime &&
+        scalars != NULL && scalars == sourceScalars && scalars->GetMTime() == scalarsMTime &&
+        maxScalar == sourceMaxScalar && fullScalarConnectivity == sourceFull;
+}
+
+double CemrgScarComponents::GetLargestArea(double threshold) const {
+
+    size_t numLevels = NumberOfLevelsAbove(threshold);
+    return (numLevels == 0) ? 0 : largestAreas[numLevels - 1];
+}
+
+int CemrgScarComponents::GetNumberOfComponents(double threshold) const {
+
+    size_t numLevels = NumberOfLevelsAbove(threshold);
+    return (numLevels == 0) ? 0 : componentCounts[numLevels - 1];
+}
+
+size_t CemrgScarComponents::NumberOfLevelsAbove(double threshold) const {
+
+    //Levels at or above the threshold are the ones whose cells are in
+    return std::upper_bound(levels.begin(), levels.end(), threshold, std::greater<double>()) - levels.begin();
+}
@@ -0,0 +1,141 @@
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * Scar Histogram
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrgapp.com
+ * orod.razeghi@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+// Qmitk
+#include <mitkLogMacros.h>
+
+// C++ Standard
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+// CemrgApp
+#include "CemrgCommonUtils.h"
+#include "CemrgScarHistogram.h"
+
+CemrgScarHistogram::CemrgScarHistogram() {
+
+    Clear();
+}
+
+void CemrgScarHistogram::Build(const CemrgScarThresholdIndex& index, int numberOfBins, int numberOfThreads) {
+
+    Clear();
+    const std::vector<double>& sorted = index.GetSortedScalars();
+    numberOfValues = sorted.size();
+    if (numberOfBins < 1 || sorted.empty())
+        return;
+
+    //Fixed bins over [min, max] hold the values in (lower, upper], the first bin includes min
+    double min = sorted.front(), max = sorted.back();
+    double width = (max - min) / numberOfBins;
+    edges.resize(numberOfBins + 1);
+    for (int b = 0; b < numberOfBins; b++)
+        edges[b] = min + b * width;
+    edges[numberOfBins] = max;
+
+    //Blocks of values are counted concurrently and merged in order
+    const vtkIdType blockSize = 1 << 16;
+    const vtkIdType numBlocks = (numberOfValues + blockSize - 1) / blockSize;
+    std::vector<vtkIdType> partials(numBlocks * numberOfBins, 0);
+    CemrgCommonUtils::ParallelFor(0, numBlocks, [&](vtkIdType first, vtkIdType last) {
+        for (vtkIdType block = first; block < last; block++) {
+            vtkIdType* blockCounts = &partials[block * numberOfBins];
+            vtkIdType end = std::min(numberOfValues, (block + 1) * blockSize);
+            for (vtkIdType i = block * blockSize; i < end; i++) {
+                double value = sorted[i];
+                int bin = (width > 0) ? std::max(0, std::min((int)std::ceil((value - min) / width) - 1, numberOfBins - 1)) : 0;
+                //The division can round across an edge, the stored edges decide
+                while (bin > 0 && value <= edges[bin])
+                    bin--;
+                while (bin < numberOfBins - 1 && value > edges[bin + 1])
+                    bin++;
+                blockCounts[bin]++;
+            }//_for
+        }//_for
+    }, numberOfThreads);
+
+    counts.assign(numberOfBins, 0);
+    for (vtkIdType block = 0; block < numBlocks; block++)
+        for (int b = 0; b < numberOfBins; b++)
+            counts[b] += partials[block * numberOfBins + b];
+
+    //Percentage of the scalars at or below the upper edge, and strictly above it as Thresholding counts
+    cumulative.resize(numberOfBins);
+    above.resize(numberOfBins);
+    vtkIdType running = 0;
+    for (int b = 0; b < numberOfBins; b++) {
+        running += counts[b];
+        cumulative[b] = (running * 100.0) / numberOfValues;
+        above[b] = ((numberOfValues - running) * 100.0) / numberOfValues;
+    }//_for
+
+    //Quantile bins straight from the sorted scalars
+    quantileEdges.resize(numberOfBins + 1);
+    for (int q = 0; q <= numberOfBins; q++)
+        quantileEdges[q] = sorted[(size_t)((double)q * (numberOfValues - 1) / numberOfBins + 0.5)];
+    quantileCounts.resize(numberOfBins);
+    for (int q = 0; q < numberOfBins; q++) {
+        std::vector<double>::const_iterator lower = std::lower_bound(sorted.begin(), sorted.end(), quantileEdges[q]);
+        std::vector<double>::const_iterator upper = (q == numberOfBins - 1) ? sorted.end() :
+            std::lower_bound(sorted.begin(), sorted.end(), quantileEdges[q + 1]);
+        quantileCounts[q] = upper - lower;
+    }//_for
+}
+
+void CemrgScarHistogram::Clear() {
+
+    numberOfValues = 0;
+    edges.clear();
+    cumulative.clear();
+    above.clear();
+    quantileEdges.clear();
+    counts.clear();
+    quantileCounts.clear();
+}
+
+bool CemrgScarHistogram::ExportCsv(QString path) const {
+
+    if (!path.contains(".csv", Qt::CaseSensitive))
+        path = path + ".csv";
+
+    std::ofstream csvFile(path.toStdString());
+    if (!csvFile.is_open()) {
+        MITK_ERROR << "Could not open " << path.toStdString() << " for writing.";
+        return false;
+    }//_if
+
+    csvFile << "bin,lower,upper,count,cumulative_percent,above_percent,quantile_lower,quantile_upper,quantile_count\n";
+    for (int b = 0; b < GetNumberOfBins(); b++) {
+        csvFile << b << "," << edges[b] << "," << edges[b + 1] << "," << counts[b] << ",";
+        csvFile << cumulative[b] << "," << above[b] << ",";
+        csvFile << quantileEdges[b] << "," << quantileEdges[b + 1] << "," << quantileCounts[b] << "\n";
+    }//_for
+    csvFile.close();
+    return true;
+}
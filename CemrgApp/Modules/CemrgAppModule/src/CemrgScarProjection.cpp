@@ -0,0 +1,729 @@
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * Scar Projection Engine
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrgapp.com
+ * orod.razeghi@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+// Qmitk
+#include <mitkLogMacros.h>
+
+// VTK
+#include <vtkMath.h>
+#include <vtkCellData.h>
+#include <vtkPointData.h>
+#include <vtkDataArray.h>
+#include <vtkIdList.h>
+#include <vtkSmartPointer.h>
+
+// ITK
+#include <itkPoint.h>
+#include <itkContinuousIndex.h>
+
+// C++ Standard
+#include <cmath>
+#include <algorithm>
+#include <utility>
+
+// CemrgApp
+#include "CemrgCommonUtils.h"
+#include "CemrgScarProjection.h"
+
+template <typename TPixel>
+CemrgScarProjection<TPixel>::CemrgScarProjection() {
+
+    this->minStep = -3, this->maxStep = 3;
+    this->samplingMode = 1;
+    this->stepSize = 0.25;
+    this->voxelBasedProjection = false;
+    this->numberOfThreads = 0;
+}
+
+template <typename TPixel>
+void CemrgScarProjection<TPixel>::SetImage(typename ImageType::Pointer image) {
+
+    scarImage = image;
+}
+
+template <typename TPixel>
+void CemrgScarProjection<TPixel>::SetSegmentation(SegImageType::Pointer image) {
+
+    segImage = image;
+}
+
+template <typename TPixel>
+void CemrgScarProjection<TPixel>::SetSteps(int minStep, int maxStep) {
+
+    this->minStep = minStep;
+    this->maxStep = maxStep;
+}
+
+template <typename TPixel>
+void CemrgScarProjection<TPixel>::SetSamplingMode(int value) {
+
+    samplingMode = value;
+}
+
+template <typename TPixel>
+void CemrgScarProjection<TPixel>::SetStepSize(double value) {
+
+    stepSize = value;
+}
+
+template <typename TPixel>
+void CemrgScarProjection<TPixel>::SetVoxelBasedProjection(bool value) {
+
+    voxelBasedProjection = value;
+}
+
+template <typename TPixel>
+void CemrgScarProjection<TPixel>::SetNumberOfThreads(int value) {
+
+    numberOfThreads = value;
+}
+
+template <typename TPixel>
+bool CemrgScarProjection<TPixel>::ComputeCellGeometry(vtkPolyData* pd) {
+
+    return ComputeGeometry(pd, false);
+}
+
+template <typename TPixel>
+bool CemrgScarProjection<TPixel>::ComputePointGeometry(vtkPolyData* pd) {
+
+    return ComputeGeometry(pd, true);
+}
+
+template <typename TPixel>
+bool CemrgScarProjection<TPixel>::ComputeGeometry(vtkPolyData* pd, bool onPoints) {
+
+    vtkDataArray* elementNormals = onPoints ? pd->GetPointData()->GetNormals() : pd->GetCellData()->GetNormals();
+    if (scarImage.IsNull() || elementNormals == NULL) {
+        MITK_ERROR << "The projection needs an image and a mesh with " << (onPoints ? "point" : "cell") << " normals.";
+        return false;
+    }//_if
+
+    //Centres and normals of the cells, or of the vertices, in index space
+    vtkIdType numElements = onPoints ? pd->GetNumberOfPoints() : pd->GetNumberOfCells();
+    centresXYZ.assign(3 * numElements, 0);
+    normalsXYZ.assign(3 * numElements, 0);
+    if (!onPoints)
+        pd->BuildCells(); //GetCellPoints is only safe to share between threads once the cells are built
+    CemrgCommonUtils::ParallelFor(0, numElements, [&](vtkIdType first, vtkIdType last) {
+
+        vtkSmartPointer<vtkIdList> cellPoints = vtkSmartPointer<vtkIdList>::New();
+        typename ImageType::IndexType pixelXYZ;
+        typename ImageType::PointType pointXYZ;
+
+        for (vtkIdType i = first; i < last; i++) {
+            double pN[3];
+            elementNormals->GetTuple(i, pN);
+            double cX = 0, cY = 0, cZ = 0, numPoints = 0;
+            if (onPoints) {
+                cellPoints->SetNumberOfIds(1);
+                cellPoints->SetId(0, i);
+            } else {
+                pd->GetCellPoints(i, cellPoints);
+            }//_if
+            vtkIdType numCellPoints = cellPoints->GetNumberOfIds();
+
+            if (samplingMode == 2) {
+                //Sub-voxel sampling: continuous index of the centroid and index displacement per mm along the normal
+                itk::ContinuousIndex<double, 3> centreIndex, tipIndex;
+                double centroid[3] = {0, 0, 0};
+                for (vtkIdType neighborPoint = 0; neighborPoint < numCellPoints; ++neighborPoint) {
+                    double cP[3];
+                    pd->GetPoint(cellPoints->GetId(neighborPoint), cP);
+                    vtkMath::Add(centroid, cP, centroid);
+                }//_innerLoop
+                vtkMath::MultiplyScalar(centroid, 1.0 / numCellPoints);
+                vtkMath::Normalize(pN);
+                for (int d = 0; d < 3; d++)
+                    pointXYZ[d] = centroid[d];
+                scarImage->TransformPhysicalPointToContinuousIndex(pointXYZ, centreIndex);
+                for (int d = 0; d < 3; d++)
+                    pointXYZ[d] = centroid[d] + pN[d];
+                scarImage->TransformPhysicalPointToContinuousIndex(pointXYZ, tipIndex);
+                for (int d = 0; d < 3; d++) {
+                    centresXYZ[3 * i + d] = centreIndex[d];
+                    normalsXYZ[3 * i + d] = tipIndex[d] - centreIndex[d];
+                }//_for
+                continue;
+            }//_if
+
+            for (vtkIdType neighborPoint = 0; neighborPoint < numCellPoints; ++neighborPoint) {
+
+                //Get the neighbor point position
+                double cP[3];
+                pd->GetPoint(cellPoints->GetId(neighborPoint), cP);
+
+                // ITK method
+                pointXYZ[0] = cP[0];
+                pointXYZ[1] = cP[1];
+                pointXYZ[2] = cP[2];
+                scarImage->TransformPhysicalPointToIndex(pointXYZ, pixelXYZ);
+
+                cX += pixelXYZ[0];
+                cY += pixelXYZ[1];
+                cZ += pixelXYZ[2];
+                numPoints++;
+            }//_innerLoop
+
+            centresXYZ[3 * i + 0] = cX / numPoints;
+            centresXYZ[3 * i + 1] = cY / numPoints;
+            centresXYZ[3 * i + 2] = cZ / numPoints;
+
+            // ITK method
+            pointXYZ[0] = pN[0];
+            pointXYZ[1] = pN[1];
+            pointXYZ[2] = pN[2];
+            scarImage->TransformPhysicalPointToIndex(pointXYZ, pixelXYZ);
+            normalsXYZ[3 * i + 0] = pixelXYZ[0];
+            normalsXYZ[3 * i + 1] = pixelXYZ[1];
+            normalsXYZ[3 * i + 2] = pixelXYZ[2];
+        }//_for
+    }, numberOfThreads);
+
+    return true;
+}
+
+template <typename TPixel>
+template <class TReducer>
+bool CemrgScarProjection<TPixel>::Project(std::vector<double>& intensities) {
+
+    if (scarImage.IsNull()) {
+        MITK_ERROR << "No image to project.";
+        return false;
+    }//_if
+    if (segImage.IsNotNull() && segImage->GetBufferedRegion() != scarImage->GetBufferedRegion()) {
+        MITK_ERROR << "The scar segmentation must match the LGE image dimensions.";
+        return false;
+    }//_if
+
+    //One bit per voxel records the voxels claimed by the projection
+    region = scarImage->GetBufferedRegion();
+    visitedVoxels.assign(region.GetNumberOfPixels(), false);
+
+    //Project the LGE intensities straight from the raw buffers
+    PrepareSamplingStencil();
+    const TPixel* scarBuffer = scarImage->GetBufferPointer();
+    const short* segBuffer = segImage.IsNotNull() ? segImage->GetBufferPointer() : NULL;
+    vtkIdType numCells = centresXYZ.size() / 3;
+    intensities.assign(numCells, 0);
+    if (CemrgCommonUtils::GetNumberOfThreads(numberOfThreads) > 1) {
+        ProjectInParallel<TReducer>(scarBuffer, segBuffer, intensities);
+    } else {
+        std::vector<itk::OffsetValueType> samples;
+        std::vector<double> values;
+        for (vtkIdType i = 0; i < numCells; i++) {
+            SampleCells(scarBuffer, &normalsXYZ[3 * i], &centresXYZ[3 * i], 1, &samples, &values);
+            intensities[i] = ReduceSamples<TReducer>(samples, values, segBuffer);
+        }//_for
+    }//_if
+
+    return true;
+}
+
+template <typename TPixel>
+template <class TReducer>
+bool CemrgScarProjection<TPixel>::ProjectWindows(
+    const std::vector<std::pair<int, int>>& windows, std::vector<std::vector<double>>& intensities) {
+
+    /**
+     * Samples the widest window once per cell and keeps the cut flag, sum, max and count of
+     * every step. Each window is then rebuilt from the partials of its steps, giving the
+     * values separate runs would give without voxel claims. Trilinear steps only line up
+     * when the step size divides the offsets between the window starts, otherwise each
+     * window is projected on its own.
+     */
+    if (scarImage.IsNull() || windows.empty()) {
+        MITK_ERROR << "The window sweep needs an image and at least one window.";
+        return false;
+    }//_if
+    if (segImage.IsNotNull() && segImage->GetBufferedRegion() != scarImage->GetBufferedRegion()) {
+        MITK_ERROR << "The scar segmentation must match the LGE image dimensions.";
+        return false;
+    }//_if
+    if (voxelBasedProjection)
+        MITK_WARN << "Voxel claims are not tracked by the window sweep.";
+
+    int widestMin = windows[0].first, widestMax = windows[0].second;
+    for (size_t w = 0; w < windows.size(); w++) {
+        if (windows[w].first > windows[w].second) {
+            MITK_ERROR << "Invalid window " << windows[w].first << " to " << windows[w].second << ".";
+            return false;
+        }//_if
+        widestMin = std::min(widestMin, windows[w].first);
+        widestMax = std::max(widestMax, windows[w].second);
+    }//_for
+
+    int savedMin = minStep, savedMax = maxStep;
+    bool onGrid = true;
+    for (size_t w = 0; w < windows.size() && samplingMode == 2; w++) {
+        double offset = (windows[w].first - widestMin) / stepSize;
+        onGrid = onGrid && std::abs(offset - std::round(offset)) < 1E-9;
+    }//_for
+    if (!onGrid) {
+        MITK_INFO << "Step size " << stepSize << " does not divide the window offsets, projecting each window on its own.";
+        bool savedVoxelBased = voxelBasedProjection;
+        voxelBasedProjection = false;
+        intensities.assign(windows.size(), std::vector<double>());
+        bool projected = true;
+        for (size_t w = 0; w < windows.size() && projected; w++) {
+            minStep = windows[w].first;
+            maxStep = windows[w].second;
+            projected = Project<TReducer>(intensities[w]);
+        }//_for
+        minStep = savedMin;
+        maxStep = savedMax;
+        voxelBasedProjection = savedVoxelBased;
+        return projected;
+    }//_if
+
+    minStep = widestMin;
+    maxStep = widestMax;
+    PrepareSamplingStencil();
+    int numSteps = GetNumberOfSteps();
+
+    //Steps of each window on the grid of the widest one
+    double stepLength = (samplingMode == 2) ? stepSize : 1;
+    std::vector<std::pair<int, int>> windowSteps(windows.size());
+    for (size_t w = 0; w < windows.size(); w++) {
+        windowSteps[w].first = std::max(0, (int)ceil((windows[w].first - widestMin) / stepLength - 1E-9));
+        windowSteps[w].second = std::min(numSteps - 1, (int)floor((windows[w].second - widestMin) / stepLength + 1E-9));
+    }//_for
+
+    region = scarImage->GetBufferedRegion();
+    visitedVoxels.assign(region.GetNumberOfPixels(), false);
+    const TPixel* scarBuffer = scarImage->GetBufferPointer();
+    const short* segBuffer = segImage.IsNotNull() ? segImage->GetBufferPointer() : NULL;
+    vtkIdType numCells = centresXYZ.size() / 3;
+    intensities.assign(windows.size(), std::vector<double>(numCells, 0));
+
+    CemrgCommonUtils::ParallelFor(0, numCells, [&](vtkIdType first, vtkIdType last) {
+
+        //Per-thread scratch, allocated once per chunk
+        std::vector<itk::OffsetValueType> samples[interpolationLanes];
+        std::vector<double> values[interpolationLanes];
+        std::vector<size_t> stepEnds[interpolationLanes];
+        std::vector<double> stepSum(numSteps), stepMax(numSteps);
+        std::vector<size_t> stepCount(numSteps);
+        std::vector<int> stepCuts(numSteps + 1);
+
+        for (vtkIdType i = first; i < last; i += interpolationLanes) {
+            int lanes = (last - i < interpolationLanes) ? last - i : interpolationLanes;
+            SampleCells(scarBuffer, &normalsXYZ[3 * i], &centresXYZ[3 * i], lanes, samples, values, stepEnds);
+
+            for (int l = 0; l < lanes; l++) {
+                //A degenerate normal samples nothing
+                stepEnds[l].resize(numSteps, samples[l].size());
+
+                //Per-step partials, cut steps are counted as a prefix sum
+                size_t begin = 0;
+                stepCuts[0] = 0;
+                for (int k = 0; k < numSteps; k++) {
+                    bool cut = false;
+                    stepSum[k] = 0;
+                    stepMax[k] = -1;
+                    stepCount[k] = stepEnds[l][k] - begin;
+                    for (size_t j = begin; j < stepEnds[l][k]; j++) {
+                        cut = cut || (segBuffer != NULL && std::abs(segBuffer[samples[l][j]] - 3.0) < 1E-10);
+                        stepSum[k] += values[l][j];
+                        if (values[l][j] > stepMax[k]) stepMax[k] = values[l][j];
+                    }//_for
+                    stepCuts[k + 1] = stepCuts[k] + (cut ? 1 : 0);
+                    begin = stepEnds[l][k];
+                }//_for
+
+                for (size_t w = 0; w < windows.size(); w++) {
+                    int kFirst = windowSteps[w].first, kLast = windowSteps[w].second;
+                    double sum = 0, max = -1;
+                    size_t count = 0;
+                    for (int k = kFirst; k <= kLast; k++) {
+                        sum += stepSum[k];
+                        count += stepCount[k];
+                        if (stepMax[k] > max) max = stepMax[k];
+                    }//_for
+                    bool cut = kLast >= kFirst && stepCuts[kLast + 1] - stepCuts[kFirst] > 0;
+                    intensities[w][i + l] = cut ? -1 : TReducer::FromSteps(sum, max, count);
+                }//_for
+            }//_for
+        }//_for
+    }, numberOfThreads);
+
+    minStep = savedMin;
+    maxStep = savedMax;
+    return true;
+}
+
+template <typename TPixel>
+void CemrgScarProjection<TPixel>::PrepareSamplingStencil() {
+
+    //Linear strides of the buffer, so samples are read without index conversions
+    const itk::OffsetValueType* offsetTable = scarImage->GetOffsetTable();
+    typename ImageType::IndexType zeroIndex;
+    zeroIndex.Fill(0);
+    stencilOrigin = scarImage->ComputeOffset(zeroIndex);
+    stencilStrides[0] = offsetTable[0];
+    stencilStrides[1] = offsetTable[1];
+    stencilStrides[2] = offsetTable[2];
+    const typename ImageType::SizeType sizeOfImage = scarImage->GetLargestPossibleRegion().GetSize();
+    for (int d = 0; d < 3; d++)
+        stencilSize[d] = sizeOfImage[d];
+
+    //3x3x3 neighbourhood around each step, in the order it has always been sampled
+    int n = 0;
+    for (int a = -1; a <= 1; a++)
+        for (int b = -1; b <= 1; b++)
+            for (int c = -1; c <= 1; c++)
+                neighbourhoodOffsets[n++] = a * stencilStrides[0] + b * stencilStrides[1] + c * stencilStrides[2];
+}
+
+template <typename TPixel>
+bool CemrgScarProjection<TPixel>::IsCutRegion(const std::vector<itk::OffsetValueType>& samples, const short* segBuffer) const {
+
+    if (segBuffer == NULL)
+        return false;
+    for (size_t i = 0; i < samples.size(); i++)
+        if (std::abs(segBuffer[samples[i]] - 3.0) < 1E-10)
+            return true;
+    return false;
+}
+
+template <typename TPixel>
+template <class TReducer>
+double CemrgScarProjection<TPixel>::ReduceSamples(
+    const std::vector<itk::OffsetValueType>& samples, std::vector<double>& values, const short* segBuffer) {
+
+    //Filter out cut regions
+    if (IsCutRegion(samples, segBuffer))
+        return -1;
+    if (!TReducer::ClaimsVoxels)
+        return TReducer::Reduce(values);
+
+    //Return max and change the visited status of this max pixel
+    double max = -1;
+    int maxIndex = 0;
+    for (size_t i = 0; i < samples.size(); i++) {
+        bool maxIntensity = values[i] > max;
+        if (voxelBasedProjection)
+            maxIntensity = maxIntensity && !visitedVoxels[samples[i]];
+        if (maxIntensity) {
+            max = values[i];
+            maxIndex = i;
+        }
+    }//_for
+
+    if (max == -1)
+        return 0;
+    visitedVoxels[samples[maxIndex]] = true;
+    return max;
+}
+
+template <typename TPixel>
+int CemrgScarProjection<TPixel>::GetNumberOfSteps() const {
+
+    if (samplingMode == 2) {
+        bool interpolable = stepSize > 0 && maxStep >= minStep && stencilSize[0] > 1 && stencilSize[1] > 1 && stencilSize[2] > 1;
+        return interpolable ? floor((maxStep - minStep) / stepSize + 1E-9) + 1 : 0;
+    }//_if
+    return std::max(0, maxStep - minStep + 1);
+}
+
+template <typename TPixel>
+void CemrgScarProjection<TPixel>::SampleCells(const TPixel* scarBuffer, const double* normals, const double* centres, int lanes,
+    std::vector<itk::OffsetValueType>* samples, std::vector<double>* values, std::vector<size_t>* stepEnds) const {
+
+    if (samplingMode == 2) {
+        InterpolateAlongNormals(scarBuffer, normals, centres, lanes, samples, values, stepEnds);
+    } else {
+        for (int l = 0; l < lanes; l++)
+            GetSamplesAlongNormal(scarBuffer, &normals[3 * l], &centres[3 * l], samples[l], values[l], stepEnds ? &stepEnds[l] : NULL);
+    }//_if
+}
+
+template <typename TPixel>
+void CemrgScarProjection<TPixel>::GetSamplesAlongNormal(const TPixel* scarBuffer, const double* normal, const double* centre,
+    std::vector<itk::OffsetValueType>& samples, std::vector<double>& values, std::vector<size_t>* stepEnds) const {
+
+    //Reuse the caller's storage
+    samples.clear();
+    values.clear();
+    if (stepEnds)
+        stepEnds->clear();
+
+    //Normalize, a degenerate normal samples nothing
+    double n[3] = {normal[0], normal[1], normal[2]};
+    if (vtkMath::Normalize(n) == 0)
+        return;
+
+    for (double i = minStep; i <= maxStep; i += 1) {
+        long x = floor(centre[0] + (i * n[0]));
+        long y = floor(centre[1] + (i * n[1]));
+        long z = floor(centre[2] + (i * n[2]));
+        itk::OffsetValueType base = stencilOrigin + x * stencilStrides[0] + y * stencilStrides[1] + z * stencilStrides[2];
+
+        //Whole neighbourhood inside the image, no per-voxel bounds checks
+        if (x >= 1 && x < stencilSize[0] - 1 && y >= 1 && y < stencilSize[1] - 1 && z >= 1 && z < stencilSize[2] - 1) {
+            for (int j = 0; j < 27; j++) {
+                samples.push_back(base + neighbourhoodOffsets[j]);
+                values.push_back(scarBuffer[base + neighbourhoodOffsets[j]]);
+            }
+            if (stepEnds)
+                stepEnds->push_back(samples.size());
+            continue;
+        }//_if
+
+        int j = 0;
+        for (int a = -1; a <= 1; a++) {
+            for (int b = -1; b <= 1; b++) {
+                for (int c = -1; c <= 1; c++, j++) {
+                    if (x + a >= 0 && x + a < stencilSize[0] && y + b >= 0 && y + b < stencilSize[1] && z + c >= 0 && z + c < stencilSize[2]) {
+                        samples.push_back(base + neighbourhoodOffsets[j]);
+                        values.push_back(scarBuffer[base + neighbourhoodOffsets[j]]);
+                    }
+                }
+            }
+        }
+        if (stepEnds)
+            stepEnds->push_back(samples.size());
+    }//_for
+}
+
+template <typename TPixel>
+void CemrgScarProjection<TPixel>::InterpolateAlongNormals(const TPixel* scarBuffer, const double* normals, const double* centres, int lanes,
+    std::vector<itk::OffsetValueType>* samples, std::vector<double>* values, std::vector<size_t>* stepEnds) const {
+
+    /**
+     * Trilinear samples every stepSize mm between minStep and maxStep mm along the normal.
+     * Several normals are processed together as a structure of arrays so each stage below
+     * is a fixed-width loop over the lanes the compiler can vectorise. Samples record the
+     * nearest voxel for the cut-region check and the visited claims.
+     */
+    double px[interpolationLanes], py[interpolationLanes], pz[interpolationLanes];
+    double fx[interpolationLanes], fy[interpolationLanes], fz[interpolationLanes];
+    double c000[interpolationLanes], c100[interpolationLanes], c010[interpolationLanes], c110[interpolationLanes];
+    double c001[interpolationLanes], c101[interpolationLanes], c011[interpolationLanes], c111[interpolationLanes];
+    double interpolated[interpolationLanes];
+    itk::OffsetValueType corner[interpolationLanes], nearest[interpolationLanes];
+    bool inside[interpolationLanes];
+
+    for (int l = 0; l < lanes; l++) {
+        samples[l].clear();
+        values[l].clear();
+        if (stepEnds)
+            stepEnds[l].clear();
+    }//_for
+
+    int numSteps = GetNumberOfSteps();
+    const itk::OffsetValueType s0 = stencilStrides[0], s1 = stencilStrides[1], s2 = stencilStrides[2];
+
+    for (int k = 0; k < numSteps; k++) {
+        double t = minStep + k * stepSize;
+
+        for (int l = 0; l < lanes; l++) {
+            px[l] = centres[3 * l + 0] + t * normals[3 * l + 0];
+            py[l] = centres[3 * l + 1] + t * normals[3 * l + 1];
+            pz[l] = centres[3 * l + 2] + t * normals[3 * l + 2];
+        }//_positions
+
+        for (int l = 0; l < lanes; l++) {
+            inside[l] = px[l] >= 0 && px[l] <= stencilSize[0] - 1 && py[l] >= 0 && py[l] <= stencilSize[1] - 1 && pz[l] >= 0 && pz[l] <= stencilSize[2] - 1;
+            //Keep the 2x2x2 footprint inside the image on the last voxel plane
+            long ix = inside[l] ? std::min<long>(px[l], stencilSize[0] - 2) : 0;
+            long iy = inside[l] ? std::min<long>(py[l], stencilSize[1] - 2) : 0;
+            long iz = inside[l] ? std::min<long>(pz[l], stencilSize[2] - 2) : 0;
+            fx[l] = inside[l] ? px[l] - ix : 0;
+            fy[l] = inside[l] ? py[l] - iy : 0;
+            fz[l] = inside[l] ? pz[l] - iz : 0;
+            corner[l] = stencilOrigin + ix * s0 + iy * s1 + iz * s2;
+            nearest[l] = inside[l] ? stencilOrigin + lround(px[l]) * s0 + lround(py[l]) * s1 + lround(pz[l]) * s2 : 0;
+        }//_footprints
+
+        for (int l = 0; l < lanes; l++) {
+            const TPixel* c = scarBuffer + corner[l];
+            c000[l] = c[0];
+            c100[l] = c[s0];
+            c010[l] = c[s1];
+            c110[l] = c[s0 + s1];
+            c001[l] = c[s2];
+            c101[l] = c[s0 + s2];
+            c011[l] = c[s1 + s2];
+            c111[l] = c[s0 + s1 + s2];
+        }//_gather
+
+        for (int l = 0; l < lanes; l++) {
+            double c00 = c000[l] + fx[l] * (c100[l] - c000[l]);
+            double c10 = c010[l] + fx[l] * (c110[l] - c010[l]);
+            double c01 = c001[l] + fx[l] * (c101[l] - c001[l]);
+            double c11 = c011[l] + fx[l] * (c111[l] - c011[l]);
+            double c0 = c00 + fy[l] * (c10 - c00);
+            double c1 = c01 + fy[l] * (c11 - c01);
+            interpolated[l] = c0 + fz[l] * (c1 - c0);
+        }//_interpolate
+
+        for (int l = 0; l < lanes; l++) {
+            if (inside[l]) {
+                samples[l].push_back(nearest[l]);
+                values[l].push_back(interpolated[l]);
+            }
+            if (stepEnds)
+                stepEnds[l].push_back(samples[l].size());
+        }//_store
+    }//_for
+}
+
+template <typename TPixel>
+int CemrgScarProjection<TPixel>::GetMaxCandidates(const std::vector<itk::OffsetValueType>& samples, const std::vector<double>& values,
+    const short* segBuffer, int maxCandidates, itk::OffsetValueType* offsets, double* candidateValues,
+    std::vector<std::pair<double, int>>& ranking) const {
+
+    //Declarations
+    int size = samples.size();
+    ranking.clear();
+
+    //Filter out cut regions, keep the samples the max could pick (greyVal > -1)
+    if (IsCutRegion(samples, segBuffer))
+        return -1;
+    for (int i = 0; i < size; i++) {
+        if (values[i] > -1)
+            ranking.push_back(std::make_pair(values[i], i));
+    }//_for
+
+    //Descending intensity, ties keep the sampling order, as the serial max does
+    std::stable_sort(ranking.begin(), ranking.end(),
+        [](const std::pair<double, int>& a, const std::pair<double, int>& b) { return a.first > b.first; });
+
+    //Keep the best distinct voxels only
+    int count = 0;
+    for (unsigned int j = 0; j < ranking.size(); j++) {
+        itk::OffsetValueType offset = samples[ranking[j].second];
+        if (std::find(offsets, offsets + count, offset) != offsets + count)
+            continue;
+        if (count == maxCandidates)
+            return maxCandidates + 1;
+        offsets[count] = offset;
+        candidateValues[count] = ranking[j].first;
+        count++;
+    }//_for
+
+    return count;
+}
+
+template <typename TPixel>
+template <class TReducer>
+void CemrgScarProjection<TPixel>::ProjectInParallel(const TPixel* scarBuffer, const short* segBuffer, std::vector<double>& intensities) {
+
+    /**
+     * Sampling runs concurrently. Only reducers that claim voxels touch the visited mask, and with
+     * voxelBasedProjection the voxel a cell claims depends on the claims of the cells before it.
+     * Each cell therefore keeps its best few distinct voxels and the claims are resolved
+     * serially in cell order, which reproduces the serial loop exactly.
+     */
+    vtkIdType numCells = intensities.size();
+    const int maxCandidates = 8;
+    std::vector<itk::OffsetValueType> candidateOffsets;
+    std::vector<double> candidateValues;
+    std::vector<int> candidateCounts;
+    if (TReducer::ClaimsVoxels) {
+        candidateOffsets.resize(numCells * maxCandidates);
+        candidateValues.resize(numCells * maxCandidates);
+        candidateCounts.resize(numCells);
+    }//_if
+
+    CemrgCommonUtils::ParallelFor(0, numCells, [&](vtkIdType first, vtkIdType last) {
+
+        //Per-thread scratch, allocated once per chunk
+        std::vector<itk::OffsetValueType> samples[interpolationLanes];
+        std::vector<double> values[interpolationLanes];
+        std::vector<std::pair<double, int>> ranking;
+
+        for (vtkIdType i = first; i < last; i += interpolationLanes) {
+            int lanes = (last - i < interpolationLanes) ? last - i : interpolationLanes;
+            SampleCells(scarBuffer, &normalsXYZ[3 * i], &centresXYZ[3 * i], lanes, samples, values);
+
+            for (int l = 0; l < lanes; l++) {
+                vtkIdType cell = i + l;
+                if (TReducer::ClaimsVoxels) {
+                    candidateCounts[cell] = GetMaxCandidates(samples[l], values[l], segBuffer, maxCandidates,
+                        &candidateOffsets[cell * maxCandidates], &candidateValues[cell * maxCandidates], ranking);
+                } else {
+                    intensities[cell] = IsCutRegion(samples[l], segBuffer) ? -1 : TReducer::Reduce(values[l]);
+                }//_if
+            }//_for
+        }//_for
+    }, numberOfThreads);
+
+    if (!TReducer::ClaimsVoxels)
+        return;
+
+    //Resolve the claims in cell order
+    std::vector<itk::OffsetValueType> samples;
+    std::vector<double> values;
+    for (vtkIdType i = 0; i < numCells; i++) {
+
+        int count = candidateCounts[i];
+        if (count < 0) {
+            intensities[i] = -1;
+            continue;
+        }//_cut_region
+
+        int claim = -1;
+        for (int j = 0; j < std::min(count, maxCandidates) && claim < 0; j++) {
+            if (!voxelBasedProjection || !visitedVoxels[candidateOffsets[i * maxCandidates + j]])
+                claim = j;
+        }//_for
+
+        if (claim >= 0) {
+            intensities[i] = candidateValues[i * maxCandidates + claim];
+            visitedVoxels[candidateOffsets[i * maxCandidates + claim]] = true;
+        } else if (count > maxCandidates) {
+            //Every stored candidate was claimed before, sample this cell again against the visited voxels
+            SampleCells(scarBuffer, &normalsXYZ[3 * i], &centresXYZ[3 * i], 1, &samples, &values);
+            intensities[i] = ReduceSamples<TReducer>(samples, values, segBuffer);
+        } else {
+            intensities[i] = 0;
+        }//_if
+    }//_for
+}
+
+//Pixel types and reducers available to the module and its command-line apps
+#define CEMRG_SCAR_PROJECTION_INSTANTIATE(TPixel) \
+    template class CemrgScarProjection<TPixel>; \
+    template bool CemrgScarProjection<TPixel>::Project<CemrgProjectionMean>(std::vector<double>&); \
+    template bool CemrgScarProjection<TPixel>::Project<CemrgProjectionMax>(std::vector<double>&); \
+    template bool CemrgScarProjection<TPixel>::Project<CemrgProjectionSum>(std::vector<double>&); \
+    template bool CemrgScarProjection<TPixel>::Project<CemrgProjectionMedian>(std::vector<double>&); \
+    template bool CemrgScarProjection<TPixel>::Project<CemrgProjectionPercentile<90>>(std::vector<double>&); \
+    template bool CemrgScarProjection<TPixel>::ProjectWindows<CemrgProjectionMean>( \
+        const std::vector<std::pair<int, int>>&, std::vector<std::vector<double>>&); \
+    template bool CemrgScarProjection<TPixel>::ProjectWindows<CemrgProjectionMax>( \
+        const std::vector<std::pair<int, int>>&, std::vector<std::vector<double>>&); \
+    template bool CemrgScarProjection<TPixel>::ProjectWindows<CemrgProjectionSum>( \
+        const std::vector<std::pair<int, int>>&, std::vector<std::vector<double>>&);
+
+CEMRG_SCAR_PROJECTION_INSTANTIATE(short)
+CEMRG_SCAR_PROJECTION_INSTANTIATE(float)
+CEMRG_SCAR_PROJECTION_INSTANTIATE(double)
+CEMRG_SCAR_PROJECTION_INSTANTIATE(unsigned char)
@@ -0,0 +1,113 @@
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * Scar Threshold Index
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrgapp.com
+ * orod.razeghi@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+// Qmitk
+#include <mitkLogMacros.h>
+
+// C++ Standard
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// CemrgApp
+#include "CemrgScarThresholdIndex.h"
+
+CemrgScarThresholdIndex::CemrgScarThresholdIndex() {
+
+    Clear();
+}
+
+void CemrgScarThresholdIndex::Build(vtkDataArray* scalars, double excludedValue) {
+
+    Clear();
+    if (scalars == NULL)
+        return;
+
+    vtkIdType numTuples = scalars->GetNumberOfTuples();
+    sortedScalars.reserve(numTuples);
+    for (vtkIdType i = 0; i < numTuples; i++) {
+        double value = scalars->GetTuple1(i);
+        if (value == excludedValue) {
+            numberOfExcluded++;
+            continue;
+        }//_if
+        //NaN has no order for the sort, infinities would stretch the histogram
+        if (!std::isfinite(value)) {
+            numberOfNonFinite++;
+            if (value > 0)
+                numberOfPositiveInfinite++;
+            continue;
+        }//_if
+        sortedScalars.push_back(value);
+    }//_for
+    std::sort(sortedScalars.begin(), sortedScalars.end());
+    MITK_WARN(numberOfNonFinite > 0) << numberOfNonFinite << " non-finite scalars, left out of the histogram.";
+
+    source = scalars;
+    sourceMTime = scalars->GetMTime();
+    sourceTuples = numTuples;
+}
+
+void CemrgScarThresholdIndex::Clear() {
+
+    sortedScalars.clear();
+    numberOfExcluded = 0;
+    numberOfNonFinite = 0;
+    numberOfPositiveInfinite = 0;
+    source = NULL;
+    sourceMTime = 0;
+    sourceTuples = 0;
+}
+
+bool CemrgScarThresholdIndex::IsBuiltFor(vtkDataArray* scalars) const {
+
+    return scalars != NULL && scalars == source && scalars->GetMTime() == sourceMTime && scalars->GetNumberOfTuples() == sourceTuples;
+}
+
+double CemrgScarThresholdIndex::Percentage(double thresh) const {
+
+    //Number of valid scalars strictly above thresh, nothing is above NaN
+    vtkIdType count = 0;
+    if (!std::isnan(thresh)) {
+        std::vector<double>::const_iterator above = std::upper_bound(sortedScalars.begin(), sortedScalars.end(), thresh,
+            [](double t, double value) { return t < value; });
+        count = sortedScalars.end() - above;
+        if (thresh < std::numeric_limits<double>::infinity())
+            count += numberOfPositiveInfinite;
+    }//_if
+    return (count * 100.0) / GetNumberOfValid();
+}
+
+std::vector<double> CemrgScarThresholdIndex::Percentages(const std::vector<double>& thresholds) const {
+
+    std::vector<double> percentages;
+    percentages.reserve(thresholds.size());
+    for (unsigned int i = 0; i < thresholds.size(); i++)
+        percentages.push_back(Percentage(thresholds[i]));
+    return percentages;
+}
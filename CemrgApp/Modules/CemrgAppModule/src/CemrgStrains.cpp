@@ -40,6 +40,7 @@ PURPOSE.  See the above copyright notices for more information.
 #include <vtkPointData.h>
 #include <vtkTriangle.h>
 #include <vtkCell.h>
+#include <vtkIdList.h>
 #include <vtkMath.h>
 #include <vtkFloatArray.h>
 #include <vtkLineSource.h>
@@ -48,9 +49,12 @@ PURPOSE.  See the above copyright notices for more information.
 #include <vtkRegularPolygonSource.h>
 
 // C++ Standard
+#include <algorithm>
+#include <cmath>
 #include <numeric>
 
 // CemrgApp
+#include "CemrgAhaSegmentation.h"
 #include "CemrgCommonUtils.h"
 #include "CemrgStrains.h"
 
@@ -62,16 +66,59 @@ PURPOSE.  See the above copyright notices for more information.
  * @brief TESTS remove later
  */
 CemrgStrains::CemrgStrains() {
+
+    this->numberOfThreads = 0;
 }
 
 CemrgStrains::CemrgStrains(QString dir, int refMeshNo) {
 
     this->projectDirectory = dir;
+    this->numberOfThreads = 0;
     this->refAhaArea.assign(16, 0);
+    this->refAhaCount.assign(16, 0);
     this->refSurface = ReadVTKMesh(refMeshNo);
     this->refCellLabels.assign(refSurface->GetVtkPolyData()->GetNumberOfCells(), 0);
     this->refPointLabels.assign(refSurface->GetVtkPolyData()->GetNumberOfPoints(), 0.0);
     this->flatSurfScalars = vtkSmartPointer<vtkFloatArray>::New();
+
+    //The reference is the first frame of the cache
+    this->frames.SetDirectory(dir);
+    if (refSurface->GetVtkPolyData()->GetNumberOfPoints() > 0)
+        this->frames.SetFrame(refMeshNo, refSurface->GetVtkPolyData());
+}
+
+CemrgStrainSeries::CemrgStrainSeries() {
+
+    numberOfFrames = 0;
+    numberOfCells = 0;
+}
+
+double CemrgStrainSeries::Get(int frame, int segment, int component) const {
+
+    return segments[(frame * 16 + segment) * CemrgStrains::NUMBER_OF_COMPONENTS + component];
+}
+
+std::vector<double> CemrgStrainSeries::GetSegmentValues(int frame, int component) const {
+
+    if (frame < 0 || frame >= numberOfFrames)
+        return std::vector<double>(0);
+
+    std::vector<double> values(16);
+    for (int i = 0; i < 16; i++)
+        values[i] = Get(frame, i, component);
+    return values;
+}
+
+vtkSmartPointer<vtkFloatArray> CemrgStrainSeries::GetCellValues(int frame, int component) const {
+
+    vtkSmartPointer<vtkFloatArray> values = vtkSmartPointer<vtkFloatArray>::New();
+    if (frame < 0 || frame >= numberOfFrames)
+        return values;
+
+    const float* first = cells.data() + ((size_t)frame * CemrgStrains::NUMBER_OF_COMPONENTS + component) * numberOfCells;
+    values->SetNumberOfTuples(numberOfCells);
+    std::copy(first, first + numberOfCells, values->GetPointer(0));
+    return values;
 }
 
 CemrgStrains::~CemrgStrains() {
@@ -84,26 +131,32 @@ CemrgStrains::~CemrgStrains() {
 
 double CemrgStrains::CalculateGlobalSqzPlot(int meshNo) {
 
-    //We want to load the mesh and then calculate the area
-    mitk::Surface::Pointer refSurf = ReadVTKMesh(0);
-    vtkSmartPointer<vtkPolyData> refPD = refSurf->GetVtkPolyData();
-    mitk::Surface::Pointer surf = ReadVTKMesh(meshNo);
-    vtkSmartPointer<vtkPolyData> pd = surf->GetVtkPolyData();
+    //The first frame is the reference, its areas are kept for the next calls
+    if (refGlobalArea.empty()) {
+        const double* refXyz = Frame(0);
+        if (refXyz == NULL)
+            return 0;
+        TriangleAreas(refXyz, refGlobalArea);
+    }//_if
+
+    const double* xyz = Frame(meshNo);
+    if (xyz == NULL || refGlobalArea.empty())
+        return 0;
 
     //Calculate squeeze
+    std::vector<double> areas;
+    TriangleAreas(xyz, areas);
     double sqzValues = 0.0;
-    for (vtkIdType cellID = 0; cellID < pd->GetNumberOfCells(); cellID++) {
+    for (size_t cellID = 0; cellID < areas.size(); cellID++) {
 
-        double refArea = GetCellArea(refPD, cellID);
-        double area = GetCellArea(pd, cellID);
-        double sqze = (area - refArea) / refArea;
-        double wsqz = area * sqze;
+        double sqze = (areas[cellID] - refGlobalArea[cellID]) / refGlobalArea[cellID];
+        double wsqz = areas[cellID] * sqze;
         sqzValues += wsqz;
 
     }//_for
 
     //Average over entire mesh
-    double avgSqzValues = sqzValues / pd->GetNumberOfCells();
+    double avgSqzValues = sqzValues / areas.size();
 
     return avgSqzValues;
 }
@@ -113,46 +166,15 @@ std::vector<double> CemrgStrains::CalculateSqzPlot(int meshNo) {
     if (refCellLabels.empty())
         return std::vector<double>(0);
 
-    //We want to load the mesh and then calculate the area
-    mitk::Surface::Pointer surf = ReadVTKMesh(meshNo);
-    vtkSmartPointer<vtkPolyData> pd = surf->GetVtkPolyData();
-    vtkSmartPointer<vtkFloatArray> sqzValues = vtkSmartPointer<vtkFloatArray>::New();
-
-    //Calculate squeeze
-    int index = 0;
-    std::vector<double> squeeze(16, 0);
-    for (vtkIdType cellID = 0; cellID < pd->GetNumberOfCells(); cellID++) {
-
-        //Ignore non AHA segments
-        if (refCellLabels[cellID] == 0) {
-            sqzValues->InsertNextTuple1(0);
-            continue;
-        }//_if
-
-        double area = GetCellArea(pd, cellID);
-        double sqze = (area - refArea.at(index)) / refArea.at(index);
-        double wsqz = area * sqze;
-        squeeze.at(refCellLabels[cellID] - 1) += wsqz;
-
-        //Global maps
-        flatSurfScalars->InsertTuple1(index, wsqz);
-        sqzValues->InsertNextTuple1(wsqz);
-
-        index++;
-    }//_for
-
-    //Store squeeze values
-    sqzValues->SetName("Squeez");
-    pd->GetCellData()->AddArray(sqzValues);
-    surf->SetVtkPolyData(pd);
-    // QString path = projectDirectory + "/sqz-" + QString::number(meshNo) + ".vtk";
-    // mitk::IOUtil::Save(surf, path.toStdString());
-
-    //Average over AHA segments
-    for (int i = 0; i < 16; i++)
-        squeeze.at(i) /= refAhaArea.at(i);
+    //Points come from the frame cache, each mesh is read once
+    const double* xyz = Frame(meshNo);
+    if (xyz == NULL)
+        return std::vector<double>(0);
 
-    return squeeze;
+    std::vector<double> segments(16 * NUMBER_OF_COMPONENTS, 0);
+    std::vector<float> cells(NUMBER_OF_COMPONENTS * refAhaCells.size(), 0);
+    FrameSqueeze(xyz, segments.data(), cells.data());
+    return StorePlot(segments, cells, SQUEEZE);
 }
 
 std::vector<double> CemrgStrains::CalculateStrainsPlot(int meshNo, mitk::DataNode::Pointer lmNode, int flag) {
@@ -160,100 +182,54 @@ std::vector<double> CemrgStrains::CalculateStrainsPlot(int meshNo, mitk::DataNod
     if (refCellLabels.empty())
         return std::vector<double>(0);
 
-    //We want to load the mesh and then calculate the strain
-    std::vector<mitk::Point3D> lm = ConvertMPS(lmNode);
-    mitk::Surface::Pointer surf = ReadVTKMesh(meshNo); ZeroVTKMesh(lm.at(0), surf);
-
-    mitk::Point3D RIV2, centre;
-    // Only do this for the manually marked landmark points (ap_3mv_2rv.mps)
-    if (lm.size() == 6) {
-        RIV2 = lm.at(5);
-        centre = Circlefit3d(ZeroPoint(lm.at(0), lm.at(1)), ZeroPoint(lm.at(0), lm.at(2)), ZeroPoint(lm.at(0), lm.at(3)));
-    } else {
-        RIV2 = lm.at(3);
-        centre = ZeroPoint(lm.at(0), lm.at(1));
-    }
+    //Rotation from the landmarks, folded into the local axes of the cells
+    mitk::Matrix<double, 3, 3> rotationMat;
+    const double* xyz = Frame(meshNo);
+    if (xyz == NULL || !FrameTransform(lmNode, rotationMat))
+        return std::vector<double>(0);
 
-    mitk::Matrix<double, 3, 3> rotationMat = CalcRotationMatrix(centre, ZeroPoint(lm.at(0), RIV2)); RotateVTKMesh(rotationMat, surf);
-    vtkSmartPointer<vtkPolyData> pd = surf->GetVtkPolyData();
+    std::vector<double> axes;
+    std::vector<double> segments(16 * NUMBER_OF_COMPONENTS, 0);
+    std::vector<float> cells(NUMBER_OF_COMPONENTS * refAhaCells.size(), 0);
+    StrainAxes(rotationMat, axes);
+    FrameStrains(xyz, axes, segments.data(), cells.data());
+    return StorePlot(segments, cells, FlagComponent(flag));
+}
 
-    //Radial, Circumferential, and Longitudinal strains for each AHA segment
-    int index = 0;
-    std::vector<double> strainRCL(16, 0);
+CemrgStrainSeries CemrgStrains::CalculateAllPlots(int numberOfFrames, mitk::DataNode::Pointer lmNode) {
 
-    for (vtkIdType cellID = 0; cellID < pd->GetNumberOfCells(); cellID++) {
+    CemrgStrainSeries series;
+    mitk::Matrix<double, 3, 3> rotationMat;
+    if (refCellLabels.empty() || numberOfFrames <= 0 || !FrameTransform(lmNode, rotationMat))
+        return series;
 
-        //Ignore non AHA segments
-        if (refCellLabels[cellID] == 0)
-            continue;
-
-        //Three nodes of the triangle
-        vtkSmartPointer<vtkCell> cell = pd->GetCell(cellID);
-        vtkSmartPointer<vtkTriangle> triangle = dynamic_cast<vtkTriangle*>(cell.GetPointer());
-        double pt1[3], pt2[3], pt3[3];
-        triangle->GetPoints()->GetPoint(0, pt1);
-        triangle->GetPoints()->GetPoint(1, pt2);
-        triangle->GetPoints()->GetPoint(2, pt3);
-
-        //Coordinate system: vectors of the triangle
-        mitk::Point3D vc1, vc2, vc3;
-        vc1.SetElement(0, pt2[0] - pt1[0]);
-        vc1.SetElement(1, pt2[1] - pt1[1]);
-        vc1.SetElement(2, pt2[2] - pt1[2]);
-        vc2.SetElement(0, pt3[0] - pt1[0]);
-        vc2.SetElement(1, pt3[1] - pt1[1]);
-        vc2.SetElement(2, pt3[2] - pt1[2]);
-        vc3.SetElement(0, Cross(vc1, vc2).GetElement(0) / Norm(Cross(vc1, vc2)));
-        vc3.SetElement(1, Cross(vc1, vc2).GetElement(1) / Norm(Cross(vc1, vc2)));
-        vc3.SetElement(2, Cross(vc1, vc2).GetElement(2) / Norm(Cross(vc1, vc2)));
-
-        //Assemble K matrix
-        mitk::Matrix<double, 3, 3> K;
-        K[0][0] = vc1.GetElement(0);
-        K[0][1] = vc2.GetElement(0);
-        K[0][2] = vc3.GetElement(0);
-        K[1][0] = vc1.GetElement(1);
-        K[1][1] = vc2.GetElement(1);
-        K[1][2] = vc3.GetElement(1);
-        K[2][0] = vc1.GetElement(2);
-        K[2][1] = vc2.GetElement(2);
-        K[2][2] = vc3.GetElement(2);
-
-        //Calculate deformation gradient
-        mitk::Matrix<double, 3, 3> F;
-        F = K * refJ.at(index).GetInverse();
-
-        //Calculate Strain Tensors
-        mitk::Matrix<double, 3, 3> ET;
-        mitk::Matrix<double, 3, 3> EYE; EYE.SetIdentity();
-
-        //Green-Lagrange or Engineering
-        if (flag > 2)
-            ET = 0.5 * (F.GetTranspose() * F.GetVnlMatrix() - EYE.GetVnlMatrix());
-        else
-            ET = 0.5 * (F.GetVnlMatrix() + F.GetTranspose()) - EYE.GetVnlMatrix();
-
-        //Rotate Green-Lagrange strain
-        mitk::Matrix<double, 3, 3> E;
-        E = refQ.at(index) * ET * refQ.at(index).GetTranspose();
-
-        //Store symmetric Green-Lagrange strain in Voigt notation
-        mitk::Matrix<double, 1, 3> EV;
-        EV[0][0] = E(0, 0);
-        EV[0][1] = E(1, 1);
-        EV[0][2] = E(2, 2);
-
-        //Prepare plot values
-        strainRCL.at(refCellLabels[cellID] - 1) += EV[0][(flag > 2) ? flag - 2 : flag];
-        flatSurfScalars->InsertTuple1(index, EV[0][(flag > 2) ? flag - 2 : flag]);
-
-        index++;
-    }//_for
-
-    for (int i = 0; i < 16; i++)
-        strainRCL.at(i) /= std::count(refCellLabels.begin(), refCellLabels.end(), i + 1);
+    //Frames are read in parallel, once each
+    if (!frames.LoadFrames(0, numberOfFrames, numberOfThreads)) {
+        MITK_ERROR << "Strains could not read the first " << numberOfFrames << " meshes of the sequence.";
+        return series;
+    }//_if
 
-    return strainRCL;
+    //Every component of a frame from one read of its points. Frames are independent
+    //and write to their own slots, so the result does not depend on the threads
+    const size_t frameSegments = 16 * NUMBER_OF_COMPONENTS;
+    const size_t frameCells = NUMBER_OF_COMPONENTS * refAhaCells.size();
+    std::vector<double> segments(numberOfFrames * frameSegments, 0);
+    std::vector<float> cells(numberOfFrames * frameCells, 0);
+    std::vector<double> axes;
+    StrainAxes(rotationMat, axes);
+    CemrgCommonUtils::ParallelFor(0, numberOfFrames, [&](vtkIdType first, vtkIdType last) {
+        for (vtkIdType i = first; i < last; i++) {
+            const double* xyz = frames.GetFrame(i);
+            FrameSqueeze(xyz, segments.data() + i * frameSegments, cells.data() + i * frameCells);
+            FrameStrains(xyz, axes, segments.data() + i * frameSegments, cells.data() + i * frameCells);
+        }//_for
+    }, numberOfThreads);
+
+    series.numberOfFrames = numberOfFrames;
+    series.numberOfCells = refAhaCells.size();
+    series.segments.swap(segments);
+    series.cells.swap(cells);
+    return series;
 }
 
 double CemrgStrains::CalculateSDI(std::vector<std::vector<double>> valueVectors, int cycleLengths, int noFrames) {
@@ -299,7 +275,7 @@ std::vector<mitk::Surface::Pointer> CemrgStrains::ReferenceGuideLines(mitk::Data
         RIV1 = LandMarks.at(4);
         RIV2 = LandMarks.at(5);
         //Calcaulte a circle through the mitral valve points
-        CNTR = Circlefit3d(MIV1, MIV2, MIV3);
+        CNTR = CemrgAhaSegmentation::Circlefit3d(MIV1, MIV2, MIV3);
 
     } else if (LandMarks.size() == 4) {
 
@@ -374,161 +350,28 @@ mitk::Surface::Pointer CemrgStrains::ReferenceAHA(mitk::DataNode::Pointer lmNode
     //Read the mesh data
     vtkSmartPointer<vtkPolyData> pd = refSurface->GetVtkPolyData();
 
-    //Prepare landmarks
-    std::vector<mitk::Point3D> LandMarks = ConvertMPS(lmNode);
-    // Siemens 4 LM = [apex, basecenter, RV1, RV2];
-    // Siemens 7 LM = [apex, baseMV1, baseMV2, baseMV3, RV1, RV2, apex
-    // (just to make it 7 and different from manual LM)]
-    // Manual 6 LM = [apex, MV1, MV2, MV3, RV1, RV2]
-    if (LandMarks.size() != 4 && LandMarks.size() != 6 && LandMarks.size() != 7)
+    //Labels, angles and areas in the frame of the landmarks, the mesh itself stays in place
+    CemrgAhaSegmentation aha;
+    aha.SetSegmentRatios(segRatios);
+    if (!aha.SetLandmarks(ConvertMPS(lmNode), pacingSite) || !aha.Segment(pd, numberOfThreads))
         return refSurface;
 
-    mitk::Point3D centre, RIV1, RIV2, APEX, MIV1, MIV2, MIV3;
-    if (LandMarks.size() >= 6) {
-
-        APEX = LandMarks.at(0);
-        MIV1 = LandMarks.at(1);
-        MIV2 = LandMarks.at(2);
-        MIV3 = LandMarks.at(3);
-        RIV1 = LandMarks.at(4);
-        RIV2 = LandMarks.at(5);
-        // Calcaulte a circle through the mitral valve points
-        centre = Circlefit3d(ZeroPoint(APEX, MIV1), ZeroPoint(APEX, MIV2), ZeroPoint(APEX, MIV3));
-
-    } else if (LandMarks.size() == 4) {
-
-        // Zero all points relative to apex
-        APEX = LandMarks.at(0);
-        RIV1 = LandMarks.at(2);
-        RIV2 = LandMarks.at(3);
-        centre = ZeroPoint(APEX, LandMarks.at(1));
-    }
-
-    //Zero all points relative to apex
-    RIV1 = ZeroPoint(APEX, RIV1);
-    RIV2 = ZeroPoint(APEX, RIV2);
-    ZeroVTKMesh(APEX, refSurface);
-    APEX = ZeroPoint(APEX, APEX);
-
-    //Calculate a circle through the mitral valve points
-    mitk::Point3D RCTR;
-
-    //Define Rotation matrix
-    mitk::Matrix<double, 3, 3> rotationMat = CalcRotationMatrix(centre, RIV2);
-
-    //Rotate points to new frame
-    if (LandMarks.size() >= 6) {
-        MIV1 = RotatePoint(rotationMat, MIV1);
-        MIV2 = RotatePoint(rotationMat, MIV2);
-        MIV3 = RotatePoint(rotationMat, MIV3);
-    }
-    RIV1 = RotatePoint(rotationMat, RIV1);
-    RIV2 = RotatePoint(rotationMat, RIV2);
-    RCTR = RotatePoint(rotationMat, centre);
-
-    /**
-      TEST
-      **/
-      //qDebug() << "RCTR IS " << RCTR.GetElement(0) << RCTR.GetElement(1) << RCTR.GetElement(2);
-
-      //Rotate mesh to new frame
-    RotateVTKMesh(rotationMat, refSurface);
-
-    //Find the mesh Z range
-    //double min = GetMinMax(pd,2).at(0);
-    //double max = GetMinMax(pd,2).at(1);
-    double min = APEX.GetElement(2);
-    double max = RCTR.GetElement(2);
-    double RangeZ = (max - min) * 1.0; //0.99;
-
-    //Top, mid, and base segments heights
-    double TOP = RangeZ * (segRatios[0] / 100.00 + segRatios[1] / 100.00 + segRatios[2] / 100.0) + min;
-    double MID = RangeZ * (segRatios[1] / 100.00 + segRatios[2] / 100.0) + min;
-    double BAS = RangeZ * (segRatios[2] / 100.0) + min;
-
-    //Angle RV cusp 2
-    double RVangle1 = atan2(RIV1.GetElement(1), RIV1.GetElement(0));
-    double RVangle2 = atan2(RIV2.GetElement(1), RIV2.GetElement(0));
-
-    //Assuming RV angle1 < RV angle 2
-    double appendAngle;
-    double sepA, freeA;
-
-    if ((LandMarks.size() == 6) && (pacingSite == false)) {
-
-        // only do this for manual segmentation, with 6 points
-        sepA = (RVangle2 - RVangle1) / 2;
-        freeA = (2 * M_PI - (RVangle2 - RVangle1)) / 4;
-        appendAngle = -RVangle1;
-        //appendAngle -= freeA - ( M_PI / 3 );
-
-    } else {
-
-        sepA = (2 * M_PI) / 6;
-        freeA = (2 * M_PI) / 6;
-        if (RVangle1 > 0) {
-            appendAngle = -((M_PI - RVangle1) / 2 + RVangle1) + M_PI / 3;
-        } else {
-            appendAngle = -RVangle1 / 2 + M_PI / 3;
-        }//_if
-        if (pacingSite == true) {
-            appendAngle += M_PI / 6;
-        }
-
-    }//_if
-    qDebug() << "appendAngle " << appendAngle;
-
-    //Point angles
-    std::vector<double> pAngles;
-    for (int i = 0; i < pd->GetNumberOfPoints(); i++) {
-        double pAngle;
-        double* pt = pd->GetPoint(i);
-        pAngle = atan2(pt[1], pt[0]) + appendAngle;
-        pAngle = pAngle * (pAngle > 0 ? 1 : 0) + (2 * M_PI + pAngle) * (pAngle < 0 ? 1 : 0);
-        pAngles.push_back(pAngle);
-    }
-
-    //Centre angles
-    std::vector<double> cAngles;
-    for (vtkIdType cellID = 0; cellID < pd->GetNumberOfCells(); cellID++) {
-        double cAngle;
-        mitk::Point3D ctrT = GetCellCenter(pd, cellID);
-        cAngle = atan2(ctrT.GetElement(1), ctrT.GetElement(0)) + appendAngle;
-        cAngle = cAngle * (cAngle > 0 ? 1 : 0) + (2 * M_PI + cAngle) * (cAngle < 0 ? 1 : 0);
-        cAngles.push_back(cAngle);
-    }
-
-    //Base points
-    std::vector<int> pBindex;
-    std::vector<int> pMindex;
-    std::vector<int> pAindex;
-    for (int i = 0; i < pd->GetNumberOfPoints(); i++) {
-        double* pt = pd->GetPoint(i);
-        pBindex.push_back((pt[2] >= MID ? 1 : 0) * (pt[2] <= TOP ? 1 : 0));
-        pMindex.push_back((pt[2] >= BAS ? 1 : 0) * (pt[2] < MID ? 1 : 0));
-        pAindex.push_back((pt[2] < BAS ? 1 : 0));
-    }
-
-    //Centre points
-    std::vector<int> cBindex;
-    std::vector<int> cMindex;
-    std::vector<int> cAindex;
-    for (vtkIdType cellID = 0; cellID < pd->GetNumberOfCells(); cellID++) {
-        mitk::Point3D ctrT = GetCellCenter(pd, cellID);
-        cBindex.push_back((ctrT.GetElement(2) >= MID ? 1 : 0) * (ctrT.GetElement(2) < TOP ? 1 : 0));
-        cMindex.push_back((ctrT.GetElement(2) >= BAS ? 1 : 0) * (ctrT.GetElement(2) < MID ? 1 : 0));
-        cAindex.push_back((ctrT.GetElement(2) < BAS ? 1 : 0));
-    }
-
-    //Assign points labels for 3 layers
-    AssignpLabels(0, refPointLabels, pBindex, pAngles, sepA, freeA);
-    AssignpLabels(1, refPointLabels, pMindex, pAngles, sepA, freeA);
-    AssignpLabels(2, refPointLabels, pAindex, pAngles, sepA, freeA);
-    AssigncLabels(0, refCellLabels, cBindex, cAngles, sepA, freeA);
-    AssigncLabels(1, refCellLabels, cMindex, cAngles, sepA, freeA);
-    AssigncLabels(2, refCellLabels, cAindex, cAngles, sepA, freeA);
+    const std::vector<double>& pAngles = aha.GetPointAngles();
+    const std::vector<double>& local = aha.GetLocalPoints();
+    const std::vector<int>& pointLabels = aha.GetPointLabels();
+    refCellLabels = aha.GetCellLabels();
+    refPointLabels.assign(pointLabels.begin(), pointLabels.end());
+    refAhaArea = aha.GetSegmentAreas();
+    refAhaCount = aha.GetSegmentCounts();
+    mitk::Point3D RCTR = aha.GetCentre();
 
     //Calculate reference mesh attributes
+    vtkIdType numPoints = pd->GetNumberOfPoints();
+    size_t numAhaCells = refCellLabels.size() - std::count(refCellLabels.begin(), refCellLabels.end(), 0);
+    refArea.clear();
+    refAhaCells.clear();
+    refStrainBasis.assign(18 * numAhaCells, 0);
+    vtkSmartPointer<vtkIdList> cellPoints = vtkSmartPointer<vtkIdList>::New();
     for (vtkIdType cellID = 0; cellID < pd->GetNumberOfCells(); cellID++) {
 
         //Ignore non AHA segments
@@ -536,24 +379,34 @@ mitk::Surface::Pointer CemrgStrains::ReferenceAHA(mitk::DataNode::Pointer lmNode
             continue;
 
         //Area
-        double area = GetCellArea(pd, cellID);
-        refArea.push_back(area);
-        refAhaArea.at(refCellLabels[cellID] - 1) += area;
-
-        //Axis
-        vtkSmartPointer<vtkCell> cell = pd->GetCell(cellID);
+        size_t index = refAhaCells.size();
+        refArea.push_back(aha.GetCellAreas()[cellID]);
+        refAhaCells.push_back(cellID);
+
+        //Axis, the inverse of J is taken once here instead of once per frame
+        double pts[3][3];
+        pd->GetCellPoints(cellID, cellPoints);
+        for (int i = 0; i < 3; i++)
+            for (int j = 0; j < 3; j++)
+                pts[i][j] = local[j * numPoints + cellPoints->GetId(i)];
         mitk::Matrix<double, 3, 3> J;
-        mitk::Matrix<double, 3, 3> Q = GetCellAxes(cell, RCTR, J);
-        refJ.push_back(J);
-        refQ.push_back(Q);
+        mitk::Matrix<double, 3, 3> Q = GetCellAxes(pts[0], pts[1], pts[2], RCTR, J);
+        mitk::Matrix<double, 3, 3> invJ = J.GetInverse();
+        for (int i = 0; i < 3; i++) {
+            for (int j = 0; j < 3; j++) {
+                double p = invJ[j][0] * Q[i][0] + invJ[j][1] * Q[i][1] + invJ[j][2] * Q[i][2];
+                refStrainBasis[(3 * i + j) * numAhaCells + index] = p;
+                refStrainBasis[(9 + 3 * i + j) * numAhaCells + index] = Q[i][j];
+            }//_for
+        }//_for
     }
 
     //Setup flattened AHA mesh
     flatSurface = refSurface->Clone();
     vtkSmartPointer<vtkPolyData> poly = flatSurface->GetVtkPolyData();
     for (int i = 0; i < poly->GetNumberOfPoints(); i++) {
-        double* point = poly->GetPoint(i);
-        double  radii = point[2];
+        double  point[3];
+        double  radii = local[2 * numPoints + i];
         double  theta = pAngles.at(i);
         point[0] = radii * cos(theta);
         point[1] = radii * sin(theta);
@@ -577,11 +430,6 @@ mitk::Surface::Pointer CemrgStrains::ReferenceAHA(mitk::DataNode::Pointer lmNode
         segmentColors->InsertTuple(i, rgbA);
     }
     refSurface->GetVtkPolyData()->GetPointData()->SetScalars(segmentColors);
-
-    //Return to the original position and rotation
-    APEX = ZeroPoint(LandMarks.at(0), APEX);
-    RotateVTKMesh(rotationMat.GetInverse().as_matrix(), refSurface);
-    ZeroVTKMesh(APEX, refSurface);
     return refSurface;
 }
 
@@ -640,104 +488,7 @@ std::vector<float> CemrgStrains::GetAHAColour(int label) {
  *************** HELPER FUNCTIONS *****************************************************************
  **************************************************************************************************/
 
-mitk::Point3D CemrgStrains::ZeroPoint(mitk::Point3D apex, mitk::Point3D point) {
-
-    //Zero relative to the apex
-    point.SetElement(0, point.GetElement(0) - apex.GetElement(0));
-    point.SetElement(1, point.GetElement(1) - apex.GetElement(1));
-    point.SetElement(2, point.GetElement(2) - apex.GetElement(2));
-    return point;
-}
-
-void CemrgStrains::ZeroVTKMesh(mitk::Point3D apex, mitk::Surface::Pointer surface) {
-
-    //Retrieve the data
-    vtkSmartPointer<vtkPolyData> pd = surface->GetVtkPolyData();
-    for (int i = 0; i < pd->GetNumberOfPoints(); i++) {
-        double* point = pd->GetPoint(i);
-        point[0] = point[0] - apex.GetElement(0);
-        point[1] = point[1] - apex.GetElement(1);
-        point[2] = point[2] - apex.GetElement(2);
-        pd->GetPoints()->SetPoint(i, point);
-    }
-}
-
-mitk::Point3D CemrgStrains::RotatePoint(mitk::Matrix<double, 3, 3> rotationMatrix, mitk::Point3D point) {
-
-    mitk::Matrix<double, 1, 3> vec;
-    mitk::Matrix<double, 3, 1> ans;
-
-    vec[0][0] = point.GetElement(0);
-    vec[0][1] = point.GetElement(1);
-    vec[0][2] = point.GetElement(2);
-    ans = rotationMatrix * vec.GetTranspose();
-    point.SetElement(0, ans[0][0]);
-    point.SetElement(1, ans[1][0]);
-    point.SetElement(2, ans[2][0]);
-
-    return point;
-}
-
-void CemrgStrains::RotateVTKMesh(mitk::Matrix<double, 3, 3> rotationMatrix, mitk::Surface::Pointer surface) {
-
-    //Retrieve the data
-    vtkSmartPointer<vtkPolyData> pd = surface->GetVtkPolyData();
-
-    //Rotate mesh into new coordiantes
-    for (int i = 0; i < pd->GetNumberOfPoints(); i++) {
-        mitk::Point3D point;
-        double* pt = pd->GetPoint(i);
-        point.SetElement(0, pt[0]);
-        point.SetElement(1, pt[1]);
-        point.SetElement(2, pt[2]);
-        point = RotatePoint(rotationMatrix, point);
-        pt[0] = point.GetElement(0);
-        pt[1] = point.GetElement(1);
-        pt[2] = point.GetElement(2);
-        pd->GetPoints()->SetPoint(i, pt);
-    }
-}
-
-double CemrgStrains::GetCellArea(vtkSmartPointer<vtkPolyData> pd, vtkIdType cellID) {
-
-    vtkSmartPointer<vtkCell> cell = pd->GetCell(cellID);
-    vtkSmartPointer<vtkTriangle> triangle = dynamic_cast<vtkTriangle*>(cell.GetPointer());
-    double pt1[3], pt2[3], pt3[3];
-    triangle->GetPoints()->GetPoint(0, pt1);
-    triangle->GetPoints()->GetPoint(1, pt2);
-    triangle->GetPoints()->GetPoint(2, pt3);
-
-    double area = vtkTriangle::TriangleArea(pt1, pt2, pt3);
-    return area;
-}
-
-mitk::Point3D CemrgStrains::GetCellCenter(vtkSmartPointer<vtkPolyData> pd, vtkIdType cellID) {
-
-    mitk::Point3D centre;
-    vtkSmartPointer<vtkCell> cell = pd->GetCell(cellID);
-    vtkSmartPointer<vtkTriangle> triangle = dynamic_cast<vtkTriangle*>(cell.GetPointer());
-    double pt1[3], pt2[3], pt3[3];
-    triangle->GetPoints()->GetPoint(0, pt1);
-    triangle->GetPoints()->GetPoint(1, pt2);
-    triangle->GetPoints()->GetPoint(2, pt3);
-
-    double x = pt1[0] + pt2[0] + pt3[0];
-    double y = pt1[1] + pt2[1] + pt3[1];
-    double z = pt1[2] + pt2[2] + pt3[2];
-    centre.SetElement(0, x / 3);
-    centre.SetElement(1, y / 3);
-    centre.SetElement(2, z / 3);
-    return centre;
-}
-
-mitk::Matrix<double, 3, 3> CemrgStrains::GetCellAxes(vtkSmartPointer<vtkCell>& cell, mitk::Point3D& termPt, mitk::Matrix<double, 3, 3>& J) {
-
-    //Three nodes of the triangle
-    vtkSmartPointer<vtkTriangle> triangle = dynamic_cast<vtkTriangle*>(cell.GetPointer());
-    double pt1[3], pt2[3], pt3[3];
-    triangle->GetPoints()->GetPoint(0, pt1);
-    triangle->GetPoints()->GetPoint(1, pt2);
-    triangle->GetPoints()->GetPoint(2, pt3);
+mitk::Matrix<double, 3, 3> CemrgStrains::GetCellAxes(const double* pt1, const double* pt2, const double* pt3, const mitk::Point3D& termPt, mitk::Matrix<double, 3, 3>& J) {
 
     //Coordinate system: vectors of the triangle
     mitk::Point3D vc1, vc2, vc3;
@@ -815,6 +566,186 @@ mitk::Surface::Pointer CemrgStrains::ReadVTKMesh(int meshNo) {
     return CemrgCommonUtils::LoadVTKMesh(meshPath.toStdString());
 }
 
+const double* CemrgStrains::Frame(int meshNo) {
+
+    if (!frames.LoadFrame(meshNo))
+        return NULL;
+    return frames.GetFrame(meshNo);
+}
+
+bool CemrgStrains::FrameTransform(mitk::DataNode::Pointer lmNode, mitk::Matrix<double, 3, 3>& rotation) {
+
+    std::vector<mitk::Point3D> lm = ConvertMPS(lmNode);
+    if (lm.size() < 4)
+        return false;
+
+    mitk::Point3D RIV2, centre;
+    // Only do this for the manually marked landmark points (ap_3mv_2rv.mps)
+    if (lm.size() == 6) {
+        RIV2 = lm.at(5);
+        centre = CemrgAhaSegmentation::Circlefit3d(
+            CemrgAhaSegmentation::ZeroPoint(lm.at(0), lm.at(1)),
+            CemrgAhaSegmentation::ZeroPoint(lm.at(0), lm.at(2)),
+            CemrgAhaSegmentation::ZeroPoint(lm.at(0), lm.at(3)));
+    } else {
+        RIV2 = lm.at(3);
+        centre = CemrgAhaSegmentation::ZeroPoint(lm.at(0), lm.at(1));
+    }
+
+    rotation = CemrgAhaSegmentation::CalcRotationMatrix(centre, CemrgAhaSegmentation::ZeroPoint(lm.at(0), RIV2));
+    return true;
+}
+
+std::vector<double> CemrgStrains::StorePlot(const std::vector<double>& segments, const std::vector<float>& cells, int component) {
+
+    //Global maps
+    size_t numCells = refAhaCells.size();
+    flatSurfScalars->SetNumberOfTuples(numCells);
+    for (size_t i = 0; i < numCells; i++)
+        flatSurfScalars->SetValue(i, cells[component * numCells + i]);
+
+    std::vector<double> plot(16);
+    for (int i = 0; i < 16; i++)
+        plot[i] = segments[i * NUMBER_OF_COMPONENTS + component];
+    return plot;
+}
+
+void CemrgStrains::TriangleAreas(const double* xyz, std::vector<double>& areas) const {
+
+    vtkIdType numPoints = frames.GetNumberOfPoints();
+    const double* x = xyz;
+    const double* y = x + numPoints;
+    const double* z = y + numPoints;
+    const vtkIdType* triangles = frames.GetTriangles();
+
+    //Half the norm of the cross product of two edges
+    areas.resize(frames.GetNumberOfCells());
+    for (size_t i = 0; i < areas.size(); i++) {
+        const vtkIdType* ids = triangles + 3 * i;
+        double ax = x[ids[1]] - x[ids[0]], ay = y[ids[1]] - y[ids[0]], az = z[ids[1]] - z[ids[0]];
+        double bx = x[ids[2]] - x[ids[0]], by = y[ids[2]] - y[ids[0]], bz = z[ids[2]] - z[ids[0]];
+        double nx = ay * bz - az * by;
+        double ny = az * bx - ax * bz;
+        double nz = ax * by - ay * bx;
+        areas[i] = 0.5 * std::sqrt(nx * nx + ny * ny + nz * nz);
+    }//_for
+}
+
+void CemrgStrains::FrameSqueeze(const double* xyz, double* segments, float* cells) const {
+
+    vtkIdType numPoints = frames.GetNumberOfPoints();
+    const double* x = xyz;
+    const double* y = x + numPoints;
+    const double* z = y + numPoints;
+    const vtkIdType* triangles = frames.GetTriangles();
+    size_t numCells = refAhaCells.size();
+
+    //Area weighted change of the AHA cells
+    float* sqzCells = cells + SQUEEZE * numCells;
+    for (size_t index = 0; index < numCells; index++) {
+        const vtkIdType* ids = triangles + 3 * refAhaCells[index];
+        double pt1[3] = {x[ids[0]], y[ids[0]], z[ids[0]]};
+        double pt2[3] = {x[ids[1]], y[ids[1]], z[ids[1]]};
+        double pt3[3] = {x[ids[2]], y[ids[2]], z[ids[2]]};
+
+        double area = vtkTriangle::TriangleArea(pt1, pt2, pt3);
+        double sqze = (area - refArea[index]) / refArea[index];
+        double wsqz = area * sqze;
+        segments[(refCellLabels[refAhaCells[index]] - 1) * NUMBER_OF_COMPONENTS + SQUEEZE] += wsqz;
+        sqzCells[index] = wsqz;
+    }//_for
+
+    //Average over AHA segments
+    for (int i = 0; i < 16; i++)
+        segments[i * NUMBER_OF_COMPONENTS + SQUEEZE] /= refAhaArea[i];
+}
+
+void CemrgStrains::StrainAxes(const mitk::Matrix<double, 3, 3>& rotation, std::vector<double>& axes) const {
+
+    //Local axes taken back through the frame rotation, q' = R^T q, and their squared norms
+    size_t numCells = refAhaCells.size();
+    const double* q = refStrainBasis.data() + 9 * numCells;
+    axes.resize(12 * numCells);
+    for (int i = 0; i < 3; i++) {
+        const double* q0 = q + (3 * i + 0) * numCells;
+        const double* q1 = q + (3 * i + 1) * numCells;
+        const double* q2 = q + (3 * i + 2) * numCells;
+        for (int j = 0; j < 3; j++) {
+            double* qr = axes.data() + (3 * i + j) * numCells;
+            for (size_t index = 0; index < numCells; index++)
+                qr[index] = rotation[0][j] * q0[index] + rotation[1][j] * q1[index] + rotation[2][j] * q2[index];
+        }//_for
+        double* qq = axes.data() + (9 + i) * numCells;
+        for (size_t index = 0; index < numCells; index++)
+            qq[index] = q0[index] * q0[index] + q1[index] * q1[index] + q2[index] * q2[index];
+    }//_for
+}
+
+void CemrgStrains::FrameStrains(const double* xyz, const std::vector<double>& axes, double* segments, float* cells) const {
+
+    /*
+     * With F = R K J^-1, K built from the unrotated frame, the diagonals of
+     * Q ETS Q^T and Q ETL Q^T along each local axis q_i reduce to
+     * small: (R^T q_i) . (K p_i) - |q_i|^2
+     * large: 0.5 (|K p_i|^2 - |q_i|^2)
+     * with p_i = J^-1 q_i taken once in ReferenceAHA. The translation drops out of K.
+     */
+    vtkIdType numPoints = frames.GetNumberOfPoints();
+    const double* x = xyz;
+    const double* y = x + numPoints;
+    const double* z = y + numPoints;
+    const vtkIdType* triangles = frames.GetTriangles();
+    const size_t numCells = refAhaCells.size();
+    const double* p = refStrainBasis.data();
+
+    double a[3][strainLanes], b[3][strainLanes], e[6][strainLanes];
+    for (size_t first = 0; first < numCells; first += strainLanes) {
+
+        //Gather the edge vectors of a batch of triangles
+        const int lanes = std::min((size_t)strainLanes, numCells - first);
+        for (int l = 0; l < lanes; l++) {
+            const vtkIdType* ids = triangles + 3 * refAhaCells[first + l];
+            a[0][l] = x[ids[1]] - x[ids[0]]; a[1][l] = y[ids[1]] - y[ids[0]]; a[2][l] = z[ids[1]] - z[ids[0]];
+            b[0][l] = x[ids[2]] - x[ids[0]]; b[1][l] = y[ids[2]] - y[ids[0]]; b[2][l] = z[ids[2]] - z[ids[0]];
+        }//_for
+
+        //Straight line arithmetic over the lanes, one strain component per axis and tensor
+        for (int i = 0; i < 3; i++) {
+            const double* pi0 = p + (3 * i + 0) * numCells + first;
+            const double* pi1 = p + (3 * i + 1) * numCells + first;
+            const double* pi2 = p + (3 * i + 2) * numCells + first;
+            const double* qi0 = axes.data() + (3 * i + 0) * numCells + first;
+            const double* qi1 = axes.data() + (3 * i + 1) * numCells + first;
+            const double* qi2 = axes.data() + (3 * i + 2) * numCells + first;
+            const double* qqi = axes.data() + (9 + i) * numCells + first;
+            for (int l = 0; l < lanes; l++) {
+                double nx = a[1][l] * b[2][l] - a[2][l] * b[1][l];
+                double ny = a[2][l] * b[0][l] - a[0][l] * b[2][l];
+                double nz = a[0][l] * b[1][l] - a[1][l] * b[0][l];
+                double inv = 1.0 / std::sqrt(nx * nx + ny * ny + nz * nz);
+                double wx = a[0][l] * pi0[l] + b[0][l] * pi1[l] + nx * inv * pi2[l];
+                double wy = a[1][l] * pi0[l] + b[1][l] * pi1[l] + ny * inv * pi2[l];
+                double wz = a[2][l] * pi0[l] + b[2][l] * pi1[l] + nz * inv * pi2[l];
+                e[RADIAL_SMALL + i][l] = qi0[l] * wx + qi1[l] * wy + qi2[l] * wz - qqi[l];
+                e[RADIAL_LARGE + i][l] = 0.5 * (wx * wx + wy * wy + wz * wz - qqi[l]);
+            }//_for
+        }//_for
+
+        //Scatter to the cells and the AHA segments
+        for (int j = RADIAL_SMALL; j <= LONGITUDINAL_LARGE; j++) {
+            float* cell = cells + j * numCells + first;
+            for (int l = 0; l < lanes; l++) {
+                cell[l] = e[j][l];
+                segments[(refCellLabels[refAhaCells[first + l]] - 1) * NUMBER_OF_COMPONENTS + j] += e[j][l];
+            }//_for
+        }//_for
+    }//_for
+
+    for (int i = 0; i < 16; i++)
+        for (int j = RADIAL_SMALL; j <= LONGITUDINAL_LARGE; j++)
+            segments[i * NUMBER_OF_COMPONENTS + j] /= refAhaCount[i];
+}
+
 std::vector<mitk::Point3D> CemrgStrains::ConvertMPS(mitk::DataNode::Pointer node) {
 
     std::vector<mitk::Point3D> points;
@@ -879,226 +810,3 @@ std::vector<double> CemrgStrains::GetMinMax(vtkSmartPointer<vtkPolyData> pd, int
     }//_for
     return std::vector<double>{min, max};
 }
-
-mitk::Point3D CemrgStrains::Circlefit3d(mitk::Point3D point1, mitk::Point3D point2, mitk::Point3D point3) {
-
-    //v1, v2 describe the vectors from p1 to p2 and p3, resp.
-    mitk::Point3D v1;
-    mitk::Point3D v2;
-    for (int i = 0; i < 3; i++) {
-        v1.SetElement(i, point2.GetElement(i) - point1.GetElement(i));
-        v2.SetElement(i, point3.GetElement(i) - point1.GetElement(i));
-    }
-
-    //l1, l2 describe the lengths of those vectors
-    double l1 = sqrt(pow(v1.GetElement(0), 2) + pow(v1.GetElement(1), 2) + pow(v1.GetElement(2), 2));
-    double l2 = sqrt(pow(v2.GetElement(0), 2) + pow(v2.GetElement(1), 2) + pow(v2.GetElement(2), 2));
-
-    //v1n, v2n describe the normalized vectors v1 and v2
-    mitk::Point3D v1n = v1;
-    mitk::Point3D v2n = v2;
-    for (int i = 0; i < 3; i++) {
-        v1n.SetElement(i, v1n.GetElement(i) / l1);
-        v2n.SetElement(i, v2n.GetElement(i) / l2);
-    }
-
-    //nv describes the normal vector on the plane of the circle
-    mitk::Point3D nv;
-    nv.SetElement(0, v1n.GetElement(1) * v2n.GetElement(2) - v1n.GetElement(2) * v2n.GetElement(1));
-    nv.SetElement(1, v1n.GetElement(2) * v2n.GetElement(0) - v1n.GetElement(0) * v2n.GetElement(2));
-    nv.SetElement(2, v1n.GetElement(0) * v2n.GetElement(1) - v1n.GetElement(1) * v2n.GetElement(0));
-
-    //v2nb: orthogonalization of v2n against v1n
-    double dotp = v2n.GetElement(0) * v1n.GetElement(0) +
-        v2n.GetElement(1) * v1n.GetElement(1) +
-        v2n.GetElement(2) * v1n.GetElement(2);
-
-    mitk::Point3D v2nb = v2n;
-    for (int i = 0; i < 3; i++) {
-        v2nb.SetElement(i, v2nb.GetElement(i) - dotp * v1n.GetElement(i));
-    }
-
-    //Normalize v2nb
-    double l2nb = sqrt(pow(v2nb.GetElement(0), 2) + pow(v2nb.GetElement(1), 2) + pow(v2nb.GetElement(2), 2));
-    for (int i = 0; i < 3; i++) {
-        v2nb.SetElement(i, v2nb.GetElement(i) / l2nb);
-    }
-
-    //Calculate 2d coordinates of points in each plane
-    mitk::Point2D p3_2d;
-    p3_2d.SetElement(0, 0);
-    p3_2d.SetElement(1, 0);
-    for (int i = 0; i < 3; i++) {
-        p3_2d.SetElement(0, p3_2d.GetElement(0) + v2.GetElement(i) * v1n.GetElement(i));
-        p3_2d.SetElement(1, p3_2d.GetElement(1) + v2.GetElement(i) * v2nb.GetElement(i));
-    }
-
-    //Calculate the fitting circle
-    double a = l1;
-    double b = p3_2d.GetElement(0);
-    double c = p3_2d.GetElement(1);
-    double t = .5 * (a - b) / c;
-    double scale1 = b / 2 + c * t;
-    double scale2 = c / 2 - b * t;
-
-    //centre
-    mitk::Point3D centre;
-    for (int i = 0; i < 3; i++) {
-        double val = point1.GetElement(i) + (scale1 * v1n.GetElement(i)) + (scale2 * v2nb.GetElement(i));
-        centre.SetElement(i, val);
-    }
-    // qDebug() << centre.GetElement(0) << centre.GetElement(1) << centre.GetElement(2);
-
-    /*radius
-    double radius = sqrt(pow(centre.GetElement(0) - point1.GetElement(0),2) +
-                         pow(centre.GetElement(1) - point1.GetElement(1),2) +
-                         pow(centre.GetElement(2) - point1.GetElement(2),2));*/
-    return centre;
-}
-
-mitk::Matrix<double, 3, 3> CemrgStrains::CalcRotationMatrix(mitk::Point3D point1, mitk::Point3D point2) {
-
-    //X Axis
-    mitk::Matrix<double, 1, 3> vec;
-    vec[0][0] = point1.GetElement(0);
-    vec[0][1] = point1.GetElement(1);
-    vec[0][2] = point1.GetElement(2);
-    double theta_x = atan(vec[0][1] / vec[0][2]);
-
-    mitk::Matrix<double, 3, 3> R_x;
-    R_x[0][0] = 1;
-    R_x[0][1] = 0;
-    R_x[0][2] = 0;
-    R_x[1][0] = 0;
-    R_x[1][1] = cos(theta_x);
-    R_x[1][2] = -sin(theta_x);
-    R_x[2][0] = 0;
-    R_x[2][1] = sin(theta_x);
-    R_x[2][2] = cos(theta_x);
-
-    //Y Axis
-    mitk::Matrix<double, 3, 1> vecX;
-    vecX = R_x * vec.GetTranspose();
-    double theta_y = atan(-vecX[0][0] / vecX[2][0]);
-
-    mitk::Matrix<double, 3, 3> R_y;
-    R_y[0][0] = cos(theta_y);
-    R_y[0][1] = 0;
-    R_y[0][2] = sin(theta_y);
-    R_y[1][0] = 0;
-    R_y[1][1] = 1;
-    R_y[1][2] = 0;
-    R_y[2][0] = -sin(theta_y);
-    R_y[2][1] = 0;
-    R_y[2][2] = cos(theta_y);
-
-    //Z Axis
-    point2 = RotatePoint(R_y * R_x, point2);
-    double theta_z = atan(-point2.GetElement(1) / point2.GetElement(0));
-
-    mitk::Matrix<double, 3, 3> R_z;
-    R_z[0][0] = cos(theta_z);
-    R_z[0][1] = -sin(theta_z);
-    R_z[0][2] = 0;
-    R_z[1][0] = sin(theta_z);
-    R_z[1][1] = cos(theta_z);
-    R_z[1][2] = 0;
-    R_z[2][0] = 0;
-    R_z[2][1] = 0;
-    R_z[2][2] = 1;
-
-    //Rotation Matrix
-    mitk::Matrix<double, 3, 3> R;
-    R = R_z * R_y * R_x;
-    return R;
-}
-
-void CemrgStrains::AssignpLabels(int layer, std::vector<double>& pLabel, std::vector<int> index, std::vector<double> pAngles, double sepA, double freeA) {
-
-    double Csec;
-    std::vector<int> oLab;
-    std::vector<double> WID;
-
-    //Create scaler
-    //double SCAL = angles.size() / 16.0;
-
-    if (layer == 0) {
-        Csec = 0;
-        oLab = {3, 2, 1, 6, 5, 4};
-        WID = {sepA, sepA, freeA, freeA, freeA, freeA};
-    } else if (layer == 1) {
-        Csec = 0;
-        oLab = {9, 8, 7, 12, 11, 10};
-        WID = {sepA, sepA, freeA, freeA, freeA, freeA};
-    } else if (layer == 2) {
-        Csec = sepA - M_PI / 4;
-        oLab = {14, 13, 16, 15};
-        WID = {M_PI / 2, M_PI / 2, M_PI / 2, M_PI / 2};
-    }//_if
-
-    for (unsigned int i = 0; i < oLab.size(); i++) {
-        double Upper = Csec + WID.at(i);
-        double Lower = Csec;
-        for (unsigned int idx = 0; idx < pAngles.size(); idx++) {
-            int logic = (pAngles.at(idx) < Upper ? 1 : 0) * (pAngles.at(idx) >= Lower ? 1 : 0) * index.at(idx);
-            logic == 1 ? pLabel.at(idx) = oLab.at(i) : false;// * SCAL;
-        }
-        if (Lower < 0) {
-            for (unsigned int idx = 0; idx < pAngles.size(); idx++) {
-                int logic = (pAngles.at(idx) < 2 * M_PI ? 1 : 0) * (pAngles.at(idx) >= 2 * M_PI + Lower ? 1 : 0) * index.at(idx);
-                logic == 1 ? pLabel.at(idx) = oLab.at(i) : false;// * SCAL;
-            }
-        }
-        if (Upper > 2 * M_PI) {
-            for (unsigned int idx = 0; idx < pAngles.size(); idx++) {
-                int logic = (pAngles.at(idx) < Upper - 2 * M_PI ? 1 : 0) * (pAngles.at(idx) >= 0 ? 1 : 0) * index.at(idx);
-                logic == 1 ? pLabel.at(idx) = oLab.at(i) : false;// * SCAL;
-            }
-        }
-        Csec = Csec + WID.at(i);
-    }//_for
-}
-
-void CemrgStrains::AssigncLabels(
-    int layer, std::vector<int>& cLabel, std::vector<int> index, std::vector<double> cAngles, double sepA, double freeA) {
-
-    double Csec;
-    std::vector<int> oLab;
-    std::vector<double> WID;
-
-    if (layer == 0) {
-        Csec = 0;
-        oLab = {3, 2, 1, 6, 5, 4};
-        WID = {sepA, sepA, freeA, freeA, freeA, freeA};
-    } else if (layer == 1) {
-        Csec = 0;
-        oLab = {9, 8, 7, 12, 11, 10};
-        WID = {sepA, sepA, freeA, freeA, freeA, freeA};
-    } else if (layer == 2) {
-        Csec = sepA - M_PI / 4;
-        oLab = {14, 13, 16, 15};
-        WID = {M_PI / 2, M_PI / 2, M_PI / 2, M_PI / 2};
-    }//_if
-
-    for (unsigned int i = 0; i < oLab.size(); i++) {
-        double Upper = Csec + WID.at(i);
-        double Lower = Csec;
-        for (unsigned int idx = 0; idx < cAngles.size(); idx++) {
-            int logic = (cAngles.at(idx) < Upper ? 1 : 0) * (cAngles.at(idx) >= Lower ? 1 : 0) * index.at(idx);
-            logic == 1 ? cLabel.at(idx) = oLab.at(i) : false;
-        }
-        if (Lower < 0) {
-            for (unsigned int idx = 0; idx < cAngles.size(); idx++) {
-                int logic = (cAngles.at(idx) < 2 * M_PI ? 1 : 0) * (cAngles.at(idx) >= 2 * M_PI + Lower ? 1 : 0) * index.at(idx);
-                logic == 1 ? cLabel.at(idx) = oLab.at(i) : false;
-            }
-        }
-        if (Upper > 2 * M_PI) {
-            for (unsigned int idx = 0; idx < cAngles.size(); idx++) {
-                int logic = (cAngles.at(idx) < Upper - 2 * M_PI ? 1 : 0) * (cAngles.at(idx) >= 0 ? 1 : 0) * index.at(idx);
-                logic == 1 ? cLabel.at(idx) = oLab.at(i) : false;
-            }
-        }
-        Csec = Csec + WID.at(i);
-    }//_for
-}
@@ -28,6 +28,12 @@ PURPOSE.  See the above copyright notices for more information.
 
 #include "CemrgMeasureTest.hpp"
 
+// VTK
+#include <vtkSphereSource.h>
+#include <vtkCubeSource.h>
+#include <vtkTriangleFilter.h>
+#include <vtkMassProperties.h>
+
 typedef CemrgMeasure::Point Point;
 typedef CemrgMeasure::Points Points;
 
@@ -299,6 +305,74 @@ void TestCemrgMeasure::Deconvert() {
     QCOMPARE(cemrgMeasure->Deconvert(dir, fileNo), result);
 }
 
+
+/*****************************************************************************************************/
+/***************************************  Morphology Functions ***************************************/
+/*****************************************************************************************************/
+static bool RelativeCompare(const double& lhs, const double& rhs, double tolerance = 1e-6) {
+    return std::fabs(lhs - rhs) <= tolerance * std::max(std::fabs(lhs), std::fabs(rhs));
+}
+
+void TestCemrgMeasure::GetMorphologyMatchesMassProperties_data() {
+    QTest::addColumn<int>("threads");
+
+    QTest::newRow("1 thread") << 1;
+    QTest::newRow("3 threads") << 3;
+    QTest::newRow("All cores") << 0;
+}
+
+void TestCemrgMeasure::GetMorphologyMatchesMassProperties() {
+    QFETCH(int, threads);
+
+    // Closed meshes away from the origin: triangle spheres and a quad cube
+    vector<vtkSmartPointer<vtkPolyData>> meshes;
+    const array<int, 2> resolutions { 16, 48 };
+    for (int resolution : resolutions) {
+        vtkSmartPointer<vtkSphereSource> sphere = vtkSmartPointer<vtkSphereSource>::New();
+        sphere->SetCenter(120, -45, 30);
+        sphere->SetRadius(25);
+        sphere->SetThetaResolution(resolution);
+        sphere->SetPhiResolution(resolution);
+        sphere->Update();
+        meshes.push_back(sphere->GetOutput());
+    }
+    vtkSmartPointer<vtkCubeSource> cube = vtkSmartPointer<vtkCubeSource>::New();
+    cube->SetCenter(-10, 20, 200);
+    cube->SetXLength(12);
+    cube->SetYLength(30);
+    cube->SetZLength(7);
+    cube->Update();
+    meshes.push_back(cube->GetOutput());
+
+    vector<mitk::Surface::Pointer> surfaces;
+    for (size_t i = 0; i < meshes.size(); i++) {
+        vtkSmartPointer<vtkTriangleFilter> triangles = vtkSmartPointer<vtkTriangleFilter>::New();
+        triangles->SetInputData(meshes[i]);
+        vtkSmartPointer<vtkMassProperties> mass = vtkSmartPointer<vtkMassProperties>::New();
+        mass->SetInputConnection(triangles->GetOutputPort());
+        mass->Update();
+
+        CemrgMeasure::Morphology morphology = cemrgMeasure->GetMorphology(meshes[i], threads);
+        QVERIFY(RelativeCompare(morphology.surfaceArea, mass->GetSurfaceArea()));
+        QVERIFY(RelativeCompare(morphology.volume, mass->GetVolume()));
+        QVERIFY(RelativeCompare(morphology.normalisedShapeIndex, mass->GetNormalizedShapeIndex()));
+
+        mitk::Surface::Pointer surface = mitk::Surface::New();
+        surface->SetVtkPolyData(meshes[i]);
+        surfaces.push_back(surface);
+    }
+
+    // The batch gives the same values as one call per mesh
+    vector<CemrgMeasure::Morphology> batch = cemrgMeasure->GetMorphology(surfaces, threads);
+    QCOMPARE(batch.size(), meshes.size());
+    for (size_t i = 0; i < meshes.size(); i++) {
+        CemrgMeasure::Morphology morphology = cemrgMeasure->GetMorphology(meshes[i], threads);
+        QVERIFY(RelativeCompare(batch[i].surfaceArea, morphology.surfaceArea, 1e-12));
+        QVERIFY(RelativeCompare(batch[i].volume, morphology.volume, 1e-12));
+        QVERIFY(RelativeCompare(batch[i].sphericity, morphology.sphericity, 1e-12));
+    }
+}
+
 int CemrgMeasureTest(int argc, char *argv[]) {
     QCoreApplication app(argc, argv);
     app.setAttribute(Qt::AA_Use96Dpi, true);
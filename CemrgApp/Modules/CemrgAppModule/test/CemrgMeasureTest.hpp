@@ -70,6 +70,9 @@ private slots:
 
     void Deconvert_data();
     void Deconvert();
+
+    void GetMorphologyMatchesMassProperties_data();
+    void GetMorphologyMatchesMassProperties();
 };
 
 Q_DECLARE_METATYPE(CemrgMeasure::Points)
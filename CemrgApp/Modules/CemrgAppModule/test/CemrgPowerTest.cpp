@@ -0,0 +1,296 @@
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * CEMRGAPPMODULE TESTS
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrg.com
+ * orod.razeghi@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+#include "CemrgPowerTest.hpp"
+
+// C++ Standard
+#include <cmath>
+
+// VTK
+#include <vtkSphereSource.h>
+#include <vtkPolyDataWriter.h>
+#include <vtkPolyDataReader.h>
+#include <vtkFloatArray.h>
+#include <vtkPointData.h>
+#include <vtkCellData.h>
+#include <vtkPoints.h>
+#include <vtkCellArray.h>
+#include <vtkIdList.h>
+
+typedef CemrgPower::TransmitterPose Pose;
+
+void TestCemrgPower::initTestCase() {
+    QVERIFY(tmpDir.isValid());
+}
+
+void TestCemrgPower::cleanupTestCase() {
+
+}
+
+void TestCemrgPower::WriteTransmitter(int ribSpacing, const double centre[3]) {
+    // Only the four corners of the face are read from the template
+    vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+    points->SetNumberOfPoints(112176);
+    for (vtkIdType i = 0; i < points->GetNumberOfPoints(); i++)
+        points->SetPoint(i, 0, 0, 0);
+    points->SetPoint(100247, centre[0] - 5, centre[1] + 5, centre[2]);
+    points->SetPoint(72364, centre[0] + 5, centre[1] + 5, centre[2]);
+    points->SetPoint(72063, centre[0] - 5, centre[1] - 5, centre[2]);
+    points->SetPoint(112175, centre[0] + 5, centre[1] - 5, centre[2]);
+
+    vtkSmartPointer<vtkPolyData> ebr = vtkSmartPointer<vtkPolyData>::New();
+    ebr->SetPoints(points);
+    vtkSmartPointer<vtkPolyDataWriter> writer = vtkSmartPointer<vtkPolyDataWriter>::New();
+    writer->SetFileName(tmpDir.filePath("ebr" + QString::number(ribSpacing) + ".vtk").toStdString().c_str());
+    writer->SetInputData(ebr);
+    writer->Write();
+}
+
+mitk::Surface::Pointer TestCemrgPower::Endo(double distance, double radius) {
+    vtkSmartPointer<vtkSphereSource> sphere = vtkSmartPointer<vtkSphereSource>::New();
+    sphere->SetCenter(0, 0, distance);
+    sphere->SetRadius(radius);
+    sphere->SetThetaResolution(40);
+    sphere->SetPhiResolution(40);
+    sphere->Update();
+    mitk::Surface::Pointer endo = mitk::Surface::New();
+    endo->SetVtkPolyData(sphere->GetOutput());
+    return endo;
+}
+
+void TestCemrgPower::ComparePowerMaps(mitk::Surface::Pointer actual, mitk::Surface::Pointer expected) {
+    vtkPolyData* a = actual->GetVtkPolyData();
+    vtkPolyData* e = expected->GetVtkPolyData();
+    QCOMPARE(a->GetNumberOfPoints(), e->GetNumberOfPoints());
+    QCOMPARE(a->GetNumberOfCells(), e->GetNumberOfCells());
+    vtkDataArray* aIntensity = a->GetPointData()->GetScalars();
+    vtkDataArray* eIntensity = e->GetPointData()->GetScalars();
+    for (vtkIdType i = 0; i < a->GetNumberOfPoints(); i++) {
+        QCOMPARE(aIntensity->GetTuple1(i), eIntensity->GetTuple1(i));
+        for (int j = 0; j < 3; j++)
+            QCOMPARE(a->GetPoint(i)[j], e->GetPoint(i)[j]);
+    }
+}
+
+void TestCemrgPower::TransmitterPose() {
+    const double centre[3] = {1, 2, 3};
+    WriteTransmitter(7, centre);
+
+    CemrgPower power(tmpDir.path(), 7);
+    Pose pose;
+    QVERIFY(power.LoadTransmitterPose(7, pose));
+    for (int i = 0; i < 3; i++)
+        QCOMPARE(pose.centre[i], centre[i]);
+    QCOMPARE(pose.normal[0], 0.0);
+    QCOMPARE(pose.normal[1], 0.0);
+    QCOMPARE(abs(pose.normal[2]), 1.0);
+
+    // Missing or foreign transmitter meshes
+    QVERIFY(!power.LoadTransmitterPose(8, pose));
+    vtkSmartPointer<vtkPolyData> small = vtkSmartPointer<vtkPolyData>::New();
+    QVERIFY(!power.GetTransmitterPose(small, pose));
+}
+
+void TestCemrgPower::AcousticIntensityOnAxis() {
+    // One triangle with a corner on the beam axis, 50 mm from the transmitter
+    Pose pose = {{0, 0, 0}, {0, 0, 1}};
+    vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+    points->InsertNextPoint(0, 0, 50);
+    points->InsertNextPoint(1, 0, 50);
+    points->InsertNextPoint(0, 1, 50);
+    vtkSmartPointer<vtkCellArray> cells = vtkSmartPointer<vtkCellArray>::New();
+    vtkIdType triangle[3] = {0, 1, 2};
+    cells->InsertNextCell(3, triangle);
+    vtkSmartPointer<vtkPolyData> pd = vtkSmartPointer<vtkPolyData>::New();
+    pd->SetPoints(points);
+    pd->SetPolys(cells);
+    mitk::Surface::Pointer endo = mitk::Surface::New();
+    endo->SetVtkPolyData(pd);
+
+    CemrgPower power;
+    vector<mitk::Surface::Pointer> maps = power.CalculateAcousticIntensity(endo, vector<Pose>(1, pose), 1);
+    QCOMPARE(maps.size(), (size_t)1);
+    QCOMPARE(maps[0]->GetVtkPolyData()->GetNumberOfPoints(), (vtkIdType)3);
+
+    // On the axis both sinc terms are 1: I = A/(l*d)^2 * 10^(d*atten*f/1E5)
+    const double f = 921.25E3, v = 1560, atten = -0.3, L = 0.9487E-3;
+    const double A = 8 * 24 * L * L, l = v / f, d = 0.05;
+    double expected = A / (l * l * d * d) * pow(10.0, d * atten * f / 1E5);
+    double onAxis = maps[0]->GetVtkPolyData()->GetPointData()->GetScalars()->GetTuple1(0);
+    QVERIFY2(abs(onAxis - expected) <= 1e-4 * expected, (to_string(onAxis) + " vs " + to_string(expected)).c_str());
+
+    // Off the axis the sinc terms only take power away
+    for (vtkIdType i = 1; i < 3; i++)
+        QVERIFY(maps[0]->GetVtkPolyData()->GetPointData()->GetScalars()->GetTuple1(i) < onAxis);
+}
+
+void TestCemrgPower::AcousticIntensityPoses_data() {
+    QTest::addColumn<int>("threads");
+
+    QTest::newRow("1 thread") << 1;
+    QTest::newRow("3 threads") << 3;
+    QTest::newRow("8 threads") << 8;
+}
+
+void TestCemrgPower::AcousticIntensityPoses() {
+    QFETCH(int, threads);
+
+    const double centre[3] = {0, 0, 0};
+    WriteTransmitter(5, centre);
+    mitk::Surface::Pointer endo = Endo(60, 20);
+
+    // The pose of the project transmitter and two tilted ones
+    CemrgPower power(tmpDir.path(), 5);
+    vector<Pose> poses(3);
+    QVERIFY(power.LoadTransmitterPose(5, poses[0]));
+    double tilt = 1 / sqrt(2.0);
+    poses[1] = {{0, 0, 0}, {tilt, 0, tilt}};
+    poses[2] = {{5, -5, 10}, {0, -tilt, tilt}};
+
+    vector<mitk::Surface::Pointer> maps = power.CalculateAcousticIntensity(endo, poses, threads);
+    QCOMPARE(maps.size(), poses.size());
+
+    // Every pose of a batch gives the map it gives on its own, on a single thread
+    for (size_t p = 0; p < poses.size(); p++) {
+        vector<mitk::Surface::Pointer> single = power.CalculateAcousticIntensity(endo, vector<Pose>(1, poses[p]), 1);
+        QCOMPARE(single.size(), (size_t)1);
+        QVERIFY(single[0]->GetVtkPolyData()->GetNumberOfPoints() > 0);
+        ComparePowerMaps(maps[p], single[0]);
+    }
+
+    // The single-pose step of the view reads the same transmitter and saves its map
+    QFile::remove(tmpDir.filePath("endo5.vtk"));
+    mitk::Surface::Pointer projectMap = power.CalculateAcousticIntensity(endo);
+    QVERIFY(projectMap.IsNotNull());
+    ComparePowerMaps(projectMap, maps[0]);
+    QVERIFY(QFileInfo::exists(tmpDir.filePath("endo5.vtk")));
+}
+
+void TestCemrgPower::AcousticIntensityKeepsArrays() {
+    // The sphere comes with point normals, plus the x of each point and the id of each cell
+    mitk::Surface::Pointer endo = Endo(60, 20);
+    vtkPolyData* pd = endo->GetVtkPolyData();
+    vtkSmartPointer<vtkFloatArray> pointX = vtkSmartPointer<vtkFloatArray>::New();
+    pointX->SetName("PointX");
+    for (vtkIdType i = 0; i < pd->GetNumberOfPoints(); i++)
+        pointX->InsertNextValue(pd->GetPoint(i)[0]);
+    pd->GetPointData()->SetScalars(pointX);
+    vtkSmartPointer<vtkFloatArray> cellIds = vtkSmartPointer<vtkFloatArray>::New();
+    cellIds->SetName("CellId");
+    for (vtkIdType c = 0; c < pd->GetNumberOfCells(); c++)
+        cellIds->InsertNextValue(c);
+    pd->GetCellData()->AddArray(cellIds);
+
+    CemrgPower power;
+    Pose pose = {{0, 0, 0}, {1 / sqrt(2.0), 0, 1 / sqrt(2.0)}};
+    vector<mitk::Surface::Pointer> maps = power.CalculateAcousticIntensity(endo, vector<Pose>(1, pose), 1);
+    QCOMPARE(maps.size(), (size_t)1);
+    vtkPolyData* powered = maps[0]->GetVtkPolyData();
+    QVERIFY(powered->GetNumberOfCells() > 0);
+    QVERIFY(powered->GetNumberOfCells() < pd->GetNumberOfCells());
+
+    // Intensity is the active scalars, the arrays of the endo mesh follow their points and cells
+    QCOMPARE(string(powered->GetPointData()->GetScalars()->GetName()), string("Intensity"));
+    QVERIFY(powered->GetPointData()->GetNormals() != NULL);
+    vtkDataArray* poweredX = powered->GetPointData()->GetArray("PointX");
+    vtkDataArray* poweredCellIds = powered->GetCellData()->GetArray("CellId");
+    QVERIFY(poweredX != NULL && poweredCellIds != NULL);
+    QCOMPARE(poweredX->GetNumberOfTuples(), powered->GetNumberOfPoints());
+    QCOMPARE(poweredCellIds->GetNumberOfTuples(), powered->GetNumberOfCells());
+    for (vtkIdType i = 0; i < powered->GetNumberOfPoints(); i++)
+        QCOMPARE(poweredX->GetTuple1(i), (double)(float)powered->GetPoint(i)[0]);
+    vtkSmartPointer<vtkIdList> cellPoints = vtkSmartPointer<vtkIdList>::New();
+    vtkSmartPointer<vtkIdList> endoPoints = vtkSmartPointer<vtkIdList>::New();
+    for (vtkIdType c = 0; c < powered->GetNumberOfCells(); c++) {
+        powered->GetCellPoints(c, cellPoints);
+        pd->GetCellPoints((vtkIdType)poweredCellIds->GetTuple1(c), endoPoints);
+        QCOMPARE(cellPoints->GetNumberOfIds(), endoPoints->GetNumberOfIds());
+        for (vtkIdType j = 0; j < cellPoints->GetNumberOfIds(); j++) {
+            for (int k = 0; k < 3; k++)
+                QCOMPARE(powered->GetPoint(cellPoints->GetId(j))[k], pd->GetPoint(endoPoints->GetId(j))[k]);
+        }
+    }
+}
+
+void TestCemrgPower::ReferenceAHAKeepsScalars() {
+    mitk::PointSet::Pointer pointSet = mitk::IOUtil::Load<mitk::PointSet>((QFINDTESTDATA(CemrgTestData::strainPath) + "/PointSet.mps").toStdString());
+    vtkSmartPointer<vtkPolyDataReader> reader = vtkSmartPointer<vtkPolyDataReader>::New();
+    reader->SetFileName((QFINDTESTDATA(CemrgTestData::strainPath) + "/transformed-0.vtk").toStdString().c_str());
+    reader->Update();
+    vtkSmartPointer<vtkPolyData> pd = vtkSmartPointer<vtkPolyData>::New();
+    pd->DeepCopy(reader->GetOutput());
+    QVERIFY(pd->GetNumberOfPoints() > 0);
+
+    // A power map, as the view holds it when the AHA mapping runs
+    vtkSmartPointer<vtkFloatArray> intensity = vtkSmartPointer<vtkFloatArray>::New();
+    intensity->SetName("Intensity");
+    intensity->SetNumberOfTuples(pd->GetNumberOfPoints());
+    for (vtkIdType i = 0; i < pd->GetNumberOfPoints(); i++)
+        intensity->SetValue(i, 0.5 * i);
+    pd->GetPointData()->SetScalars(intensity);
+    mitk::Surface::Pointer surface = mitk::Surface::New();
+    surface->SetVtkPolyData(pd);
+
+    vector<mitk::Point3D> landmarks;
+    for (mitk::PointSet::PointsIterator it = pointSet->Begin(); it != pointSet->End(); ++it)
+        landmarks.push_back(it.Value());
+    CemrgAhaSegmentation aha;
+    QVERIFY(aha.SetLandmarks(landmarks));
+    QVERIFY(aha.Segment(pd));
+    const vector<int> expected = aha.GetPointLabels();
+
+    CemrgPower power(tmpDir.path(), 5);
+    mitk::Surface::Pointer labelled = power.ReferenceAHA(pointSet, surface);
+    vtkPointData* pointData = labelled->GetVtkPolyData()->GetPointData();
+
+    // The intensity stays the active scalars the view colours and reads
+    QVERIFY(pointData->GetScalars() != NULL);
+    QCOMPARE(string(pointData->GetScalars()->GetName()), string("Intensity"));
+    for (vtkIdType i = 0; i < pd->GetNumberOfPoints(); i++)
+        QCOMPARE(pointData->GetScalars()->GetTuple1(i), 0.5 * i);
+
+    // The labels are added next to it
+    vtkDataArray* labels = pointData->GetArray("AHA");
+    QVERIFY(labels != NULL);
+    QCOMPARE(labels->GetNumberOfTuples(), pd->GetNumberOfPoints());
+    int segmented = 0;
+    for (vtkIdType i = 0; i < pd->GetNumberOfPoints(); i++) {
+        QCOMPARE((int)labels->GetTuple1(i), expected[i]);
+        if (expected[i] >= 1 && expected[i] <= 16)
+            segmented++;
+    }
+    QVERIFY(segmented > 0);
+}
+
+int CemrgPowerTest(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    app.setAttribute(Qt::AA_Use96Dpi, true);
+    TestCemrgPower tc;
+    QTEST_SET_MAIN_SOURCE_PATH
+    return QTest::qExec(&tc, argc, argv);
+}
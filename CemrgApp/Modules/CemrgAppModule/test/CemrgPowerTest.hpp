@@ -0,0 +1,63 @@
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * CEMRGAPPMODULE TESTS
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrg.com
+ * orod.razeghi@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+// Qt
+#include <QTemporaryDir>
+
+// CemrgApp
+#include "CemrgTestCommon.hpp"
+#include <CemrgPower.h>
+#include <CemrgAhaSegmentation.h>
+
+using namespace std;
+
+class TestCemrgPower : public QObject {
+
+    Q_OBJECT
+
+private:
+    QTemporaryDir tmpDir;
+
+    // Transmitter template with its face centred on centre and facing +z
+    void WriteTransmitter(int ribSpacing, const double centre[3]);
+    // Sphere in front of the transmitter, as an endo mesh
+    mitk::Surface::Pointer Endo(double distance, double radius);
+    // Compares the points and intensities of two power maps
+    void ComparePowerMaps(mitk::Surface::Pointer actual, mitk::Surface::Pointer expected);
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void TransmitterPose();
+    void AcousticIntensityOnAxis();
+    void AcousticIntensityPoses_data();
+    void AcousticIntensityPoses();
+    void AcousticIntensityKeepsArrays();
+    void ReferenceAHAKeepsScalars();
+};
@@ -0,0 +1,783 @@
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * CEMRGAPPMODULE TESTS
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrg.com
+ * orod.razeghi@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+#include "CemrgScar3DTest.hpp"
+
+// C++ Standard
+#include <random>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+
+// ITK
+#include <itkImageFileReader.h>
+#include <itkImageRegionIteratorWithIndex.h>
+
+// Qmitk
+#include <mitkITKImageImport.h>
+
+// VTK
+#include <vtkSphereSource.h>
+#include <vtkPolyDataWriter.h>
+#include <vtkCellData.h>
+#include <vtkPointData.h>
+
+void TestCemrgScar3D::initTestCase() {
+    QVERIFY(tmpDir.isValid());
+
+    // Synthetic LGE volume with plenty of ties, so claims compete for the same voxels
+    ImageType::RegionType region;
+    ImageType::SizeType size = {{40, 40, 40}};
+    region.SetSize(size);
+    ImageType::Pointer lge = ImageType::New();
+    lge->SetRegions(region);
+    lge->Allocate();
+    ImageType::Pointer seg = ImageType::New();
+    seg->SetRegions(region);
+    seg->Allocate();
+
+    mt19937 generator(0);
+    uniform_int_distribution<int> distribution(0, 60);
+    itk::ImageRegionIteratorWithIndex<ImageType> lgeIt(lge, region);
+    itk::ImageRegionIterator<ImageType> segIt(seg, region);
+    for (; !lgeIt.IsAtEnd(); ++lgeIt, ++segIt) {
+        lgeIt.Set(distribution(generator));
+        // Label 3 marks the cut regions (e.g. the mitral valve)
+        segIt.Set(lgeIt.GetIndex()[2] < 12 ? 3 : 0);
+    }
+    lgeImage = mitk::ImportItkImage(lge)->Clone();
+    segImage = mitk::ImportItkImage(seg)->Clone();
+
+    ImageType::RegionType flatRegion;
+    ImageType::SizeType flatSize = {{40, 40, 1}};
+    flatRegion.SetSize(flatSize);
+    ImageType::Pointer flat = ImageType::New();
+    flat->SetRegions(flatRegion);
+    flat->Allocate();
+    flat->FillBuffer(30);
+    flatLgeImage = mitk::ImportItkImage(flat)->Clone();
+
+    // Volume the expected scalars of Data/Scar3D were computed on, cut region at x <= 4
+    ImageType::RegionType fixtureRegion;
+    ImageType::SizeType fixtureSize = {{20, 20, 24}};
+    fixtureRegion.SetSize(fixtureSize);
+    ImageType::Pointer fixtureLge = ImageType::New();
+    fixtureLge->SetRegions(fixtureRegion);
+    fixtureLge->Allocate();
+    ImageType::Pointer fixtureSeg = ImageType::New();
+    fixtureSeg->SetRegions(fixtureRegion);
+    fixtureSeg->Allocate();
+    itk::ImageRegionIteratorWithIndex<ImageType> fixtureIt(fixtureLge, fixtureRegion);
+    itk::ImageRegionIterator<ImageType> fixtureSegIt(fixtureSeg, fixtureRegion);
+    for (; !fixtureIt.IsAtEnd(); ++fixtureIt, ++fixtureSegIt) {
+        ImageType::IndexType index = fixtureIt.GetIndex();
+        fixtureIt.Set((7 * index[0] + 13 * index[1] + 29 * index[2] + index[0] * index[1]) % 50);
+        fixtureSegIt.Set(index[0] <= 4 ? 3 : 0);
+    }
+    fixtureLgeImage = mitk::ImportItkImage(fixtureLge)->Clone();
+    fixtureSegImage = mitk::ImportItkImage(fixtureSeg)->Clone();
+
+    // Shell inside the volume, flipped in XY as CemrgCommonUtils::LoadVTKMesh expects
+    vtkSmartPointer<vtkSphereSource> sphere = vtkSmartPointer<vtkSphereSource>::New();
+    sphere->SetCenter(-20, -20, 20);
+    sphere->SetRadius(12);
+    sphere->SetThetaResolution(60);
+    sphere->SetPhiResolution(60);
+    sphere->Update();
+    vtkSmartPointer<vtkPolyDataWriter> writer = vtkSmartPointer<vtkPolyDataWriter>::New();
+    writer->SetInputData(sphere->GetOutput());
+    writer->SetFileName(tmpDir.filePath("segmentation.vtk").toStdString().c_str());
+    writer->Write();
+}
+
+void TestCemrgScar3D::cleanupTestCase() {
+
+}
+
+vtkSmartPointer<vtkFloatArray> TestCemrgScar3D::Scar3D(
+    int methodType, bool voxelBased, int threads, QString debugName, int samplingMode, bool vertexBased, pair<int, int> window,
+    double stepSize, bool flat) {
+    unique_ptr<CemrgScar3D> scar(new CemrgScar3D());
+    scar->SetMethodType(methodType);
+    scar->SetVoxelBasedProjection(voxelBased);
+    scar->SetSamplingMode(samplingMode);
+    scar->SetStepSize(stepSize);
+    scar->SetVertexBasedProjection(vertexBased);
+    scar->SetMinStep(window.first);
+    scar->SetMaxStep(window.second);
+    scar->SetNumberOfThreads(threads);
+    if (!flat)
+        scar->SetScarSegImage(segImage);
+
+    mitk::Surface::Pointer shell = scar->Scar3D(tmpDir.path().toStdString(), flat ? flatLgeImage : lgeImage);
+    if (shell.IsNull())
+        return nullptr;
+    scar->SaveScarDebugImage(debugName, tmpDir.path());
+    if (vertexBased)
+        return vtkFloatArray::SafeDownCast(shell->GetVtkPolyData()->GetPointData()->GetScalars());
+    return vtkFloatArray::SafeDownCast(shell->GetVtkPolyData()->GetCellData()->GetScalars());
+}
+
+TestCemrgScar3D::ImageType::Pointer TestCemrgScar3D::LoadDebugImage(QString debugName) {
+    itk::ImageFileReader<ImageType>::Pointer reader = itk::ImageFileReader<ImageType>::New();
+    reader->SetFileName(tmpDir.filePath(debugName + ".nii").toStdString());
+    reader->Update();
+    return reader->GetOutput();
+}
+
+vector<double> TestCemrgScar3D::FixtureScalars(int methodType, int samplingMode, bool voxelBased) {
+    /**
+     * Data/Scar3D/shell.vtk holds two flat patches, one facing +z over the cut region and one
+     * facing +x against the image border. shell_expected.txt has the plotted scalar of each cell.
+     * The neighbourhood rows of methods 1 and 2 are the values of the baseline
+     * GetIntensityAlongNormal and GetStatisticalMeasure loop. The baseline left methods 3 and 4
+     * at 0, so their rows and the trilinear rows hold the sum, median and interpolated samples
+     * over the same steps.
+     */
+    vector<double> expected;
+    QFile expectedFile(QFINDTESTDATA(CemrgTestData::scar3DPath) + "/shell_expected.txt");
+    if (!expectedFile.open(QIODevice::ReadOnly | QIODevice::Text))
+        return expected;
+    QTextStream in(&expectedFile);
+    while (!in.atEnd()) {
+        QStringList fields = in.readLine().split(' ', QString::SkipEmptyParts);
+        if (fields.size() < 3 || fields[0].startsWith("#"))
+            continue;
+        if (fields[0].toInt() != methodType || fields[1].toInt() != samplingMode || fields[2].toInt() != (voxelBased ? 1 : 0))
+            continue;
+        for (int i = 3; i < fields.size(); i++)
+            expected.push_back(fields[i].toDouble());
+    }
+    return expected;
+}
+
+vtkSmartPointer<vtkFloatArray> TestCemrgScar3D::FixtureScar3D(
+    int methodType, int samplingMode, bool voxelBased, int threads, mitk::Image::Pointer image) {
+    unique_ptr<CemrgScar3D> scar(new CemrgScar3D());
+    scar->SetMethodType(methodType);
+    scar->SetVoxelBasedProjection(voxelBased);
+    scar->SetSamplingMode(samplingMode);
+    scar->SetMinStep(-3);
+    scar->SetMaxStep(3);
+    scar->SetNumberOfThreads(threads);
+    scar->SetScarSegImage(fixtureSegImage);
+
+    mitk::Surface::Pointer shell = scar->Scar3D(QFINDTESTDATA(CemrgTestData::scar3DPath).toStdString(), image, "shell.vtk");
+    if (shell.IsNull())
+        return nullptr;
+    return vtkFloatArray::SafeDownCast(shell->GetVtkPolyData()->GetCellData()->GetScalars());
+}
+
+void TestCemrgScar3D::Scar3DParallel_data() {
+    QTest::addColumn<int>("methodType");
+    QTest::addColumn<bool>("voxelBased");
+    QTest::addColumn<int>("threads");
+
+    for (int methodType : {1, 2}) {
+        for (bool voxelBased : {false, true}) {
+            for (int threads : {2, 3, 8}) {
+                string name = "method " + to_string(methodType) + (voxelBased ? " voxel-based " : " ") + to_string(threads) + " threads";
+                QTest::newRow(name.c_str()) << methodType << voxelBased << threads;
+            }
+        }
+    }
+}
+
+void TestCemrgScar3D::Scar3DParallel() {
+    QFETCH(int, methodType);
+    QFETCH(bool, voxelBased);
+    QFETCH(int, threads);
+
+    vtkSmartPointer<vtkFloatArray> serial = Scar3D(methodType, voxelBased, 1, "serial");
+    vtkSmartPointer<vtkFloatArray> parallel = Scar3D(methodType, voxelBased, threads, "parallel");
+
+    QVERIFY(serial != nullptr && parallel != nullptr);
+    QCOMPARE(parallel->GetNumberOfTuples(), serial->GetNumberOfTuples());
+    for (vtkIdType i = 0; i < serial->GetNumberOfTuples(); i++)
+        QVERIFY2(parallel->GetValue(i) == serial->GetValue(i), ("Cell " + to_string(i) + " doesn't match!").c_str());
+
+    // Voxels claimed by the projection must match too
+    ImageType::Pointer serialVisited = LoadDebugImage("serial");
+    ImageType::Pointer parallelVisited = LoadDebugImage("parallel");
+    itk::ImageRegionConstIterator<ImageType> serialIt(serialVisited, serialVisited->GetLargestPossibleRegion());
+    itk::ImageRegionConstIterator<ImageType> parallelIt(parallelVisited, parallelVisited->GetLargestPossibleRegion());
+    for (; !serialIt.IsAtEnd(); ++serialIt, ++parallelIt)
+        QCOMPARE(parallelIt.Get(), serialIt.Get());
+}
+
+void TestCemrgScar3D::Scar3DMatchesFixture_data() {
+    QTest::addColumn<int>("methodType");
+    QTest::addColumn<int>("samplingMode");
+    QTest::addColumn<bool>("voxelBased");
+    QTest::addColumn<int>("threads");
+
+    for (int methodType : {1, 2, 3, 4}) {
+        for (int samplingMode : {1, 2}) {
+            for (bool voxelBased : {false, true}) {
+                for (int threads : {1, 0}) {
+                    string name = "method " + to_string(methodType) + (samplingMode == 2 ? " trilinear" : " neighbourhood") +
+                        (voxelBased ? " voxel-based " : " ") + (threads == 1 ? "serial" : "all threads");
+                    QTest::newRow(name.c_str()) << methodType << samplingMode << voxelBased << threads;
+                }
+            }
+        }
+    }
+}
+
+void TestCemrgScar3D::Scar3DMatchesFixture() {
+    QFETCH(int, methodType);
+    QFETCH(int, samplingMode);
+    QFETCH(bool, voxelBased);
+    QFETCH(int, threads);
+
+    vector<double> expected = FixtureScalars(methodType, samplingMode, voxelBased);
+    QCOMPARE(expected.size(), (size_t)100);
+
+    vtkSmartPointer<vtkFloatArray> scalars = FixtureScar3D(methodType, samplingMode, voxelBased, threads, fixtureLgeImage);
+    QVERIFY(scalars != nullptr);
+    QCOMPARE(scalars->GetNumberOfTuples(), (vtkIdType)expected.size());
+    for (vtkIdType i = 0; i < scalars->GetNumberOfTuples(); i++) {
+        QVERIFY2(abs(scalars->GetValue(i) - expected[i]) <= 1e-4 * (1 + abs(expected[i])),
+            ("Cell " + to_string(i) + " is " + to_string(scalars->GetValue(i)) + ", expected " + to_string(expected[i])).c_str());
+    }
+}
+
+void TestCemrgScar3D::Scar3DPixelTypes_data() {
+    QTest::addColumn<int>("methodType");
+    QTest::addColumn<int>("samplingMode");
+    QTest::addColumn<bool>("asDouble");
+
+    for (int methodType : {1, 2, 3, 4}) {
+        for (int samplingMode : {1, 2}) {
+            for (bool asDouble : {false, true}) {
+                string name = "method " + to_string(methodType) + (samplingMode == 2 ? " trilinear " : " neighbourhood ") + (asDouble ? "double" : "float");
+                QTest::newRow(name.c_str()) << methodType << samplingMode << asDouble;
+            }
+        }
+    }
+}
+
+void TestCemrgScar3D::Scar3DPixelTypes() {
+    QFETCH(int, methodType);
+    QFETCH(int, samplingMode);
+    QFETCH(bool, asDouble);
+
+    vector<double> expected = FixtureScalars(methodType, samplingMode, false);
+    QCOMPARE(expected.size(), (size_t)100);
+
+    // The fixture volume in floating point, projected in its own pixel type
+    mitk::Image::Pointer image;
+    mitk::Image::Pointer shifted;
+    if (asDouble) {
+        itk::Image<double, 3>::Pointer itkImage;
+        mitk::CastToItkImage(fixtureLgeImage, itkImage);
+        image = mitk::ImportItkImage(itkImage)->Clone();
+        for (itk::ImageRegionIterator<itk::Image<double, 3>> it(itkImage, itkImage->GetLargestPossibleRegion()); !it.IsAtEnd(); ++it)
+            it.Set(it.Get() + 0.25);
+        shifted = mitk::ImportItkImage(itkImage)->Clone();
+    } else {
+        FloatImageType::Pointer itkImage;
+        mitk::CastToItkImage(fixtureLgeImage, itkImage);
+        image = mitk::ImportItkImage(itkImage)->Clone();
+        for (itk::ImageRegionIterator<FloatImageType> it(itkImage, itkImage->GetLargestPossibleRegion()); !it.IsAtEnd(); ++it)
+            it.Set(it.Get() + 0.25);
+        shifted = mitk::ImportItkImage(itkImage)->Clone();
+    }//_if
+
+    vtkSmartPointer<vtkFloatArray> scalars = FixtureScar3D(methodType, samplingMode, false, 0, image);
+    vtkSmartPointer<vtkFloatArray> shiftedScalars = FixtureScar3D(methodType, samplingMode, false, 0, shifted);
+    QVERIFY(scalars != nullptr && shiftedScalars != nullptr);
+    QCOMPARE(scalars->GetNumberOfTuples(), (vtkIdType)expected.size());
+    for (vtkIdType i = 0; i < scalars->GetNumberOfTuples(); i++) {
+        QVERIFY2(abs(scalars->GetValue(i) - expected[i]) <= 1e-4 * (1 + abs(expected[i])),
+            ("Cell " + to_string(i) + " is " + to_string(scalars->GetValue(i)) + ", expected " + to_string(expected[i])).c_str());
+        // Fractions survive the projection, means, maxima and medians move with the volume
+        if (expected[i] > 0 && methodType != 3)
+            QVERIFY2(abs(shiftedScalars->GetValue(i) - expected[i] - 0.25) <= 1e-4 * (1 + abs(expected[i])),
+                ("Shifted cell " + to_string(i) + " is " + to_string(shiftedScalars->GetValue(i))).c_str());
+        if (expected[i] > 0 && methodType == 3)
+            QVERIFY(shiftedScalars->GetValue(i) > expected[i]);
+    }
+}
+
+void TestCemrgScar3D::Scar3DFailures() {
+    unique_ptr<CemrgScar3D> scar(new CemrgScar3D());
+    scar->SetScarSegImage(segImage);
+
+    // Missing shell
+    QVERIFY(scar->Scar3D(tmpDir.path().toStdString(), lgeImage, "missing.vtk").IsNull());
+    // No windows to project
+    QVERIFY(scar->Scar3DWindows(tmpDir.path().toStdString(), lgeImage, vector<pair<int, int>>()).IsNull());
+
+    // Scar segmentation that doesn't match the LGE image
+    ImageType::RegionType region;
+    ImageType::SizeType size = {{10, 10, 10}};
+    region.SetSize(size);
+    ImageType::Pointer seg = ImageType::New();
+    seg->SetRegions(region);
+    seg->Allocate();
+    seg->FillBuffer(0);
+    scar->SetScarSegImage(mitk::ImportItkImage(seg)->Clone());
+    QVERIFY(scar->Scar3D(tmpDir.path().toStdString(), lgeImage).IsNull());
+}
+
+void TestCemrgScar3D::Scar3DSamplingModes_data() {
+    QTest::addColumn<int>("samplingMode");
+    QTest::addColumn<bool>("vertexBased");
+    QTest::addColumn<int>("threads");
+
+    for (int samplingMode : {1, 2}) {
+        for (bool vertexBased : {false, true}) {
+            if (samplingMode == 1 && !vertexBased)
+                continue; // covered by Scar3DParallel
+            for (int threads : {3, 8}) {
+                string name = (samplingMode == 2 ? "trilinear" : "neighbourhood") + string(vertexBased ? " vertices " : " cells ") + to_string(threads) + " threads";
+                QTest::newRow(name.c_str()) << samplingMode << vertexBased << threads;
+            }
+        }
+    }
+}
+
+void TestCemrgScar3D::Scar3DSamplingModes() {
+    QFETCH(int, samplingMode);
+    QFETCH(bool, vertexBased);
+    QFETCH(int, threads);
+
+    vtkSmartPointer<vtkFloatArray> serial = Scar3D(2, false, 1, "serial", samplingMode, vertexBased);
+    vtkSmartPointer<vtkFloatArray> parallel = Scar3D(2, false, threads, "parallel", samplingMode, vertexBased);
+    QVERIFY(serial != nullptr && parallel != nullptr);
+
+    // One scalar per point of the shell for the vertex projection, per cell otherwise
+    mitk::Surface::Pointer shell = CemrgCommonUtils::LoadVTKMesh(tmpDir.filePath("segmentation.vtk").toStdString());
+    vtkIdType expected = vertexBased ? shell->GetVtkPolyData()->GetNumberOfPoints() : shell->GetVtkPolyData()->GetNumberOfCells();
+    QCOMPARE(serial->GetNumberOfTuples(), expected);
+    QCOMPARE(parallel->GetNumberOfTuples(), expected);
+
+    // Samples of the 0-60 volume, interpolated or not, stay in its range
+    for (vtkIdType i = 0; i < serial->GetNumberOfTuples(); i++) {
+        QVERIFY2(parallel->GetValue(i) == serial->GetValue(i), ("Scalar " + to_string(i) + " doesn't match!").c_str());
+        QVERIFY(serial->GetValue(i) >= 0 && serial->GetValue(i) <= 60);
+    }
+}
+
+void TestCemrgScar3D::Scar3DWindowsMatchScar3D_data() {
+    QTest::addColumn<int>("methodType");
+    QTest::addColumn<int>("samplingMode");
+    QTest::addColumn<bool>("vertexBased");
+    QTest::addColumn<double>("stepSize");
+    QTest::addColumn<bool>("flat");
+
+    for (int methodType : {1, 2, 3}) {
+        for (int samplingMode : {1, 2}) {
+            string name = "method " + to_string(methodType) + (samplingMode == 2 ? " trilinear" : " neighbourhood");
+            QTest::newRow(name.c_str()) << methodType << samplingMode << false << 0.25 << false;
+        }
+        // 0.5 divides the window offsets, 0.3 does not and falls back to separate runs
+        for (double stepSize : {0.5, 0.3}) {
+            string name = "method " + to_string(methodType) + " trilinear step " + to_string(stepSize);
+            QTest::newRow(name.c_str()) << methodType << 2 << false << stepSize << false;
+        }
+        // No trilinear steps fit in a single slice, every window is 0
+        string name = "method " + to_string(methodType) + " trilinear single slice";
+        QTest::newRow(name.c_str()) << methodType << 2 << false << 0.25 << true;
+    }
+    QTest::newRow("method 2 vertices") << 2 << 1 << true << 0.25 << false;
+}
+
+void TestCemrgScar3D::Scar3DWindowsMatchScar3D() {
+    QFETCH(int, methodType);
+    QFETCH(int, samplingMode);
+    QFETCH(bool, vertexBased);
+    QFETCH(double, stepSize);
+    QFETCH(bool, flat);
+
+    vector<pair<int, int>> windows = {{-1, 3}, {0, 2}, {1, 3}, {-1, 0}};
+    unique_ptr<CemrgScar3D> scar(new CemrgScar3D());
+    scar->SetMethodType(methodType);
+    scar->SetSamplingMode(samplingMode);
+    scar->SetStepSize(stepSize);
+    scar->SetVertexBasedProjection(vertexBased);
+    scar->SetNumberOfThreads(3);
+    if (!flat)
+        scar->SetScarSegImage(segImage);
+    mitk::Surface::Pointer shell = scar->Scar3DWindows(tmpDir.path().toStdString(), flat ? flatLgeImage : lgeImage, windows);
+    QVERIFY(shell.IsNotNull());
+
+    vtkDataSetAttributes* attributes = shell->GetVtkPolyData()->GetCellData();
+    if (vertexBased)
+        attributes = shell->GetVtkPolyData()->GetPointData();
+    QCOMPARE(string(attributes->GetScalars()->GetName()), CemrgScar3D::WindowArrayName(-1, 3).toStdString());
+
+    // Each window holds the scalars of a separate run over it
+    for (const pair<int, int>& window : windows) {
+        vtkDataArray* windowScalars = attributes->GetArray(CemrgScar3D::WindowArrayName(window.first, window.second).toStdString().c_str());
+        QVERIFY(windowScalars != NULL);
+        vtkSmartPointer<vtkFloatArray> single = Scar3D(methodType, false, 1, "window", samplingMode, vertexBased, window, stepSize, flat);
+        QVERIFY(single != nullptr);
+        QCOMPARE(windowScalars->GetNumberOfTuples(), single->GetNumberOfTuples());
+        for (vtkIdType i = 0; i < single->GetNumberOfTuples(); i++) {
+            double expected = single->GetValue(i);
+            QVERIFY(std::isfinite(windowScalars->GetTuple1(i)));
+            if (flat)
+                QCOMPARE(windowScalars->GetTuple1(i), 0.0);
+            QVERIFY2(abs(windowScalars->GetTuple1(i) - expected) <= 1e-4 * (1 + abs(expected)),
+                ("Window " + to_string(window.first) + ":" + to_string(window.second) + " scalar " + to_string(i) + " doesn't match!").c_str());
+        }
+    }
+}
+
+void TestCemrgScar3D::ProjectionReducers_data() {
+    QTest::addColumn<vector<double>>("values");
+    QTest::addColumn<double>("mean");
+    QTest::addColumn<double>("max");
+    QTest::addColumn<double>("sum");
+    QTest::addColumn<double>("median");
+    QTest::addColumn<double>("percentile90");
+
+    QTest::newRow("odd") << vector<double>{7, 1, 3, 9, 5} << 5.0 << 9.0 << 25.0 << 5.0 << 8.2;
+    QTest::newRow("even") << vector<double>{4, 2, 8, 6} << 5.0 << 8.0 << 20.0 << 5.0 << 7.4;
+    QTest::newRow("single") << vector<double>{3} << 3.0 << 3.0 << 3.0 << 3.0 << 3.0;
+}
+
+void TestCemrgScar3D::ProjectionReducers() {
+    QFETCH(vector<double>, values);
+    QFETCH(double, mean);
+    QFETCH(double, max);
+    QFETCH(double, sum);
+    QFETCH(double, median);
+    QFETCH(double, percentile90);
+
+    // Reducers may reorder their input, each gets its own copy
+    vector<double> copy = values;
+    QCOMPARE(CemrgProjectionMean::Reduce(copy), mean);
+    copy = values;
+    QCOMPARE(CemrgProjectionMax::Reduce(copy), max);
+    copy = values;
+    QCOMPARE(CemrgProjectionSum::Reduce(copy), sum);
+    copy = values;
+    QCOMPARE(CemrgProjectionMedian::Reduce(copy), median);
+    copy = values;
+    QCOMPARE(CemrgProjectionPercentile<90>::Reduce(copy), percentile90);
+}
+
+// Percentage above thresh counted as the baseline CemrgScar3D::Thresholding did, one pass over the scalars
+static double LinearThresholding(vtkDataArray* scalars, double excludedValue, double thresh) {
+    int ctr1 = 0, ctr2 = 0;
+    for (vtkIdType i = 0; i < scalars->GetNumberOfTuples(); i++) {
+        double value = scalars->GetTuple1(i);
+        if (value == excludedValue) {
+            ctr1++;
+            continue;
+        }
+        if (value > thresh) ctr2++;
+    }
+    return (ctr2 * 100.0) / (scalars->GetNumberOfTuples() - ctr1);
+}
+
+void TestCemrgScar3D::ThresholdIndexMatchesLinearCount_data() {
+    QTest::addColumn<double>("excludedValue");
+
+    QTest::newRow("shell scalars, -1 excluded") << -1.0;
+    QTest::newRow("scar score, 0 excluded") << 0.0;
+}
+
+void TestCemrgScar3D::ThresholdIndexMatchesLinearCount() {
+    QFETCH(double, excludedValue);
+
+    // Repeated values, so many thresholds fall on the scalars themselves
+    mt19937 generator(4);
+    uniform_int_distribution<int> distribution(-4, 40);
+    vtkSmartPointer<vtkFloatArray> values = vtkSmartPointer<vtkFloatArray>::New();
+    for (int i = 0; i < 5000; i++)
+        values->InsertNextValue(distribution(generator) * 0.25f);
+    // A few scalars the projection can leave non-finite
+    for (int i = 0; i < 5000; i += 499)
+        values->SetValue(i, (i % 3 == 0) ? numeric_limits<float>::quiet_NaN() : ((i % 3 == 1) ? 1 : -1) * numeric_limits<float>::infinity());
+    CemrgScarThresholdIndex index;
+    index.Build(values, excludedValue);
+    QVERIFY(index.GetNumberOfNonFinite() > 0);
+    QVERIFY(index.IsBuiltFor(values));
+    QVERIFY(is_sorted(index.GetSortedScalars().begin(), index.GetSortedScalars().end()));
+
+    vector<double> thresholds;
+    for (int t = -8; t <= 44; t++)
+        thresholds.push_back(t * 0.25);
+    thresholds.push_back(0.1);
+    thresholds.push_back(3.3);
+
+    vector<double> percentages = index.Percentages(thresholds);
+    QCOMPARE(percentages.size(), thresholds.size());
+    for (size_t t = 0; t < thresholds.size(); t++) {
+        double expected = LinearThresholding(values, excludedValue, thresholds[t]);
+        QCOMPARE(index.Percentage(thresholds[t]), expected);
+        QCOMPARE(percentages[t], expected);
+    }
+
+    // Changed scalars are seen and indexed again
+    values->SetValue(0, 100);
+    QVERIFY(!index.IsBuiltFor(values));
+}
+
+void TestCemrgScar3D::ThresholdIndexNonFinite() {
+    vtkSmartPointer<vtkFloatArray> values = vtkSmartPointer<vtkFloatArray>::New();
+    for (int v = -1; v <= 10; v++)
+        values->InsertNextValue(v);
+    values->InsertNextValue(numeric_limits<float>::quiet_NaN());
+    values->InsertNextValue(numeric_limits<float>::infinity());
+    values->InsertNextValue(-numeric_limits<float>::infinity());
+    values->InsertNextValue(numeric_limits<float>::quiet_NaN());
+
+    CemrgScarThresholdIndex index;
+    index.Build(values, -1);
+    QCOMPARE(index.GetNumberOfExcluded(), (vtkIdType)1);
+    QCOMPARE(index.GetNumberOfNonFinite(), (vtkIdType)4);
+    QCOMPARE(index.GetNumberOfFinite(), (vtkIdType)11);
+    QCOMPARE(index.GetNumberOfValid(), (vtkIdType)15);
+
+    // Only the finite scalars are sorted, in order
+    const vector<double>& sorted = index.GetSortedScalars();
+    QVERIFY(all_of(sorted.begin(), sorted.end(), [](double v) { return std::isfinite(v); }));
+    QVERIFY(is_sorted(sorted.begin(), sorted.end()));
+    QCOMPARE(sorted.front(), 0.0);
+    QCOMPARE(sorted.back(), 10.0);
+
+    // NaN and -inf stay in the denominator and are never scar, +inf is scar below +inf
+    const double inf = numeric_limits<double>::infinity();
+    QCOMPARE(index.Percentage(4.5), 7 * 100.0 / 15);
+    QCOMPARE(index.Percentage(10), 1 * 100.0 / 15);
+    QCOMPARE(index.Percentage(-inf), 12 * 100.0 / 15);
+    QCOMPARE(index.Percentage(inf), 0.0);
+    QCOMPARE(index.Percentage(numeric_limits<double>::quiet_NaN()), 0.0);
+    for (double thresh : {-inf, -2.0, 0.0, 4.5, 10.0, inf})
+        QCOMPARE(index.Percentage(thresh), LinearThresholding(values, -1, thresh));
+
+    // The histogram spans the finite range
+    CemrgScarHistogram histogram;
+    histogram.Build(index, 10, 1);
+    QCOMPARE(histogram.GetNumberOfValues(), (vtkIdType)11);
+    QCOMPARE(histogram.GetEdges().back(), 10.0);
+}
+
+void TestCemrgScar3D::HistogramEdges() {
+    // 0 to 10 over 10 bins puts every integer on an edge, -1 is excluded
+    vtkSmartPointer<vtkFloatArray> values = vtkSmartPointer<vtkFloatArray>::New();
+    for (int v = -1; v <= 10; v++)
+        values->InsertNextValue(v);
+    CemrgScarThresholdIndex index;
+    index.Build(values, -1);
+    CemrgScarHistogram histogram;
+    histogram.Build(index, 10, 1);
+
+    QCOMPARE(histogram.GetNumberOfValues(), (vtkIdType)11);
+    QCOMPARE(histogram.GetEdges().front(), 0.0);
+    QCOMPARE(histogram.GetEdges().back(), 10.0);
+
+    // Bins hold (lower, upper], the first one includes the minimum
+    vector<vtkIdType> expected(10, 1);
+    expected[0] = 2;
+    QCOMPARE(histogram.GetCounts(), expected);
+    for (int b = 0; b < 10; b++) {
+        QCOMPARE(histogram.GetCumulativePercentages()[b], (b + 2) * 100.0 / 11);
+        QCOMPARE(histogram.GetAbovePercentages()[b], index.Percentage(histogram.GetEdges()[b + 1]));
+    }
+    QCOMPARE(histogram.GetAbovePercentages().back(), 0.0);
+
+    // All values equal
+    vtkSmartPointer<vtkFloatArray> flat = vtkSmartPointer<vtkFloatArray>::New();
+    for (int i = 0; i < 5; i++)
+        flat->InsertNextValue(3);
+    index.Build(flat, -1);
+    histogram.Build(index, 4, 1);
+    QCOMPARE(histogram.GetCounts(), (vector<vtkIdType>{5, 0, 0, 0}));
+    QCOMPARE(histogram.GetAbovePercentages().front(), index.Percentage(3));
+}
+
+void TestCemrgScar3D::HistogramMatchesThresholding_data() {
+    QTest::addColumn<int>("numberOfBins");
+    QTest::addColumn<int>("threads");
+
+    for (int numberOfBins : {1, 7, 100}) {
+        for (int threads : {1, 3, 8}) {
+            string name = to_string(numberOfBins) + " bins " + to_string(threads) + " threads";
+            QTest::newRow(name.c_str()) << numberOfBins << threads;
+        }
+    }
+}
+
+void TestCemrgScar3D::HistogramMatchesThresholding() {
+    QFETCH(int, numberOfBins);
+    QFETCH(int, threads);
+
+    // Several blocks of values, many of them repeated, some on the bin edges
+    mt19937 generator(2);
+    uniform_int_distribution<int> distribution(-1, 400);
+    vtkSmartPointer<vtkFloatArray> values = vtkSmartPointer<vtkFloatArray>::New();
+    for (int i = 0; i < 200000; i++)
+        values->InsertNextValue(distribution(generator) * 0.25f);
+    CemrgScarThresholdIndex index;
+    index.Build(values, -0.25);
+
+    CemrgScarHistogram histogram;
+    histogram.Build(index, numberOfBins, threads);
+    const vector<double>& edges = histogram.GetEdges();
+    const vector<double>& sorted = index.GetSortedScalars();
+
+    vtkIdType total = 0;
+    for (int b = 0; b < numberOfBins; b++) {
+        // Brute-force count of the values in (lower, upper]
+        vtkIdType count = 0;
+        for (double v : sorted)
+            if ((v > edges[b] || (b == 0 && v == edges[0])) && v <= edges[b + 1])
+                count++;
+        QCOMPARE(histogram.GetCounts()[b], count);
+        total += count;
+
+        // Above the upper edge means the same as a threshold at that edge
+        QCOMPARE(histogram.GetAbovePercentages()[b], index.Percentage(edges[b + 1]));
+    }
+    QCOMPARE(total, index.GetNumberOfValid());
+}
+
+TestCemrgScar3D::FloatImageType::Pointer TestCemrgScar3D::FloatImage(unsigned int size, bool labels) {
+    FloatImageType::RegionType region;
+    FloatImageType::SizeType imageSize = {{size, size, size}};
+    region.SetSize(imageSize);
+    FloatImageType::Pointer image = FloatImageType::New();
+    image->SetRegions(region);
+    image->Allocate();
+
+    mt19937 generator(1);
+    uniform_real_distribution<float> distribution(0, 500);
+    itk::ImageRegionIteratorWithIndex<FloatImageType> it(image, region);
+    for (; !it.IsAtEnd(); ++it) {
+        FloatImageType::IndexType ix = it.GetIndex();
+        it.Set(labels ? (ix[0] + ix[1] + ix[2]) % 4 : distribution(generator));
+    }
+    return image;
+}
+
+void TestCemrgScar3D::RoiStatistics() {
+    // Larger than one 65536-voxel block, so partial moments get merged
+    FloatImageType::Pointer lge = FloatImage(50, false);
+    FloatImageType::Pointer roi = FloatImage(50, true);
+    vector<int> labels = {1, 2, 3};
+
+    // Two-pass reference over the raw voxels
+    map<int, vector<double>> values;
+    itk::ImageRegionConstIterator<FloatImageType> lgeIt(lge, lge->GetLargestPossibleRegion());
+    itk::ImageRegionConstIterator<FloatImageType> roiIt(roi, roi->GetLargestPossibleRegion());
+    for (; !lgeIt.IsAtEnd(); ++lgeIt, ++roiIt)
+        values[(int)roiIt.Get()].push_back(lgeIt.Get());
+
+    for (int threads : {1, 3, 8}) {
+        unique_ptr<CemrgScar3D> scar(new CemrgScar3D());
+        scar->SetNumberOfThreads(threads);
+        map<int, CemrgScar3D::RoiStatistics> statistics;
+        int status = scar->CalculateRoiStatistics(mitk::ImportItkImage(lge), mitk::ImportItkImage(roi), labels, statistics);
+        QCOMPARE(status, (int)CemrgScar3D::ROI_STATS_OK);
+        QCOMPARE(statistics.size(), labels.size());
+
+        for (int label : labels) {
+            const vector<double>& v = values[label];
+            double mean = 0.0, m2 = 0.0;
+            for (double x : v)
+                mean += x;
+            mean /= v.size();
+            for (double x : v)
+                m2 += (x - mean) * (x - mean);
+
+            const CemrgScar3D::RoiStatistics& roiStats = statistics[label];
+            QCOMPARE(roiStats.count, (unsigned long)v.size());
+            QVERIFY(std::abs(roiStats.mean - mean) < 1e-9 * mean);
+            QVERIFY(std::abs(roiStats.stdv - std::sqrt(m2 / v.size())) < 1e-9 * mean);
+            QCOMPARE(roiStats.min, *min_element(v.begin(), v.end()));
+            QCOMPARE(roiStats.max, *max_element(v.begin(), v.end()));
+        }
+
+        // The label-1 wrapper reports the same moments
+        double mean = 0.0, stdv = 0.0;
+        QVERIFY(scar->CalculateMeanStd(mitk::ImportItkImage(lge), mitk::ImportItkImage(roi), mean, stdv));
+        QCOMPARE(mean, statistics[1].mean);
+        QCOMPARE(stdv, statistics[1].stdv);
+    }
+}
+
+void TestCemrgScar3D::RoiStatisticsStatus_data() {
+    QTest::addColumn<bool>("nullImage");
+    QTest::addColumn<unsigned int>("roiSize");
+    QTest::addColumn<vector<double>>("labels");
+    QTest::addColumn<int>("status");
+
+    QTest::newRow("null image") << true << 20u << vector<double>{1} << (int)CemrgScar3D::ROI_STATS_NULL_IMAGE;
+    QTest::newRow("size mismatch") << false << 21u << vector<double>{1} << (int)CemrgScar3D::ROI_STATS_SIZE_MISMATCH;
+    QTest::newRow("missing label") << false << 20u << vector<double>{1, 7} << (int)CemrgScar3D::ROI_STATS_EMPTY_LABEL;
+    QTest::newRow("only missing label") << false << 20u << vector<double>{7} << (int)CemrgScar3D::ROI_STATS_EMPTY_LABEL;
+}
+
+void TestCemrgScar3D::RoiStatisticsStatus() {
+    QFETCH(bool, nullImage);
+    QFETCH(unsigned int, roiSize);
+    QFETCH(vector<double>, labels);
+    QFETCH(int, status);
+
+    mitk::Image::Pointer lge = nullImage ? mitk::Image::Pointer() : mitk::ImportItkImage(FloatImage(20, false))->Clone();
+    mitk::Image::Pointer roi = mitk::ImportItkImage(FloatImage(roiSize, true))->Clone();
+    vector<int> roiLabels(labels.begin(), labels.end());
+
+    unique_ptr<CemrgScar3D> scar(new CemrgScar3D());
+    map<int, CemrgScar3D::RoiStatistics> statistics;
+    QCOMPARE(scar->CalculateRoiStatistics(lge, roi, roiLabels, statistics), status);
+
+    if (status == CemrgScar3D::ROI_STATS_EMPTY_LABEL) {
+        // Labels with voxels are still filled in, the missing ones come back zeroed
+        QCOMPARE(statistics.size(), roiLabels.size());
+        QCOMPARE(statistics[7].count, 0ul);
+        QCOMPARE(statistics[7].mean, 0.0);
+        if (statistics.count(1))
+            QVERIFY(statistics[1].count > 0);
+    } else {
+        QVERIFY(statistics.empty());
+    }
+
+    // The label-1 wrapper fails whenever label 1 can't be measured
+    double mean = -1.0, stdv = -1.0;
+    bool measured = scar->CalculateMeanStd(lge, roi, mean, stdv);
+    QCOMPARE(measured, status == CemrgScar3D::ROI_STATS_EMPTY_LABEL);
+    if (!measured) {
+        QCOMPARE(mean, -1.0);
+        QCOMPARE(stdv, -1.0);
+    }
+}
+
+int CemrgScar3DTest(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    app.setAttribute(Qt::AA_Use96Dpi, true);
+    TestCemrgScar3D tc;
+    QTEST_SET_MAIN_SOURCE_PATH
+    return QTest::qExec(&tc, argc, argv);
+}
@@ -0,0 +1,105 @@
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * CEMRGAPPMODULE TESTS
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrg.com
+ * orod.razeghi@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+// Qt
+#include <QTemporaryDir>
+#include <QTextStream>
+
+// CemrgApp
+#include "CemrgTestCommon.hpp"
+#include <CemrgScar3D.h>
+#include <CemrgCommonUtils.h>
+#include <CemrgScarProjection.h>
+#include <CemrgScarHistogram.h>
+#include <CemrgScarThresholdIndex.h>
+
+using namespace std;
+
+class TestCemrgScar3D : public QObject {
+
+    Q_OBJECT
+
+private:
+    typedef itk::Image<short, 3> ImageType;
+    typedef itk::Image<float, 3> FloatImageType;
+
+    QTemporaryDir tmpDir;
+    mitk::Image::Pointer lgeImage;
+    mitk::Image::Pointer segImage;
+    // Single slice, too thin for the trilinear stencil
+    mitk::Image::Pointer flatLgeImage;
+    // Volumes of the checked in shell and its expected scalars, set by formula
+    mitk::Image::Pointer fixtureLgeImage;
+    mitk::Image::Pointer fixtureSegImage;
+
+    // Used for comparing serial and parallel projections, point scalars for the vertex projection
+    vtkSmartPointer<vtkFloatArray> Scar3D(
+        int methodType, bool voxelBased, int threads, QString debugName,
+        int samplingMode = 1, bool vertexBased = false, pair<int, int> window = make_pair(-1, 3),
+        double stepSize = 0.25, bool flat = false);
+    ImageType::Pointer LoadDebugImage(QString debugName);
+    // Expected scalars of Data/Scar3D/shell.vtk and the projection of an image onto it
+    vector<double> FixtureScalars(int methodType, int samplingMode, bool voxelBased);
+    vtkSmartPointer<vtkFloatArray> FixtureScar3D(int methodType, int samplingMode, bool voxelBased, int threads, mitk::Image::Pointer image);
+    // Float volumes for the ROI statistics, labels cycle through 0-3
+    FloatImageType::Pointer FloatImage(unsigned int size, bool labels);
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void Scar3DParallel_data();
+    void Scar3DParallel();
+    void Scar3DMatchesFixture_data();
+    void Scar3DMatchesFixture();
+    void Scar3DPixelTypes_data();
+    void Scar3DPixelTypes();
+
+    void Scar3DFailures();
+    void Scar3DSamplingModes_data();
+    void Scar3DSamplingModes();
+    void Scar3DWindowsMatchScar3D_data();
+    void Scar3DWindowsMatchScar3D();
+
+    void ProjectionReducers_data();
+    void ProjectionReducers();
+
+    void ThresholdIndexMatchesLinearCount_data();
+    void ThresholdIndexMatchesLinearCount();
+    void ThresholdIndexNonFinite();
+
+    void HistogramEdges();
+    void HistogramMatchesThresholding_data();
+    void HistogramMatchesThresholding();
+
+    void RoiStatistics();
+    void RoiStatisticsStatus_data();
+    void RoiStatisticsStatus();
+};
+
+Q_DECLARE_METATYPE(vector<double>)
@@ -0,0 +1,621 @@
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * CEMRGAPPMODULE TESTS
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrg.com
+ * orod.razeghi@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+#include "CemrgScarAdvancedTest.hpp"
+
+// C++ Standard
+#include <fstream>
+#include <sstream>
+#include <random>
+#include <limits>
+#include <cmath>
+
+// VTK
+#include <vtkSphereSource.h>
+#include <vtkFloatArray.h>
+#include <vtkPointData.h>
+#include <vtkThreshold.h>
+#include <vtkConnectivityFilter.h>
+#include <vtkPolyDataConnectivityFilter.h>
+#include <vtkMassProperties.h>
+#include <vtkMath.h>
+#include <vtkPointLocator.h>
+#include <vtkPolyDataReader.h>
+#include <vtkDijkstraGraphGeodesicPath.h>
+#include <vtkIdList.h>
+#include <vtkPoints.h>
+#include <vtkCellArray.h>
+#include <vtkPlaneSource.h>
+#include <vtkCell.h>
+
+void TestCemrgScarAdvanced::initTestCase() {
+    QVERIFY(tmpDir.isValid());
+}
+
+void TestCemrgScarAdvanced::cleanupTestCase() {
+
+}
+
+QString TestCemrgScarAdvanced::WriteManifest(QString name, QString text) {
+    QString path = tmpDir.filePath(name);
+    QFile file(path);
+    file.open(QIODevice::WriteOnly | QIODevice::Text);
+    file.write(text.toUtf8());
+    return path;
+}
+
+void TestCemrgScarAdvanced::GapManifestRead() {
+    QString path = QFINDTESTDATA(CemrgTestData::gapManifestPath);
+    vector<CemrgGapManifest::GapCase> cases;
+    QVERIFY(CemrgGapManifest::Read(path, cases));
+    QCOMPARE(cases.size(), (size_t)3);
+
+    // Spaces, tabs and commas all separate tokens, meshes are relative to the manifest
+    QDir base = QFileInfo(path).absoluteDir();
+    QCOMPARE(cases[0].name, QString("p01_left"));
+    QCOMPARE(cases[0].mesh, QDir::cleanPath(base.absoluteFilePath("p01/MaxScar.vtk")));
+    QCOMPARE(cases[0].threshold, 1.2);
+    QVERIFY(cases[0].points == vector<int>({1043, 2210, 3318, 4127, 5051}));
+    QCOMPARE(cases[1].name, QString("p01_right"));
+    QVERIFY(cases[1].points == vector<int>({612, 1984, 2870, 3605}));
+    QCOMPARE(cases[2].name, QString("p02_left"));
+    QCOMPARE(cases[2].mesh, QDir::cleanPath(base.absoluteFilePath("p02/MaxScar.vtp")));
+    QCOMPARE(cases[2].threshold, 1.1);
+    QVERIFY(cases[2].points == vector<int>({88, 401, 977}));
+    for (const CemrgGapManifest::GapCase& gc : cases) {
+        QCOMPARE(gc.status, QString("not_run"));
+        QCOMPARE(gc.connectedAreas, -1);
+    }
+}
+
+void TestCemrgScarAdvanced::GapManifestRejects_data() {
+    QTest::addColumn<QString>("text");
+
+    QTest::newRow("duplicate name") << "a m.vtk 1 1 2\nb m.vtk 1 1 2\na n.vtk 2 3 4\n";
+    QTest::newRow("duplicate name ignoring case") << "Case1 m.vtk 1 1 2\ncase1 n.vtk 1 1 2\n";
+    QTest::newRow("one point id") << "a m.vtk 1 1\n";
+    QTest::newRow("bad threshold") << "a m.vtk high 1 2\n";
+    QTest::newRow("bad point id") << "a m.vtk 1 1 two\n";
+}
+
+void TestCemrgScarAdvanced::GapManifestRejects() {
+    QFETCH(QString, text);
+
+    vector<CemrgGapManifest::GapCase> cases;
+    QVERIFY(!CemrgGapManifest::Read(WriteManifest("rejected.txt", text), cases));
+}
+
+void TestCemrgScarAdvanced::GapManifestResults() {
+    vector<CemrgGapManifest::GapCase> cases;
+    QVERIFY(CemrgGapManifest::Read(WriteManifest("results.txt", "a m.vtk 1.5 1 2 3\n"), cases));
+    cases[0].mesh = "/data/case 1, left/say \"scar\".vtk";
+    cases[0].status = "ok";
+
+    QString path = tmpDir.filePath("results.csv");
+    QVERIFY(CemrgGapManifest::WriteResults(path, cases, 3));
+    ifstream in(path.toStdString());
+    string header, row;
+    getline(in, header);
+    getline(in, row);
+    QCOMPARE(row, string("a,\"/data/case 1, left/say \"\"scar\"\".vtk\",1.5,3,3,-1,-1,-1,-1,ok"));
+
+    QCOMPARE(CemrgGapManifest::CsvField("plain"), string("plain"));
+    QCOMPARE(CemrgGapManifest::CsvField("a,b"), string("\"a,b\""));
+}
+
+vtkSmartPointer<vtkPolyData> TestCemrgScarAdvanced::Sphere(int resolution) {
+    vtkSmartPointer<vtkSphereSource> sphere = vtkSmartPointer<vtkSphereSource>::New();
+    sphere->SetRadius(10);
+    sphere->SetThetaResolution(resolution);
+    sphere->SetPhiResolution(resolution);
+    sphere->Update();
+
+    vtkSmartPointer<vtkPolyData> pd = vtkSmartPointer<vtkPolyData>::New();
+    pd->DeepCopy(sphere->GetOutput());
+    vtkSmartPointer<vtkFloatArray> scalars = vtkSmartPointer<vtkFloatArray>::New();
+    scalars->SetName("scalars");
+    scalars->SetNumberOfTuples(pd->GetNumberOfPoints());
+    scalars->FillComponent(0, 0);
+    pd->GetPointData()->SetScalars(scalars);
+    return pd;
+}
+
+vtkSmartPointer<vtkPolyData> TestCemrgScarAdvanced::UnitSquare() {
+    vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+    points->InsertNextPoint(0, 0, 0);
+    points->InsertNextPoint(1, 0, 0);
+    points->InsertNextPoint(0, 1, 0);
+    points->InsertNextPoint(1, 1, 0);
+    vtkSmartPointer<vtkCellArray> polys = vtkSmartPointer<vtkCellArray>::New();
+    const vtkIdType lower[3] = {0, 1, 3}, upper[3] = {0, 3, 2};
+    polys->InsertNextCell(3, lower);
+    polys->InsertNextCell(3, upper);
+
+    vtkSmartPointer<vtkPolyData> pd = vtkSmartPointer<vtkPolyData>::New();
+    pd->SetPoints(points);
+    pd->SetPolys(polys);
+    vtkSmartPointer<vtkFloatArray> scalars = vtkSmartPointer<vtkFloatArray>::New();
+    scalars->SetName("scalars");
+    scalars->SetNumberOfTuples(4);
+    for (vtkIdType i = 0; i < 4; i++)
+        scalars->SetValue(i, 10 * (i + 1));
+    pd->GetPointData()->SetScalars(scalars);
+    return pd;
+}
+
+void TestCemrgScarAdvanced::ScarComponentsMatchVtk_data() {
+    QTest::addColumn<double>("maxScalar");
+    QTest::addColumn<bool>("fullScalarConnectivity");
+
+    QTest::newRow("full, bounded") << 3.0 << true;
+    QTest::newRow("full, unbounded") << numeric_limits<double>::infinity() << true;
+    QTest::newRow("partial, bounded") << 3.0 << false;
+}
+
+void TestCemrgScarAdvanced::ScarComponentsMatchVtk() {
+    QFETCH(double, maxScalar);
+    QFETCH(bool, fullScalarConnectivity);
+
+    // Patchy integer scalars give many regions at every threshold
+    vtkSmartPointer<vtkPolyData> pd = Sphere(40);
+    vtkFloatArray* scalars = vtkFloatArray::SafeDownCast(pd->GetPointData()->GetScalars());
+    mt19937 generator(3);
+    uniform_int_distribution<int> distribution(0, 5);
+    for (vtkIdType i = 0; i < pd->GetNumberOfPoints(); i++)
+        scalars->SetValue(i, distribution(generator));
+
+    CemrgScarComponents components;
+    components.Build(pd, scalars, maxScalar, fullScalarConnectivity);
+
+    for (double threshold : {1.0, 2.0, 3.0}) {
+        // Number of regions as vtkThreshold and vtkConnectivityFilter count them
+        if (fullScalarConnectivity && std::isinf(maxScalar)) {
+            vtkSmartPointer<vtkThreshold> threshold1 = vtkSmartPointer<vtkThreshold>::New();
+            threshold1->ThresholdByUpper(threshold);
+            threshold1->SetInputArrayToProcess(0, 0, 0, vtkDataObject::FIELD_ASSOCIATION_POINTS, vtkDataSetAttributes::SCALARS);
+            threshold1->SetInputData(pd);
+            vtkSmartPointer<vtkConnectivityFilter> regions = vtkSmartPointer<vtkConnectivityFilter>::New();
+            regions->SetInputConnection(threshold1->GetOutputPort());
+            regions->Update();
+            QCOMPARE(components.GetNumberOfComponents(threshold), regions->GetNumberOfExtractedRegions());
+        }
+
+        // Largest region as vtkPolyDataConnectivityFilter extracts it
+        vtkSmartPointer<vtkPolyDataConnectivityFilter> largest = vtkSmartPointer<vtkPolyDataConnectivityFilter>::New();
+        largest->SetInputData(pd);
+        largest->ScalarConnectivityOn();
+        largest->SetFullScalarConnectivity(fullScalarConnectivity);
+        largest->SetScalarRange(threshold, std::isinf(maxScalar) ? VTK_DOUBLE_MAX : maxScalar);
+        largest->SetExtractionModeToLargestRegion();
+        largest->Update();
+        vtkSmartPointer<vtkMassProperties> mass = vtkSmartPointer<vtkMassProperties>::New();
+        mass->SetInputConnection(largest->GetOutputPort());
+        mass->Update();
+        double area = components.GetLargestArea(threshold);
+        QVERIFY2(abs(area - mass->GetSurfaceArea()) <= 1e-9 * (1 + area),
+            ("Threshold " + to_string(threshold) + ": " + to_string(area) + " vs " + to_string(mass->GetSurfaceArea())).c_str());
+    }
+}
+
+void TestCemrgScarAdvanced::CorridorConnectedAreas_data() {
+    QTest::addColumn<double>("maxScalar");
+    QTest::addColumn<bool>("largestInRange");
+
+    QTest::newRow("scar above the maximum scalar") << 5.0 << false;
+    QTest::newRow("scar within the maximum scalar") << 20.0 << true;
+}
+
+void TestCemrgScarAdvanced::CorridorConnectedAreas() {
+    QFETCH(double, maxScalar);
+    QFETCH(bool, largestInRange);
+
+    vtkSmartPointer<vtkPolyData> pd = Sphere(30);
+    pd->GetPointData()->GetScalars()->FillComponent(0, 10);
+
+    QString outDir = tmpDir.filePath("corridor-" + QString::number(maxScalar)) + "/";
+    QDir().mkpath(outDir);
+    CemrgScarAdvanced csadv;
+    csadv.SetOutputPath(outDir.toStdString());
+    csadv.SetOutputFileName((outDir + "encirclement.csv").toStdString());
+    csadv.SetInputData(pd);
+    csadv.SetFillThreshold(1);
+    csadv.SetMaxScalar(maxScalar);
+    csadv.SetCorridorMeshesOff();
+    csadv.ExtractCorridorData(vector<vector<vtkIdType>>{{100, 101, 102}});
+
+    // Regions are counted with no upper bound, as vtkThreshold::ThresholdByUpper did
+    QCOMPARE(csadv.fi2_connectedAreasTotal, 1);
+    // The largest region keeps the [threshold, max scalar] range of the connectivity filter
+    QCOMPARE(csadv.fi2_largestSurfaceArea > 0, largestInRange);
+    QVERIFY(csadv.fi2_corridorSurfaceArea > 0);
+
+    // Measurements only, the table is the single file written
+    QStringList written = QDir(outDir).entryList(QDir::Files);
+    QCOMPARE(written, QStringList() << "encirclement.csv");
+}
+
+void TestCemrgScarAdvanced::RecursiveNeighbours(
+    vtkPolyData* pd, vtkIdType pointId, int order, map<vtkIdType, int>& visited, bool reexpand) {
+    if (order == 0)
+        return;
+    map<vtkIdType, int>::iterator it = visited.find(pointId);
+    if (it != visited.end() && (!reexpand || it->second >= order))
+        return;
+    visited[pointId] = order;
+
+    // Neighbours through the cell edges, as GetConnectedVertices found them
+    vtkSmartPointer<vtkIdList> cellIds = vtkSmartPointer<vtkIdList>::New();
+    pd->GetPointCells(pointId, cellIds);
+    for (vtkIdType c = 0; c < cellIds->GetNumberOfIds(); c++) {
+        vtkCell* cell = pd->GetCell(cellIds->GetId(c));
+        for (int e = 0; e < cell->GetNumberOfEdges(); e++) {
+            vtkIdList* edge = cell->GetEdge(e)->GetPointIds();
+            if (edge->GetId(0) == pointId)
+                RecursiveNeighbours(pd, edge->GetId(1), order - 1, visited, reexpand);
+            else if (edge->GetId(1) == pointId)
+                RecursiveNeighbours(pd, edge->GetId(0), order - 1, visited, reexpand);
+        }
+    }
+}
+
+void TestCemrgScarAdvanced::MeshGraphKRing_data() {
+    QTest::addColumn<bool>("quads");
+
+    QTest::newRow("triangles") << false;
+    QTest::newRow("quads") << true;
+}
+
+void TestCemrgScarAdvanced::MeshGraphKRing() {
+    QFETCH(bool, quads);
+
+    vtkSmartPointer<vtkPolyData> pd = Sphere(16);
+    if (quads) {
+        vtkSmartPointer<vtkPlaneSource> plane = vtkSmartPointer<vtkPlaneSource>::New();
+        plane->SetResolution(12, 9);
+        plane->Update();
+        pd = vtkSmartPointer<vtkPolyData>::New();
+        pd->DeepCopy(plane->GetOutput());
+    }
+    pd->BuildLinks();
+
+    CemrgMeshGraph graph;
+    graph.Build(pd);
+    QVERIFY(graph.IsBuiltFor(pd));
+    QCOMPARE(graph.GetNumberOfVertices(), pd->GetNumberOfPoints());
+
+    for (int maxOrder = 1; maxOrder <= 5; maxOrder++) {
+        for (vtkIdType seed = 0; seed < pd->GetNumberOfPoints(); seed += 7) {
+            vector<pair<int, int>> ring;
+            graph.GetKRing(seed, maxOrder, ring);
+            map<vtkIdType, int> bfs;
+            for (const pair<int, int>& entry : ring)
+                QVERIFY2(bfs.insert(make_pair((vtkIdType)entry.first, entry.second)).second, "Vertex listed twice!");
+            QCOMPARE(ring.front(), make_pair((int)seed, maxOrder));
+
+            map<vtkIdType, int> baseline, reexpanded;
+            RecursiveNeighbours(pd, seed, maxOrder, baseline, false);
+            RecursiveNeighbours(pd, seed, maxOrder, reexpanded, true);
+
+            // Every vertex gets the order left at its distance in edges
+            QCOMPARE(bfs, reexpanded);
+            if (maxOrder <= 2) {
+                // Up to the first ring no vertex can be reached by a longer path first
+                QCOMPARE(bfs, baseline);
+            } else {
+                // The baseline walk finds a subset, with the same or less order left
+                for (const pair<const vtkIdType, int>& entry : baseline) {
+                    QVERIFY(bfs.count(entry.first) == 1);
+                    QVERIFY(bfs[entry.first] >= entry.second);
+                }
+            }
+        }
+    }
+}
+
+void TestCemrgScarAdvanced::GeodesicPathMatchesVtk_data() {
+    QTest::addColumn<bool>("useScalarWeights");
+
+    QTest::newRow("edge lengths") << false;
+    QTest::newRow("scalar weights") << true;
+}
+
+void TestCemrgScarAdvanced::GeodesicPathMatchesVtk() {
+    QFETCH(bool, useScalarWeights);
+
+    // Jittered sphere, so no two paths have the same cost
+    vtkSmartPointer<vtkPolyData> pd = Sphere(24);
+    vtkFloatArray* scalars = vtkFloatArray::SafeDownCast(pd->GetPointData()->GetScalars());
+    mt19937 generator(5);
+    uniform_real_distribution<double> jitter(-0.2, 0.2);
+    uniform_real_distribution<double> weight(0.5, 5);
+    for (vtkIdType i = 0; i < pd->GetNumberOfPoints(); i++) {
+        double x[3];
+        pd->GetPoint(i, x);
+        for (int j = 0; j < 3; j++)
+            x[j] += jitter(generator);
+        pd->GetPoints()->SetPoint(i, x);
+        scalars->SetValue(i, weight(generator));
+    }
+
+    CemrgMeshGraph graph;
+    graph.Build(pd);
+    CemrgGeodesicPath geodesics;
+    geodesics.Build(pd, graph, useScalarWeights);
+    QVERIFY(geodesics.IsBuiltFor(pd, useScalarWeights));
+
+    // Cost of a path as vtkDijkstraGraphGeodesicPath weighs its edges
+    auto cost = [&](const vector<vtkIdType>& path) {
+        double total = 0;
+        for (size_t i = 1; i < path.size(); i++) {
+            double a[3], b[3];
+            pd->GetPoint(path[i - 1], a);
+            pd->GetPoint(path[i], b);
+            double edge = sqrt(vtkMath::Distance2BetweenPoints(a, b));
+            double s = scalars->GetValue(path[i]);
+            total += useScalarWeights ? edge / (s * s) : edge;
+        }
+        return total;
+    };
+
+    uniform_int_distribution<vtkIdType> vertex(0, pd->GetNumberOfPoints() - 1);
+    for (int p = 0; p < 20; p++) {
+        vtkIdType start = vertex(generator), end = vertex(generator);
+        if (start == end)
+            continue;
+        vtkSmartPointer<vtkDijkstraGraphGeodesicPath> dijkstra = vtkSmartPointer<vtkDijkstraGraphGeodesicPath>::New();
+        dijkstra->SetInputData(pd);
+        dijkstra->SetStartVertex(start);
+        dijkstra->SetEndVertex(end);
+        dijkstra->SetUseScalarWeights(useScalarWeights);
+        dijkstra->Update();
+
+        // VTK lists the ids from the end back to the start
+        vector<vtkIdType> expected;
+        vtkIdList* ids = dijkstra->GetIdList();
+        for (vtkIdType i = ids->GetNumberOfIds() - 1; i >= 0; i--)
+            expected.push_back(ids->GetId(i));
+
+        vector<vtkIdType> path;
+        QVERIFY(geodesics.ShortestPath(start, end, path));
+        QCOMPARE(path.front(), start);
+        QCOMPARE(path.back(), end);
+        QCOMPARE(path, expected);
+        QVERIFY(abs(cost(path) - cost(expected)) <= 1e-9 * (1 + cost(expected)));
+        QCOMPARE(geodesics.GetPathPolyData(path)->GetNumberOfPoints(), (vtkIdType)path.size());
+    }
+
+    // One search tree for several targets gives the paths of separate searches
+    vtkIdType start = vertex(generator);
+    vector<vtkIdType> targets;
+    for (int t = 0; t < 6; t++)
+        targets.push_back(vertex(generator));
+    targets.push_back(-1);
+    vector<vector<vtkIdType>> paths;
+    QCOMPARE(geodesics.ShortestPaths(start, targets, paths), 6);
+    QCOMPARE(paths.size(), targets.size());
+    for (int t = 0; t < 6; t++) {
+        vector<vtkIdType> single;
+        QVERIFY(geodesics.ShortestPath(start, targets[t], single));
+        QCOMPARE(paths[t], single);
+    }
+    QVERIFY(paths.back().empty());
+
+    vector<vtkIdType> path;
+    QVERIFY(!geodesics.ShortestPath(0, pd->GetNumberOfPoints(), path));
+    QVERIFY(path.empty());
+}
+
+void TestCemrgScarAdvanced::GeodesicPathUnreachable() {
+    // Two triangles without a shared edge
+    vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+    for (int t = 0; t < 2; t++) {
+        points->InsertNextPoint(5 * t, 0, 0);
+        points->InsertNextPoint(5 * t + 1, 0, 0);
+        points->InsertNextPoint(5 * t, 1, 0);
+    }
+    vtkSmartPointer<vtkCellArray> polys = vtkSmartPointer<vtkCellArray>::New();
+    const vtkIdType first[3] = {0, 1, 2}, second[3] = {3, 4, 5};
+    polys->InsertNextCell(3, first);
+    polys->InsertNextCell(3, second);
+    vtkSmartPointer<vtkPolyData> pd = vtkSmartPointer<vtkPolyData>::New();
+    pd->SetPoints(points);
+    pd->SetPolys(polys);
+
+    CemrgMeshGraph graph;
+    graph.Build(pd);
+    CemrgGeodesicPath geodesics;
+    geodesics.Build(pd, graph, false);
+
+    vector<vtkIdType> path;
+    QVERIFY(!geodesics.ShortestPath(0, 4, path));
+    QVERIFY(path.empty());
+
+    vector<vector<vtkIdType>> paths;
+    QCOMPARE(geodesics.ShortestPaths(0, vector<vtkIdType> {2, 4, 1}, paths), 2);
+    QCOMPARE(paths[0], (vector<vtkIdType> {0, 2}));
+    QVERIFY(paths[1].empty());
+    QCOMPARE(paths[2], (vector<vtkIdType> {0, 1}));
+
+    // No zero-length line for the unreachable target
+    vtkSmartPointer<vtkPolyData> line = geodesics.GetPathPolyData(paths[1]);
+    QVERIFY(line != NULL);
+    QCOMPARE(line->GetNumberOfPoints(), (vtkIdType)0);
+    QCOMPARE(line->GetNumberOfCells(), (vtkIdType)0);
+    QCOMPARE(geodesics.GetPathPolyData(paths[0])->GetNumberOfLines(), (vtkIdType)1);
+}
+
+void TestCemrgScarAdvanced::ScalarTransferMatchesLocator_data() {
+    QTest::addColumn<int>("threads");
+
+    QTest::newRow("1 thread") << 1;
+    QTest::newRow("3 threads") << 3;
+    QTest::newRow("8 threads") << 8;
+}
+
+void TestCemrgScarAdvanced::ScalarTransferMatchesLocator() {
+    QFETCH(int, threads);
+
+    vtkSmartPointer<vtkPolyData> target = Sphere(40);
+    vtkFloatArray* scalars = vtkFloatArray::SafeDownCast(target->GetPointData()->GetScalars());
+    for (vtkIdType i = 0; i < target->GetNumberOfPoints(); i++)
+        scalars->SetValue(i, i + 1);
+
+    // Query points scattered around the shell, off its vertices
+    vtkSmartPointer<vtkPolyData> source = Sphere(25);
+    mt19937 generator(7);
+    uniform_real_distribution<double> distribution(-0.5, 0.5);
+    for (vtkIdType i = 0; i < source->GetNumberOfPoints(); i++) {
+        double x[3];
+        source->GetPoint(i, x);
+        for (int j = 0; j < 3; j++)
+            x[j] += distribution(generator);
+        source->GetPoints()->SetPoint(i, x);
+    }
+
+    CemrgScalarTransfer transfer;
+    transfer.SetReference(target);
+    transfer.SetNumberOfThreads(threads);
+    vector<vtkSmartPointer<vtkFloatArray>> mapped;
+    QVERIFY(transfer.Transfer(source, vector<vtkDataArray*>(1, scalars), mapped));
+    QCOMPARE((int)mapped.size(), 1);
+    QCOMPARE(mapped[0]->GetNumberOfTuples(), source->GetNumberOfPoints());
+
+    vtkSmartPointer<vtkPointLocator> locator = vtkSmartPointer<vtkPointLocator>::New();
+    locator->SetDataSet(target);
+    locator->AutomaticOn();
+    locator->BuildLocator();
+    for (vtkIdType i = 0; i < source->GetNumberOfPoints(); i++) {
+        double x[3], a[3], b[3];
+        source->GetPoint(i, x);
+        vtkIdType expected = locator->FindClosestPoint(x);
+        vtkIdType id = (vtkIdType)mapped[0]->GetValue(i) - 1;
+        QVERIFY(id >= 0 && id < target->GetNumberOfPoints());
+        // Ties may pick either point, both are at the same distance
+        target->GetPoint(expected, a);
+        target->GetPoint(id, b);
+        QCOMPARE(vtkMath::Distance2BetweenPoints(x, b), vtkMath::Distance2BetweenPoints(x, a));
+    }
+}
+
+void TestCemrgScarAdvanced::TransformSource2TargetFirstPoint() {
+    vtkSmartPointer<vtkPolyData> source = Sphere(20);
+    vtkSmartPointer<vtkPolyData> target = Sphere(20);
+    vtkFloatArray* scalars = vtkFloatArray::SafeDownCast(target->GetPointData()->GetScalars());
+    for (vtkIdType i = 0; i < target->GetNumberOfPoints(); i++)
+        scalars->SetValue(i, i + 1);
+
+    QString outDir = tmpDir.filePath("transfer") + "/";
+    QDir().mkpath(outDir);
+    CemrgScarAdvanced csadv;
+    csadv.SetOutputPath(outDir.toStdString());
+    csadv.SetSourceAndTarget(source, target);
+    csadv.TransformSource2Target();
+
+    vtkSmartPointer<vtkPolyDataReader> reader = vtkSmartPointer<vtkPolyDataReader>::New();
+    reader->SetFileName((outDir + "MaxScarPre_OnPost.vtk").toStdString().c_str());
+    reader->Update();
+    vtkDataArray* output = reader->GetOutput()->GetPointData()->GetScalars();
+    QVERIFY(output != NULL);
+    QCOMPARE(output->GetNumberOfTuples(), source->GetNumberOfPoints());
+
+    // The closest point of source point 0 is target point 0, which used to get the default value
+    QCOMPARE(output->GetTuple1(0), 1.0);
+    for (vtkIdType i = 0; i < source->GetNumberOfPoints(); i++)
+        QCOMPARE(output->GetTuple1(i), (double)(i + 1));
+}
+
+void TestCemrgScarAdvanced::ScalarTransferInverseDistance() {
+    vtkSmartPointer<vtkPolyData> target = UnitSquare();
+    vtkSmartPointer<vtkPolyData> source = vtkSmartPointer<vtkPolyData>::New();
+    vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+    points->InsertNextPoint(0.25, 0.25, 0);
+    points->InsertNextPoint(1, 1, 0);
+    source->SetPoints(points);
+
+    CemrgScalarTransfer transfer;
+    transfer.SetReference(target);
+    transfer.SetInterpolationMode(CemrgScalarTransfer::INVERSE_DISTANCE);
+    transfer.SetNumberOfNeighbours(4);
+    vector<vtkSmartPointer<vtkFloatArray>> mapped;
+    QVERIFY(transfer.Transfer(source, vector<vtkDataArray*>(1, target->GetPointData()->GetScalars()), mapped));
+    QCOMPARE(mapped[0]->GetNumberOfTuples(), (vtkIdType)2);
+
+    // Squared distances 1/8, 5/8, 5/8 and 9/8 give weights 45, 9, 9 and 5 over 68
+    QCOMPARE(mapped[0]->GetValue(0), (float)(1100.0 / 68.0));
+    // A query on a reference point takes its value
+    QCOMPARE(mapped[0]->GetValue(1), 40.0f);
+}
+
+void TestCemrgScarAdvanced::ScalarTransferClosestCell() {
+    vtkSmartPointer<vtkPolyData> target = UnitSquare();
+    vtkSmartPointer<vtkPolyData> source = vtkSmartPointer<vtkPolyData>::New();
+    vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+    points->InsertNextPoint(0.75, 0.25, 0.5);
+    points->InsertNextPoint(0.25, 0.75, -1);
+    points->InsertNextPoint(2, -1, 0);
+    source->SetPoints(points);
+
+    CemrgScalarTransfer transfer;
+    transfer.SetReference(target);
+    transfer.SetInterpolationMode(CemrgScalarTransfer::CLOSEST_CELL);
+    vector<vtkSmartPointer<vtkFloatArray>> mapped;
+    QVERIFY(transfer.Transfer(source, vector<vtkDataArray*>(1, target->GetPointData()->GetScalars()), mapped));
+    QCOMPARE(mapped[0]->GetNumberOfTuples(), (vtkIdType)3);
+
+    // Projections (0.75, 0.25) on the lower triangle, weights 1/4, 1/2, 1/4 on points 0, 1, 3,
+    // and (0.25, 0.75) on the upper one, weights 1/4, 1/4, 1/2 on points 0, 3, 2
+    QCOMPARE(mapped[0]->GetValue(0), 22.5f);
+    QCOMPARE(mapped[0]->GetValue(1), 27.5f);
+    // Outside the square the closest point is the corner
+    QCOMPARE(mapped[0]->GetValue(2), 20.0f);
+
+    // Same values through TransformSource2Target
+    QString outDir = tmpDir.filePath("transfer-cell") + "/";
+    QDir().mkpath(outDir);
+    CemrgScarAdvanced csadv;
+    csadv.SetOutputPath(outDir.toStdString());
+    csadv.SetTransferInterpolation(CemrgScalarTransfer::CLOSEST_CELL);
+    csadv.SetSourceAndTarget(source, target);
+    csadv.TransformSource2Target();
+
+    vtkSmartPointer<vtkPolyDataReader> reader = vtkSmartPointer<vtkPolyDataReader>::New();
+    reader->SetFileName((outDir + "MaxScarPre_OnPost.vtk").toStdString().c_str());
+    reader->Update();
+    vtkDataArray* output = reader->GetOutput()->GetPointData()->GetScalars();
+    QVERIFY(output != NULL);
+    for (vtkIdType i = 0; i < source->GetNumberOfPoints(); i++)
+        QCOMPARE(output->GetTuple1(i), (double)mapped[0]->GetValue(i));
+}
+
+int CemrgScarAdvancedTest(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    app.setAttribute(Qt::AA_Use96Dpi, true);
+    TestCemrgScarAdvanced tc;
+    QTEST_SET_MAIN_SOURCE_PATH
+    return QTest::qExec(&tc, argc, argv);
+}
@@ -0,0 +1,89 @@
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * CEMRGAPPMODULE TESTS
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrg.com
+ * orod.razeghi@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+// Qt
+#include <QTemporaryDir>
+
+// CemrgApp
+#include "CemrgTestCommon.hpp"
+#include <CemrgGapManifest.h>
+#include <CemrgGeodesicPath.h>
+#include <CemrgMeshGraph.h>
+#include <CemrgScalarTransfer.h>
+#include <CemrgScarAdvanced.h>
+#include <CemrgScarComponents.h>
+
+// C++ Standard
+#include <map>
+
+using namespace std;
+
+class TestCemrgScarAdvanced : public QObject {
+
+    Q_OBJECT
+
+private:
+    QTemporaryDir tmpDir;
+
+    // Writes a manifest into the temporary directory
+    QString WriteManifest(QString name, QString text);
+    // Triangulated sphere with float point scalars, all 0
+    vtkSmartPointer<vtkPolyData> Sphere(int resolution);
+    // Unit square in z = 0 split along its diagonal, point scalars 10, 20, 30, 40
+    vtkSmartPointer<vtkPolyData> UnitSquare();
+    // Depth-first walk of the baseline RecursivePointNeighbours, optionally expanding again
+    // a vertex reached later with more order left
+    void RecursiveNeighbours(vtkPolyData* pd, vtkIdType pointId, int order, map<vtkIdType, int>& visited, bool reexpand);
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void GapManifestRead();
+    void GapManifestRejects_data();
+    void GapManifestRejects();
+    void GapManifestResults();
+
+    void ScarComponentsMatchVtk_data();
+    void ScarComponentsMatchVtk();
+    void CorridorConnectedAreas_data();
+    void CorridorConnectedAreas();
+
+    void MeshGraphKRing_data();
+    void MeshGraphKRing();
+
+    void GeodesicPathMatchesVtk_data();
+    void GeodesicPathMatchesVtk();
+    void GeodesicPathUnreachable();
+
+    void ScalarTransferMatchesLocator_data();
+    void ScalarTransferMatchesLocator();
+    void TransformSource2TargetFirstPoint();
+    void ScalarTransferInverseDistance();
+    void ScalarTransferClosestCell();
+};
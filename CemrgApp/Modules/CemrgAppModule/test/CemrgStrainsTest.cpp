@@ -28,6 +28,18 @@ PURPOSE.  See the above copyright notices for more information.
 
 #include "CemrgStrainsTest.hpp"
 
+// C++ Standard
+#include <cstring>
+
+// VTK
+#include <vtkSphereSource.h>
+#include <vtkPoints.h>
+#include <vtkPointData.h>
+#include <vtkPolyDataWriter.h>
+
+// Frames of the strain test data
+static const int strainFrames = CemrgTestData::strainDataSize;
+
 static bool FuzzyCompare(const double& lhs, const double& rhs) {
     constexpr double almostZero = 1e-6;
     if (abs(lhs) < almostZero && abs(rhs) < almostZero)
@@ -44,8 +56,18 @@ mitk::DataNode::Pointer TestCemrgStrains::ReferenceAHA(const array<int, 3>& segR
     return lmNode;
 }
 
-void TestCemrgStrains::initTestCase() {
+QString TestCemrgStrains::CopyStrainFrames(QString folder) {
+    QString dir = tmpDir.filePath(folder);
+    QDir().mkpath(dir);
+    for (int i = 0; i < strainFrames; i++) {
+        QString name = "/transformed-" + QString::number(i) + ".vtk";
+        QFile::copy(QFINDTESTDATA(CemrgTestData::strainPath) + name, dir + name);
+    }
+    return dir;
+}
 
+void TestCemrgStrains::initTestCase() {
+    QVERIFY(tmpDir.isValid());
 }
 
 void TestCemrgStrains::cleanupTestCase() {
@@ -250,6 +272,251 @@ void TestCemrgStrains::ReferenceGuideLines() {
         QVERIFY(mitk::Equal(*referenceGuideLines[i], *result[i], mitk::eps, true));
 }
 
+void TestCemrgStrains::MeshSequenceRoundTrip_data() {
+    QTest::addColumn<bool>("deltaEncoding");
+
+    QTest::newRow("float32") << false;
+    QTest::newRow("delta") << true;
+}
+
+void TestCemrgStrains::MeshSequenceRoundTrip() {
+    QFETCH(bool, deltaEncoding);
+
+    CemrgMeshSequence sequence;
+    sequence.SetDirectory(QFINDTESTDATA(CemrgTestData::strainPath));
+    QVERIFY(!sequence.IsMapped());
+    QVERIFY(sequence.LoadFrames(0, strainFrames));
+
+    QString path = tmpDir.filePath(deltaEncoding ? "delta.cms" : "plain.cms");
+    QVERIFY(sequence.Save(path, deltaEncoding));
+
+    CemrgMeshSequence opened;
+    QVERIFY(opened.Open(path));
+    QVERIFY(opened.IsMapped());
+    QCOMPARE(opened.GetNumberOfFrames(), sequence.GetNumberOfFrames());
+    QCOMPARE(opened.GetNumberOfPoints(), sequence.GetNumberOfPoints());
+    QCOMPARE(opened.GetNumberOfCells(), sequence.GetNumberOfCells());
+    for (vtkIdType i = 0; i < 3 * sequence.GetNumberOfCells(); i++)
+        QCOMPARE(opened.GetTriangles()[i], sequence.GetTriangles()[i]);
+
+    QVERIFY(opened.LoadFrames(0, opened.GetNumberOfFrames()));
+    for (int f = 0; f < sequence.GetNumberOfFrames(); f++) {
+        const double* expected = sequence.GetFrame(f);
+        const double* actual = opened.GetFrame(f);
+        for (vtkIdType i = 0; i < 3 * sequence.GetNumberOfPoints(); i++) {
+            // Without offsets every coordinate is its float32 rounding
+            if (!deltaEncoding || f == 0)
+                QCOMPARE(actual[i], (double)(float)expected[i]);
+            else
+                QVERIFY(abs(actual[i] - expected[i]) <= 1e-6 * (1 + abs(expected[i])));
+        }
+    }
+}
+
+void TestCemrgStrains::MeshSequenceDeltaEncoding() {
+    // Small motion far from the origin, where float32 coordinates lose it
+    vtkSmartPointer<vtkSphereSource> sphere = vtkSmartPointer<vtkSphereSource>::New();
+    sphere->SetCenter(1e4, 1e4, 1e4);
+    sphere->SetRadius(10);
+    sphere->Update();
+    vtkSmartPointer<vtkPolyData> moved = vtkSmartPointer<vtkPolyData>::New();
+    moved->DeepCopy(sphere->GetOutput());
+    for (vtkIdType i = 0; i < moved->GetNumberOfPoints(); i++) {
+        double pt[3];
+        moved->GetPoint(i, pt);
+        pt[2] += 1e-3 * sin((double)i);
+        moved->GetPoints()->SetPoint(i, pt);
+    }
+
+    CemrgMeshSequence sequence;
+    QVERIFY(sequence.SetFrame(0, sphere->GetOutput()));
+    QVERIFY(sequence.SetFrame(1, moved));
+
+    double maxError[2] = {0, 0};
+    for (bool deltaEncoding : {false, true}) {
+        QString path = tmpDir.filePath(deltaEncoding ? "far-delta.cms" : "far-plain.cms");
+        QVERIFY(sequence.Save(path, deltaEncoding));
+        CemrgMeshSequence opened;
+        QVERIFY(opened.Open(path));
+        QVERIFY(opened.LoadFrame(1));
+        for (vtkIdType i = 0; i < 3 * sequence.GetNumberOfPoints(); i++)
+            maxError[deltaEncoding] = max(maxError[deltaEncoding], abs(opened.GetFrame(1)[i] - sequence.GetFrame(1)[i]));
+    }
+
+    // The offsets keep the later frames close to double precision
+    QVERIFY(maxError[true] < 1e-6);
+    QVERIFY(maxError[true] < maxError[false]);
+}
+
+void TestCemrgStrains::MeshSequenceCorruptHeader() {
+    CemrgMeshSequence sequence;
+    sequence.SetDirectory(QFINDTESTDATA(CemrgTestData::strainPath));
+    QVERIFY(sequence.LoadFrames(0, strainFrames));
+    QString path = tmpDir.filePath("corrupt.cms");
+    QVERIFY(sequence.Save(path));
+
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QByteArray bytes = file.readAll();
+    file.close();
+
+    // Point and cell counts shifted by 2^62 give the same size modulo 2^64
+    for (int offset : {16, 24}) {
+        QByteArray corrupt = bytes;
+        qint64 count;
+        memcpy(&count, corrupt.constData() + offset, sizeof(count));
+        count += qint64(1) << 62;
+        memcpy(corrupt.data() + offset, &count, sizeof(count));
+        QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+        QCOMPARE(file.write(corrupt), (qint64)corrupt.size());
+        file.close();
+
+        CemrgMeshSequence opened;
+        QVERIFY(!opened.Open(path));
+        QCOMPARE(opened.GetNumberOfFrames(), 0);
+    }
+}
+
+void TestCemrgStrains::MeshSequenceStaleFile() {
+    QString dir = CopyStrainFrames("stale");
+    CemrgMeshSequence sequence;
+    sequence.SetDirectory(dir);
+    QVERIFY(sequence.LoadFrames(0, strainFrames));
+    QVERIFY(sequence.Save(sequence.GetSequencePath()));
+    QDateTime saved = QFileInfo(sequence.GetSequencePath()).lastModified();
+
+    CemrgMeshSequence fresh;
+    fresh.SetDirectory(dir);
+    QVERIFY(fresh.IsMapped());
+    QCOMPARE(fresh.GetNumberOfFrames(), strainFrames);
+
+    // A frame written after the sequence file
+    QFile frame(sequence.GetFramePath(1));
+    QVERIFY(frame.open(QIODevice::ReadWrite));
+    QVERIFY(frame.setFileTime(saved.addSecs(10), QFileDevice::FileModificationTime));
+    frame.close();
+    CemrgMeshSequence newerFrame;
+    newerFrame.SetDirectory(dir);
+    QVERIFY(!newerFrame.IsMapped());
+    QVERIFY(newerFrame.LoadFrame(1));
+
+    // An extra frame the sequence file doesn't hold
+    QVERIFY(frame.open(QIODevice::ReadWrite));
+    QVERIFY(frame.setFileTime(saved.addSecs(-10), QFileDevice::FileModificationTime));
+    frame.close();
+    QString extra = sequence.GetFramePath(strainFrames);
+    QVERIFY(QFile::copy(sequence.GetFramePath(0), extra));
+    QFile extraFrame(extra);
+    QVERIFY(extraFrame.open(QIODevice::ReadWrite));
+    QVERIFY(extraFrame.setFileTime(saved.addSecs(-10), QFileDevice::FileModificationTime));
+    extraFrame.close();
+    CemrgMeshSequence moreFrames;
+    moreFrames.SetDirectory(dir);
+    QVERIFY(!moreFrames.IsMapped());
+    QCOMPARE(moreFrames.GetNumberOfFrames(), 0);
+}
+
+void TestCemrgStrains::MeshSequenceFrameArrays() {
+    // The tracked frames carry point normals, which the sequence file doesn't keep
+    QString dir = CopyStrainFrames("arrays");
+    CemrgMeshSequence sequence;
+    sequence.SetDirectory(dir);
+    QVERIFY(sequence.FramesHaveArrays());
+    QVERIFY(sequence.LoadFrame(0));
+    QCOMPARE(sequence.GetPolyData(0)->GetPointData()->GetNumberOfArrays(), 0);
+
+    // Frames holding points and triangles only lose nothing
+    QString bareDir = tmpDir.filePath("bare");
+    QDir().mkpath(bareDir);
+    CemrgMeshSequence bare;
+    bare.SetDirectory(bareDir);
+    QVERIFY(!bare.FramesHaveArrays());
+    vtkSmartPointer<vtkPolyDataWriter> writer = vtkSmartPointer<vtkPolyDataWriter>::New();
+    writer->SetInputData(sequence.GetPolyData(0));
+    writer->SetFileName(bare.GetFramePath(0).toStdString().c_str());
+    writer->Write();
+    QVERIFY(!bare.FramesHaveArrays());
+}
+
+void TestCemrgStrains::CalculateAllPlotsParallel_data() {
+    QTest::addColumn<int>("threads");
+
+    QTest::newRow("2 threads") << 2;
+    QTest::newRow("3 threads") << 3;
+    QTest::newRow("8 threads") << 8;
+}
+
+void TestCemrgStrains::CalculateAllPlotsParallel() {
+    QFETCH(int, threads);
+
+    // Frames are independent, the parallel pass must be bit identical to the serial one
+    const array<int, 3> segRatios { 40, 40, 20 };
+    mitk::PointSet::Pointer pointSet = mitk::IOUtil::Load<mitk::PointSet>((QFINDTESTDATA(CemrgTestData::strainPath) + "/PointSet.mps").toStdString());
+    mitk::DataNode::Pointer lmNode = mitk::DataNode::New();
+    lmNode->SetData(pointSet);
+
+    CemrgStrains serialStrains(QFINDTESTDATA(CemrgTestData::strainPath), 0);
+    serialStrains.ReferenceAHA(lmNode, (int*)segRatios.data(), false);
+    serialStrains.SetNumberOfThreads(1);
+    CemrgStrainSeries serial = serialStrains.CalculateAllPlots(strainFrames, lmNode);
+
+    CemrgStrains parallelStrains(QFINDTESTDATA(CemrgTestData::strainPath), 0);
+    parallelStrains.ReferenceAHA(lmNode, (int*)segRatios.data(), false);
+    parallelStrains.SetNumberOfThreads(threads);
+    CemrgStrainSeries parallel = parallelStrains.CalculateAllPlots(strainFrames, lmNode);
+
+    QCOMPARE(serial.numberOfFrames, strainFrames);
+    QVERIFY(serial.numberOfCells > 0);
+    QCOMPARE(parallel.numberOfFrames, serial.numberOfFrames);
+    QCOMPARE(parallel.numberOfCells, serial.numberOfCells);
+    QVERIFY(parallel.segments == serial.segments);
+    QVERIFY(parallel.cells == serial.cells);
+}
+
+void TestCemrgStrains::StrainSeriesMatchesPlots_data() {
+    QTest::addColumn<int>("meshNo");
+    QTest::addColumn<mitk::DataNode::Pointer>("lmNode");
+
+    // Preparation for tests
+    mitk::DataNode::Pointer lmNode = ReferenceAHA();
+
+    for (int i = 0; i < strainFrames; i++)
+        QTest::newRow(("Test " + to_string(i + 1)).c_str()) << i << lmNode;
+}
+
+void TestCemrgStrains::StrainSeriesMatchesPlots() {
+    QFETCH(int, meshNo);
+    QFETCH(mitk::DataNode::Pointer, lmNode);
+
+    CemrgStrainSeries series = cemrgStrains->CalculateAllPlots(strainFrames, lmNode);
+    QCOMPARE(series.numberOfFrames, strainFrames);
+
+    // Each plot flag and the squeeze against the per frame call, and the flat surface scalars it leaves behind
+    const int numberOfFlags = 5;
+    for (int flag = 0; flag <= numberOfFlags; flag++) {
+        int component = (flag < numberOfFlags) ? CemrgStrains::FlagComponent(flag) : (int)CemrgStrains::SQUEEZE;
+        vector<double> plot = (flag < numberOfFlags) ?
+            cemrgStrains->CalculateStrainsPlot(meshNo, lmNode, flag) : cemrgStrains->CalculateSqzPlot(meshNo);
+
+        vector<double> values = series.GetSegmentValues(meshNo, component);
+        QCOMPARE(values.size(), plot.size());
+        QVERIFY(equal(begin(plot), end(plot), begin(values), FuzzyCompare));
+        for (int i = 0; i < 16; i++)
+            QCOMPARE(series.Get(meshNo, i, component), values[i]);
+
+        vtkSmartPointer<vtkFloatArray> cells = series.GetCellValues(meshNo, component);
+        vtkSmartPointer<vtkFloatArray> scalars = cemrgStrains->GetFlatSurfScalars();
+        QCOMPARE(cells->GetNumberOfTuples(), (vtkIdType)series.numberOfCells);
+        QCOMPARE(scalars->GetNumberOfTuples(), cells->GetNumberOfTuples());
+        for (vtkIdType i = 0; i < cells->GetNumberOfTuples(); i++)
+            QVERIFY(FuzzyCompare(cells->GetValue(i), scalars->GetValue(i)));
+    }//_for
+
+    // Out of range frames give empty values
+    QVERIFY(series.GetSegmentValues(strainFrames, 0).empty());
+    QCOMPARE(series.GetCellValues(-1, 0)->GetNumberOfTuples(), (vtkIdType)0);
+}
+
 int CemrgStrainsTest(int argc, char *argv[]) {
     QCoreApplication app(argc, argv);
     app.setAttribute(Qt::AA_Use96Dpi, true);
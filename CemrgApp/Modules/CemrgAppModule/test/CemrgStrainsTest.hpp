@@ -26,9 +26,13 @@ PURPOSE.  See the above copyright notices for more information.
  *
 =========================================================================*/
 
+// Qt
+#include <QTemporaryDir>
+
 // CemrgApp
 #include "CemrgTestCommon.hpp"
 #include <CemrgStrains.h>
+#include <CemrgMeshSequence.h>
 
 using namespace std;
 
@@ -41,6 +45,10 @@ private:
 
     // Used for preparation of multiple tests
     mitk::DataNode::Pointer ReferenceAHA(const array<int, 3>& segRatios = { 40, 40, 20 }, bool pacingSite = false);
+    // Copies the test frames into a folder of the temporary directory
+    QString CopyStrainFrames(QString folder);
+
+    QTemporaryDir tmpDir;
 
 private slots:
     void initTestCase();
@@ -60,6 +68,18 @@ private slots:
 
     void ReferenceGuideLines_data();
     void ReferenceGuideLines();
+
+    void MeshSequenceRoundTrip_data();
+    void MeshSequenceRoundTrip();
+    void MeshSequenceDeltaEncoding();
+    void MeshSequenceCorruptHeader();
+    void MeshSequenceStaleFile();
+    void MeshSequenceFrameArrays();
+
+    void CalculateAllPlotsParallel_data();
+    void CalculateAllPlotsParallel();
+    void StrainSeriesMatchesPlots_data();
+    void StrainSeriesMatchesPlots();
 };
 
 Q_DECLARE_METATYPE(vector<double>)
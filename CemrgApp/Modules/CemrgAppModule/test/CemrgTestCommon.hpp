@@ -64,4 +64,8 @@ struct CemrgTestData {
     static constexpr size_t strainDataSize = 2;
 
     static constexpr const char *cmdLinePath = "Data/CommandLine";
+
+    static constexpr const char *gapManifestPath = "Data/GapMeasurement/manifest.txt";
+
+    static constexpr const char *scar3DPath = "Data/Scar3D";
 };
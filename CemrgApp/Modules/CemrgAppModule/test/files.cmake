@@ -1,6 +1,9 @@
 set(MOC_H_FILES
   CemrgCommandLineTest.hpp
   CemrgMeasureTest.hpp
+  CemrgPowerTest.hpp
+  CemrgScar3DTest.hpp
+  CemrgScarAdvancedTest.hpp
   CemrgStrainsTest.hpp
 )
 
@@ -11,6 +14,9 @@ set(CPP_FILES
 set(MODULE_TESTS
   CemrgCommandLineTest.cpp
   CemrgMeasureTest.cpp
+  CemrgPowerTest.cpp
+  CemrgScar3DTest.cpp
+  CemrgScarAdvancedTest.cpp
   CemrgStrainsTest.cpp
 )
 
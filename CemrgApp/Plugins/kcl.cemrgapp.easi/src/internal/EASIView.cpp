@@ -600,10 +600,16 @@ void EASIView::Simulation() {
                 std::vector<std::vector<double>> plotValueVectorsCRC;
                 std::vector<std::vector<double>> plotValueVectorsLNG;
 
+                //Squeeze and both strains of every frame from one read of each mesh
+                CemrgStrainSeries series = strain1->CalculateAllPlots(10, lmNode);
+                if (series.numberOfFrames != 10) {
+                    MITK_WARN << "Could not read the tracked meshes in " << directory.toStdString();
+                    continue;
+                }
                 for (int j = 0; j < 10; j++) {
-                    plotValueVectorsSQZ.push_back(strain1->CalculateSqzPlot(j));
-                    plotValueVectorsCRC.push_back(strain1->CalculateStrainsPlot(j, lmNode, 3));
-                    plotValueVectorsLNG.push_back(strain1->CalculateStrainsPlot(j, lmNode, 4));
+                    plotValueVectorsSQZ.push_back(series.GetSegmentValues(j, CemrgStrains::SQUEEZE));
+                    plotValueVectorsCRC.push_back(series.GetSegmentValues(j, CemrgStrains::CIRCUMFERENTIAL_LARGE));
+                    plotValueVectorsLNG.push_back(series.GetSegmentValues(j, CemrgStrains::LONGITUDINAL_LARGE));
                 }
 
                 for (int j = 0; j < 3; j++) {
@@ -70,6 +70,7 @@ PURPOSE.  See the above copyright notices for more information.
 // CemrgAppModule
 #include <CemrgCommandLine.h>
 #include <CemrgCommonUtils.h>
+#include <CemrgMeshSequence.h>
 
 const std::string MmcwView::VIEW_ID = "org.mitk.views.mmcw";
 
@@ -859,6 +860,12 @@ void MmcwView::Demoings() {
 
     this->BusyCursorOn();
     mitk::ProgressBar::GetInstance()->AddStepsToDo(timePoints);
+    CemrgMeshSequence sequence;
+    sequence.SetDirectory(directory);
+
+    //The sequence file keeps points and triangles only, frames with arrays are read from the VTK files
+    bool useSequence = sequence.IsMapped() && !sequence.FramesHaveArrays();
+    MITK_INFO(sequence.IsMapped() && !useSequence) << "The mesh frames carry point or cell arrays, reading the VTK frames instead of the mesh sequence.";
 
     for (int tS = 0; tS < timePoints; tS++) {
 
@@ -872,9 +879,14 @@ void MmcwView::Demoings() {
         }//_if
         img4D->SetVolume(mitk::ImageReadAccessor(img3D).GetData(), tS);
 
-        //Mesh
-        path = directory + "/transformed-" + QString::number(tS) + ".vtk";
-        sur3D = CemrgCommonUtils::LoadVTKMesh(path.toStdString());
+        //Mesh, from the binary sequence when the folder has one
+        if (useSequence && sequence.LoadFrame(tS)) {
+            sur3D = mitk::Surface::New();
+            sur3D->SetVtkPolyData(sequence.GetPolyData(tS));
+        } else {
+            path = directory + "/transformed-" + QString::number(tS) + ".vtk";
+            sur3D = CemrgCommonUtils::LoadVTKMesh(path.toStdString());
+        }//_if
         sur4D->SetVtkPolyData(sur3D->GetVtkPolyData(), tS);
 
         mitk::ProgressBar::GetInstance()->Progress();
@@ -60,6 +60,11 @@ PURPOSE.  See the above copyright notices for more information.
 #include <QFileDialog>
 #include <QInputDialog>
 #include <QSignalMapper>
+#include <QCoreApplication>
+
+// C++ Standard
+#include <chrono>
+#include <future>
 
 QString MmcwViewPlot::directory;
 int MmcwViewPlot::noFrames = 10;
@@ -207,54 +212,44 @@ void MmcwViewPlot::PlotData() {
     plotValueVectors.clear();
     std::string plotType = m_Controls.comboBox->currentText().toStdString();
 
+    int component = -1;
+    int* ratios = segRatios;
+    bool pacingSite = false;
     if (plotType.compare("Area Change") == 0) {
-        refSurf = strain->ReferenceAHA(lmNode, segRatios, false);
-        for (int i = 0; i < noFrames * smoothness; i++) {
-            plotValueVectors.push_back(strain->CalculateSqzPlot(i));
-            vtkSmartPointer<vtkFloatArray> holder = vtkSmartPointer<vtkFloatArray>::New();
-            holder->DeepCopy(strain->GetFlatSurfScalars());
-            flatPlotScalars.push_back(holder);
-        }
+        component = CemrgStrains::SQUEEZE;
     } else if (plotType.compare("Circumferential Small Strain") == 0) {
-        refSurf = strain->ReferenceAHA(lmNode, segRatios, false);
-        for (int i = 0; i < noFrames * smoothness; i++) {
-            plotValueVectors.push_back(strain->CalculateStrainsPlot(i, lmNode, 1));
-            vtkSmartPointer<vtkFloatArray> holder = vtkSmartPointer<vtkFloatArray>::New();
-            holder->DeepCopy(strain->GetFlatSurfScalars());
-            flatPlotScalars.push_back(holder);
-        }
+        component = CemrgStrains::CIRCUMFERENTIAL_SMALL;
     } else if (plotType.compare("Circumferential Large Strain") == 0) {
-        refSurf = strain->ReferenceAHA(lmNode, segRatios, false);
-        for (int i = 0; i < noFrames * smoothness; i++) {
-            plotValueVectors.push_back(strain->CalculateStrainsPlot(i, lmNode, 3));
-            vtkSmartPointer<vtkFloatArray> holder = vtkSmartPointer<vtkFloatArray>::New();
-            holder->DeepCopy(strain->GetFlatSurfScalars());
-            flatPlotScalars.push_back(holder);
-        }
+        component = CemrgStrains::CIRCUMFERENTIAL_LARGE;
     } else if (plotType.compare("Longitudinal Small Strain") == 0) {
-        refSurf = strain->ReferenceAHA(lmNode, segRatios, false);
-        for (int i = 0; i < noFrames * smoothness; i++) {
-            plotValueVectors.push_back(strain->CalculateStrainsPlot(i, lmNode, 2));
-            vtkSmartPointer<vtkFloatArray> holder = vtkSmartPointer<vtkFloatArray>::New();
-            holder->DeepCopy(strain->GetFlatSurfScalars());
-            flatPlotScalars.push_back(holder);
-        }
+        component = CemrgStrains::LONGITUDINAL_SMALL;
     } else if (plotType.compare("Longitudinal Large Strain") == 0) {
-        refSurf = strain->ReferenceAHA(lmNode, segRatios, false);
-        for (int i = 0; i < noFrames * smoothness; i++) {
-            plotValueVectors.push_back(strain->CalculateStrainsPlot(i, lmNode, 4));
-            vtkSmartPointer<vtkFloatArray> holder = vtkSmartPointer<vtkFloatArray>::New();
-            holder->DeepCopy(strain->GetFlatSurfScalars());
-            flatPlotScalars.push_back(holder);
-        }
+        component = CemrgStrains::LONGITUDINAL_LARGE;
     } else if (plotType.compare("Pacing site Squeez") == 0) {
-        refSurf = strain->ReferenceAHA(lmNode, pacingSegRatios, true);
+        component = CemrgStrains::SQUEEZE;
+        ratios = pacingSegRatios;
+        pacingSite = true;
+    }//_if
+
+    if (component >= 0) {
+        //All frames in one pass, each mesh is read once
+        refSurf = strain->ReferenceAHA(lmNode, ratios, pacingSite);
+        //Frames run on worker threads while the view keeps repainting
+        std::future<CemrgStrainSeries> pending = std::async(
+            std::launch::async, &CemrgStrains::CalculateAllPlots, strain.get(), noFrames * smoothness, lmNode);
+        while (pending.wait_for(std::chrono::milliseconds(100)) != std::future_status::ready)
+            QCoreApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
+        CemrgStrainSeries series = pending.get();
+        if (series.numberOfFrames != noFrames * smoothness) {
+            QMessageBox::warning(NULL, "Attention", "Could not read all the tracked meshes of the sequence!");
+            this->BusyCursorOff();
+            mitk::ProgressBar::GetInstance()->Progress();
+            return;
+        }//_if
         for (int i = 0; i < noFrames * smoothness; i++) {
-            plotValueVectors.push_back(strain->CalculateSqzPlot(i));
-            vtkSmartPointer<vtkFloatArray> holder = vtkSmartPointer<vtkFloatArray>::New();
-            holder->DeepCopy(strain->GetFlatSurfScalars());
-            flatPlotScalars.push_back(holder);
-        }
+            plotValueVectors.push_back(series.GetSegmentValues(i, component));
+            flatPlotScalars.push_back(series.GetCellValues(i, component));
+        }//_for
     }//_if
 
     //Visualise AHA plots
@@ -716,11 +716,14 @@ void powertransView::CalculatePower() {
             this->BusyCursorOn();
             mitk::ProgressBar::GetInstance()->AddStepsToDo(1);
             power = std::unique_ptr<CemrgPower>(new CemrgPower(directory, ribSpacing));
-            // mitk::Surface::Pointer outputEndoMesh = power->CalculateAcousticIntensity(surface);
-            // Load in mesh
-            //AddToStorage("PowerMap", outputEndoMesh);
+            mitk::Surface::Pointer outputEndoMesh = power->CalculateAcousticIntensity(surface);
             mitk::ProgressBar::GetInstance()->Progress();
             this->BusyCursorOff();
+            if (outputEndoMesh.IsNull()) {
+                QMessageBox::warning(NULL, "Attention", "Was unable to calculate power, please map the power transmitter for this rib spacing first!");
+                return;
+            }//_if
+            CemrgCommonUtils::AddToStorage(outputEndoMesh, "PowerMap", this->GetDataStorage());
 
         } else {
             QMessageBox::warning(NULL, "Attention", "Please select input mesh from the Data Manager to calculate power!");
@@ -748,6 +748,11 @@ void AtrialScarView::AutomaticAnalysis() {
             mitk::IOUtil::Save(mitk::ImportItkImage(segITK), (direct + "/PVeinsCroppedImage.nii").toStdString());
             scar->SetScarSegImage(mitk::ImportItkImage(segITK));
             mitk::Surface::Pointer scarShell = scar->Scar3D(direct.toStdString(), mitk::ImportItkImage(lgeITK));
+            if (scarShell.IsNull()) {
+                timerLog->StopTimer();
+                QMessageBox::warning(NULL, "Attention", "Error with the scar projection! Check the LOG file.");
+                return;
+            }//_if
             MITK_INFO << "[...][10.1] Converting cell to point data";
             vtkSmartPointer<vtkCellDataToPointData> cell_to_point = vtkSmartPointer<vtkCellDataToPointData>::New();
             cell_to_point->SetInputData(scarShell->GetVtkPolyData());
@@ -775,17 +780,26 @@ void AtrialScarView::AutomaticAnalysis() {
             ImageType::Pointer lgeFloat = ImageType::New();
             mitk::CastToItkImage(mitk::IOUtil::Load<mitk::Image>(lgePath.toStdString()), lgeFloat);
             double mean = 0.0, stdv = 0.0;
-            scar->CalculateMeanStd(mitk::ImportItkImage(lgeFloat), roiImage, mean, stdv);
+            if (!scar->CalculateMeanStd(mitk::ImportItkImage(lgeFloat), roiImage, mean, stdv)) {
+                timerLog->StopTimer();
+                MITK_WARN << "[AUTOMATIC_ANALYSIS][11] Thresholding aborted, blood pool statistics unavailable";
+                QMessageBox::warning(NULL, "Attention", "Mean and std of the blood pool could not be calculated! Thresholding was skipped, check the LOG file.");
+                return;
+            }//_if
             MITK_INFO << "[...][11.1] Creating Scar map normalised by Mean blood pool.";
             QString prodPath = direct + "/";
             scar->SaveNormalisedScalars(mean, scarShell, (prodPath + "MaxScar_Normalised.vtk"));
             MITK_INFO << "[...][11.2] Saving to files.";
             ofstream prodFile1, prodFileExplanation;
             prodFile1.open((prodPath + "prodThresholds.txt").toStdString());
+            std::vector<double> thresholds;
+            for (unsigned int ix = 0; ix < values_vector.size(); ix++)
+                thresholds.push_back((threshType == 1) ? mean * values_vector.at(ix) : mean + values_vector.at(ix) * stdv);
+            std::vector<double> percentages = scar->ThresholdingCurve(thresholds);
             for (unsigned int ix = 0; ix < values_vector.size(); ix++) {
                 double thisValue = values_vector.at(ix);
-                double thisThresh = (threshType == 1) ? mean * thisValue : mean + thisValue * stdv;
-                double thisPercentage = scar->Thresholding(thisThresh);
+                double thisThresh = thresholds.at(ix);
+                double thisPercentage = percentages.at(ix);
                 prodFile1 << thisValue << "\n";
                 prodFile1 << threshType << "\n";
                 prodFile1 << mean << "\n";
@@ -1520,6 +1534,13 @@ void AtrialScarView::ScarMap() {
                     //Projection
                     scar->SetScarSegImage(scarSegImg);
                     mitk::Surface::Pointer shell = scar->Scar3D(directory.toStdString(), image);
+                    if (shell.IsNull()) {
+                        QMessageBox::critical(NULL, "Attention", "The scar projection failed! Check the LOG file.");
+                        mitk::ProgressBar::GetInstance()->Progress();
+                        this->BusyCursorOff();
+                        inputs->deleteLater();
+                        return;
+                    }//_if
                     mitk::DataNode::Pointer node = CemrgCommonUtils::AddToStorage(shell, (meType + "Scar3D").toStdString(), this->GetDataStorage());
 
                     MITK_INFO << "Saving debug scar map labels.";
@@ -1648,8 +1669,10 @@ void AtrialScarView::Threshold() {
 
                 //Calculate mean, std of ROI
                 bool success = scar->CalculateMeanStd(lgeImage, roiImage, mean, stdv);
-                if (!success)
+                if (!success) {
+                    QMessageBox::critical(NULL, "Attention", "The mean and std of the ROI could not be calculated!");
                     return;
+                }//_if
 
             } else {
                 QMessageBox::warning(NULL, "Attention", "The scar map from the previous step has not been generated!");
@@ -1700,7 +1723,11 @@ void AtrialScarView::Threshold() {
          * End Test
          **/
 
-        if (scar) percentage = scar->Thresholding(thresh);
+        if (scar) {
+            percentage = scar->Thresholding(thresh);
+            //Threshold versus percentage curve for plotting outside the view
+            scar->SaveHistogramCsv(prodPath + "prodHistogram.csv");
+        }//_if
         std::ostringstream os;
         os << std::fixed << std::setprecision(2) << percentage;
         QString message = "The percentage scar is " + QString::fromStdString(os.str()) + "% of total segmented volume.";
@@ -877,6 +877,7 @@ void ScarCalculationsView::GapMeasurement() {
             std::string lrpre = m_UICorridor.rb_left->isChecked() ? "left_" : "right_";
 
             csadv->SetWeightedCorridorBool(m_UICorridor.checkBox_weighted->isChecked());
+            csadv->SetCorridorVtpBool(m_UICorridor.checkBox_vtp->isChecked());
 
             if (!ok1) { //Set default values
                 QMessageBox::warning(NULL, "Attention", "Using default thickness!");
@@ -888,8 +889,10 @@ void ScarCalculationsView::GapMeasurement() {
             csadv->SetNeighbourhoodSize(thickness);
             csadv->SetLeftRightPrefix(lrpre);
             csadv->CorridorFromPointList(v);
-            if (m_Controls.fandi_t2_visualise->findText(QString::fromStdString(csadv->GetPrefix()) + "exploration_scalars") == -1)
-                m_Controls.fandi_t2_visualise->addItem(QString::fromStdString(csadv->GetPrefix()) + "exploration_scalars");
+            // The .vtp holds the scalars of the corridor as its active array
+            QString explorationName = QString::fromStdString(csadv->GetPrefix()) + (m_UICorridor.checkBox_vtp->isChecked() ? "exploration" : "exploration_scalars");
+            if (m_Controls.fandi_t2_visualise->findText(explorationName) == -1)
+                m_Controls.fandi_t2_visualise->addItem(explorationName);
             csadv->ClearLeftRightPrefix();
             this->dijkstraActors = csadv->GetPathsMappersAndActors();
 
@@ -927,6 +930,8 @@ void ScarCalculationsView::GapMeasurementVisualisation(const QString& text) {
         MITK_INFO << ("Current text: " + cb).toStdString();
         QString prodPath = ScarCalculationsView::advdir + "/";
         QFileInfo fi(prodPath + cb + ".vtk");
+        if (!fi.exists())
+            fi.setFile(prodPath + cb + ".vtp");
         MITK_INFO << ("Changing to file" + fi.absoluteFilePath()).toStdString();
 
         if (fi.exists()) {
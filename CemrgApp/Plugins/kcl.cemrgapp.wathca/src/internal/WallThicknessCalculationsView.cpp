@@ -650,10 +650,11 @@ void WallThicknessCalculationsView::MorphologyAnalysis() {
 
                 //Volume and surface calculations
                 std::unique_ptr<CemrgMeasure> morphAnal = std::unique_ptr<CemrgMeasure>(new CemrgMeasure());
-                double surfceLA = morphAnal->calcSurfaceMesh(surfLA);
-                double volumeLA = morphAnal->calcVolumeMesh(surfLA);
-                double surfceAP = morphAnal->calcSurfaceMesh(surfAP);
-                double volumeAP = morphAnal->calcVolumeMesh(surfAP);
+                std::vector<CemrgMeasure::Morphology> morphs = morphAnal->GetMorphology({surfLA, surfAP});
+                double surfceLA = morphs[0].surfaceArea;
+                double volumeLA = morphs[0].volume;
+                double surfceAP = morphs[1].surfaceArea;
+                double volumeAP = morphs[1].volume;
 
                 //Store in text file
                 ofstream morphResult;